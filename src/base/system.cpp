@@ -28,6 +28,7 @@
 #if defined(CONF_FAMILY_UNIX)
 #include <csignal>
 #include <locale>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/utsname.h>
@@ -111,6 +112,18 @@ void net_buffer_init(NETSOCKET_BUFFER *buffer);
 void net_buffer_reinit(NETSOCKET_BUFFER *buffer);
 void net_buffer_simple(NETSOCKET_BUFFER *buffer, char **buf, int *size);
 
+#ifdef CONF_PLATFORM_LINUX
+typedef struct
+{
+	int num;
+	int fds[VLEN];
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovecs[VLEN];
+	char bufs[VLEN][PACKETSIZE];
+	sockaddr_storage sockaddrs[VLEN];
+} NETSOCKET_SEND_BUFFER;
+#endif
+
 struct NETSOCKET_INTERNAL
 {
 	int type;
@@ -120,6 +133,9 @@ struct NETSOCKET_INTERNAL
 	int web_ipv6sock;
 
 	NETSOCKET_BUFFER buffer;
+#ifdef CONF_PLATFORM_LINUX
+	NETSOCKET_SEND_BUFFER *send_buffer;
+#endif
 };
 static NETSOCKET_INTERNAL invalid_socket = {NETTYPE_INVALID, -1, -1, -1, -1};
 
@@ -440,6 +456,37 @@ int io_error(IOHANDLE io)
 	return ferror((FILE *)io);
 }
 
+void *io_map(IOHANDLE io, int64_t size)
+{
+	if(size <= 0 || (uint64_t)size > SIZE_MAX)
+	{
+		return nullptr;
+	}
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE mapping = CreateFileMappingW((HANDLE)_get_osfhandle(_fileno((FILE *)io)), nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if(mapping == nullptr)
+	{
+		return nullptr;
+	}
+	void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, size);
+	// the view keeps the mapping alive
+	CloseHandle(mapping);
+	return data;
+#else
+	void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno((FILE *)io), 0);
+	return data == MAP_FAILED ? nullptr : data;
+#endif
+}
+
+void io_unmap(void *data, int64_t size)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 IOHANDLE io_stdin()
 {
 	return stdin;
@@ -1548,6 +1595,10 @@ static void priv_net_close_all_sockets(NETSOCKET sock)
 	}
 #endif
 
+#if defined(CONF_PLATFORM_LINUX)
+	free(sock->send_buffer);
+#endif
+
 	free(sock);
 }
 
@@ -1754,6 +1805,9 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 {
 	int d = -1;
 
+	// keep the order of the packets
+	net_udp_flush(sock);
+
 	if(addr->type & NETTYPE_IPV4)
 	{
 		if(sock->ipv4sock >= 0)
@@ -1853,6 +1907,89 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 	return d;
 }
 
+int net_udp_send_batch(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	// everything that is not a plain packet to a single address is sent directly
+	int fd = -1;
+	if(addr->type == NETTYPE_IPV4)
+		fd = sock->ipv4sock;
+	else if(addr->type == NETTYPE_IPV6)
+		fd = sock->ipv6sock;
+	if(fd < 0 || size > PACKETSIZE)
+		return net_udp_send(sock, addr, data, size);
+
+	if(!sock->send_buffer)
+	{
+		sock->send_buffer = (NETSOCKET_SEND_BUFFER *)calloc(1, sizeof(*sock->send_buffer));
+		for(int i = 0; i < VLEN; ++i)
+		{
+			sock->send_buffer->iovecs[i].iov_base = sock->send_buffer->bufs[i];
+			sock->send_buffer->msgs[i].msg_hdr.msg_iov = &(sock->send_buffer->iovecs[i]);
+			sock->send_buffer->msgs[i].msg_hdr.msg_iovlen = 1;
+			sock->send_buffer->msgs[i].msg_hdr.msg_name = &(sock->send_buffer->sockaddrs[i]);
+		}
+	}
+	else if(sock->send_buffer->num == VLEN)
+	{
+		net_udp_flush(sock);
+	}
+
+	NETSOCKET_SEND_BUFFER *buffer = sock->send_buffer;
+	const int i = buffer->num++;
+	buffer->fds[i] = fd;
+	if(addr->type == NETTYPE_IPV4)
+	{
+		netaddr_to_sockaddr_in(addr, (sockaddr_in *)&buffer->sockaddrs[i]);
+		buffer->msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+	}
+	else
+	{
+		netaddr_to_sockaddr_in6(addr, (sockaddr_in6 *)&buffer->sockaddrs[i]);
+		buffer->msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+	}
+	mem_copy(buffer->bufs[i], data, size);
+	buffer->iovecs[i].iov_len = size;
+
+	network_stats.sent_bytes += size;
+	network_stats.sent_packets++;
+	return size;
+#else
+	return net_udp_send(sock, addr, data, size);
+#endif
+}
+
+void net_udp_flush(NETSOCKET sock)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	NETSOCKET_SEND_BUFFER *buffer = sock->send_buffer;
+	if(!buffer)
+		return;
+
+	// one sendmmsg call for each run of packets that use the same socket
+	int start = 0;
+	while(start < buffer->num)
+	{
+		int end = start + 1;
+		while(end < buffer->num && buffer->fds[end] == buffer->fds[start])
+			end++;
+
+		while(start < end)
+		{
+			const int sent = sendmmsg(buffer->fds[start], &buffer->msgs[start], end - start, 0);
+			if(sent <= 0)
+			{
+				// drop the packet that could not be sent, like sendto does
+				start++;
+				continue;
+			}
+			start += sent;
+		}
+	}
+	buffer->num = 0;
+#endif
+}
+
 void net_buffer_init(NETSOCKET_BUFFER *buffer)
 {
 #if defined(CONF_PLATFORM_LINUX)
@@ -1997,6 +2134,7 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, unsigned char **data)
 
 void net_udp_close(NETSOCKET sock)
 {
+	net_udp_flush(sock);
 	priv_net_close_all_sockets(sock);
 }
 
@@ -430,6 +430,34 @@ int io_sync(IOHANDLE io);
  */
 int io_error(IOHANDLE io);
 
+/**
+ * Maps the start of a file into memory. Pages are shared with the page cache
+ * until they are written to, writes are private and never reach the file.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to the file.
+ * @param size Number of bytes to map, must not exceed the file length.
+ *
+ * @return Pointer to the mapped data, or `nullptr` on failure.
+ *
+ * @remark The mapping stays valid after the file is closed. Accessing it
+ * after the file was truncated by another process crashes the program.
+ *
+ * @see io_unmap
+ */
+void *io_map(IOHANDLE io, int64_t size);
+
+/**
+ * Unmaps data mapped with @link io_map @endlink.
+ *
+ * @ingroup File-IO
+ *
+ * @param data Pointer returned by @link io_map @endlink.
+ * @param size Size that was passed to @link io_map @endlink.
+ */
+void io_unmap(void *data, int64_t size);
+
 /**
  * Returns a handle for the standard input.
  *
@@ -1015,6 +1043,33 @@ NETSOCKET net_udp_create(NETADDR bindaddr);
  */
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size);
 
+/**
+ * Queues a packet to be sent over an UDP socket. Queued packets are sent
+ * together with @link net_udp_flush @endlink, when the queue is full or
+ * before the next packet that is sent with @link net_udp_send @endlink.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ * @param addr Where to send the packet.
+ * @param data Pointer to the packet data to send, it is copied.
+ * @param size Size of the packet.
+ *
+ * @return On success it returns the number of bytes queued or sent. Returns `-1` on error.
+ *
+ * @remark Packets are only queued on Linux, where they are sent with `sendmmsg`. Elsewhere they are sent directly.
+ */
+int net_udp_send_batch(NETSOCKET sock, const NETADDR *addr, const void *data, int size);
+
+/**
+ * Sends all packets that were queued with @link net_udp_send_batch @endlink.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ */
+void net_udp_flush(NETSOCKET sock);
+
 /**
  * Receives a packet over an UDP socket.
  *
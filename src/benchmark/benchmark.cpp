@@ -0,0 +1,407 @@
+#include "benchmark.h"
+
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/jsonwriter.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/version.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static const char *BENCHMARK_NAME = "benchmark";
+
+// Counts heap allocations for the benchmarks. All other forms of new and
+// delete without alignment forward to these.
+static std::atomic<int64_t> gs_Allocations{0};
+
+void *operator new(std::size_t Size)
+{
+	gs_Allocations.fetch_add(1, std::memory_order_relaxed);
+	void *pMem = malloc(Size > 0 ? Size : 1);
+	dbg_assert(pMem != nullptr, "out of memory");
+	return pMem;
+}
+
+void operator delete(void *pMem) noexcept
+{
+	free(pMem);
+}
+
+void operator delete(void *pMem, std::size_t Size) noexcept
+{
+	free(pMem);
+}
+
+CBenchmarkState::CBenchmarkState(int64_t Iterations) :
+	m_Iterations(Iterations)
+{
+	m_aError[0] = '\0';
+}
+
+void CBenchmarkState::StartTimer()
+{
+	m_Start = time_get_nanoseconds();
+	m_AllocationsStart = gs_Allocations.load(std::memory_order_relaxed);
+}
+
+void CBenchmarkState::StopTimer()
+{
+	if(!m_Paused)
+	{
+		m_Elapsed += time_get_nanoseconds() - m_Start;
+		m_Allocations += gs_Allocations.load(std::memory_order_relaxed) - m_AllocationsStart;
+	}
+	m_Paused = true;
+}
+
+void CBenchmarkState::PauseTiming()
+{
+	dbg_assert(!m_Paused, "benchmark timing paused twice");
+	m_Elapsed += time_get_nanoseconds() - m_Start;
+	m_Allocations += gs_Allocations.load(std::memory_order_relaxed) - m_AllocationsStart;
+	m_Paused = true;
+}
+
+void CBenchmarkState::ResumeTiming()
+{
+	dbg_assert(m_Paused, "benchmark timing resumed without pausing");
+	m_Paused = false;
+	StartTimer();
+}
+
+void CBenchmarkState::SkipWithError(const char *pError)
+{
+	str_copy(m_aError, pError);
+	m_Iterations = 0;
+}
+
+class CBenchmarkInfo
+{
+public:
+	char m_aName[128];
+	FBenchmark m_pfnBenchmark;
+};
+
+static std::vector<CBenchmarkInfo> &Benchmarks()
+{
+	static std::vector<CBenchmarkInfo> s_vBenchmarks;
+	return s_vBenchmarks;
+}
+
+CBenchmarkRegistration::CBenchmarkRegistration(const char *pGroup, const char *pName, FBenchmark pfnBenchmark)
+{
+	CBenchmarkInfo Info;
+	str_format(Info.m_aName, sizeof(Info.m_aName), "%s.%s", pGroup, pName);
+	Info.m_pfnBenchmark = pfnBenchmark;
+	Benchmarks().push_back(Info);
+}
+
+static IStorage *gs_pStorage = nullptr;
+
+IStorage *BenchmarkStorage()
+{
+	return gs_pStorage;
+}
+
+CBenchmarkMap::CBenchmarkMap() = default;
+
+CBenchmarkMap::~CBenchmarkMap()
+{
+	// the collision points into the map data
+	m_pCollision = nullptr;
+	m_pLayers = nullptr;
+	m_pKernel = nullptr;
+}
+
+bool CBenchmarkMap::Load(const char *pMapName)
+{
+	m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+	m_pKernel->RegisterInterface(BenchmarkStorage(), false);
+	IEngineMap *pMap = CreateEngineMap();
+	m_pKernel->RegisterInterface(pMap);
+
+	char aFilename[IO_MAX_PATH_LENGTH];
+	str_format(aFilename, sizeof(aFilename), "maps/%s.map", pMapName);
+	if(!pMap->Load(aFilename))
+		return false;
+
+	m_pLayers = std::make_unique<CLayers>();
+	m_pLayers->Init(pMap, true);
+	m_pCollision = std::make_unique<CCollision>();
+	m_pCollision->Init(m_pLayers.get());
+	return true;
+}
+
+class CBenchmarkResult
+{
+public:
+	const CBenchmarkInfo *m_pInfo;
+	char m_aError[256];
+	int64_t m_Iterations = 0;
+	int64_t m_BytesPerIteration = 0;
+	int64_t m_ItemsPerIteration = 0;
+	// highest of all repetitions
+	double m_AllocationsPerIteration = 0.0;
+	// nanoseconds per iteration of each repetition
+	std::vector<double> m_vSamples;
+
+	double Min() const { return *std::min_element(m_vSamples.begin(), m_vSamples.end()); }
+	double Max() const { return *std::max_element(m_vSamples.begin(), m_vSamples.end()); }
+	double Median() const
+	{
+		std::vector<double> vSorted = m_vSamples;
+		std::sort(vSorted.begin(), vSorted.end());
+		const size_t Middle = vSorted.size() / 2;
+		return vSorted.size() % 2 ? vSorted[Middle] : (vSorted[Middle - 1] + vSorted[Middle]) / 2;
+	}
+	double Mean() const
+	{
+		double Sum = 0.0;
+		for(double Sample : m_vSamples)
+			Sum += Sample;
+		return Sum / m_vSamples.size();
+	}
+};
+
+class CBenchmarkOptions
+{
+public:
+	const char *m_pFilter = "";
+	const char *m_pJsonFile = nullptr;
+	std::chrono::nanoseconds m_MinTime = std::chrono::milliseconds(200);
+	int m_Repetitions = 5;
+	bool m_List = false;
+};
+
+static bool RunOnce(const CBenchmarkInfo &Info, int64_t Iterations, CBenchmarkResult &Result, std::chrono::nanoseconds &Elapsed, int64_t &Allocations)
+{
+	CBenchmarkState State(Iterations);
+	Info.m_pfnBenchmark(State);
+	if(State.Failed())
+	{
+		str_copy(Result.m_aError, State.Error());
+		return false;
+	}
+	if(State.IterationsDone() != Iterations || State.Elapsed() <= std::chrono::nanoseconds::zero())
+	{
+		str_copy(Result.m_aError, "benchmark did not run its loop");
+		return false;
+	}
+	Result.m_BytesPerIteration = State.BytesPerIteration();
+	Result.m_ItemsPerIteration = State.ItemsPerIteration();
+	Elapsed = State.Elapsed();
+	Allocations = State.Allocations();
+	return true;
+}
+
+static CBenchmarkResult RunBenchmark(const CBenchmarkInfo &Info, const CBenchmarkOptions &Options)
+{
+	CBenchmarkResult Result;
+	Result.m_pInfo = &Info;
+	Result.m_aError[0] = '\0';
+
+	// find the number of iterations that takes at least the minimum time
+	const int64_t MaxIterations = 1000000000;
+	int64_t Iterations = 1;
+	std::chrono::nanoseconds Elapsed;
+	int64_t Allocations;
+	while(true)
+	{
+		if(!RunOnce(Info, Iterations, Result, Elapsed, Allocations))
+			return Result;
+		if(Elapsed >= Options.m_MinTime || Iterations >= MaxIterations)
+			break;
+		// aim a bit above the minimum time, but grow slowly if the
+		// first runs were too short to predict anything
+		double Multiplier = 10.0;
+		if(Elapsed * 10 > Options.m_MinTime)
+			Multiplier = 1.4 * Options.m_MinTime.count() / Elapsed.count();
+		Iterations = std::clamp((int64_t)(Iterations * Multiplier), Iterations + 1, MaxIterations);
+	}
+	Result.m_Iterations = Iterations;
+
+	for(int i = 0; i < Options.m_Repetitions; i++)
+	{
+		if(!RunOnce(Info, Iterations, Result, Elapsed, Allocations))
+		{
+			Result.m_vSamples.clear();
+			return Result;
+		}
+		Result.m_vSamples.push_back((double)Elapsed.count() / Iterations);
+		Result.m_AllocationsPerIteration = maximum(Result.m_AllocationsPerIteration, (double)Allocations / Iterations);
+	}
+	return Result;
+}
+
+static void PrintResult(const CBenchmarkResult &Result)
+{
+	if(Result.m_aError[0])
+	{
+		log_error(BENCHMARK_NAME, "%-40s FAILED: %s", Result.m_pInfo->m_aName, Result.m_aError);
+		return;
+	}
+
+	char aThroughput[64] = "";
+	const double SecondsPerIteration = Result.Median() / 1e9;
+	if(Result.m_BytesPerIteration > 0)
+		str_format(aThroughput, sizeof(aThroughput), "%10.1f MiB/s", Result.m_BytesPerIteration / SecondsPerIteration / (1024.0 * 1024.0));
+	else if(Result.m_ItemsPerIteration > 0)
+		str_format(aThroughput, sizeof(aThroughput), "%10.3f M items/s", Result.m_ItemsPerIteration / SecondsPerIteration / 1e6);
+	log_info(BENCHMARK_NAME, "%-40s %12.1f ns %12.1f ns %12" PRId64 " %12.2f %s", Result.m_pInfo->m_aName, Result.Median(), Result.Min(), Result.m_Iterations, Result.m_AllocationsPerIteration, aThroughput);
+}
+
+static void WriteJsonInt64(CJsonWriter &Writer, const char *pName, int64_t Value)
+{
+	// the writer only has 32 bit integers, larger values are clamped
+	Writer.WriteAttribute(pName);
+	Writer.WriteIntValue((int)std::clamp<int64_t>(Value, std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+}
+
+static bool WriteJson(const char *pFilename, const std::vector<CBenchmarkResult> &vResults, const CBenchmarkOptions &Options)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_WRITE);
+	if(!File)
+	{
+		log_error(BENCHMARK_NAME, "failed to open '%s' for writing", pFilename);
+		return false;
+	}
+
+	char aTimestamp[64];
+	str_timestamp_format(aTimestamp, sizeof(aTimestamp), FORMAT_SPACE);
+
+	CJsonFileWriter Writer(File);
+	Writer.BeginObject();
+	Writer.WriteAttribute("context");
+	Writer.BeginObject();
+	Writer.WriteAttribute("version");
+	Writer.WriteStrValue(GAME_RELEASE_VERSION);
+	Writer.WriteAttribute("git_revision");
+	if(GIT_SHORTREV_HASH)
+		Writer.WriteStrValue(GIT_SHORTREV_HASH);
+	else
+		Writer.WriteNullValue();
+	Writer.WriteAttribute("platform");
+	Writer.WriteStrValue(CONF_PLATFORM_STRING);
+	Writer.WriteAttribute("arch");
+	Writer.WriteStrValue(CONF_ARCH_STRING);
+	Writer.WriteAttribute("date");
+	Writer.WriteStrValue(aTimestamp);
+	Writer.WriteAttribute("repetitions");
+	Writer.WriteIntValue(Options.m_Repetitions);
+	Writer.EndObject();
+
+	Writer.WriteAttribute("benchmarks");
+	Writer.BeginArray();
+	for(const CBenchmarkResult &Result : vResults)
+	{
+		Writer.BeginObject();
+		Writer.WriteAttribute("name");
+		Writer.WriteStrValue(Result.m_pInfo->m_aName);
+		if(Result.m_aError[0])
+		{
+			Writer.WriteAttribute("error");
+			Writer.WriteStrValue(Result.m_aError);
+		}
+		else
+		{
+			WriteJsonInt64(Writer, "iterations", Result.m_Iterations);
+			WriteJsonInt64(Writer, "ns_per_iteration_median", round_to_int(Result.Median()));
+			WriteJsonInt64(Writer, "ns_per_iteration_min", round_to_int(Result.Min()));
+			WriteJsonInt64(Writer, "ns_per_iteration_max", round_to_int(Result.Max()));
+			WriteJsonInt64(Writer, "ns_per_iteration_mean", round_to_int(Result.Mean()));
+			WriteJsonInt64(Writer, "bytes_per_iteration", Result.m_BytesPerIteration);
+			WriteJsonInt64(Writer, "items_per_iteration", Result.m_ItemsPerIteration);
+			// rounded up, only code that never allocates reports 0
+			WriteJsonInt64(Writer, "allocations_per_iteration", (int64_t)std::ceil(Result.m_AllocationsPerIteration));
+		}
+		Writer.EndObject();
+	}
+	Writer.EndArray();
+	Writer.EndObject();
+	return true;
+}
+
+static bool ParseOptions(int argc, const char **argv, CBenchmarkOptions &Options)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		const char *pValue;
+		if((pValue = str_startswith(argv[i], "--filter=")))
+			Options.m_pFilter = pValue;
+		else if((pValue = str_startswith(argv[i], "--json=")))
+			Options.m_pJsonFile = pValue;
+		else if((pValue = str_startswith(argv[i], "--min-time-ms=")))
+			Options.m_MinTime = std::chrono::milliseconds(maximum(str_toint(pValue), 1));
+		else if((pValue = str_startswith(argv[i], "--repetitions=")))
+			Options.m_Repetitions = maximum(str_toint(pValue), 1);
+		else if(str_comp(argv[i], "--list") == 0)
+			Options.m_List = true;
+		else
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, const char **argv)
+{
+	const CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	CBenchmarkOptions Options;
+	if(!ParseOptions(argc, argv, Options))
+	{
+		log_error(BENCHMARK_NAME, "Usage: %s [--list] [--filter=<substring>] [--json=<file>] [--min-time-ms=<ms>] [--repetitions=<n>]", argv[0]);
+		return -1;
+	}
+
+	std::vector<const CBenchmarkInfo *> vpSelected;
+	for(const CBenchmarkInfo &Info : Benchmarks())
+		if(str_find(Info.m_aName, Options.m_pFilter))
+			vpSelected.push_back(&Info);
+	std::sort(vpSelected.begin(), vpSelected.end(), [](const CBenchmarkInfo *pA, const CBenchmarkInfo *pB) {
+		return str_comp(pA->m_aName, pB->m_aName) < 0;
+	});
+
+	if(Options.m_List)
+	{
+		for(const CBenchmarkInfo *pInfo : vpSelected)
+			log_info(BENCHMARK_NAME, "%s", pInfo->m_aName);
+		return 0;
+	}
+
+	std::unique_ptr<IStorage> pStorage = std::unique_ptr<IStorage>(CreateStorage(IStorage::EInitializationType::BASIC, argc, argv));
+	if(!pStorage)
+	{
+		log_error(BENCHMARK_NAME, "Error creating basic storage");
+		return -1;
+	}
+	gs_pStorage = pStorage.get();
+
+	log_info(BENCHMARK_NAME, "%-40s %15s %15s %12s %12s", "benchmark", "median", "min", "iterations", "allocs/iter");
+	std::vector<CBenchmarkResult> vResults;
+	bool Failed = false;
+	for(const CBenchmarkInfo *pInfo : vpSelected)
+	{
+		vResults.push_back(RunBenchmark(*pInfo, Options));
+		PrintResult(vResults.back());
+		Failed |= vResults.back().m_aError[0] != '\0';
+	}
+
+	if(Options.m_pJsonFile && !WriteJson(Options.m_pJsonFile, vResults, Options))
+		Failed = true;
+
+	gs_pStorage = nullptr;
+	return Failed ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#ifndef BENCHMARK_BENCHMARK_H
+#define BENCHMARK_BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+class CCollision;
+class CLayers;
+class IKernel;
+class IStorage;
+
+// Passed to every benchmark. The benchmark does its setup, then runs the
+// measured code in a `while(State.KeepRunning())` loop. Only the loop is
+// timed, the number of iterations is chosen by the runner.
+class CBenchmarkState
+{
+	int64_t m_Iterations;
+	int64_t m_Done = 0;
+	std::chrono::nanoseconds m_Start{0};
+	std::chrono::nanoseconds m_Elapsed{0};
+	bool m_Paused = false;
+	int64_t m_AllocationsStart = 0;
+	int64_t m_Allocations = 0;
+
+	int64_t m_BytesPerIteration = 0;
+	int64_t m_ItemsPerIteration = 0;
+	char m_aError[256];
+
+	void StartTimer();
+	void StopTimer();
+
+public:
+	CBenchmarkState(int64_t Iterations);
+
+	bool KeepRunning()
+	{
+		if(m_Done == 0)
+			StartTimer();
+		if(m_Done < m_Iterations)
+		{
+			m_Done++;
+			return true;
+		}
+		StopTimer();
+		return false;
+	}
+
+	// Excludes work inside the loop from the measurement, e.g. resetting
+	// state that the measured code changed.
+	void PauseTiming();
+	void ResumeTiming();
+
+	// Reported along with the time, so throughput can be compared between
+	// benchmarks that do a different amount of work per iteration.
+	void SetBytesPerIteration(int64_t Bytes) { m_BytesPerIteration = Bytes; }
+	void SetItemsPerIteration(int64_t Items) { m_ItemsPerIteration = Items; }
+
+	// Marks the benchmark as failed, e.g. if its data could not be loaded
+	// or the result of the measured code is wrong. The loop is not run if
+	// this is called before it.
+	void SkipWithError(const char *pError);
+
+	int64_t Iterations() const { return m_Iterations; }
+	int64_t IterationsDone() const { return m_Done; }
+	std::chrono::nanoseconds Elapsed() const { return m_Elapsed; }
+	// heap allocations with operator new while the timer was running
+	int64_t Allocations() const { return m_Allocations; }
+	int64_t BytesPerIteration() const { return m_BytesPerIteration; }
+	int64_t ItemsPerIteration() const { return m_ItemsPerIteration; }
+	bool Failed() const { return m_aError[0] != '\0'; }
+	const char *Error() const { return m_aError; }
+};
+
+typedef void (*FBenchmark)(CBenchmarkState &State);
+
+class CBenchmarkRegistration
+{
+public:
+	CBenchmarkRegistration(const char *pGroup, const char *pName, FBenchmark pfnBenchmark);
+};
+
+// Keeps the compiler from optimizing away computations whose result is
+// otherwise unused.
+template<typename T>
+inline void BenchmarkDoNotOptimize(const T &Value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile(""
+		     :
+		     : "r,m"(Value)
+		     : "memory");
+#else
+	static volatile const void *s_pSink;
+	s_pSink = &Value;
+#endif
+}
+
+// Storage of the benchmark runner, to load maps from the data directory.
+IStorage *BenchmarkStorage();
+
+// A map from the data directory with its collision.
+class CBenchmarkMap
+{
+	std::unique_ptr<IKernel> m_pKernel;
+	std::unique_ptr<CLayers> m_pLayers;
+	std::unique_ptr<CCollision> m_pCollision;
+
+public:
+	CBenchmarkMap();
+	~CBenchmarkMap();
+
+	bool Load(const char *pMapName);
+	CCollision *Collision() const { return m_pCollision.get(); }
+};
+
+#define BENCHMARK(Group, Name) \
+	static void Benchmark##Group##Name(CBenchmarkState &State); \
+	static CBenchmarkRegistration gs_BenchmarkRegistration##Group##Name(#Group, #Name, Benchmark##Group##Name); \
+	static void Benchmark##Group##Name(CBenchmarkState &State)
+
+#endif // BENCHMARK_BENCHMARK_H
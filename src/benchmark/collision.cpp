@@ -0,0 +1,161 @@
+#include "benchmark.h"
+
+#include <base/vmath.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/teamscore.h>
+
+#include <random>
+#include <vector>
+
+static const char *BENCHMARK_MAP = "coverage";
+static const int NUM_QUERIES = 256;
+
+static std::vector<vec2> FreePositions(const CCollision *pCollision, int Num, std::mt19937 &Rng)
+{
+	std::vector<vec2> vPositions;
+	const vec2 Size = CCharacterCore::PhysicalSizeVec2();
+	while((int)vPositions.size() < Num)
+	{
+		const vec2 Pos = vec2(Rng() % (pCollision->GetWidth() * 32), Rng() % (pCollision->GetHeight() * 32));
+		if(!pCollision->TestBox(Pos, Size))
+			vPositions.push_back(Pos);
+	}
+	return vPositions;
+}
+
+BENCHMARK(Collision, IntersectLine)
+{
+	CBenchmarkMap Map;
+	if(!Map.Load(BENCHMARK_MAP))
+	{
+		State.SkipWithError("failed to load map");
+		return;
+	}
+	const CCollision *pCollision = Map.Collision();
+
+	// segments with the length of laser and hook traces
+	std::mt19937 Rng(3);
+	std::vector<vec2> vFrom = FreePositions(pCollision, NUM_QUERIES, Rng);
+	std::vector<vec2> vTo;
+	for(vec2 From : vFrom)
+	{
+		const float Angle = (Rng() % 3600) / 3600.0f * 2 * pi;
+		vTo.push_back(From + direction(Angle) * (float)(50 + Rng() % 750));
+	}
+
+	while(State.KeepRunning())
+	{
+		for(int i = 0; i < NUM_QUERIES; i++)
+		{
+			vec2 Collision, BeforeCollision;
+			BenchmarkDoNotOptimize(pCollision->IntersectLine(vFrom[i], vTo[i], &Collision, &BeforeCollision));
+		}
+	}
+	State.SetItemsPerIteration(NUM_QUERIES);
+}
+
+BENCHMARK(Collision, MoveBox)
+{
+	CBenchmarkMap Map;
+	if(!Map.Load(BENCHMARK_MAP))
+	{
+		State.SkipWithError("failed to load map");
+		return;
+	}
+	const CCollision *pCollision = Map.Collision();
+
+	std::mt19937 Rng(4);
+	std::vector<vec2> vPos = FreePositions(pCollision, NUM_QUERIES, Rng);
+	std::vector<vec2> vVel;
+	for(int i = 0; i < NUM_QUERIES; i++)
+		vVel.emplace_back((int)(Rng() % 61) - 30, (int)(Rng() % 61) - 30);
+
+	const vec2 Size = CCharacterCore::PhysicalSizeVec2();
+	while(State.KeepRunning())
+	{
+		for(int i = 0; i < NUM_QUERIES; i++)
+		{
+			// always start from the same state to measure the same work
+			vec2 Pos = vPos[i];
+			vec2 Vel = vVel[i];
+			bool Grounded = false;
+			pCollision->MoveBox(&Pos, &Vel, Size, vec2(0, 0), &Grounded);
+			BenchmarkDoNotOptimize(Pos);
+		}
+	}
+	State.SetItemsPerIteration(NUM_QUERIES);
+}
+
+static void TickCharacters(CBenchmarkState &State, int NumCharacters)
+{
+	CBenchmarkMap Map;
+	if(!Map.Load(BENCHMARK_MAP))
+	{
+		State.SkipWithError("failed to load map");
+		return;
+	}
+	CCollision *pCollision = Map.Collision();
+
+	const int TicksPerRound = 250;
+	std::mt19937 Rng(5);
+	const std::vector<vec2> vSpawns = FreePositions(pCollision, NumCharacters, Rng);
+
+	CWorldCore World;
+	CTeamsCore Teams;
+	std::vector<CCharacterCore> vCores(NumCharacters);
+	const auto Spawn = [&]() {
+		for(int i = 0; i < NumCharacters; i++)
+		{
+			CCharacterCore &Core = vCores[i];
+			Core.Reset();
+			Core.Init(&World, pCollision, &Teams);
+			Core.m_Id = i;
+			Core.m_Pos = vSpawns[i];
+			World.m_apCharacters[i] = &Core;
+		}
+	};
+	Spawn();
+
+	// everyone runs, jumps and hooks around, so that hooking other
+	// characters and collisions between them are part of the tick
+	int Tick = 0;
+	while(State.KeepRunning())
+	{
+		if(Tick == TicksPerRound)
+		{
+			Spawn();
+			Tick = 0;
+		}
+		for(int i = 0; i < NumCharacters; i++)
+		{
+			CNetObj_PlayerInput &Input = vCores[i].m_Input;
+			Input.m_Direction = (i + Tick / 40) % 3 - 1;
+			Input.m_Jump = (Tick + i) % 30 < 2;
+			Input.m_Hook = (Tick + i * 7) % 50 < 35;
+			const vec2 Target = vSpawns[(i + 1 + Tick / 50) % NumCharacters] - vCores[i].m_Pos;
+			Input.m_TargetX = (int)Target.x;
+			Input.m_TargetY = (int)Target.y;
+			vCores[i].Tick(true);
+		}
+		for(CCharacterCore &Core : vCores)
+		{
+			Core.Move();
+			Core.Quantize();
+		}
+		Tick++;
+	}
+	State.SetItemsPerIteration(NumCharacters);
+}
+
+BENCHMARK(CharacterCore, Tick)
+{
+	TickCharacters(State, 32);
+}
+
+// a full server
+BENCHMARK(CharacterCore, TickFull)
+{
+	TickCharacters(State, MAX_CLIENTS);
+}
@@ -0,0 +1,36 @@
+#include "benchmark.h"
+
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+
+static void ConBenchmark(IConsole::IResult *pResult, void *pUserData)
+{
+	int *pSum = (int *)pUserData;
+	*pSum += pResult->GetInteger(1) + str_length(pResult->GetString(0));
+	if(pResult->NumArguments() > 2)
+		*pSum += str_length(pResult->GetString(2));
+}
+
+BENCHMARK(Console, ExecuteLine)
+{
+	std::unique_ptr<IConsole> pConsole = CreateConsole(CFGFLAG_SERVER);
+	int Sum = 0;
+	pConsole->Register("benchmark_command", "s[name] i[number] ?r[rest]", CFGFLAG_SERVER, ConBenchmark, &Sum, "");
+
+	// quoting, escapes, optional arguments and several commands per line
+	const char *apLines[] = {
+		"benchmark_command name 1",
+		"benchmark_command \"quoted name\" 42 and the rest of the line",
+		"benchmark_command \"escaped \\\"name\\\"\" -7; benchmark_command other 3 rest",
+		"benchmark_command a 1; benchmark_command b 2; benchmark_command c 3; benchmark_command d 4",
+	};
+	while(State.KeepRunning())
+	{
+		for(const char *pLine : apLines)
+			pConsole->ExecuteLine(pLine);
+	}
+	BenchmarkDoNotOptimize(Sum);
+	State.SetItemsPerIteration(std::size(apLines));
+}
@@ -0,0 +1,47 @@
+#include "benchmark.h"
+
+#include <base/system.h>
+
+#include <engine/shared/datafile.h>
+#include <engine/storage.h>
+
+static const char *BENCHMARK_MAP = "coverage";
+
+BENCHMARK(Datafile, Load)
+{
+	char aFilename[IO_MAX_PATH_LENGTH];
+	str_format(aFilename, sizeof(aFilename), "maps/%s.map", BENCHMARK_MAP);
+
+	int Size = 0;
+	bool Error = false;
+	while(State.KeepRunning())
+	{
+		CDataFileReader Reader;
+		if(!Reader.Open(BenchmarkStorage(), aFilename, IStorage::TYPE_ALL))
+		{
+			Error = true;
+			break;
+		}
+		for(int i = 0; i < Reader.NumData(); i++)
+			BenchmarkDoNotOptimize(Reader.GetData(i));
+		Size = Reader.MapSize();
+		Reader.Close();
+	}
+	if(Error)
+		State.SkipWithError("failed to open map");
+	State.SetBytesPerIteration(Size);
+}
+
+BENCHMARK(Map, Load)
+{
+	while(State.KeepRunning())
+	{
+		CBenchmarkMap Map;
+		if(!Map.Load(BENCHMARK_MAP))
+		{
+			State.SkipWithError("failed to load map");
+			break;
+		}
+		BenchmarkDoNotOptimize(Map.Collision());
+	}
+}
@@ -0,0 +1,66 @@
+#include "benchmark.h"
+
+#include <base/system.h>
+
+#include <engine/shared/huffman.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/network.h>
+
+#include <random>
+
+// Packed integers like in snapshot deltas: mostly zeros and small changes.
+static int FillPayload(unsigned char *pData, int Size)
+{
+	std::mt19937 Rng(1);
+	CPacker Packer;
+	Packer.Reset();
+	while(Packer.Size() < Size - 8)
+	{
+		const unsigned Kind = Rng() % 20;
+		if(Kind < 14)
+			Packer.AddInt(0);
+		else if(Kind < 19)
+			Packer.AddInt((int)(Rng() % 129) - 64);
+		else
+			Packer.AddInt((int)Rng());
+	}
+	mem_copy(pData, Packer.Data(), Packer.Size());
+	return Packer.Size();
+}
+
+BENCHMARK(Huffman, Compress)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	unsigned char aInput[NET_MAX_PAYLOAD];
+	unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+	const int InputSize = FillPayload(aInput, sizeof(aInput));
+
+	while(State.KeepRunning())
+	{
+		const int Size = Huffman.Compress(aInput, InputSize, aCompressed, sizeof(aCompressed));
+		BenchmarkDoNotOptimize(Size);
+	}
+	State.SetBytesPerIteration(InputSize);
+}
+
+BENCHMARK(Huffman, Decompress)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	unsigned char aInput[NET_MAX_PAYLOAD];
+	unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+	unsigned char aDecompressed[NET_MAX_PAYLOAD];
+	const int InputSize = FillPayload(aInput, sizeof(aInput));
+	const int CompressedSize = Huffman.Compress(aInput, InputSize, aCompressed, sizeof(aCompressed));
+
+	int Size = 0;
+	while(State.KeepRunning())
+	{
+		Size = Huffman.Decompress(aCompressed, CompressedSize, aDecompressed, sizeof(aDecompressed));
+		BenchmarkDoNotOptimize(Size);
+	}
+	if(Size != InputSize || mem_comp(aInput, aDecompressed, InputSize) != 0)
+		State.SkipWithError("decompressed data differs");
+	State.SetBytesPerIteration(InputSize);
+}
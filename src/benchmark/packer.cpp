@@ -0,0 +1,78 @@
+#include "benchmark.h"
+
+#include <base/system.h>
+
+#include <engine/shared/packer.h>
+
+#include <random>
+
+static const int NUM_INTS = 256;
+static const int NUM_STRINGS = 8;
+
+class CPackerInput
+{
+public:
+	int m_aInts[NUM_INTS];
+	char m_aaStrings[NUM_STRINGS][32];
+
+	CPackerInput()
+	{
+		std::mt19937 Rng(2);
+		for(int &Int : m_aInts)
+		{
+			// the same mix of sizes as in game messages
+			const unsigned Kind = Rng() % 4;
+			Int = Kind == 0 ? (int)(Rng() % 64) : Kind == 1 ? (int)(Rng() % 8192) - 4096 : (int)Rng();
+		}
+		for(int i = 0; i < NUM_STRINGS; i++)
+			str_format(m_aaStrings[i], sizeof(m_aaStrings[i]), "nameless tee %d", i);
+	}
+
+	void Pack(CPacker &Packer) const
+	{
+		Packer.Reset();
+		for(int i = 0; i < NUM_INTS; i++)
+		{
+			Packer.AddInt(m_aInts[i]);
+			if(i % (NUM_INTS / NUM_STRINGS) == 0)
+				Packer.AddString(m_aaStrings[i / (NUM_INTS / NUM_STRINGS)]);
+		}
+	}
+};
+
+BENCHMARK(Packer, Pack)
+{
+	const CPackerInput Input;
+	CPacker Packer;
+	while(State.KeepRunning())
+	{
+		Input.Pack(Packer);
+		BenchmarkDoNotOptimize(Packer.Data());
+	}
+	State.SetItemsPerIteration(NUM_INTS + NUM_STRINGS);
+	State.SetBytesPerIteration(Packer.Size());
+}
+
+BENCHMARK(Packer, Unpack)
+{
+	const CPackerInput Input;
+	CPacker Packer;
+	Input.Pack(Packer);
+	CUnpacker Unpacker;
+	bool Error = false;
+	while(State.KeepRunning())
+	{
+		Unpacker.Reset(Packer.Data(), Packer.Size());
+		for(int i = 0; i < NUM_INTS; i++)
+		{
+			BenchmarkDoNotOptimize(Unpacker.GetInt());
+			if(i % (NUM_INTS / NUM_STRINGS) == 0)
+				BenchmarkDoNotOptimize(Unpacker.GetString());
+		}
+		Error |= Unpacker.Error();
+	}
+	if(Error)
+		State.SkipWithError("unpacking failed");
+	State.SetItemsPerIteration(NUM_INTS + NUM_STRINGS);
+	State.SetBytesPerIteration(Packer.Size());
+}
@@ -0,0 +1,113 @@
+#include "benchmark.h"
+
+#include <base/system.h>
+
+#include <game/client/prediction/entities/character.h>
+#include <game/client/prediction/gameworld.h>
+#include <game/collision.h>
+#include <game/generated/protocol.h>
+#include <game/mapbugs.h>
+
+#include <random>
+
+static const char *BENCHMARK_MAP = "coverage";
+static const int NUM_CHARACTERS = 64;
+static const int NUM_PROJECTILES = 100;
+static const int NUM_PICKUPS = 80;
+
+// The world received from the server, with everything that the client
+// predicts: characters, projectiles and pickups.
+class CPredictionWorld
+{
+public:
+	CTuningParams m_aTuningList[NUM_TUNEZONES];
+	CMapBugs m_MapBugs = CMapBugs::Create("", 0, SHA256_ZEROED);
+	CGameWorld m_World;
+
+	void Init(CCollision *pCollision)
+	{
+		m_World.m_pCollision = pCollision;
+		m_World.m_pTuningList = m_aTuningList;
+		m_World.m_pMapBugs = &m_MapBugs;
+		m_World.m_Core.InitSwitchers(pCollision->m_HighestSwitchNumber);
+		mem_zero(&m_World.m_WorldConfig, sizeof(m_World.m_WorldConfig));
+		m_World.m_WorldConfig.m_IsDDRace = true;
+		m_World.m_WorldConfig.m_PredictTiles = true;
+		m_World.m_WorldConfig.m_PredictWeapons = true;
+		m_World.m_WorldConfig.m_PredictDDRace = true;
+		m_World.m_WorldConfig.m_InfiniteAmmo = true;
+
+		std::mt19937 Rng(14);
+		const auto RandomPos = [&]() {
+			while(true)
+			{
+				const vec2 Pos = vec2(Rng() % (pCollision->GetWidth() * 32), Rng() % (pCollision->GetHeight() * 32));
+				if(!pCollision->TestBox(Pos, CCharacterCore::PhysicalSizeVec2()))
+					return Pos;
+			}
+		};
+
+		m_World.NetObjBegin(CTeamsCore(), 0);
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			CNetObj_Character Character;
+			mem_zero(&Character, sizeof(Character));
+			const vec2 Pos = RandomPos();
+			Character.m_X = Pos.x;
+			Character.m_Y = Pos.y;
+			Character.m_HookedPlayer = -1;
+			Character.m_Weapon = WEAPON_GUN;
+			m_World.NetCharAdd(i, &Character, nullptr, 0, i == 0);
+		}
+		for(int i = 0; i < NUM_PROJECTILES; i++)
+		{
+			CNetObj_Projectile Projectile;
+			const vec2 Pos = RandomPos();
+			Projectile.m_X = Pos.x;
+			Projectile.m_Y = Pos.y;
+			Projectile.m_VelX = 100;
+			Projectile.m_VelY = 0;
+			Projectile.m_Type = WEAPON_GUN;
+			Projectile.m_StartTick = 0;
+			m_World.NetObjAdd(i, NETOBJTYPE_PROJECTILE, &Projectile, nullptr);
+		}
+		for(int i = 0; i < NUM_PICKUPS; i++)
+		{
+			CNetObj_Pickup Pickup;
+			const vec2 Pos = RandomPos();
+			Pickup.m_X = Pos.x;
+			Pickup.m_Y = Pos.y;
+			Pickup.m_Type = i % 2 ? POWERUP_HEALTH : POWERUP_ARMOR;
+			Pickup.m_Subtype = 0;
+			m_World.NetObjAdd(NUM_PROJECTILES + i, NETOBJTYPE_PICKUP, &Pickup, nullptr);
+		}
+		m_World.NetObjEnd();
+	}
+};
+
+BENCHMARK(Prediction, CopyWorld)
+{
+	CBenchmarkMap Map;
+	if(!Map.Load(BENCHMARK_MAP))
+	{
+		State.SkipWithError("failed to load map");
+		return;
+	}
+	CPredictionWorld Received;
+	Received.Init(Map.Collision());
+
+	// the client copies into the same world every frame, the first
+	// copies that fill the entity pool are not measured
+	CGameWorld Predicted;
+	for(int i = 0; i < 2; i++)
+		Predicted.CopyWorld(&Received.m_World);
+
+	while(State.KeepRunning())
+		Predicted.CopyWorld(&Received.m_World);
+
+	int NumCharacters = 0;
+	for(CEntity *pEnt = Predicted.FindFirst(CGameWorld::ENTTYPE_CHARACTER); pEnt; pEnt = pEnt->TypeNext())
+		NumCharacters++;
+	if(NumCharacters != NUM_CHARACTERS)
+		State.SkipWithError("copied world has the wrong number of characters");
+}
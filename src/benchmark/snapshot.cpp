@@ -0,0 +1,149 @@
+#include "benchmark.h"
+
+#include <base/system.h>
+
+#include <engine/shared/snapshot.h>
+
+#include <game/gamecore.h>
+#include <game/generated/protocol.h>
+
+// A full server: 64 players, some projectiles, lasers and pickups. Half of
+// the characters move each tick, the rest stand still.
+static const int NUM_PLAYERS = 64;
+static const int NUM_PROJECTILES = 100;
+static const int NUM_LASERS = 20;
+static const int NUM_PICKUPS = 80;
+
+static void AddItems(CSnapshotBuilder &Builder, int Tick)
+{
+	for(int i = 0; i < NUM_PLAYERS; i++)
+	{
+		const int Moved = i % 2 ? Tick : 0;
+		CNetObj_Character *pCharacter = (CNetObj_Character *)Builder.NewItem(NETOBJTYPE_CHARACTER, i, sizeof(CNetObj_Character));
+		mem_zero(pCharacter, sizeof(*pCharacter));
+		pCharacter->m_Tick = Tick;
+		pCharacter->m_X = 1000 + i * 64 + Moved * 3;
+		pCharacter->m_Y = 2000 + i * 16 - Moved;
+		pCharacter->m_VelX = (i * 37 + Moved) % 512;
+		pCharacter->m_VelY = (i * 11) % 256;
+		pCharacter->m_Angle = (i * 100 + Moved * 7) % 1608;
+		pCharacter->m_Direction = i % 3 - 1;
+		pCharacter->m_HookedPlayer = -1;
+		pCharacter->m_Health = 10;
+		pCharacter->m_Armor = 10;
+		pCharacter->m_AmmoCount = -1;
+		pCharacter->m_Weapon = i % NUM_WEAPONS;
+
+		CNetObj_PlayerInfo *pPlayerInfo = (CNetObj_PlayerInfo *)Builder.NewItem(NETOBJTYPE_PLAYERINFO, i, sizeof(CNetObj_PlayerInfo));
+		pPlayerInfo->m_Local = i == 0;
+		pPlayerInfo->m_ClientId = i;
+		pPlayerInfo->m_Team = 0;
+		pPlayerInfo->m_Score = -9999;
+		pPlayerInfo->m_Latency = 20 + i % 50;
+
+		CNetObj_ClientInfo *pClientInfo = (CNetObj_ClientInfo *)Builder.NewItem(NETOBJTYPE_CLIENTINFO, i, sizeof(CNetObj_ClientInfo));
+		mem_zero(pClientInfo, sizeof(*pClientInfo));
+		char aName[16];
+		str_format(aName, sizeof(aName), "player %d", i);
+		StrToInts(&pClientInfo->m_Name0, 4, aName);
+		StrToInts(&pClientInfo->m_Clan0, 3, "clan");
+		StrToInts(&pClientInfo->m_Skin0, 6, "default");
+		pClientInfo->m_Country = -1;
+	}
+	for(int i = 0; i < NUM_PROJECTILES; i++)
+	{
+		CNetObj_Projectile *pProjectile = (CNetObj_Projectile *)Builder.NewItem(NETOBJTYPE_PROJECTILE, 100 + i, sizeof(CNetObj_Projectile));
+		pProjectile->m_X = 500 + i * 40;
+		pProjectile->m_Y = 800 + i * 8;
+		pProjectile->m_VelX = 1500;
+		pProjectile->m_VelY = -200 + i;
+		pProjectile->m_Type = WEAPON_GRENADE;
+		pProjectile->m_StartTick = Tick - i % 50;
+	}
+	for(int i = 0; i < NUM_LASERS; i++)
+	{
+		CNetObj_Laser *pLaser = (CNetObj_Laser *)Builder.NewItem(NETOBJTYPE_LASER, 300 + i, sizeof(CNetObj_Laser));
+		pLaser->m_X = 700 + i * 50;
+		pLaser->m_Y = 900;
+		pLaser->m_FromX = 700 + i * 50 - Tick % 10;
+		pLaser->m_FromY = 1100;
+		pLaser->m_StartTick = Tick - i % 5;
+	}
+	for(int i = 0; i < NUM_PICKUPS; i++)
+	{
+		CNetObj_Pickup *pPickup = (CNetObj_Pickup *)Builder.NewItem(NETOBJTYPE_PICKUP, 400 + i, sizeof(CNetObj_Pickup));
+		pPickup->m_X = 64 * i;
+		pPickup->m_Y = 1200;
+		pPickup->m_Type = i % 2 ? POWERUP_HEALTH : POWERUP_ARMOR;
+		pPickup->m_Subtype = 0;
+	}
+}
+
+static int BuildSnapshot(CSnapshotBuilder &Builder, int Tick, CSnapshot *pSnapshot)
+{
+	Builder.Init();
+	AddItems(Builder, Tick);
+	return Builder.Finish(pSnapshot);
+}
+
+static void InitDelta(CSnapshotDelta &Delta)
+{
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		Delta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+}
+
+BENCHMARK(Snapshot, Build)
+{
+	CSnapshotBuilder Builder;
+	alignas(CSnapshot) static char s_aSnapshot[CSnapshot::MAX_SIZE];
+	int Size = 0;
+	while(State.KeepRunning())
+	{
+		Size = BuildSnapshot(Builder, 100, (CSnapshot *)s_aSnapshot);
+		BenchmarkDoNotOptimize(s_aSnapshot);
+	}
+	State.SetBytesPerIteration(Size);
+}
+
+BENCHMARK(Snapshot, CreateDelta)
+{
+	CSnapshotBuilder Builder;
+	CSnapshotDelta Delta;
+	InitDelta(Delta);
+	alignas(CSnapshot) static char s_aFrom[CSnapshot::MAX_SIZE];
+	alignas(CSnapshot) static char s_aTo[CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	BuildSnapshot(Builder, 100, (CSnapshot *)s_aFrom);
+	const int ToSize = BuildSnapshot(Builder, 101, (CSnapshot *)s_aTo);
+
+	while(State.KeepRunning())
+	{
+		const int DeltaSize = Delta.CreateDelta((CSnapshot *)s_aFrom, (CSnapshot *)s_aTo, s_aDelta);
+		BenchmarkDoNotOptimize(DeltaSize);
+	}
+	State.SetBytesPerIteration(ToSize);
+}
+
+BENCHMARK(Snapshot, UnpackDelta)
+{
+	CSnapshotBuilder Builder;
+	CSnapshotDelta Delta;
+	InitDelta(Delta);
+	alignas(CSnapshot) static char s_aFrom[CSnapshot::MAX_SIZE];
+	alignas(CSnapshot) static char s_aTo[CSnapshot::MAX_SIZE];
+	alignas(CSnapshot) static char s_aUnpacked[CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	BuildSnapshot(Builder, 100, (CSnapshot *)s_aFrom);
+	const int ToSize = BuildSnapshot(Builder, 101, (CSnapshot *)s_aTo);
+	const int DeltaSize = Delta.CreateDelta((CSnapshot *)s_aFrom, (CSnapshot *)s_aTo, s_aDelta);
+
+	while(State.KeepRunning())
+	{
+		const int Size = Delta.UnpackDelta((CSnapshot *)s_aFrom, (CSnapshot *)s_aUnpacked, s_aDelta, DeltaSize, false);
+		BenchmarkDoNotOptimize(Size);
+	}
+	if(mem_comp(s_aTo, s_aUnpacked, ToSize) != 0)
+		State.SkipWithError("unpacked snapshot differs");
+	State.SetBytesPerIteration(ToSize);
+}
@@ -821,7 +821,7 @@ IClient::CSnapItem CClient::SnapGetItem(int SnapId, int Index) const
 	const CSnapshot *pSnapshot = m_aapSnapshots[g_Config.m_ClDummy][SnapId]->m_pAltSnap;
 	const CSnapshotItem *pSnapshotItem = pSnapshot->GetItem(Index);
 	CSnapItem Item;
-	Item.m_Type = pSnapshot->GetItemType(Index);
+	Item.m_Type = m_aapSnapshots[g_Config.m_ClDummy][SnapId]->m_pAltSnapIndex->GetItemType(Index);
 	Item.m_Id = pSnapshotItem->Id();
 	Item.m_pData = pSnapshotItem->Data();
 	Item.m_DataSize = pSnapshot->GetItemSize(Index);
@@ -833,7 +833,7 @@ const void *CClient::SnapFindItem(int SnapId, int Type, int Id) const
 	if(!m_aapSnapshots[g_Config.m_ClDummy][SnapId])
 		return nullptr;
 
-	return m_aapSnapshots[g_Config.m_ClDummy][SnapId]->m_pAltSnap->FindItem(Type, Id);
+	return m_aapSnapshots[g_Config.m_ClDummy][SnapId]->m_pAltSnapIndex->FindItem(Type, Id);
 }
 
 int CClient::SnapNumItems(int SnapId) const
@@ -945,7 +945,7 @@ void CClient::RenderDebug()
 		{
 			if(m_SnapshotDelta.GetDataRate(i) && m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT])
 			{
-				const int Type = m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT]->m_pAltSnap->GetExternalItemType(i);
+				const int Type = m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT]->m_pAltSnapIndex->GetExternalItemType(i);
 				if(Type == UUID_INVALID)
 				{
 					str_format(
@@ -2627,6 +2627,7 @@ void CClient::OnDemoPlayerSnapshot(void *pData, int Size)
 	std::swap(m_aapSnapshots[0][SNAP_PREV], m_aapSnapshots[0][SNAP_CURRENT]);
 	mem_copy(m_aapSnapshots[0][SNAP_CURRENT]->m_pSnap, pData, Size);
 	mem_copy(m_aapSnapshots[0][SNAP_CURRENT]->m_pAltSnap, pAltSnapBuffer, AltSnapSize);
+	m_aapSnapshots[0][SNAP_CURRENT]->m_pAltSnapIndex->Build(m_aapSnapshots[0][SNAP_CURRENT]->m_pAltSnap);
 
 	GameClient()->OnNewSnapshot();
 }
@@ -3927,6 +3928,8 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 		m_aapSnapshots[0][SnapshotType] = &m_aDemorecSnapshotHolders[SnapshotType];
 		m_aapSnapshots[0][SnapshotType]->m_pSnap = (CSnapshot *)&m_aaaDemorecSnapshotData[SnapshotType][0];
 		m_aapSnapshots[0][SnapshotType]->m_pAltSnap = (CSnapshot *)&m_aaaDemorecSnapshotData[SnapshotType][1];
+		m_aapSnapshots[0][SnapshotType]->m_pAltSnapIndex = &m_aDemorecSnapshotIndices[SnapshotType];
+		m_aapSnapshots[0][SnapshotType]->m_pAltSnapIndex->Build(m_aapSnapshots[0][SnapshotType]->m_pAltSnap);
 		m_aapSnapshots[0][SnapshotType]->m_SnapSize = 0;
 		m_aapSnapshots[0][SnapshotType]->m_AltSnapSize = 0;
 		m_aapSnapshots[0][SnapshotType]->m_Tick = -1;
@@ -36,6 +36,10 @@ class IEngineMap : public IMap
 	MACRO_INTERFACE("enginemap")
 public:
 	[[nodiscard]] virtual bool Load(const char *pMapName) = 0;
+	// Opens a map so that it can be loaded with LoadPrepared later, without
+	// touching the loaded map. Can be called from any thread.
+	[[nodiscard]] virtual bool Prepare(class IStorage *pStorage, const char *pMapName, class CDataFileReader *pDataFile, bool Mapped) const = 0;
+	virtual void LoadPrepared(class CDataFileReader &&DataFile) = 0;
 	virtual void Unload() = 0;
 	virtual bool IsLoaded() const = 0;
 	virtual IOHANDLE File() const = 0;
@@ -20,6 +20,7 @@
 #include <game/generated/protocolglue.h>
 
 struct CAntibotRoundData;
+class CSnapshotItemPool;
 
 // When recording a demo on the server, the ClientId -1 is used
 enum
@@ -244,6 +245,11 @@ public:
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
+	// While a pool is set, SnapNewItem adds the items to the pool instead
+	// of the snapshot that is currently being built.
+	virtual void SnapSetItemPool(CSnapshotItemPool *pPool) = 0;
+	virtual bool SnapAddItemPoolGroup(const CSnapshotItemPool *pPool, int Group) = 0;
+
 	enum
 	{
 		RCON_CID_SERV = -1,
@@ -258,6 +264,8 @@ public:
 	virtual void RedirectClient(int ClientId, int Port) = 0;
 	virtual void ChangeMap(const char *pMap) = 0;
 	virtual void ReloadMap() = 0;
+	// starts loading a map in the background that is likely to be changed to
+	virtual void PreloadMap(const char *pMap) = 0;
 
 	virtual void DemoRecorder_HandleAutoStart() = 0;
 
@@ -310,6 +318,9 @@ public:
 
 	virtual void OnTick() = 0;
 
+	// Called once before the snapshots of a tick are created.
+	virtual void OnPreSnap() = 0;
+
 	// Snap for a specific client.
 	//
 	// GlobalSnap is true when sending snapshots to all clients,
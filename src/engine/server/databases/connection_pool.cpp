@@ -3,12 +3,16 @@
 #include <engine/shared/config.h>
 
 #include <base/system.h>
+#include <base/tl/threading.h>
 #include <cstring>
 #include <engine/console.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -24,7 +28,8 @@ struct CSqlExecData
 	CSqlExecData(
 		CDbConnectionPool::FWrite pFunc,
 		std::unique_ptr<const ISqlData> pThreadData,
-		const char *pName);
+		const char *pName,
+		bool Batch);
 	CSqlExecData(
 		CDbConnectionPool::Mode m,
 		const char aFileName[64]);
@@ -65,6 +70,104 @@ struct CSqlExecData
 
 	std::unique_ptr<const ISqlData> m_pThreadData;
 	const char *m_pName;
+	// write that may share a transaction with the writes queued after it
+	bool m_Batch = false;
+	std::chrono::nanoseconds m_QueueTime = time_get_nanoseconds();
+};
+
+// Depth and latency of one of the queues. The latency is measured from
+// queuing a query until its result is available to the main thread.
+class CQueueStats
+{
+public:
+	enum
+	{
+		// bucket i counts latencies below 2^i ms, the last one all above
+		NUM_BUCKETS = 16,
+	};
+
+	void Push()
+	{
+		const int Depth = m_Depth.fetch_add(1) + 1;
+		int PeakDepth = m_PeakDepth.load();
+		while(Depth > PeakDepth && !m_PeakDepth.compare_exchange_weak(PeakDepth, Depth))
+		{
+		}
+	}
+
+	void Pop(std::chrono::nanoseconds QueueTime)
+	{
+		m_Depth.fetch_sub(1);
+		const int64_t Latency = std::chrono::duration_cast<std::chrono::milliseconds>(time_get_nanoseconds() - QueueTime).count();
+		int Bucket = 0;
+		while(Bucket < NUM_BUCKETS - 1 && Latency >= (int64_t(1) << Bucket))
+			Bucket++;
+		m_aBuckets[Bucket].fetch_add(1);
+	}
+
+	void Print(IConsole *pConsole, const char *pName) const;
+
+private:
+	std::atomic_int m_Depth{0};
+	std::atomic_int m_PeakDepth{0};
+	std::atomic<int64_t> m_aBuckets[NUM_BUCKETS]{};
+};
+
+void CQueueStats::Print(IConsole *pConsole, const char *pName) const
+{
+	int64_t aBuckets[NUM_BUCKETS];
+	int64_t NumQueries = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		aBuckets[i] = m_aBuckets[i].load();
+		NumQueries += aBuckets[i];
+	}
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "%s queue: depth=%d peak=%d queries=%" PRId64, pName, m_Depth.load(), m_PeakDepth.load(), NumQueries);
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "sql", aBuf);
+	int64_t NumBelow = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		if(aBuckets[i] == 0)
+			continue;
+		NumBelow += aBuckets[i];
+		str_format(aBuf, sizeof(aBuf), "  %s%6dms: %8" PRId64 " (%5.1f%%)",
+			i < NUM_BUCKETS - 1 ? "< " : ">=", i < NUM_BUCKETS - 1 ? 1 << i : 1 << (NUM_BUCKETS - 2),
+			aBuckets[i], 100.0 * NumBelow / NumQueries);
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "sql", aBuf);
+	}
+}
+
+struct CDbConnectionPool::CSharedData
+{
+	// Used as signal that shutdown is in progress from main thread to
+	// speed up the queries by discarding read queries and writing to
+	// the sqlite file instead of the remote mysql server.
+	// The worker thread signals the main thread that all queries are
+	// processed by setting this variable to false again.
+	std::atomic_bool m_Shutdown{false};
+	// Queries go first to the backup thread. This semaphore signals about
+	// new queries.
+	CSemaphore m_NumBackup;
+	// When the backup thread processed the query, it signals the main
+	// thread with this semaphore about the new query
+	CSemaphore m_NumWorker;
+
+	// spsc queue with additional backup worker to look at queries first.
+	std::unique_ptr<CSqlExecData> m_aQueries[512];
+
+	// Reads are taken from this queue by whichever read worker is idle.
+	std::mutex m_ReadMutex;
+	std::condition_variable m_ReadCondition;
+	std::deque<std::unique_ptr<CSqlExecData>> m_ReadQueue;
+	int m_ReadJobNum = 0;
+	// The read workers discard the remaining reads and exit when set.
+	bool m_ReadShutdown = false;
+	// READ servers added so far, each read worker connects to all of them.
+	std::vector<std::unique_ptr<CSqlExecData>> m_vpReadServers;
+
+	CQueueStats m_aStats[CDbConnectionPool::NUM_QUEUES];
 };
 
 CSqlExecData::CSqlExecData(
@@ -81,10 +184,12 @@ CSqlExecData::CSqlExecData(
 CSqlExecData::CSqlExecData(
 	CDbConnectionPool::FWrite pFunc,
 	std::unique_ptr<const ISqlData> pThreadData,
-	const char *pName) :
+	const char *pName,
+	bool Batch) :
 	m_Mode(WRITE_ACCESS),
 	m_pThreadData(std::move(pThreadData)),
-	m_pName(pName)
+	m_pName(pName),
+	m_Batch(Batch)
 {
 	m_Ptr.m_pWriteFunc = pFunc;
 }
@@ -118,25 +223,60 @@ CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 	m_Ptr.m_Print.m_Mode = m;
 }
 
-void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
+void CDbConnectionPool::AddQuery(std::unique_ptr<CSqlExecData> pQuery)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
+	m_pShared->m_aStats[QUEUE_WRITE].Push();
+	m_pShared->m_aQueries[m_InsertIdx++] = std::move(pQuery);
 	m_InsertIdx %= std::size(m_pShared->m_aQueries);
 	m_pShared->m_NumBackup.Signal();
 }
 
+void CDbConnectionPool::AddReadQuery(std::unique_ptr<CSqlExecData> pQuery)
+{
+	if(m_vpReadThreads.empty() && !m_Shutdown)
+		StartReadWorkers();
+	m_pShared->m_aStats[QUEUE_READ].Push();
+	{
+		std::unique_lock<std::mutex> Lock(m_pShared->m_ReadMutex);
+		m_pShared->m_ReadQueue.push_back(std::move(pQuery));
+	}
+	m_pShared->m_ReadCondition.notify_one();
+}
+
+void CDbConnectionPool::AddReadServer(std::unique_ptr<CSqlExecData> pServer)
+{
+	std::unique_lock<std::mutex> Lock(m_pShared->m_ReadMutex);
+	m_pShared->m_vpReadServers.push_back(std::move(pServer));
+}
+
+void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
+{
+	if(DatabaseMode == Mode::READ)
+		AddReadQuery(std::make_unique<CSqlExecData>(pConsole, DatabaseMode));
+	else
+		AddQuery(std::make_unique<CSqlExecData>(pConsole, DatabaseMode));
+}
+
+void CDbConnectionPool::PrintStats(IConsole *pConsole)
+{
+	m_pShared->m_aStats[QUEUE_READ].Print(pConsole, "read");
+	m_pShared->m_aStats[QUEUE_WRITE].Print(pConsole, "write");
+}
+
 void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64])
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	if(DatabaseMode == Mode::READ)
+		AddReadServer(std::make_unique<CSqlExecData>(DatabaseMode, aFileName));
+	else
+		AddQuery(std::make_unique<CSqlExecData>(DatabaseMode, aFileName));
 }
 
 void CDbConnectionPool::RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	if(DatabaseMode == Mode::READ)
+		AddReadServer(std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig));
+	else
+		AddQuery(std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig));
 }
 
 void CDbConnectionPool::Execute(
@@ -144,19 +284,16 @@ void CDbConnectionPool::Execute(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	AddReadQuery(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
 }
 
 void CDbConnectionPool::ExecuteWrite(
 	FWrite pFunc,
 	std::unique_ptr<const ISqlData> pSqlRequestData,
-	const char *pName)
+	const char *pName,
+	bool Batch)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	AddQuery(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName, Batch));
 }
 
 void CDbConnectionPool::OnShutdown()
@@ -164,6 +301,11 @@ void CDbConnectionPool::OnShutdown()
 	if(m_Shutdown)
 		return;
 	m_Shutdown = true;
+	{
+		std::unique_lock<std::mutex> Lock(m_pShared->m_ReadMutex);
+		m_pShared->m_ReadShutdown = true;
+	}
+	m_pShared->m_ReadCondition.notify_all();
 	m_pShared->m_Shutdown.store(true);
 	m_pShared->m_NumBackup.Signal();
 	int i = 0;
@@ -180,7 +322,7 @@ void CDbConnectionPool::OnShutdown()
 }
 
 // The backup worker thread looks at write queries and stores them
-// in the sqlite database (WRITE_BACKUP). It skips over read queries.
+// in the sqlite database (WRITE_BACKUP). It skips over other queries.
 // After processing the query, it gets passed on to the Worker thread.
 // This is done to not loose ranks when the server shuts down before all
 // queries are executed on the mysql server
@@ -238,82 +380,105 @@ void CBackup::ProcessQueries()
 	}
 }
 
-// the worker threads executes queries on mysql or sqlite. If we write on
-// a mysql server and have a backup server configured, we'll remove the
-// entry from the backup server after completing it on the write server.
-// static void Worker(void *pUser);
-class CWorker
+static void CompleteQuery(CSqlExecData *pThreadData, bool Success, CQueueStats *pStats)
+{
+	pStats->Pop(pThreadData->m_QueueTime);
+	if(pThreadData->m_pThreadData != nullptr && pThreadData->m_pThreadData->m_pResult != nullptr)
+	{
+		pThreadData->m_pThreadData->m_pResult->m_Success = Success;
+		pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
+	}
+}
+
+// The read workers execute read queries in parallel, so that a slow query
+// doesn't delay the others. Each of them has its own connection to every
+// READ server and fails over to the next one like the write worker.
+class CReadWorker
 {
 public:
-	CWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared, int DebugSql) :
+	CReadWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared, int DebugSql) :
 		m_DebugSql(DebugSql), m_pShared(std::move(pShared)) {}
 	static void Start(void *pUser);
 	void ProcessQueries();
 
 private:
-	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+	void Print(IConsole *pConsole);
 
 	bool m_DebugSql;
 
-	// There are two possible configurations
-	//  * sqlite mode: There exists exactly one READ and the same WRITE server
-	//                 with no WRITE_BACKUP server
-	//  * mysql mode: there can exist multiple READ server, there must be at
-	//                most one WRITE server. The WRITE server for all DDNet
-	//                Servers must be the same (to counteract double loads).
-	//                There may be one WRITE_BACKUP sqlite server.
-	// This variable should only change, before the worker threads
+	// connections to m_vpReadServers of the shared data, the servers
+	// registered since the last query are added when taking the next one
 	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
-	std::unique_ptr<IDbConnection> m_pWriteConnection;
-	std::unique_ptr<IDbConnection> m_pWriteBackup;
 
 	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
 };
 
 /* static */
-void CWorker::Start(void *pUser)
+void CReadWorker::Start(void *pUser)
 {
-	CWorker *pThis = (CWorker *)pUser;
+	CReadWorker *pThis = (CReadWorker *)pUser;
 	pThis->ProcessQueries();
 	delete pThis;
 }
 
-void CWorker::ProcessQueries()
+void CReadWorker::ProcessQueries()
 {
 	// remember last working server and try to connect to it first
 	int ReadServer = 0;
-	// enter fail mode when a sql request fails, skip read request during it and
-	// write to the backup database until all requests are handled
+	// enter fail mode when a sql request fails, skip read requests during it
+	// until the queue is empty
 	bool FailMode = false;
-	for(int JobNum = 0;; JobNum++)
+	while(true)
 	{
-		if(FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
+		std::unique_ptr<CSqlExecData> pThreadData;
+		int JobNum;
+		bool Shutdown;
 		{
-			FailMode = false;
-		}
-		m_pShared->m_NumWorker.Wait();
-		auto pThreadData = std::move(m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)]);
-		// work through all database jobs after OnShutdown is called before exiting the thread
-		if(pThreadData == nullptr)
-		{
-			m_pShared->m_Shutdown.store(false);
-			return;
+			std::unique_lock<std::mutex> Lock(m_pShared->m_ReadMutex);
+			if(FailMode && m_pShared->m_ReadQueue.empty())
+			{
+				FailMode = false;
+			}
+			m_pShared->m_ReadCondition.wait(Lock, [this]() { return !m_pShared->m_ReadQueue.empty() || m_pShared->m_ReadShutdown; });
+			// work through all queued reads after OnShutdown is called before exiting the thread
+			if(m_pShared->m_ReadQueue.empty())
+			{
+				return;
+			}
+			pThreadData = std::move(m_pShared->m_ReadQueue.front());
+			m_pShared->m_ReadQueue.pop_front();
+			JobNum = m_pShared->m_ReadJobNum++;
+			Shutdown = m_pShared->m_ReadShutdown;
+
+			for(size_t i = m_vpReadConnections.size(); i < m_pShared->m_vpReadServers.size(); i++)
+			{
+				const CSqlExecData *pServer = m_pShared->m_vpReadServers[i].get();
+				if(pServer->m_Mode == CSqlExecData::ADD_MYSQL)
+					m_vpReadConnections.push_back(CreateMysqlConnection(pServer->m_Ptr.m_Mysql.m_Config));
+				else
+					m_vpReadConnections.push_back(CreateSqliteConnection(pServer->m_Ptr.m_Sqlite.m_FileName, true));
+			}
 		}
+
 		bool Success = false;
-		switch(pThreadData->m_Mode)
+		if(pThreadData->m_Mode == CSqlExecData::PRINT)
 		{
-		case CSqlExecData::READ_ACCESS:
+			Print(pThreadData->m_Ptr.m_Print.m_pConsole);
+			Success = true;
+		}
+		else
 		{
+			dbg_assert(pThreadData->m_Mode == CSqlExecData::READ_ACCESS, "only reads go to the read workers");
 			for(size_t i = 0; i < m_vpReadConnections.size(); i++)
 			{
-				if(m_pShared->m_Shutdown)
+				if(Shutdown)
 				{
-					dbg_msg("sql", "[%i] %s dismissed read request during shutdown", JobNum, pThreadData->m_pName);
+					dbg_msg("sql", "[r%i] %s dismissed read request during shutdown", JobNum, pThreadData->m_pName);
 					break;
 				}
 				if(FailMode)
 				{
-					dbg_msg("sql", "[%i] %s dismissed read request during FailMode", JobNum, pThreadData->m_pName);
+					dbg_msg("sql", "[r%i] %s dismissed read request during FailMode", JobNum, pThreadData->m_pName);
 					break;
 				}
 				int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
@@ -321,7 +486,7 @@ void CWorker::ProcessQueries()
 				{
 					ReadServer = CurServer;
 					if(m_DebugSql)
-						dbg_msg("sql", "[%i] %s done on read database %d", JobNum, pThreadData->m_pName, CurServer);
+						dbg_msg("sql", "[r%i] %s done on read database %d", JobNum, pThreadData->m_pName, CurServer);
 					Success = true;
 					break;
 				}
@@ -331,41 +496,122 @@ void CWorker::ProcessQueries()
 				FailMode = true;
 			}
 		}
-		break;
-		case CSqlExecData::WRITE_ACCESS:
+		if(!Success)
+			dbg_msg("sql", "[r%i] %s failed on all databases", JobNum, pThreadData->m_pName);
+		CompleteQuery(pThreadData.get(), Success, &m_pShared->m_aStats[CDbConnectionPool::QUEUE_READ]);
+	}
+}
+
+void CReadWorker::Print(IConsole *pConsole)
+{
+	for(auto &pReadConnection : m_vpReadConnections)
+		pReadConnection->Print(pConsole, "Read");
+	if(m_vpReadConnections.empty())
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+}
+
+// The write worker executes all other queries on mysql or sqlite in the
+// order they are queued. If we write on a mysql server and have a backup
+// server configured, we'll remove the entry from the backup server after
+// completing it on the write server.
+class CWorker
+{
+public:
+	CWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared, int DebugSql) :
+		m_DebugSql(DebugSql), m_pShared(std::move(pShared)) {}
+	static void Start(void *pUser);
+	void ProcessQueries();
+
+private:
+	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+	bool ProcessWrite(int JobNum, CSqlExecData *pThreadData, bool *pFailMode);
+	// moves the batchable writes following JobNum out of the queue
+	void CollectBatch(int *pJobNum, std::vector<std::unique_ptr<CSqlExecData>> *pvpBatch);
+	bool ProcessBatch(int FirstJobNum, const std::vector<std::unique_ptr<CSqlExecData>> &vpBatch);
+
+	bool m_DebugSql;
+
+	// There are two possible configurations
+	//  * sqlite mode: There exists exactly one READ and the same WRITE server
+	//                 with no WRITE_BACKUP server
+	//  * mysql mode: there can exist multiple READ server, there must be at
+	//                most one WRITE server. The WRITE server for all DDNet
+	//                Servers must be the same (to counteract double loads).
+	//                There may be one WRITE_BACKUP sqlite server.
+	// The READ servers are connected to by the read workers.
+	std::unique_ptr<IDbConnection> m_pWriteConnection;
+	std::unique_ptr<IDbConnection> m_pWriteBackup;
+
+	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
+};
+
+/* static */
+void CWorker::Start(void *pUser)
+{
+	CWorker *pThis = (CWorker *)pUser;
+	pThis->ProcessQueries();
+	delete pThis;
+}
+
+void CWorker::ProcessQueries()
+{
+	// enter fail mode when a sql request fails, write to the backup
+	// database until all requests are handled
+	bool FailMode = false;
+	for(int JobNum = 0;; JobNum++)
+	{
+		if(FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
 		{
-			if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
-			}
-			else if(FailMode && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
-			}
-			else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData.get(), Write::NORMAL))
+			FailMode = false;
+		}
+		m_pShared->m_NumWorker.Wait();
+		auto pThreadData = std::move(m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)]);
+		// work through all database jobs after OnShutdown is called before exiting the thread
+		if(pThreadData == nullptr)
+		{
+			m_pShared->m_Shutdown.store(false);
+			return;
+		}
+		if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS && pThreadData->m_Batch)
+		{
+			const int FirstJobNum = JobNum;
+			std::vector<std::unique_ptr<CSqlExecData>> vpBatch;
+			vpBatch.push_back(std::move(pThreadData));
+			if(!FailMode)
+				CollectBatch(&JobNum, &vpBatch);
+			if(vpBatch.size() > 1 && !FailMode && !m_pShared->m_Shutdown && ProcessBatch(FirstJobNum, vpBatch))
 			{
-				if(m_DebugSql)
-					dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
-				Success = true;
+				for(auto &pBatchData : vpBatch)
+					CompleteQuery(pBatchData.get(), true, &m_pShared->m_aStats[CDbConnectionPool::QUEUE_WRITE]);
+				continue;
 			}
-			// enter fail mode if not successful
-			FailMode = FailMode || !Success;
-			const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
-			if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData.get(), w))
+			// execute the writes one by one, so that only the failing ones
+			// end up in the backup database
+			for(size_t i = 0; i < vpBatch.size(); i++)
 			{
-				if(m_DebugSql)
-					dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
-				Success = true;
+				const bool Success = ProcessWrite(FirstJobNum + i, vpBatch[i].get(), &FailMode);
+				if(!Success)
+					dbg_msg("sql", "[%i] %s failed on all databases", FirstJobNum + (int)i, vpBatch[i]->m_pName);
+				CompleteQuery(vpBatch[i].get(), Success, &m_pShared->m_aStats[CDbConnectionPool::QUEUE_WRITE]);
 			}
+			continue;
 		}
-		break;
+		bool Success = false;
+		switch(pThreadData->m_Mode)
+		{
+		case CSqlExecData::READ_ACCESS:
+			dbg_assert(false, "reads are executed by the read workers");
+			break;
+		case CSqlExecData::WRITE_ACCESS:
+			Success = ProcessWrite(JobNum, pThreadData.get(), &FailMode);
+			break;
 		case CSqlExecData::ADD_MYSQL:
 		{
 			auto pMysql = CreateMysqlConnection(pThreadData->m_Ptr.m_Mysql.m_Config);
 			switch(pThreadData->m_Ptr.m_Mysql.m_Mode)
 			{
 			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pMysql));
+				dbg_assert(false, "read servers are added to the read workers");
 				break;
 			case CDbConnectionPool::Mode::WRITE:
 				m_pWriteConnection = std::move(pMysql);
@@ -385,7 +631,7 @@ void CWorker::ProcessQueries()
 			switch(pThreadData->m_Ptr.m_Sqlite.m_Mode)
 			{
 			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pSqlite));
+				dbg_assert(false, "read servers are added to the read workers");
 				break;
 			case CDbConnectionPool::Mode::WRITE:
 				m_pWriteConnection = std::move(pSqlite);
@@ -406,24 +652,92 @@ void CWorker::ProcessQueries()
 		}
 		if(!Success)
 			dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
-		if(pThreadData->m_pThreadData != nullptr && pThreadData->m_pThreadData->m_pResult != nullptr)
+		CompleteQuery(pThreadData.get(), Success, &m_pShared->m_aStats[CDbConnectionPool::QUEUE_WRITE]);
+	}
+}
+
+bool CWorker::ProcessWrite(int JobNum, CSqlExecData *pThreadData, bool *pFailMode)
+{
+	bool Success = false;
+	if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
+	{
+		dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
+	}
+	else if(*pFailMode && m_pWriteBackup != nullptr)
+	{
+		dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
+	}
+	else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData, Write::NORMAL))
+	{
+		if(m_DebugSql)
+			dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
+		Success = true;
+	}
+	// enter fail mode if not successful
+	*pFailMode = *pFailMode || !Success;
+	const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
+	if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, w))
+	{
+		if(m_DebugSql)
+			dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
+		Success = true;
+	}
+	return Success;
+}
+
+void CWorker::CollectBatch(int *pJobNum, std::vector<std::unique_ptr<CSqlExecData>> *pvpBatch)
+{
+	const auto Deadline = time_get_nanoseconds() + std::chrono::milliseconds(g_Config.m_SvSqlBatchWindow);
+	while((int)pvpBatch->size() < g_Config.m_SvSqlBatchSize)
+	{
+		// the backup thread signals each query after it is done looking at it
+		if(m_pShared->m_NumWorker.GetApproximateValue() == 0)
 		{
-			pThreadData->m_pThreadData->m_pResult->m_Success = Success;
-			pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
+			if(m_pShared->m_Shutdown || time_get_nanoseconds() >= Deadline)
+				break;
+			std::this_thread::sleep_for(1ms);
+			continue;
 		}
+		const int NextIdx = (*pJobNum + 1) % std::size(m_pShared->m_aQueries);
+		const CSqlExecData *pNext = m_pShared->m_aQueries[NextIdx].get();
+		if(pNext == nullptr || pNext->m_Mode != CSqlExecData::WRITE_ACCESS || !pNext->m_Batch)
+			break;
+		m_pShared->m_NumWorker.Wait();
+		(*pJobNum)++;
+		pvpBatch->push_back(std::move(m_pShared->m_aQueries[NextIdx]));
 	}
 }
 
-void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+bool CWorker::ProcessBatch(int FirstJobNum, const std::vector<std::unique_ptr<CSqlExecData>> &vpBatch)
 {
-	if(DatabaseMode == CDbConnectionPool::Mode::READ)
+	const int LastJobNum = FirstJobNum + (int)vpBatch.size() - 1;
+	if(!CDbConnectionPool::ExecSqlBatch(m_pWriteConnection.get(), vpBatch, Write::NORMAL))
+	{
+		dbg_msg("sql", "[%i-%i] batch rolled back, retrying the writes one by one", FirstJobNum, LastJobNum);
+		return false;
+	}
+	if(m_DebugSql)
+		dbg_msg("sql", "[%i-%i] %d writes done in one transaction on write database", FirstJobNum, LastJobNum, (int)vpBatch.size());
+	if(m_pWriteBackup == nullptr)
+		return true;
+	if(CDbConnectionPool::ExecSqlBatch(m_pWriteBackup.get(), vpBatch, Write::NORMAL_SUCCEEDED))
 	{
-		for(auto &pReadConnection : m_vpReadConnections)
-			pReadConnection->Print(pConsole, "Read");
-		if(m_vpReadConnections.empty())
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+		if(m_DebugSql)
+			dbg_msg("sql", "[%i-%i] writes removed from backup database", FirstJobNum, LastJobNum);
+		return true;
 	}
-	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
+	for(size_t i = 0; i < vpBatch.size(); i++)
+	{
+		if(!CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), vpBatch[i].get(), Write::NORMAL_SUCCEEDED))
+			dbg_msg("sql", "[%i] %s couldn't be removed from backup database", FirstJobNum + (int)i, vpBatch[i]->m_pName);
+	}
+	// the writes themselves are already committed
+	return true;
+}
+
+void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+{
+	if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
 	{
 		if(m_pWriteConnection)
 			m_pWriteConnection->Print(pConsole, "Write");
@@ -473,6 +787,50 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 	return Success;
 }
 
+/* static */
+bool CDbConnectionPool::ExecSqlBatch(IDbConnection *pConnection, const std::vector<std::unique_ptr<CSqlExecData>> &vpData, Write w)
+{
+	if(pConnection == nullptr)
+	{
+		dbg_msg("sql", "No database given");
+		return false;
+	}
+	char aError[256] = "unknown error";
+	if(!pConnection->Connect(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "failed connecting to db: %s", aError);
+		return false;
+	}
+	if(!pConnection->BeginTransaction(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "begin transaction failed: %s", aError);
+		pConnection->Disconnect();
+		return false;
+	}
+	bool Success = true;
+	for(const auto &pData : vpData)
+	{
+		dbg_assert(pData->m_Mode == CSqlExecData::WRITE_ACCESS, "only writes can be batched");
+		if(!pData->m_Ptr.m_pWriteFunc(pConnection, pData->m_pThreadData.get(), w, aError, sizeof(aError)))
+		{
+			dbg_msg("sql", "%s failed: %s", pData->m_pName, aError);
+			Success = false;
+			break;
+		}
+	}
+	if(Success && !pConnection->CommitTransaction(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "commit transaction failed: %s", aError);
+		Success = false;
+	}
+	if(!Success && !pConnection->RollbackTransaction(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "rollback transaction failed: %s", aError);
+	}
+	pConnection->Disconnect();
+	return Success;
+}
+
 CDbConnectionPool::CDbConnectionPool()
 {
 	m_pShared = std::make_shared<CSharedData>();
@@ -480,6 +838,16 @@ CDbConnectionPool::CDbConnectionPool()
 	m_pBackupThread = thread_init(CBackup::Start, new CBackup(m_pShared, g_Config.m_DbgSql), "database backup worker thread");
 }
 
+void CDbConnectionPool::StartReadWorkers()
+{
+	for(int i = 0; i < g_Config.m_SvSqlReadWorkers; i++)
+	{
+		char aName[64];
+		str_format(aName, sizeof(aName), "database read worker thread %d", i);
+		m_vpReadThreads.push_back(thread_init(CReadWorker::Start, new CReadWorker(m_pShared, g_Config.m_DbgSql), aName));
+	}
+}
+
 CDbConnectionPool::~CDbConnectionPool()
 {
 	OnShutdown();
@@ -487,4 +855,6 @@ CDbConnectionPool::~CDbConnectionPool()
 		thread_wait(m_pWorkerThread);
 	if(m_pBackupThread)
 		thread_wait(m_pBackupThread);
+	for(void *pReadThread : m_vpReadThreads)
+		thread_wait(pReadThread);
 }
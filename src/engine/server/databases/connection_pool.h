@@ -76,7 +76,18 @@ public:
 		NUM_MODES,
 	};
 
+	// reads are executed by sv_sql_read_workers threads in parallel, all
+	// other queries by a single write worker in the order they are queued
+	enum Queue
+	{
+		QUEUE_READ,
+		QUEUE_WRITE,
+		NUM_QUEUES,
+	};
+
 	void Print(IConsole *pConsole, Mode DatabaseMode);
+	// prints depth and latency histogram of the queues
+	void PrintStats(IConsole *pConsole);
 
 	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64]);
 	void RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig);
@@ -86,19 +97,30 @@ public:
 		std::unique_ptr<const ISqlData> pSqlRequestData,
 		const char *pName);
 	// writes to WRITE_BACKUP first and removes it from there when successfully
-	// executed on WRITE server
+	// executed on WRITE server. Consecutive writes with Batch set are executed
+	// in one transaction when they are queued within sv_sql_batch_window.
 	void ExecuteWrite(
 		FWrite pFunc,
 		std::unique_ptr<const ISqlData> pSqlRequestData,
-		const char *pName);
+		const char *pName,
+		bool Batch = false);
 
 	void OnShutdown();
 
 	friend class CWorker;
+	friend class CReadWorker;
 	friend class CBackup;
 
 private:
 	static bool ExecSqlFunc(IDbConnection *pConnection, struct CSqlExecData *pData, Write w);
+	// executes all writes in one transaction, rolls back when one of them fails
+	static bool ExecSqlBatch(IDbConnection *pConnection, const std::vector<std::unique_ptr<struct CSqlExecData>> &vpData, Write w);
+
+	void AddQuery(std::unique_ptr<struct CSqlExecData> pQuery);
+	void AddReadQuery(std::unique_ptr<struct CSqlExecData> pQuery);
+	void AddReadServer(std::unique_ptr<struct CSqlExecData> pServer);
+	// sv_sql_read_workers is only known after the config is loaded
+	void StartReadWorkers();
 
 	// Only the main thread accesses this variable. It points to the index,
 	// where the next query is added to the queue.
@@ -106,28 +128,12 @@ private:
 
 	bool m_Shutdown = false;
 
-	struct CSharedData
-	{
-		// Used as signal that shutdown is in progress from main thread to
-		// speed up the queries by discarding read queries and writing to
-		// the sqlite file instead of the remote mysql server.
-		// The worker thread signals the main thread that all queries are
-		// processed by setting this variable to false again.
-		std::atomic_bool m_Shutdown{false};
-		// Queries go first to the backup thread. This semaphore signals about
-		// new queries.
-		CSemaphore m_NumBackup;
-		// When the backup thread processed the query, it signals the main
-		// thread with this semaphore about the new query
-		CSemaphore m_NumWorker;
-
-		// spsc queue with additional backup worker to look at queries first.
-		std::unique_ptr<struct CSqlExecData> m_aQueries[512];
-	};
-
+	struct CSharedData;
 	std::shared_ptr<CSharedData> m_pShared;
 	void *m_pWorkerThread = nullptr;
 	void *m_pBackupThread = nullptr;
+	// started with the first read query
+	std::vector<void *> m_vpReadThreads;
 };
 
 #endif // ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
@@ -10,6 +10,8 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 // MySQL >= 8.0.1 removed my_bool, 8.0.2 accidentally reintroduced it: https://bugs.mysql.com/bug.php?id=87337
@@ -102,6 +104,10 @@ public:
 	void GetString(int Col, char *pBuffer, int BufferSize) override;
 	int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) override;
 
+	bool BeginTransaction(char *pError, int ErrorSize) override;
+	bool CommitTransaction(char *pError, int ErrorSize) override;
+	bool RollbackTransaction(char *pError, int ErrorSize) override;
+
 	bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) override;
 
 private:
@@ -111,11 +117,19 @@ private:
 		void operator()(MYSQL_STMT *pStmt) const;
 	};
 
+	enum
+	{
+		MAX_CACHED_STATEMENTS = 64,
+	};
+
 	char m_aErrorDetail[128];
 	void StoreErrorMysql(const char *pContext);
-	void StoreErrorStmt(const char *pContext);
+	void StoreErrorStmt(const char *pContext, MYSQL_STMT *pStmt);
 	bool ConnectImpl();
 	bool PrepareAndExecuteStatement(const char *pStmt);
+	bool ExecuteQuery(const char *pQuery, char *pError, int ErrorSize);
+	// frees the remaining result of the current statement
+	void FreeResult();
 	//static void DeleteResult(MYSQL_RES *pResult);
 
 	union UParameterExtra
@@ -129,7 +143,12 @@ private:
 	bool m_NewQuery = false;
 	bool m_HaveConnection = false;
 	MYSQL m_Mysql;
-	std::unique_ptr<MYSQL_STMT, CStmtDeleter> m_pStmt = nullptr;
+	// statements belong to the server side session, the cache is dropped
+	// when the connection id changes after a reconnect
+	unsigned long m_ConnectionId = 0;
+	std::unordered_map<std::string, std::unique_ptr<MYSQL_STMT, CStmtDeleter>> m_StatementCache;
+	// points into m_StatementCache
+	MYSQL_STMT *m_pStmt = nullptr;
 	std::vector<MYSQL_BIND> m_vStmtParameters;
 	std::vector<UParameterExtra> m_vStmtParameterExtras;
 
@@ -159,6 +178,8 @@ CMysqlConnection::CMysqlConnection(CMysqlConfig Config) :
 
 CMysqlConnection::~CMysqlConnection()
 {
+	m_pStmt = nullptr;
+	m_StatementCache.clear();
 	mysql_close(&m_Mysql);
 	g_MysqlNumConnections -= 1;
 }
@@ -168,26 +189,49 @@ void CMysqlConnection::StoreErrorMysql(const char *pContext)
 	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:mysql:%d): %s", pContext, mysql_errno(&m_Mysql), mysql_error(&m_Mysql));
 }
 
-void CMysqlConnection::StoreErrorStmt(const char *pContext)
+void CMysqlConnection::StoreErrorStmt(const char *pContext, MYSQL_STMT *pStmt)
 {
-	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:stmt:%d): %s", pContext, mysql_stmt_errno(m_pStmt.get()), mysql_stmt_error(m_pStmt.get()));
+	str_format(m_aErrorDetail, sizeof(m_aErrorDetail), "(%s:stmt:%d): %s", pContext, mysql_stmt_errno(pStmt), mysql_stmt_error(pStmt));
 }
 
 bool CMysqlConnection::PrepareAndExecuteStatement(const char *pStmt)
 {
-	if(mysql_stmt_prepare(m_pStmt.get(), pStmt, str_length(pStmt)))
+	// only used while setting up the connection, not worth caching
+	std::unique_ptr<MYSQL_STMT, CStmtDeleter> pSetupStmt(mysql_stmt_init(&m_Mysql));
+	if(mysql_stmt_prepare(pSetupStmt.get(), pStmt, str_length(pStmt)))
 	{
-		StoreErrorStmt("prepare");
+		StoreErrorStmt("prepare", pSetupStmt.get());
 		return false;
 	}
-	if(mysql_stmt_execute(m_pStmt.get()))
+	if(mysql_stmt_execute(pSetupStmt.get()))
+	{
+		StoreErrorStmt("execute", pSetupStmt.get());
+		return false;
+	}
+	return true;
+}
+
+bool CMysqlConnection::ExecuteQuery(const char *pQuery, char *pError, int ErrorSize)
+{
+	FreeResult();
+	if(mysql_real_query(&m_Mysql, pQuery, str_length(pQuery)))
 	{
-		StoreErrorStmt("execute");
+		StoreErrorMysql("query");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
 		return false;
 	}
 	return true;
 }
 
+void CMysqlConnection::FreeResult()
+{
+	if(m_pStmt && mysql_stmt_free_result(m_pStmt))
+	{
+		StoreErrorStmt("free_result", m_pStmt);
+		dbg_msg("mysql", "can't free last result %s", m_aErrorDetail);
+	}
+}
+
 void CMysqlConnection::Print(IConsole *pConsole, const char *pMode)
 {
 	char aBuf[512];
@@ -223,24 +267,30 @@ bool CMysqlConnection::ConnectImpl()
 {
 	if(m_HaveConnection)
 	{
-		if(m_pStmt && mysql_stmt_free_result(m_pStmt.get()))
-		{
-			StoreErrorStmt("free_result");
-			dbg_msg("mysql", "can't free last result %s", m_aErrorDetail);
-		}
+		FreeResult();
 		if(!mysql_select_db(&m_Mysql, m_Config.m_aDatabase))
 		{
-			// Success.
+			// Success. MYSQL_OPT_RECONNECT may have opened a new session
+			// without the prepared statements
+			if(mysql_thread_id(&m_Mysql) != m_ConnectionId)
+			{
+				m_pStmt = nullptr;
+				m_StatementCache.clear();
+				m_ConnectionId = mysql_thread_id(&m_Mysql);
+			}
 			return true;
 		}
 		StoreErrorMysql("select_db");
 		dbg_msg("mysql", "ping error, trying to reconnect %s", m_aErrorDetail);
+		m_pStmt = nullptr;
+		m_StatementCache.clear();
 		mysql_close(&m_Mysql);
 		mem_zero(&m_Mysql, sizeof(m_Mysql));
 		mysql_init(&m_Mysql);
 	}
 
 	m_pStmt = nullptr;
+	m_StatementCache.clear();
 	unsigned int OptConnectTimeout = 60;
 	unsigned int OptReadTimeout = 60;
 	unsigned int OptWriteTimeout = 120;
@@ -261,8 +311,7 @@ bool CMysqlConnection::ConnectImpl()
 		return false;
 	}
 	m_HaveConnection = true;
-
-	m_pStmt = std::unique_ptr<MYSQL_STMT, CStmtDeleter>(mysql_stmt_init(&m_Mysql));
+	m_ConnectionId = mysql_thread_id(&m_Mysql);
 
 	// Apparently MYSQL_SET_CHARSET_NAME is not enough
 	if(!PrepareAndExecuteStatement("SET CHARACTER SET utf8mb4"))
@@ -322,14 +371,30 @@ void CMysqlConnection::Disconnect()
 
 bool CMysqlConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
 {
-	if(mysql_stmt_prepare(m_pStmt.get(), pStmt, str_length(pStmt)))
+	FreeResult();
+	m_pStmt = nullptr;
+	auto Cached = m_StatementCache.find(pStmt);
+	if(Cached != m_StatementCache.end())
 	{
-		StoreErrorStmt("prepare");
-		str_copy(pError, m_aErrorDetail, ErrorSize);
-		return false;
+		m_pStmt = Cached->second.get();
+	}
+	else
+	{
+		// queries with formatted values would grow the cache forever
+		if(m_StatementCache.size() >= MAX_CACHED_STATEMENTS)
+			m_StatementCache.clear();
+		std::unique_ptr<MYSQL_STMT, CStmtDeleter> pNewStmt(mysql_stmt_init(&m_Mysql));
+		if(mysql_stmt_prepare(pNewStmt.get(), pStmt, str_length(pStmt)))
+		{
+			StoreErrorStmt("prepare", pNewStmt.get());
+			str_copy(pError, m_aErrorDetail, ErrorSize);
+			return false;
+		}
+		m_pStmt = pNewStmt.get();
+		m_StatementCache.emplace(pStmt, std::move(pNewStmt));
 	}
 	m_NewQuery = true;
-	unsigned NumParameters = mysql_stmt_param_count(m_pStmt.get());
+	unsigned NumParameters = mysql_stmt_param_count(m_pStmt);
 	m_vStmtParameters.resize(NumParameters);
 	m_vStmtParameterExtras.resize(NumParameters);
 	if(NumParameters)
@@ -447,23 +512,23 @@ bool CMysqlConnection::Step(bool *pEnd, char *pError, int ErrorSize)
 	if(m_NewQuery)
 	{
 		m_NewQuery = false;
-		if(mysql_stmt_bind_param(m_pStmt.get(), m_vStmtParameters.data()))
+		if(mysql_stmt_bind_param(m_pStmt, m_vStmtParameters.data()))
 		{
-			StoreErrorStmt("bind_param");
+			StoreErrorStmt("bind_param", m_pStmt);
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return false;
 		}
-		if(mysql_stmt_execute(m_pStmt.get()))
+		if(mysql_stmt_execute(m_pStmt))
 		{
-			StoreErrorStmt("execute");
+			StoreErrorStmt("execute", m_pStmt);
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return false;
 		}
 	}
-	int Result = mysql_stmt_fetch(m_pStmt.get());
+	int Result = mysql_stmt_fetch(m_pStmt);
 	if(Result == 1)
 	{
-		StoreErrorStmt("fetch");
+		StoreErrorStmt("fetch", m_pStmt);
 		str_copy(pError, m_aErrorDetail, ErrorSize);
 		return false;
 	}
@@ -478,19 +543,19 @@ bool CMysqlConnection::ExecuteUpdate(int *pNumUpdated, char *pError, int ErrorSi
 	if(m_NewQuery)
 	{
 		m_NewQuery = false;
-		if(mysql_stmt_bind_param(m_pStmt.get(), m_vStmtParameters.data()))
+		if(mysql_stmt_bind_param(m_pStmt, m_vStmtParameters.data()))
 		{
-			StoreErrorStmt("bind_param");
+			StoreErrorStmt("bind_param", m_pStmt);
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return false;
 		}
-		if(mysql_stmt_execute(m_pStmt.get()))
+		if(mysql_stmt_execute(m_pStmt))
 		{
-			StoreErrorStmt("execute");
+			StoreErrorStmt("execute", m_pStmt);
 			str_copy(pError, m_aErrorDetail, ErrorSize);
 			return false;
 		}
-		*pNumUpdated = mysql_stmt_affected_rows(m_pStmt.get());
+		*pNumUpdated = mysql_stmt_affected_rows(m_pStmt);
 		return true;
 	}
 	str_copy(pError, "tried to execute update without query", ErrorSize);
@@ -511,9 +576,9 @@ bool CMysqlConnection::IsNull(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
-		StoreErrorStmt("fetch_column:null");
+		StoreErrorStmt("fetch_column:null", m_pStmt);
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
 		dbg_assert(0, "error in IsNull");
 	}
@@ -535,9 +600,9 @@ float CMysqlConnection::GetFloat(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
-		StoreErrorStmt("fetch_column:float");
+		StoreErrorStmt("fetch_column:float", m_pStmt);
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
 		dbg_assert(0, "error in GetFloat");
 	}
@@ -563,9 +628,9 @@ int CMysqlConnection::GetInt(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
-		StoreErrorStmt("fetch_column:int");
+		StoreErrorStmt("fetch_column:int", m_pStmt);
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
 		dbg_assert(0, "error in GetInt");
 	}
@@ -591,9 +656,9 @@ int64_t CMysqlConnection::GetInt64(int Col)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = nullptr;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
-		StoreErrorStmt("fetch_column:int64");
+		StoreErrorStmt("fetch_column:int64", m_pStmt);
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
 		dbg_assert(0, "error in GetInt64");
 	}
@@ -626,9 +691,9 @@ void CMysqlConnection::GetString(int Col, char *pBuffer, int BufferSize)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = &Error;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
-		StoreErrorStmt("fetch_column:string");
+		StoreErrorStmt("fetch_column:string", m_pStmt);
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
 		dbg_assert(0, "error in GetString");
 	}
@@ -658,9 +723,9 @@ int CMysqlConnection::GetBlob(int Col, unsigned char *pBuffer, int BufferSize)
 	Bind.is_null = &IsNull;
 	Bind.is_unsigned = false;
 	Bind.error = &Error;
-	if(mysql_stmt_fetch_column(m_pStmt.get(), &Bind, Col, 0))
+	if(mysql_stmt_fetch_column(m_pStmt, &Bind, Col, 0))
 	{
-		StoreErrorStmt("fetch_column:blob");
+		StoreErrorStmt("fetch_column:blob", m_pStmt);
 		dbg_msg("mysql", "error fetching column %s", m_aErrorDetail);
 		dbg_assert(0, "error in GetBlob");
 	}
@@ -687,6 +752,21 @@ const char *CMysqlConnection::MedianMapTime(char *pBuffer, int BufferSize) const
 	return pBuffer;
 }
 
+bool CMysqlConnection::BeginTransaction(char *pError, int ErrorSize)
+{
+	return ExecuteQuery("START TRANSACTION", pError, ErrorSize);
+}
+
+bool CMysqlConnection::CommitTransaction(char *pError, int ErrorSize)
+{
+	return ExecuteQuery("COMMIT", pError, ErrorSize);
+}
+
+bool CMysqlConnection::RollbackTransaction(char *pError, int ErrorSize)
+{
+	return ExecuteQuery("ROLLBACK", pError, ErrorSize);
+}
+
 bool CMysqlConnection::AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize)
 {
 	char aBuf[512];
@@ -6,6 +6,9 @@
 #include <engine/console.h>
 
 #include <atomic>
+#include <limits>
+#include <string>
+#include <unordered_map>
 
 class CSqliteConnection : public IDbConnection
 {
@@ -51,6 +54,10 @@ public:
 	// passing a negative buffer size is undefined behavior
 	int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) override;
 
+	bool BeginTransaction(char *pError, int ErrorSize) override;
+	bool CommitTransaction(char *pError, int ErrorSize) override;
+	bool RollbackTransaction(char *pError, int ErrorSize) override;
+
 	bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) override;
 
 	// fail safe
@@ -61,9 +68,19 @@ private:
 	char m_aFilename[IO_MAX_PATH_LENGTH];
 	bool m_Setup;
 
+	enum
+	{
+		MAX_CACHED_STATEMENTS = 64,
+	};
+
 	sqlite3 *m_pDb;
+	// points into m_StatementCache
 	sqlite3_stmt *m_pStmt;
+	std::unordered_map<std::string, sqlite3_stmt *> m_StatementCache;
 	bool m_Done; // no more rows available for Step
+	// resets the current statement and drops its bound buffers
+	void ResetStatement();
+	void ClearStatementCache();
 	// returns false, if the query succeeded
 	bool Execute(const char *pQuery, char *pError, int ErrorSize);
 	// returns true on failure
@@ -89,8 +106,7 @@ CSqliteConnection::CSqliteConnection(const char *pFilename, bool Setup) :
 
 CSqliteConnection::~CSqliteConnection()
 {
-	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
+	ClearStatementCache();
 	sqlite3_close(m_pDb);
 	m_pDb = nullptr;
 }
@@ -142,8 +158,9 @@ bool CSqliteConnection::ConnectImpl(char *pError, int ErrorSize)
 		return false;
 	}
 
-	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors
-	sqlite3_busy_timeout(m_pDb, -1);
+	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors,
+	// a negative timeout would disable the busy handler instead
+	sqlite3_busy_timeout(m_pDb, std::numeric_limits<int>::max());
 
 	if(m_Setup)
 	{
@@ -182,27 +199,57 @@ bool CSqliteConnection::ConnectImpl(char *pError, int ErrorSize)
 
 void CSqliteConnection::Disconnect()
 {
-	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
-	m_pStmt = nullptr;
+	ResetStatement();
 	m_InUse.store(false);
 }
 
-bool CSqliteConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
+void CSqliteConnection::ResetStatement()
 {
-	if(m_pStmt != nullptr)
-		sqlite3_finalize(m_pStmt);
+	if(m_pStmt == nullptr)
+		return;
+	// an unfinished statement keeps its read transaction open, and the
+	// bound strings are not copied by SQLite
+	sqlite3_reset(m_pStmt);
+	sqlite3_clear_bindings(m_pStmt);
 	m_pStmt = nullptr;
+}
+
+void CSqliteConnection::ClearStatementCache()
+{
+	ResetStatement();
+	for(auto &[Query, pStmt] : m_StatementCache)
+		sqlite3_finalize(pStmt);
+	m_StatementCache.clear();
+}
+
+bool CSqliteConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
+{
+	ResetStatement();
+	auto Cached = m_StatementCache.find(pStmt);
+	if(Cached != m_StatementCache.end())
+	{
+		m_pStmt = Cached->second;
+		m_Done = false;
+		return true;
+	}
+
+	// queries with formatted values would grow the cache forever
+	if(m_StatementCache.size() >= MAX_CACHED_STATEMENTS)
+		ClearStatementCache();
+	sqlite3_stmt *pNewStmt = nullptr;
 	int Result = sqlite3_prepare_v2(
 		m_pDb,
 		pStmt,
 		-1, // pStmt can be any length
-		&m_pStmt,
+		&pNewStmt,
 		nullptr);
 	if(FormatError(Result, pError, ErrorSize))
 	{
+		sqlite3_finalize(pNewStmt);
 		return false;
 	}
+	m_StatementCache.emplace(pStmt, pNewStmt);
+	m_pStmt = pNewStmt;
 	m_Done = false;
 	return true;
 }
@@ -393,6 +440,24 @@ void CSqliteConnection::AssertNoError(int Result)
 	}
 }
 
+bool CSqliteConnection::BeginTransaction(char *pError, int ErrorSize)
+{
+	ResetStatement();
+	return Execute("BEGIN", pError, ErrorSize);
+}
+
+bool CSqliteConnection::CommitTransaction(char *pError, int ErrorSize)
+{
+	ResetStatement();
+	return Execute("COMMIT", pError, ErrorSize);
+}
+
+bool CSqliteConnection::RollbackTransaction(char *pError, int ErrorSize)
+{
+	ResetStatement();
+	return Execute("ROLLBACK", pError, ErrorSize);
+}
+
 bool CSqliteConnection::AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize)
 {
 	char aBuf[512];
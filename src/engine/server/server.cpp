@@ -248,6 +248,7 @@ CServer::CServer()
 		m_apCurrentMapData[i] = nullptr;
 		m_aCurrentMapSize[i] = 0;
 	}
+	m_CurrentMapDataMapped = false;
 
 	m_MapReload = false;
 	m_SameMapReload = false;
@@ -277,9 +278,11 @@ CServer::CServer()
 
 CServer::~CServer()
 {
-	for(auto &pCurrentMapData : m_apCurrentMapData)
+	StopSnapWorkers();
+
+	for(int i = 0; i < NUM_MAP_TYPES; i++)
 	{
-		free(pCurrentMapData);
+		FreeCurrentMapData(i);
 	}
 
 	if(m_RunServer != UNINITIALIZED)
@@ -932,6 +935,8 @@ void CServer::DoSnapshot()
 {
 	bool IsGlobalSnap = Config()->m_SvHighBandwidth || (m_CurrentGameTick % 2) == 0;
 
+	GameServer()->OnPreSnap();
+
 	if(m_aDemoRecorder[RECORDER_MANUAL].IsRecording() || m_aDemoRecorder[RECORDER_AUTO].IsRecording())
 	{
 		// create snapshot for demo recording
@@ -949,6 +954,14 @@ void CServer::DoSnapshot()
 			m_aDemoRecorder[RECORDER_AUTO].RecordSnapshot(Tick(), aData, SnapshotSize);
 	}
 
+	if((int)m_vpSnapWorkers.size() != Config()->m_SvSnapThreads + 1)
+		StartSnapWorkers(Config()->m_SvSnapThreads);
+	const bool Threaded = m_vpSnapWorkers.size() > 1;
+	m_NumSnapJobs = 0;
+
+	// send the snapshots of all clients with as few syscalls as possible
+	m_NetServer.SetSendBatching(true);
+
 	// create snapshots for all clients
 	for(int i = 0; i < MaxClients(); i++)
 	{
@@ -968,6 +981,14 @@ void CServer::DoSnapshot()
 		if(!IsGlobalSnap && !(m_aClients[i].m_ForceHighBandwidthOnSpectate && GameServer()->IsClientHighBandwidth(i)))
 			continue;
 
+		// without worker threads every snapshot is finished right away
+		// and the job is reused
+		if((int)m_vpSnapJobs.size() <= m_NumSnapJobs)
+			m_vpSnapJobs.push_back(std::make_unique<CSnapJob>());
+		CSnapJob *pJob = m_vpSnapJobs[m_NumSnapJobs].get();
+		if(Threaded)
+			m_NumSnapJobs++;
+
 		{
 			m_SnapshotBuilder.Init(m_aClients[i].m_Sixup);
 
@@ -975,97 +996,189 @@ void CServer::DoSnapshot()
 			GameServer()->OnSnap(i, IsGlobalSnap);
 
 			// finish snapshot
-			char aData[CSnapshot::MAX_SIZE];
-			CSnapshot *pData = (CSnapshot *)aData; // Fix compiler warning for strict-aliasing
-			int SnapshotSize = m_SnapshotBuilder.Finish(pData);
+			pJob->m_ClientId = i;
+			pJob->m_Size = m_SnapshotBuilder.Finish(pJob->m_aData);
 
 			if(m_aDemoRecorder[i].IsRecording())
 			{
 				// write snapshot
-				m_aDemoRecorder[i].RecordSnapshot(Tick(), aData, SnapshotSize);
+				m_aDemoRecorder[i].RecordSnapshot(Tick(), pJob->m_aData, pJob->m_Size);
 			}
+		}
 
-			int Crc = pData->Crc();
+		if(!Threaded)
+		{
+			ProcessSnapJob(pJob, m_vpSnapWorkers[0].get());
+			SendSnapJob(pJob);
+		}
+	}
 
-			// remove old snapshots
-			// keep 3 seconds worth of snapshots
-			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick - TickSpeed() * 3);
+	if(Threaded)
+	{
+		for(size_t i = 1; i < m_vpSnapWorkers.size(); i++)
+			m_vpSnapWorkers[i]->m_Activate.Signal();
+		RunSnapJobs(m_vpSnapWorkers[0].get());
+		for(size_t i = 1; i < m_vpSnapWorkers.size(); i++)
+			m_SnapWorkersDone.Wait();
 
-			// save the snapshot
-			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0, nullptr);
+		// send in client order, independent of the worker that created it
+		for(int i = 0; i < m_NumSnapJobs; i++)
+			SendSnapJob(m_vpSnapJobs[i].get());
+	}
 
-			// find snapshot that we can perform delta against
-			int DeltaTick = -1;
-			const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
-			{
-				int DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, nullptr, &pDeltashot, nullptr);
-				if(DeltashotSize >= 0)
-					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
-				else
-				{
-					// no acked package found, force client to recover rate
-					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
-						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
-				}
-			}
+	m_NetServer.SetSendBatching(false);
 
-			// create delta
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, m_aClients[i].m_Sixup);
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, m_aClients[i].m_Sixup);
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			int DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+	if(IsGlobalSnap)
+	{
+		GameServer()->OnPostGlobalSnap();
+	}
+}
 
-			if(DeltaSize)
-			{
-				// compress it
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+void CServer::CSnapWorker::ThreadFunc(void *pUser)
+{
+	CSnapWorker *pThis = (CSnapWorker *)pUser;
+	while(true)
+	{
+		pThis->m_Activate.Wait();
+		if(pThis->m_pServer->m_SnapWorkersShutdown)
+			return;
+		pThis->m_pServer->RunSnapJobs(pThis);
+		pThis->m_pServer->m_SnapWorkersDone.Signal();
+	}
+}
 
-				char aCompData[CSnapshot::MAX_SIZE];
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+void CServer::StartSnapWorkers(int NumThreads)
+{
+	StopSnapWorkers();
 
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+	// worker 0 is the main thread itself
+	for(int i = 0; i <= NumThreads; i++)
+	{
+		std::unique_ptr<CSnapWorker> pWorker = std::make_unique<CSnapWorker>();
+		pWorker->m_pServer = this;
+		pWorker->m_Index = i;
+		if(i == 0)
+		{
+			pWorker->m_pSnapshotDelta = &m_SnapshotDelta;
+		}
+		else
+		{
+			pWorker->m_pOwnSnapshotDelta = std::make_unique<CSnapshotDelta>(m_SnapshotDelta);
+			pWorker->m_pSnapshotDelta = pWorker->m_pOwnSnapshotDelta.get();
+			char aName[32];
+			str_format(aName, sizeof(aName), "snapshot worker %d", i);
+			pWorker->m_pThread = thread_init(CSnapWorker::ThreadFunc, pWorker.get(), aName);
+		}
+		m_vpSnapWorkers.push_back(std::move(pWorker));
+	}
+}
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
+void CServer::StopSnapWorkers()
+{
+	m_SnapWorkersShutdown = true;
+	for(auto &pWorker : m_vpSnapWorkers)
+	{
+		if(pWorker->m_pThread)
+		{
+			pWorker->m_Activate.Signal();
+			thread_wait(pWorker->m_pThread);
+		}
+	}
+	m_vpSnapWorkers.clear();
+	m_SnapWorkersShutdown = false;
+}
+
+void CServer::RunSnapJobs(CSnapWorker *pWorker)
+{
+	// static distribution so every job always ends up on the same worker
+	for(int i = pWorker->m_Index; i < m_NumSnapJobs; i += m_vpSnapWorkers.size())
+		ProcessSnapJob(m_vpSnapJobs[i].get(), pWorker);
+}
+
+void CServer::ProcessSnapJob(CSnapJob *pJob, CSnapWorker *pWorker)
+{
+	// only touches the state of the job's client, so that jobs of
+	// different clients can run in parallel
+	CClient &Client = m_aClients[pJob->m_ClientId];
+	const CSnapshot *pData = (const CSnapshot *)pJob->m_aData;
+
+	pJob->m_Crc = pData->Crc();
+
+	// remove old snapshots
+	// keep 3 seconds worth of snapshots
+	Client.m_Snapshots.PurgeUntil(m_CurrentGameTick - TickSpeed() * 3);
+
+	// save the snapshot
+	Client.m_Snapshots.Add(m_CurrentGameTick, time_get(), pJob->m_Size, pData, 0, nullptr);
+
+	// find snapshot that we can perform delta against
+	pJob->m_DeltaTick = -1;
+	const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
+	{
+		int DeltashotSize = Client.m_Snapshots.Get(Client.m_LastAckedSnapshot, nullptr, &pDeltashot, nullptr);
+		if(DeltashotSize >= 0)
+			pJob->m_DeltaTick = Client.m_LastAckedSnapshot;
+		else
+		{
+			// no acked package found, force client to recover rate
+			if(Client.m_SnapRate == CClient::SNAPRATE_FULL)
+				Client.m_SnapRate = CClient::SNAPRATE_RECOVER;
+		}
+	}
+
+	// create delta
+	pWorker->m_pSnapshotDelta->SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, Client.m_Sixup);
+	pWorker->m_pSnapshotDelta->SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, Client.m_Sixup);
+	int DeltaSize = pWorker->m_pSnapshotDelta->CreateDelta(pDeltashot, pData, pWorker->m_aDeltaData);
+
+	// compress it, the snapshot itself is not needed anymore
+	pJob->m_Size = DeltaSize ? CVariableInt::Compress(pWorker->m_aDeltaData, DeltaSize, pJob->m_aData, sizeof(pJob->m_aData)) : 0;
+}
+
+void CServer::SendSnapJob(const CSnapJob *pJob)
+{
+	const int ClientId = pJob->m_ClientId;
+	if(pJob->m_Size)
+	{
+		const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+
+		int NumPackets = (pJob->m_Size + MaxSize - 1) / MaxSize;
+
+		for(int n = 0, Left = pJob->m_Size; Left > 0; n++)
+		{
+			int Chunk = Left < MaxSize ? Left : MaxSize;
+			Left -= Chunk;
+
+			if(NumPackets == 1)
+			{
+				CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick - pJob->m_DeltaTick);
+				Msg.AddInt(pJob->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pJob->m_aData[n * MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientId);
 			}
 			else
 			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+				CMsgPacker Msg(NETMSG_SNAP, true);
 				Msg.AddInt(m_CurrentGameTick);
-				Msg.AddInt(m_CurrentGameTick - DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				Msg.AddInt(m_CurrentGameTick - pJob->m_DeltaTick);
+				Msg.AddInt(NumPackets);
+				Msg.AddInt(n);
+				Msg.AddInt(pJob->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pJob->m_aData[n * MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientId);
 			}
 		}
 	}
-
-	if(IsGlobalSnap)
+	else
 	{
-		GameServer()->OnPostGlobalSnap();
+		CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+		Msg.AddInt(m_CurrentGameTick);
+		Msg.AddInt(m_CurrentGameTick - pJob->m_DeltaTick);
+		SendMsg(&Msg, MSGFLAG_FLUSH, ClientId);
 	}
 }
 
@@ -2793,6 +2906,100 @@ void CServer::ChangeMap(const char *pMap)
 void CServer::ReloadMap()
 {
 	m_SameMapReload = true;
+	// the map might have changed on disk since it was preloaded
+	m_pMapLoadJob = nullptr;
+}
+
+void CServer::PreloadMap(const char *pMap)
+{
+	m_pMapLoadJob = std::make_shared<CMapLoadJob>(Storage(), m_pMap, pMap, Config()->m_SvSixup, Config()->m_SvMapMmap);
+	Engine()->AddJob(m_pMapLoadJob);
+}
+
+bool CServer::MapLoadReady()
+{
+	if(!m_pMapLoadJob || str_comp(m_pMapLoadJob->m_aMapName, Config()->m_SvMap) != 0)
+		PreloadMap(Config()->m_SvMap);
+	return m_pMapLoadJob->Done();
+}
+
+void CServer::FreeCurrentMapData(int MapType)
+{
+	if(MapType == MAP_TYPE_SIX && m_CurrentMapDataMapped)
+		m_CurrentMapDataMapped = false;
+	else
+		free(const_cast<unsigned char *>(m_apCurrentMapData[MapType]));
+	m_apCurrentMapData[MapType] = nullptr;
+}
+
+CServer::CMapLoadJob::CMapLoadJob(IStorage *pStorage, IEngineMap *pMap, const char *pMapName, bool Sixup, bool Mapped) :
+	m_pStorage(pStorage),
+	m_pMap(pMap),
+	m_Sixup(Sixup),
+	m_Mapped(Mapped),
+	m_Success(false)
+{
+	str_copy(m_aMapName, pMapName);
+	str_format(m_aPath, sizeof(m_aPath), "maps/%s.map", pMapName);
+	for(int i = 0; i < NUM_MAP_TYPES; i++)
+	{
+		m_aSha256[i] = SHA256_ZEROED;
+		m_aCrc[i] = 0;
+		m_apData[i] = nullptr;
+		m_aSize[i] = 0;
+	}
+}
+
+CServer::CMapLoadJob::~CMapLoadJob()
+{
+	for(auto *pData : m_apData)
+		free(pData);
+}
+
+void CServer::CMapLoadJob::Run()
+{
+	Load();
+}
+
+void CServer::CMapLoadJob::Load()
+{
+	m_Success = m_pMap->Prepare(m_pStorage, m_aPath, &m_DataFile, m_Mapped);
+	if(!m_Success)
+		return;
+
+	m_aSha256[MAP_TYPE_SIX] = m_DataFile.Sha256();
+	m_aCrc[MAP_TYPE_SIX] = m_DataFile.Crc();
+
+	// load complete map into memory for download, unless the mapping can be
+	// sent directly
+	if(m_DataFile.MappedFile() != nullptr)
+	{
+		m_aSize[MAP_TYPE_SIX] = m_DataFile.MapSize();
+	}
+	else
+	{
+		void *pData;
+		m_pStorage->ReadFile(m_aPath, IStorage::TYPE_ALL, &pData, &m_aSize[MAP_TYPE_SIX]);
+		m_apData[MAP_TYPE_SIX] = (unsigned char *)pData;
+	}
+
+	if(m_Sixup)
+		LoadSixup();
+}
+
+void CServer::CMapLoadJob::LoadSixup()
+{
+	m_Sixup = true;
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "maps7/%s.map", m_aMapName);
+	void *pData;
+	if(!m_pStorage->ReadFile(aPath, IStorage::TYPE_ALL, &pData, &m_aSize[MAP_TYPE_SIXUP]))
+		return;
+
+	m_apData[MAP_TYPE_SIXUP] = (unsigned char *)pData;
+	m_aSha256[MAP_TYPE_SIXUP] = sha256(pData, m_aSize[MAP_TYPE_SIXUP]);
+	m_aCrc[MAP_TYPE_SIXUP] = crc32(0, m_apData[MAP_TYPE_SIXUP], m_aSize[MAP_TYPE_SIXUP]);
 }
 
 int CServer::LoadMap(const char *pMapName)
@@ -2806,17 +3013,29 @@ int CServer::LoadMap(const char *pMapName)
 	{
 		return 0;
 	}
-	if(!m_pMap->Load(aBuf))
+
+	// use the map loaded in the background if there is one, otherwise load
+	// it now
+	std::shared_ptr<CMapLoadJob> pJob = std::move(m_pMapLoadJob);
+	if(!pJob || pJob->State() != IJob::STATE_DONE || str_comp(pJob->m_aPath, aBuf) != 0)
+	{
+		pJob = std::make_shared<CMapLoadJob>(Storage(), m_pMap, pMapName, Config()->m_SvSixup, Config()->m_SvMapMmap);
+		str_copy(pJob->m_aPath, aBuf);
+		pJob->Load();
+	}
+	if(!pJob->m_Success)
 	{
 		return 0;
 	}
+	const unsigned char *pMappedData = pJob->m_DataFile.MappedFile();
+	m_pMap->LoadPrepared(std::move(pJob->m_DataFile));
 
 	// reinit snapshot ids
 	m_IdPool.TimeoutIds();
 
 	// get the crc of the map
-	m_aCurrentMapSha256[MAP_TYPE_SIX] = m_pMap->Sha256();
-	m_aCurrentMapCrc[MAP_TYPE_SIX] = m_pMap->Crc();
+	m_aCurrentMapSha256[MAP_TYPE_SIX] = pJob->m_aSha256[MAP_TYPE_SIX];
+	m_aCurrentMapCrc[MAP_TYPE_SIX] = pJob->m_aCrc[MAP_TYPE_SIX];
 	char aBufMsg[256];
 	char aSha256[SHA256_MAXSTRSIZE];
 	sha256_str(m_aCurrentMapSha256[MAP_TYPE_SIX], aSha256, sizeof(aSha256));
@@ -2826,13 +3045,19 @@ int CServer::LoadMap(const char *pMapName)
 	str_copy(m_aCurrentMap, pMapName);
 	m_pCurrentMapName = fs_filename(m_aCurrentMap);
 
-	// load complete map into memory for download
+	// take the complete map for download
+	FreeCurrentMapData(MAP_TYPE_SIX);
+	if(pMappedData != nullptr)
 	{
-		free(m_apCurrentMapData[MAP_TYPE_SIX]);
-		void *pData;
-		Storage()->ReadFile(aBuf, IStorage::TYPE_ALL, &pData, &m_aCurrentMapSize[MAP_TYPE_SIX]);
-		m_apCurrentMapData[MAP_TYPE_SIX] = (unsigned char *)pData;
+		m_apCurrentMapData[MAP_TYPE_SIX] = pMappedData;
+		m_CurrentMapDataMapped = true;
 	}
+	else
+	{
+		m_apCurrentMapData[MAP_TYPE_SIX] = pJob->m_apData[MAP_TYPE_SIX];
+		pJob->m_apData[MAP_TYPE_SIX] = nullptr;
+	}
+	m_aCurrentMapSize[MAP_TYPE_SIX] = pJob->m_aSize[MAP_TYPE_SIX];
 
 	if(Config()->m_SvMapsBaseUrl[0])
 	{
@@ -2849,9 +3074,12 @@ int CServer::LoadMap(const char *pMapName)
 	// load sixup version of the map
 	if(Config()->m_SvSixup)
 	{
+		// sixup was enabled after the map started loading
+		if(!pJob->m_Sixup)
+			pJob->LoadSixup();
+
 		str_format(aBuf, sizeof(aBuf), "maps7/%s.map", pMapName);
-		void *pData;
-		if(!Storage()->ReadFile(aBuf, IStorage::TYPE_ALL, &pData, &m_aCurrentMapSize[MAP_TYPE_SIXUP]))
+		if(!pJob->m_apData[MAP_TYPE_SIXUP])
 		{
 			Config()->m_SvSixup = 0;
 			if(m_pRegister)
@@ -2863,11 +3091,13 @@ int CServer::LoadMap(const char *pMapName)
 		}
 		else
 		{
-			free(m_apCurrentMapData[MAP_TYPE_SIXUP]);
-			m_apCurrentMapData[MAP_TYPE_SIXUP] = (unsigned char *)pData;
+			FreeCurrentMapData(MAP_TYPE_SIXUP);
+			m_apCurrentMapData[MAP_TYPE_SIXUP] = pJob->m_apData[MAP_TYPE_SIXUP];
+			m_aCurrentMapSize[MAP_TYPE_SIXUP] = pJob->m_aSize[MAP_TYPE_SIXUP];
+			pJob->m_apData[MAP_TYPE_SIXUP] = nullptr;
 
-			m_aCurrentMapSha256[MAP_TYPE_SIXUP] = sha256(m_apCurrentMapData[MAP_TYPE_SIXUP], m_aCurrentMapSize[MAP_TYPE_SIXUP]);
-			m_aCurrentMapCrc[MAP_TYPE_SIXUP] = crc32(0, m_apCurrentMapData[MAP_TYPE_SIXUP], m_aCurrentMapSize[MAP_TYPE_SIXUP]);
+			m_aCurrentMapSha256[MAP_TYPE_SIXUP] = pJob->m_aSha256[MAP_TYPE_SIXUP];
+			m_aCurrentMapCrc[MAP_TYPE_SIXUP] = pJob->m_aCrc[MAP_TYPE_SIXUP];
 			sha256_str(m_aCurrentMapSha256[MAP_TYPE_SIXUP], aSha256, sizeof(aSha256));
 			str_format(aBufMsg, sizeof(aBufMsg), "%s sha256 is %s", aBuf, aSha256);
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "sixup", aBufMsg);
@@ -2875,8 +3105,7 @@ int CServer::LoadMap(const char *pMapName)
 	}
 	if(!Config()->m_SvSixup)
 	{
-		free(m_apCurrentMapData[MAP_TYPE_SIXUP]);
-		m_apCurrentMapData[MAP_TYPE_SIXUP] = nullptr;
+		FreeCurrentMapData(MAP_TYPE_SIXUP);
 	}
 
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -3005,7 +3234,7 @@ int CServer::Run()
 	BindAddr.type = Config()->m_SvIpv4Only ? NETTYPE_IPV4 : NETTYPE_ALL;
 
 	int Port = Config()->m_SvPort;
-	for(BindAddr.port = Port != 0 ? Port : 8303; !m_NetServer.Open(BindAddr, &m_ServerBan, Config()->m_SvMaxClients, Config()->m_SvMaxClientsPerIp); BindAddr.port++)
+	for(BindAddr.port = Port != 0 ? Port : 8303; !m_NetServer.Open(BindAddr, &m_ServerBan, Config()->m_SvMaxClients, Config()->m_SvMaxClientsPerIp, Config()->m_SvNetRecvThread); BindAddr.port++)
 	{
 		if(Port != 0 || BindAddr.port >= 8310)
 		{
@@ -3085,8 +3314,8 @@ int CServer::Run()
 			int64_t LastTime = time_get();
 			int NewTicks = 0;
 
-			// load new map
-			if(m_MapReload || m_SameMapReload || m_CurrentGameTick >= MAX_TICK) // force reload to make sure the ticks stay within a valid range
+			// load new map once it is loaded in the background
+			if((m_MapReload || m_SameMapReload || m_CurrentGameTick >= MAX_TICK) && MapLoadReady()) // force reload to make sure the ticks stay within a valid range
 			{
 				const bool SameMapReload = m_SameMapReload;
 				// load map
@@ -3328,14 +3557,14 @@ int CServer::Run()
 				!m_aDemoRecorder[RECORDER_MANUAL].IsRecording() &&
 				!m_aDemoRecorder[RECORDER_AUTO].IsRecording())
 			{
-				PacketWaiting = net_socket_read_wait(m_NetServer.Socket(), 1s);
+				PacketWaiting = m_NetServer.Wait(1s);
 			}
 			else
 			{
 				set_new_tick();
 				LastTime = time_get();
 				const auto MicrosecondsToWait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(TickStartTime(m_CurrentGameTick + 1) - LastTime)) + 1us;
-				PacketWaiting = MicrosecondsToWait > 0us ? net_socket_read_wait(m_NetServer.Socket(), MicrosecondsToWait) : true;
+				PacketWaiting = MicrosecondsToWait > 0us ? m_NetServer.Wait(MicrosecondsToWait) : true;
 			}
 			if(IsInterrupted())
 			{
@@ -3368,6 +3597,7 @@ int CServer::Run()
 	GameServer()->OnShutdown(nullptr);
 	m_pMap->Unload();
 	DbPool()->OnShutdown();
+	StopSnapWorkers();
 
 #if defined(CONF_UPNP)
 	m_UPnP.Shutdown();
@@ -3959,6 +4189,12 @@ void CServer::ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData)
 	}
 }
 
+void CServer::ConDumpSqlStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CServer *pSelf = (CServer *)pUserData;
+	pSelf->DbPool()->PrintStats(pSelf->Console());
+}
+
 void CServer::ConReloadAnnouncement(IConsole::IResult *pResult, void *pUserData)
 {
 	CServer *pThis = static_cast<CServer *>(pUserData);
@@ -4234,6 +4470,7 @@ void CServer::RegisterCommands()
 
 	Console()->Register("add_sqlserver", "s['r'|'w'] s[Database] s[Prefix] s[User] s[Password] s[IP] i[Port] ?i[SetUpDatabase ?]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAddSqlServer, this, "add a sqlserver");
 	Console()->Register("dump_sqlservers", "s['r'|'w']", CFGFLAG_SERVER, ConDumpSqlServers, this, "dumps all sqlservers readservers = r, writeservers = w");
+	Console()->Register("dump_sqlstats", "", CFGFLAG_SERVER, ConDumpSqlStats, this, "dumps depth and latency histogram of the read and write sql queues");
 
 	Console()->Register("auth_add", "s[ident] s[level] r[pw]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAdd, this, "Add a rcon key");
 	Console()->Register("auth_add_p", "s[ident] s[level] s[hash] s[salt]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAddHashed, this, "Add a prehashed rcon key");
@@ -4290,12 +4527,31 @@ void CServer::SnapFreeId(int Id)
 void *CServer::SnapNewItem(int Type, int Id, int Size)
 {
 	dbg_assert(Id >= -1 && Id <= 0xffff, "incorrect id");
-	return Id < 0 ? nullptr : m_SnapshotBuilder.NewItem(Type, Id, Size);
+	if(Id < 0)
+		return nullptr;
+	if(m_pSnapItemPool)
+		return m_pSnapItemPool->NewItem(Type, Id, Size);
+	return m_SnapshotBuilder.NewItem(Type, Id, Size);
 }
 
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+	for(auto &pWorker : m_vpSnapWorkers)
+	{
+		if(pWorker->m_pOwnSnapshotDelta)
+			pWorker->m_pOwnSnapshotDelta->SetStaticsize(ItemType, Size);
+	}
+}
+
+void CServer::SnapSetItemPool(CSnapshotItemPool *pPool)
+{
+	m_pSnapItemPool = pPool;
+}
+
+bool CServer::SnapAddItemPoolGroup(const CSnapshotItemPool *pPool, int Group)
+{
+	return pPool->AddGroup(&m_SnapshotBuilder, Group);
 }
 
 CServer *CreateServer() { return new CServer(); }
@@ -4,20 +4,24 @@
 #define ENGINE_SERVER_SERVER_H
 
 #include <base/hash.h>
+#include <base/tl/threading.h>
 
 #include <engine/console.h>
 #include <engine/server.h>
 
 #include <engine/shared/demo.h>
 #include <engine/shared/econ.h>
+#include <engine/shared/datafile.h>
 #include <engine/shared/fifo.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
 #include <engine/shared/uuid_manager.h>
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -39,6 +43,7 @@ class CPacker;
 class IEngine;
 class IEngineMap;
 class ILogger;
+class IStorage;
 
 class CServerBan : public CNetBan
 {
@@ -213,6 +218,47 @@ public:
 
 	CSnapshotDelta m_SnapshotDelta;
 	CSnapshotBuilder m_SnapshotBuilder;
+	CSnapshotItemPool *m_pSnapItemPool = nullptr;
+
+	// Snapshot of a client that still has to be stored, delta compressed
+	// and split into packets. After processing m_aData holds the
+	// compressed delta.
+	class CSnapJob
+	{
+	public:
+		int m_ClientId;
+		int m_Size;
+		int m_Crc;
+		int m_DeltaTick;
+		char m_aData[CSnapshot::MAX_SIZE];
+	};
+
+	// Processes every NumWorkers-th snap job, worker 0 runs on the main
+	// thread and uses the delta tables of the server directly.
+	class CSnapWorker
+	{
+	public:
+		CServer *m_pServer;
+		int m_Index;
+		void *m_pThread = nullptr;
+		CSemaphore m_Activate;
+		std::unique_ptr<CSnapshotDelta> m_pOwnSnapshotDelta;
+		CSnapshotDelta *m_pSnapshotDelta;
+		char m_aDeltaData[CSnapshot::MAX_SIZE];
+
+		static void ThreadFunc(void *pUser);
+	};
+	std::vector<std::unique_ptr<CSnapWorker>> m_vpSnapWorkers;
+	std::vector<std::unique_ptr<CSnapJob>> m_vpSnapJobs;
+	int m_NumSnapJobs = 0;
+	CSemaphore m_SnapWorkersDone;
+	std::atomic_bool m_SnapWorkersShutdown{false};
+
+	void StartSnapWorkers(int NumThreads);
+	void StopSnapWorkers();
+	void RunSnapJobs(CSnapWorker *pWorker);
+	void ProcessSnapJob(CSnapJob *pJob, CSnapWorker *pWorker);
+	void SendSnapJob(const CSnapJob *pJob);
 	CSnapIdPool m_IdPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
@@ -261,10 +307,41 @@ public:
 	const char *m_pCurrentMapName;
 	SHA256_DIGEST m_aCurrentMapSha256[NUM_MAP_TYPES];
 	unsigned m_aCurrentMapCrc[NUM_MAP_TYPES];
-	unsigned char *m_apCurrentMapData[NUM_MAP_TYPES];
+	const unsigned char *m_apCurrentMapData[NUM_MAP_TYPES];
 	unsigned int m_aCurrentMapSize[NUM_MAP_TYPES];
+	// the map data is the mapping of the loaded map instead of a copy
+	bool m_CurrentMapDataMapped;
 	char m_aMapDownloadUrl[256];
 
+	// Reads, hashes and opens a map on a worker thread, so that the main
+	// thread only has to swap it in when changing the map.
+	class CMapLoadJob : public IJob
+	{
+		IStorage *m_pStorage;
+		IEngineMap *m_pMap;
+
+		void Run() override;
+
+	public:
+		CMapLoadJob(IStorage *pStorage, IEngineMap *pMap, const char *pMapName, bool Sixup, bool Mapped);
+		~CMapLoadJob() override;
+
+		void Load();
+		void LoadSixup();
+
+		char m_aMapName[IO_MAX_PATH_LENGTH];
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		bool m_Sixup;
+		bool m_Mapped;
+		bool m_Success;
+		CDataFileReader m_DataFile;
+		SHA256_DIGEST m_aSha256[NUM_MAP_TYPES];
+		unsigned m_aCrc[NUM_MAP_TYPES];
+		unsigned char *m_apData[NUM_MAP_TYPES];
+		unsigned int m_aSize[NUM_MAP_TYPES];
+	};
+	std::shared_ptr<CMapLoadJob> m_pMapLoadJob;
+
 	CDemoRecorder m_aDemoRecorder[NUM_RECORDERS];
 	CAuthManager m_AuthManager;
 
@@ -416,6 +493,9 @@ public:
 	void ChangeMap(const char *pMap) override;
 	const char *GetMapName() const override;
 	void ReloadMap() override;
+	void PreloadMap(const char *pMap) override;
+	bool MapLoadReady();
+	void FreeCurrentMapData(int MapType);
 	int LoadMap(const char *pMapName);
 
 	void SaveDemo(int ClientId, float Time) override;
@@ -447,6 +527,7 @@ public:
 	// console commands for sqlmasters
 	static void ConAddSqlServer(IConsole::IResult *pResult, void *pUserData);
 	static void ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpSqlStats(IConsole::IResult *pResult, void *pUserData);
 
 	static void ConReloadAnnouncement(IConsole::IResult *pResult, void *pUserData);
 	static void ConReloadMaplist(IConsole::IResult *pResult, void *pUserData);
@@ -479,6 +560,8 @@ public:
 	void SnapFreeId(int Id) override;
 	void *SnapNewItem(int Type, int Id, int Size) override;
 	void SnapSetStaticsize(int ItemType, int Size) override;
+	void SnapSetItemPool(CSnapshotItemPool *pPool) override;
+	bool SnapAddItemPoolGroup(const CSnapshotItemPool *pPool, int Group) override;
 
 	// DDRace
 
@@ -130,6 +130,8 @@ class CDatafile
 public:
 	IOHANDLE m_File;
 	unsigned m_FileSize;
+	// whole file if it was opened mapped, nullptr otherwise
+	unsigned char *m_pMapped;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
@@ -139,6 +141,18 @@ public:
 	int *m_pDataSizes;
 	char *m_pData;
 
+	bool IsMappedData(const void *pData) const
+	{
+		return m_pMapped != nullptr && pData >= m_pMapped && pData < m_pMapped + m_FileSize;
+	}
+
+	void FreeData(int Index) const
+	{
+		if(!IsMappedData(m_ppDataPtrs[Index]))
+			free(m_ppDataPtrs[Index]);
+		m_ppDataPtrs[Index] = nullptr;
+	}
+
 	int GetFileDataSize(int Index) const
 	{
 		dbg_assert(Index >= 0 && Index < m_Header.m_NumRawData, "Index invalid: %d", Index);
@@ -213,41 +227,51 @@ public:
 				return nullptr;
 			}
 
-			// read the compressed data
-			void *pCompressedData = malloc(DataSize);
-			if(pCompressedData == nullptr)
+			// read the compressed data, or decompress straight from the mapping
+			void *pCompressedData;
+			if(m_pMapped != nullptr)
 			{
-				log_error("datafile", "out of memory. could not allocate memory for compressed data. index=%d size=%d", Index, DataSize);
-				m_ppDataPtrs[Index] = nullptr;
-				m_pDataSizes[Index] = -1;
-				return nullptr;
+				pCompressedData = m_pMapped + m_DataStartOffset + m_Info.m_pDataOffsets[Index];
 			}
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_File, m_DataStartOffset + m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-			{
-				ActualDataSize = io_read(m_File, pCompressedData, DataSize);
-			}
-			if(DataSize != ActualDataSize)
+			else
 			{
-				log_error("datafile", "truncation error. could not read all compressed data. index=%d wanted=%d got=%d", Index, DataSize, ActualDataSize);
-				free(pCompressedData);
-				m_ppDataPtrs[Index] = nullptr;
-				m_pDataSizes[Index] = -1;
-				return nullptr;
+				pCompressedData = malloc(DataSize);
+				if(pCompressedData == nullptr)
+				{
+					log_error("datafile", "out of memory. could not allocate memory for compressed data. index=%d size=%d", Index, DataSize);
+					m_ppDataPtrs[Index] = nullptr;
+					m_pDataSizes[Index] = -1;
+					return nullptr;
+				}
+				unsigned ActualDataSize = 0;
+				if(io_seek(m_File, m_DataStartOffset + m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
+				{
+					ActualDataSize = io_read(m_File, pCompressedData, DataSize);
+				}
+				if(DataSize != ActualDataSize)
+				{
+					log_error("datafile", "truncation error. could not read all compressed data. index=%d wanted=%d got=%d", Index, DataSize, ActualDataSize);
+					free(pCompressedData);
+					m_ppDataPtrs[Index] = nullptr;
+					m_pDataSizes[Index] = -1;
+					return nullptr;
+				}
 			}
 
 			// decompress the data
 			m_ppDataPtrs[Index] = static_cast<char *>(malloc(OriginalUncompressedSize));
 			if(m_ppDataPtrs[Index] == nullptr)
 			{
-				free(pCompressedData);
+				if(!IsMappedData(pCompressedData))
+					free(pCompressedData);
 				log_error("datafile", "out of memory. could not allocate memory for uncompressed data. index=%d size=%d", Index, OriginalUncompressedSize);
 				m_pDataSizes[Index] = -1;
 				return nullptr;
 			}
 			unsigned long UncompressedSize = OriginalUncompressedSize;
 			const int Result = uncompress(static_cast<Bytef *>(m_ppDataPtrs[Index]), &UncompressedSize, static_cast<Bytef *>(pCompressedData), DataSize);
-			free(pCompressedData);
+			if(!IsMappedData(pCompressedData))
+				free(pCompressedData);
 			if(Result != Z_OK || UncompressedSize != OriginalUncompressedSize)
 			{
 				log_error("datafile", "failed to uncompress data. index=%d result=%d wanted=%d got=%ld", Index, Result, OriginalUncompressedSize, UncompressedSize);
@@ -258,6 +282,13 @@ public:
 			}
 			m_pDataSizes[Index] = OriginalUncompressedSize;
 		}
+		else if(m_pMapped != nullptr)
+		{
+			// uncompressed data is used from the mapping without copying it
+			log_trace("datafile", "mapping data. index=%d size=%d", Index, DataSize);
+			m_ppDataPtrs[Index] = m_pMapped + m_DataStartOffset + m_Info.m_pDataOffsets[Index];
+			m_pDataSizes[Index] = DataSize;
+		}
 		else
 		{
 			log_trace("datafile", "loading data. index=%d size=%d", Index, DataSize);
@@ -442,7 +473,7 @@ CDataFileReader &CDataFileReader::operator=(CDataFileReader &&Other)
 	return *this;
 }
 
-bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
+bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType, bool Mapped)
 {
 	dbg_assert(m_pDataFile == nullptr, "File already open");
 
@@ -608,6 +639,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
 	pTmpDataFile->m_File = File;
 	pTmpDataFile->m_FileSize = FileSize;
+	pTmpDataFile->m_pMapped = nullptr;
 	pTmpDataFile->m_Sha256 = Sha256;
 	pTmpDataFile->m_Crc = Crc;
 
@@ -652,6 +684,15 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		return false;
 	}
 
+	if(Mapped)
+	{
+		pTmpDataFile->m_pMapped = static_cast<unsigned char *>(io_map(File, FileSize));
+		if(pTmpDataFile->m_pMapped == nullptr)
+		{
+			log_warn("datafile", "could not map file, data will be read instead. datafile='%s'", pFilename);
+		}
+	}
+
 	m_pDataFile = pTmpDataFile;
 	log_trace("datafile", "loading done. datafile='%s'", pFilename);
 
@@ -667,9 +708,13 @@ void CDataFileReader::Close()
 
 	for(int i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
 	{
-		free(m_pDataFile->m_ppDataPtrs[i]);
+		m_pDataFile->FreeData(i);
 	}
 
+	if(m_pDataFile->m_pMapped != nullptr)
+	{
+		io_unmap(m_pDataFile->m_pMapped, m_pDataFile->m_FileSize);
+	}
 	io_close(m_pDataFile->m_File);
 	free(m_pDataFile);
 	m_pDataFile = nullptr;
@@ -687,6 +732,13 @@ IOHANDLE CDataFileReader::File() const
 	return m_pDataFile->m_File;
 }
 
+const unsigned char *CDataFileReader::MappedFile() const
+{
+	dbg_assert(m_pDataFile != nullptr, "File not open");
+
+	return m_pDataFile->m_pMapped;
+}
+
 int CDataFileReader::GetDataSize(int Index) const
 {
 	dbg_assert(m_pDataFile != nullptr, "File not open");
@@ -736,7 +788,7 @@ void CDataFileReader::ReplaceData(int Index, char *pData, size_t Size)
 	dbg_assert(m_pDataFile != nullptr, "File not open");
 	dbg_assert(Index >= 0 && Index < m_pDataFile->m_Header.m_NumRawData, "Index invalid: %d", Index);
 
-	free(m_pDataFile->m_ppDataPtrs[Index]);
+	m_pDataFile->FreeData(Index);
 	m_pDataFile->m_ppDataPtrs[Index] = pData;
 	m_pDataFile->m_pDataSizes[Index] = Size;
 }
@@ -748,8 +800,7 @@ void CDataFileReader::UnloadData(int Index)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return;
 
-	free(m_pDataFile->m_ppDataPtrs[Index]);
-	m_pDataFile->m_ppDataPtrs[Index] = nullptr;
+	m_pDataFile->FreeData(Index);
 	m_pDataFile->m_pDataSizes[Index] = 0;
 }
 
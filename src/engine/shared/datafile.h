@@ -31,10 +31,14 @@ public:
 	~CDataFileReader();
 	CDataFileReader &operator=(CDataFileReader &&Other);
 
-	[[nodiscard]] bool Open(class IStorage *pStorage, const char *pFilename, int StorageType);
+	// Mapped serves uncompressed data from a mapping of the file and
+	// decompresses from it without copying
+	[[nodiscard]] bool Open(class IStorage *pStorage, const char *pFilename, int StorageType, bool Mapped = false);
 	void Close();
 	bool IsOpen() const;
 	IOHANDLE File() const;
+	// the whole file if it was opened mapped, nullptr otherwise
+	const unsigned char *MappedFile() const;
 
 	int GetDataSize(int Index) const;
 	void *GetData(int Index);
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <base/system.h>
 
+#include <cstdint>
+
 const unsigned CHuffman::ms_aFreqTable[HUFFMAN_MAX_SYMBOLS] = {
 	1 << 30, 4545, 2657, 431, 1950, 919, 444, 482, 2244, 617, 838, 542, 715, 1814, 304, 240, 754, 212, 647, 186,
 	283, 131, 146, 166, 543, 164, 167, 136, 179, 859, 363, 113, 157, 154, 204, 108, 137, 180, 202, 176,
@@ -94,110 +96,116 @@ void CHuffman::Init(const unsigned *pFrequencies)
 {
 	// make sure to cleanout every thing
 	mem_zero(m_aNodes, sizeof(m_aNodes));
-	mem_zero(m_apDecodeLut, sizeof(m_apDecodeLut));
+	mem_zero(m_aDecodeLut, sizeof(m_aDecodeLut));
 	m_pStartNode = nullptr;
 	m_NumNodes = 0;
 
 	// construct the tree
 	ConstructTree(pFrequencies);
 
+	m_MaxCodeBits = 0;
+	for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+		m_MaxCodeBits = std::max(m_MaxCodeBits, (int)m_aNodes[i].m_NumBits);
+
 	// build decode LUT
 	for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
 	{
-		unsigned Bits = i;
-		int k;
-		CNode *pNode = m_pStartNode;
-		for(k = 0; k < HUFFMAN_LUTBITS; k++)
+		CDecodeEntry *pEntry = &m_aDecodeLut[i];
+		int NumBits = 0;
+		while(pEntry->m_NumSymbols < HUFFMAN_LUTSYMBOLS)
 		{
-			pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
-			Bits >>= 1;
-
-			if(!pNode)
+			// walk the tree for the next code, stop if it doesn't fit
+			const CNode *pNode = m_pStartNode;
+			int k = NumBits;
+			while(k < HUFFMAN_LUTBITS && !pNode->m_NumBits)
+			{
+				pNode = &m_aNodes[pNode->m_aLeafs[(i >> k) & 1]];
+				k++;
+			}
+			if(!pNode->m_NumBits)
+			{
+				if(pEntry->m_NumSymbols == 0)
+				{
+					pEntry->m_Node = pNode - m_aNodes;
+					NumBits = k;
+				}
 				break;
+			}
 
-			if(pNode->m_NumBits)
+			NumBits = k;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			{
-				m_apDecodeLut[i] = pNode;
+				pEntry->m_Node = HUFFMAN_EOF_SYMBOL;
 				break;
 			}
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
 		}
-
-		if(k == HUFFMAN_LUTBITS)
-			m_apDecodeLut[i] = pNode;
+		pEntry->m_NumBits = NumBits;
 	}
 }
 
 //***************************************************************
 int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
 {
-	// this macro loads a symbol for a byte into bits and bitcount
-#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
-	do \
-	{ \
-		Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
-		Bitcount += m_aNodes[Sym].m_NumBits; \
-	} while(0)
-
-	// this macro writes the symbol stored in bits and bitcount to the dst pointer
-#define HUFFMAN_MACRO_WRITE() \
-	do \
-	{ \
-		while(Bitcount >= 8) \
-		{ \
-			*pDst++ = (unsigned char)(Bits & 0xff); \
-			if(pDst == pDstEnd) \
-				return -1; \
-			Bits >>= 8; \
-			Bitcount -= 8; \
-		} \
-	} while(0)
-
 	// setup buffer pointers
 	const unsigned char *pSrc = (const unsigned char *)pInput;
 	const unsigned char *pSrcEnd = pSrc + InputSize;
 	unsigned char *pDst = (unsigned char *)pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// the codes are collected in a 64-bit accumulator and written 32 bits
+	// at a time. The output always ends with a (partial) byte after the
+	// full bytes, so there must be space left after each write.
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	while(pSrc != pSrcEnd)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		const CNode *pNode = &m_aNodes[*pSrc++];
+		Bits |= (uint64_t)pNode->m_Bits << Bitcount;
+		Bitcount += pNode->m_NumBits;
 
-		while(pSrc != pSrcEnd)
+		if(Bitcount >= 32)
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol);
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE();
+			if(pDstEnd - pDst <= 4)
+				return -1;
+			pDst[0] = (unsigned char)Bits;
+			pDst[1] = (unsigned char)(Bits >> 8);
+			pDst[2] = (unsigned char)(Bits >> 16);
+			pDst[3] = (unsigned char)(Bits >> 24);
+			pDst += 4;
+			Bits >>= 32;
+			Bitcount -= 32;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol);
-		HUFFMAN_MACRO_WRITE();
 	}
 
 	// write EOF symbol
-	HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL);
-	HUFFMAN_MACRO_WRITE();
+	Bits |= (uint64_t)m_aNodes[HUFFMAN_EOF_SYMBOL].m_Bits << Bitcount;
+	Bitcount += m_aNodes[HUFFMAN_EOF_SYMBOL].m_NumBits;
+	while(Bitcount >= 8)
+	{
+		if(pDstEnd - pDst <= 1)
+			return -1;
+		*pDst++ = (unsigned char)Bits;
+		Bits >>= 8;
+		Bitcount -= 8;
+	}
 
 	// write out the last bits
-	*pDst++ = Bits;
+	if(pDst == pDstEnd)
+		return -1;
+	*pDst++ = (unsigned char)Bits;
 
 	// return the size of the output
 	return (int)(pDst - (const unsigned char *)pOutput);
+}
 
-	// remove macros
-#undef HUFFMAN_MACRO_LOADSYMBOL
-#undef HUFFMAN_MACRO_WRITE
+static inline uint64_t ReadLittleEndian64(const unsigned char *pData)
+{
+	uint64_t Value = 0;
+	for(int i = 7; i >= 0; i--)
+		Value = (Value << 8) | pData[i];
+	return Value;
 }
 
 //***************************************************************
@@ -205,71 +213,87 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 {
 	// setup buffer pointers
 	unsigned char *pDst = (unsigned char *)pOutput;
-	unsigned char *pSrc = (unsigned char *)pInput;
+	const unsigned char *pSrc = (const unsigned char *)pInput;
 	unsigned char *pDstEnd = pDst + OutputSize;
-	unsigned char *pSrcEnd = pSrc + InputSize;
-
-	unsigned Bits = 0;
-	unsigned Bitcount = 0;
+	const unsigned char *pSrcEnd = pSrc + InputSize;
 
-	const CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
+	// the next bit is the lowest one. After the end of the input the
+	// decoder reads zeros, Bitcount turns negative then.
+	uint64_t Bits = 0;
+	int Bitcount = 0;
 
 	while(true)
 	{
-		// {A} try to load a node now, this will reduce dependency at location {D}
-		const CNode *pNode = nullptr;
-		if(Bitcount >= HUFFMAN_LUTBITS)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		// {B} fill with new bits
-		while(Bitcount < 24 && pSrc != pSrcEnd)
+		// {A} fill with new bits, 8 bytes at once if there are enough
+		if(pSrcEnd - pSrc >= 8)
 		{
-			Bits |= (*pSrc++) << Bitcount;
-			Bitcount += 8;
-		}
-
-		// {C} load symbol now if we didn't that earlier at location {A}
-		if(!pNode)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		if(!pNode)
-			return -1;
-
-		// {D} check if we hit a symbol already
-		if(pNode->m_NumBits)
-		{
-			// remove the bits for that symbol
-			Bits >>= pNode->m_NumBits;
-			Bitcount -= pNode->m_NumBits;
+			Bits |= ReadLittleEndian64(pSrc) << Bitcount;
+			pSrc += (63 - Bitcount) >> 3;
+			Bitcount |= 56;
 		}
 		else
 		{
-			// remove the bits that the lut checked up for us
-			Bits >>= HUFFMAN_LUTBITS;
-			Bitcount -= HUFFMAN_LUTBITS;
-
-			// walk the tree bit by bit
-			while(true)
+			while(Bitcount < 56 && pSrc != pSrcEnd)
 			{
-				// traverse tree
-				pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+				Bits |= (uint64_t)(*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
+		}
 
-				// remove bit
-				Bitcount--;
-				Bits >>= 1;
+		// {B} decode several symbols per lookup while there is enough
+		// space and the bits suffice for any code
+		while(Bitcount >= m_MaxCodeBits && pDstEnd - pDst >= HUFFMAN_LUTSYMBOLS)
+		{
+			const CDecodeEntry &Entry = m_aDecodeLut[Bits & HUFFMAN_LUTMASK];
+			for(int i = 0; i < HUFFMAN_LUTSYMBOLS; i++)
+				pDst[i] = Entry.m_aSymbols[i];
+			pDst += Entry.m_NumSymbols;
+			Bits >>= Entry.m_NumBits;
+			Bitcount -= Entry.m_NumBits;
+
+			if(Entry.m_Node)
+			{
+				// continue walking the tree for codes longer than the
+				// lookup bits
+				const CNode *pNode = &m_aNodes[Entry.m_Node];
+				while(!pNode->m_NumBits)
+				{
+					pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+					Bits >>= 1;
+					Bitcount--;
+				}
+
+				// check for eof
+				if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
+					return (int)(pDst - (const unsigned char *)pOutput);
+				*pDst++ = pNode->m_Symbol;
+			}
+		}
 
-				// check if we hit a symbol
-				if(pNode->m_NumBits)
-					break;
+		// {C} get more bits if we ran out of them
+		if(Bitcount < 56 && pSrc != pSrcEnd)
+			continue;
 
-				// no more bits, decoding error
-				if(Bitcount == 0)
-					return -1;
-			}
+		// {D} the output is almost full or the input ends, decode a single
+		// symbol by walking the tree bit by bit
+		const CNode *pNode = m_pStartNode;
+		int NumBits = 0;
+		while(!pNode->m_NumBits)
+		{
+			pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+			Bits >>= 1;
+			NumBits++;
 		}
 
+		// the original decoder only noticed a code cut off by the end of
+		// the input if it started more than its lookup bits before the
+		// end, keep that so malformed input gives the same result
+		if(Bitcount > HUFFMAN_LEGACY_LUTBITS && Bitcount < NumBits)
+			return -1;
+		Bitcount -= NumBits;
+
 		// check for eof
-		if(pNode == pEof)
+		if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			break;
 
 		// output character
@@ -12,9 +12,15 @@ class CHuffman
 		HUFFMAN_MAX_SYMBOLS = HUFFMAN_EOF_SYMBOL + 1,
 		HUFFMAN_MAX_NODES = HUFFMAN_MAX_SYMBOLS * 2 - 1,
 
-		HUFFMAN_LUTBITS = 10,
+		// each lookup in the decode table decodes all codes that fit into
+		// the next HUFFMAN_LUTBITS bits, up to HUFFMAN_LUTSYMBOLS symbols
+		HUFFMAN_LUTBITS = 11,
 		HUFFMAN_LUTSIZE = (1 << HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1),
+		HUFFMAN_LUTSYMBOLS = 4,
+
+		// the lookup table of the original decoder, see Decompress
+		HUFFMAN_LEGACY_LUTBITS = 10,
 	};
 
 	struct CNode
@@ -30,17 +36,32 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
-	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
+	struct CDecodeEntry
+	{
+		// symbols of the codes that fit completely into the lookup bits
+		// and the number of bits they use
+		unsigned char m_aSymbols[HUFFMAN_LUTSYMBOLS];
+		unsigned char m_NumSymbols;
+		unsigned char m_NumBits;
+
+		// HUFFMAN_EOF_SYMBOL if the EOF symbol follows the symbols, it is
+		// included in m_NumBits. If the first code is longer than the
+		// lookup bits, the node that the lookup bits lead to. 0 otherwise.
+		unsigned short m_Node;
+	};
 
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
-	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CDecodeEntry m_aDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
+	int m_MaxCodeBits;
 
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
 
 public:
+	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
+
 	/*
 		Function: Init
 			Inits the compressor/decompressor.
@@ -79,7 +79,17 @@ bool CMap::Load(const char *pMapName)
 	// Ensure current datafile is not left in an inconsistent state if loading fails,
 	// by loading the new datafile separately first.
 	CDataFileReader NewDataFile;
-	if(!NewDataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL))
+	if(!Prepare(pStorage, pMapName, &NewDataFile, false))
+		return false;
+
+	LoadPrepared(std::move(NewDataFile));
+	return true;
+}
+
+bool CMap::Prepare(IStorage *pStorage, const char *pMapName, CDataFileReader *pDataFile, bool Mapped) const
+{
+	CDataFileReader &NewDataFile = *pDataFile;
+	if(!NewDataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL, Mapped))
 		return false;
 
 	// Check version
@@ -124,10 +134,14 @@ bool CMap::Load(const char *pMapName)
 		}
 	}
 
+	return true;
+}
+
+void CMap::LoadPrepared(CDataFileReader &&DataFile)
+{
 	// Replace existing datafile with new datafile
 	m_DataFile.Close();
-	m_DataFile = std::move(NewDataFile);
-	return true;
+	m_DataFile = std::move(DataFile);
 }
 
 void CMap::Unload()
@@ -32,6 +32,8 @@ public:
 	int NumItems() const override;
 
 	[[nodiscard]] bool Load(const char *pMapName) override;
+	[[nodiscard]] bool Prepare(class IStorage *pStorage, const char *pMapName, CDataFileReader *pDataFile, bool Mapped) const override;
+	void LoadPrepared(CDataFileReader &&DataFile) override;
 	void Unload() override;
 	bool IsLoaded() const override;
 	IOHANDLE File() const override;
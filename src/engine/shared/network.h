@@ -9,6 +9,11 @@
 #include <base/types.h>
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <optional>
 
 class CHuffman;
@@ -243,6 +248,7 @@ private:
 	int m_RemoteClosed;
 	bool m_BlockCloseMsg;
 	bool m_UnknownSeq;
+	bool m_BatchSend;
 
 	CStaticRingBuffer<CNetChunkResend, NET_CONN_BUFFERSIZE> m_Buffer;
 
@@ -295,6 +301,7 @@ public:
 
 	int Update();
 	int Flush();
+	void SetBatchSend(bool BatchSend) { m_BatchSend = BatchSend; }
 
 	int Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr, SECURITY_TOKEN SecurityToken = NET_SECURITY_TOKEN_UNSUPPORTED, SECURITY_TOKEN ResponseToken = NET_SECURITY_TOKEN_UNSUPPORTED);
 	int QueueChunk(int Flags, int DataSize, const void *pData);
@@ -431,6 +438,41 @@ class CNetServer
 
 	CNetRecvUnpacker m_RecvUnpacker;
 
+	// packet read and unpacked by the receive thread
+	struct CRecvPacket
+	{
+		NETADDR m_Addr;
+		int m_Flags;
+		// whether m_Packet holds the packet unpacked for a non-sixup connection
+		bool m_Unpacked;
+		bool m_Sixup;
+		SECURITY_TOKEN m_Token;
+		SECURITY_TOKEN m_ResponseToken;
+		int m_Size;
+		unsigned char m_aData[NET_MAX_PACKETSIZE];
+		CNetPacketConstruct m_Packet;
+	};
+
+	enum
+	{
+		RECV_QUEUE_SIZE = 1024,
+	};
+
+	// single producer (receive thread), single consumer (Recv) ring buffer
+	std::unique_ptr<CRecvPacket[]> m_pRecvQueue;
+	std::atomic<unsigned> m_RecvQueueRead;
+	std::atomic<unsigned> m_RecvQueueWrite;
+	std::atomic<bool> m_RecvThreadStop;
+	void *m_pRecvThread;
+	std::mutex m_RecvWaitMutex;
+	std::condition_variable m_RecvWaitCond;
+
+	static void RecvThread(void *pUser);
+	bool UnpackReceived(const NETADDR &Addr, unsigned char *pData, int Size, CNetPacketConstruct *pPacket, bool &Sixup, SECURITY_TOKEN *pToken, SECURITY_TOKEN *pResponseToken);
+	int ReadPacket(NETADDR *pAddr, int *pSlot, bool *pSixup, SECURITY_TOKEN *pToken, SECURITY_TOKEN *pResponseToken);
+	int ReadQueuedPacket(NETADDR *pAddr, int *pSlot, bool *pSixup, SECURITY_TOKEN *pToken, SECURITY_TOKEN *pResponseToken);
+	bool RejectBanned(NETADDR &Addr);
+
 	void OnTokenCtrlMsg(NETADDR &Addr, int ControlMsg, const CNetPacketConstruct &Packet);
 	int OnSixupCtrlMsg(NETADDR &Addr, CNetChunk *pChunk, int ControlMsg, const CNetPacketConstruct &Packet, SECURITY_TOKEN &ResponseToken, SECURITY_TOKEN Token);
 	void OnPreConnMsg(NETADDR &Addr, CNetPacketConstruct &Packet);
@@ -448,15 +490,22 @@ public:
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_NEWCLIENT_NOAUTH pfnNewClientNoAuth, NETFUNC_CLIENTREJOIN pfnClientRejoin, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
 
-	//
-	bool Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp);
+	// with UseRecvThread, a thread reads and unpacks the packets and Recv
+	// only processes the queued ones
+	bool Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp, bool UseRecvThread = false);
 	void Close();
 
+	// wait until Recv has packets to process, returns false on timeout
+	bool Wait(std::chrono::nanoseconds Timeout);
+
 	//
 	int Recv(CNetChunk *pChunk, SECURITY_TOKEN *pResponseToken);
 	int Send(CNetChunk *pChunk);
 	void Update();
 
+	// queue the packets of all connections until batching is disabled again
+	void SetSendBatching(bool Batching);
+
 	//
 	void Drop(int ClientId, const char *pReason);
 
@@ -622,7 +671,7 @@ public:
 	static void SendControlMsgWithToken7(NETSOCKET Socket, NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended);
 	static void SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize, bool Extended, unsigned char aExtra[NET_CONNLESS_EXTRA_SIZE]);
 	static void SendPacketConnlessWithToken7(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize, SECURITY_TOKEN Token, SECURITY_TOKEN ResponseToken);
-	static void SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, SECURITY_TOKEN SecurityToken, bool Sixup = false);
+	static void SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, SECURITY_TOKEN SecurityToken, bool Sixup = false, bool Batch = false);
 
 	static std::optional<int> UnpackPacketFlags(unsigned char *pBuffer, int Size);
 	static int UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct *pPacket, bool &Sixup, SECURITY_TOKEN *pSecurityToken = nullptr, SECURITY_TOKEN *pResponseToken = nullptr);
@@ -74,6 +74,7 @@ void CNetConnection::Init(NETSOCKET Socket, bool BlockCloseMsg)
 
 	m_Socket = Socket;
 	m_BlockCloseMsg = BlockCloseMsg;
+	m_BatchSend = false;
 	mem_zero(m_aErrorString, sizeof(m_aErrorString));
 }
 
@@ -109,7 +110,7 @@ int CNetConnection::Flush()
 
 	// send of the packets
 	m_Construct.m_Ack = m_Ack;
-	CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct, m_SecurityToken, m_Sixup);
+	CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct, m_SecurityToken, m_Sixup, m_BatchSend);
 
 	// update send times
 	m_LastSendTime = time_get();
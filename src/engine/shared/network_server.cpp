@@ -11,6 +11,8 @@
 #include <engine/shared/packer.h>
 #include <engine/shared/protocol.h>
 
+using namespace std::chrono_literals;
+
 const int g_DummyMapCrc = 0xD6909B17;
 const unsigned char g_aDummyMapData[] = {
 	0x44, 0x41, 0x54, 0x41, 0x04, 0x00, 0x00, 0x00, 0xFA, 0x00, 0x00, 0x00,
@@ -37,7 +39,7 @@ const unsigned char g_aDummyMapData[] = {
 	0x78, 0x9C, 0x63, 0x64, 0x60, 0x60, 0x60, 0x44, 0xC2, 0x00, 0x00, 0x38,
 	0x00, 0x05};
 
-bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp)
+bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIp, bool UseRecvThread)
 {
 	// zero out the whole structure
 	this->~CNetServer();
@@ -62,6 +64,12 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	for(auto &Slot : m_aSlots)
 		Slot.m_Connection.Init(m_Socket, true);
 
+	if(UseRecvThread)
+	{
+		m_pRecvQueue = std::make_unique<CRecvPacket[]>(RECV_QUEUE_SIZE);
+		m_pRecvThread = thread_init(RecvThread, this, "net recv");
+	}
+
 	return true;
 }
 
@@ -89,6 +97,13 @@ void CNetServer::Close()
 	{
 		return;
 	}
+	if(m_pRecvThread)
+	{
+		m_RecvThreadStop = true;
+		thread_wait(m_pRecvThread);
+		m_pRecvThread = nullptr;
+		m_pRecvQueue = nullptr;
+	}
 	net_udp_close(m_Socket);
 	m_Socket = nullptr;
 }
@@ -103,6 +118,14 @@ void CNetServer::Drop(int ClientId, const char *pReason)
 	m_aSlots[ClientId].m_Connection.Disconnect(pReason);
 }
 
+void CNetServer::SetSendBatching(bool Batching)
+{
+	for(auto &Slot : m_aSlots)
+		Slot.m_Connection.SetBatchSend(Batching);
+	if(!Batching)
+		net_udp_flush(m_Socket);
+}
+
 void CNetServer::Update()
 {
 	for(int i = 0; i < MaxClients(); i++)
@@ -579,6 +602,157 @@ static bool IsDDNetControlMsg(const CNetPacketConstruct *pPacket)
 	return false;
 }
 
+bool CNetServer::RejectBanned(NETADDR &Addr)
+{
+	char aBuf[128];
+	if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
+	{
+		// banned, reply with a message
+		CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1, NET_SECURITY_TOKEN_UNSUPPORTED);
+		return true;
+	}
+	return false;
+}
+
+bool CNetServer::UnpackReceived(const NETADDR &Addr, unsigned char *pData, int Size, CNetPacketConstruct *pPacket, bool &Sixup, SECURITY_TOKEN *pToken, SECURITY_TOKEN *pResponseToken)
+{
+	if(CNetBase::UnpackPacket(pData, Size, pPacket, Sixup, pToken, pResponseToken) != 0)
+		return false;
+
+	// drop 0.7 connless packets with a wrong token
+	if((pPacket->m_Flags & NET_PACKETFLAG_CONNLESS) && Sixup && *pToken != GetToken(Addr) && *pToken != GetGlobalToken())
+		return false;
+	return true;
+}
+
+// Reads the next packet from the socket into m_RecvUnpacker.m_Data. Returns
+// -1 if there are no more packets, 1 if the packet was dropped and 0 otherwise.
+int CNetServer::ReadPacket(NETADDR *pAddr, int *pSlot, bool *pSixup, SECURITY_TOKEN *pToken, SECURITY_TOKEN *pResponseToken)
+{
+	unsigned char *pData;
+	int Bytes = net_udp_recv(m_Socket, pAddr, &pData);
+
+	// no more packets for now
+	if(Bytes <= 0)
+		return -1;
+
+	// check if we just should drop the packet
+	if(RejectBanned(*pAddr))
+		return 1;
+
+	// Check size and unpack packet flags early so we can determine the sixup
+	// state correctly for connection-oriented packets before unpacking them.
+	std::optional<int> Flags = CNetBase::UnpackPacketFlags(pData, Bytes);
+	if(!Flags)
+		return 1;
+
+	*pSlot = (*Flags & NET_PACKETFLAG_CONNLESS) == 0 ? GetClientSlot(*pAddr) : -1;
+	*pSixup = *pSlot != -1 && m_aSlots[*pSlot].m_Connection.m_Sixup;
+	return UnpackReceived(*pAddr, pData, Bytes, &m_RecvUnpacker.m_Data, *pSixup, pToken, pResponseToken) ? 0 : 1;
+}
+
+// Same as ReadPacket, but takes the packet from the receive thread's queue.
+int CNetServer::ReadQueuedPacket(NETADDR *pAddr, int *pSlot, bool *pSixup, SECURITY_TOKEN *pToken, SECURITY_TOKEN *pResponseToken)
+{
+	const unsigned Read = m_RecvQueueRead.load(std::memory_order_relaxed);
+	if(Read == m_RecvQueueWrite.load(std::memory_order_acquire))
+		return -1;
+
+	CRecvPacket *pPacket = &m_pRecvQueue[Read % RECV_QUEUE_SIZE];
+	*pAddr = pPacket->m_Addr;
+
+	int Result = 1;
+	if(!RejectBanned(*pAddr))
+	{
+		*pSlot = (pPacket->m_Flags & NET_PACKETFLAG_CONNLESS) == 0 ? GetClientSlot(*pAddr) : -1;
+		*pSixup = *pSlot != -1 && m_aSlots[*pSlot].m_Connection.m_Sixup;
+		if(*pSixup && !pPacket->m_Sixup)
+		{
+			// the receive thread does not know the connections, unpack it
+			// again for the sixup one
+			Result = UnpackReceived(*pAddr, pPacket->m_aData, pPacket->m_Size, &m_RecvUnpacker.m_Data, *pSixup, pToken, pResponseToken) ? 0 : 1;
+		}
+		else if(pPacket->m_Unpacked)
+		{
+			const CNetPacketConstruct &Packet = pPacket->m_Packet;
+			CNetPacketConstruct &Data = m_RecvUnpacker.m_Data;
+			Data.m_Flags = Packet.m_Flags;
+			Data.m_Ack = Packet.m_Ack;
+			Data.m_NumChunks = Packet.m_NumChunks;
+			Data.m_DataSize = Packet.m_DataSize;
+			mem_copy(Data.m_aChunkData, Packet.m_aChunkData, Packet.m_DataSize);
+			mem_copy(Data.m_aExtraData, Packet.m_aExtraData, sizeof(Data.m_aExtraData));
+			*pSixup = pPacket->m_Sixup;
+			*pToken = pPacket->m_Token;
+			if(pPacket->m_ResponseToken != NET_SECURITY_TOKEN_UNKNOWN)
+				*pResponseToken = pPacket->m_ResponseToken;
+			Result = 0;
+		}
+	}
+
+	m_RecvQueueRead.store(Read + 1);
+	return Result;
+}
+
+void CNetServer::RecvThread(void *pUser)
+{
+	CNetServer *pThis = (CNetServer *)pUser;
+	while(!pThis->m_RecvThreadStop)
+	{
+		if(!net_socket_read_wait(pThis->m_Socket, 100ms))
+			continue;
+
+		NETADDR Addr;
+		unsigned char *pData;
+		int Bytes;
+		while((Bytes = net_udp_recv(pThis->m_Socket, &Addr, &pData)) > 0)
+		{
+			std::optional<int> Flags = CNetBase::UnpackPacketFlags(pData, Bytes);
+			if(!Flags)
+				continue;
+
+			// drop the packet if the main thread does not keep up
+			const unsigned Write = pThis->m_RecvQueueWrite.load(std::memory_order_relaxed);
+			if(Write - pThis->m_RecvQueueRead.load(std::memory_order_acquire) >= RECV_QUEUE_SIZE)
+				continue;
+
+			// unpack it as if it was not from a sixup connection, the main
+			// thread unpacks it again otherwise
+			CRecvPacket *pPacket = &pThis->m_pRecvQueue[Write % RECV_QUEUE_SIZE];
+			pPacket->m_Sixup = false;
+			pPacket->m_Token = NET_SECURITY_TOKEN_UNKNOWN;
+			pPacket->m_ResponseToken = NET_SECURITY_TOKEN_UNKNOWN;
+			pPacket->m_Unpacked = pThis->UnpackReceived(Addr, pData, Bytes, &pPacket->m_Packet, pPacket->m_Sixup, &pPacket->m_Token, &pPacket->m_ResponseToken);
+			if(!pPacket->m_Unpacked && (*Flags & NET_PACKETFLAG_CONNLESS))
+				continue;
+
+			pPacket->m_Addr = Addr;
+			pPacket->m_Flags = *Flags;
+			pPacket->m_Size = Bytes;
+			mem_copy(pPacket->m_aData, pData, Bytes);
+			pThis->m_RecvQueueWrite.store(Write + 1);
+
+			// wake the main thread if it emptied the queue before this packet
+			if(pThis->m_RecvQueueRead.load() == Write)
+			{
+				{
+					std::unique_lock<std::mutex> Lock(pThis->m_RecvWaitMutex);
+				}
+				pThis->m_RecvWaitCond.notify_one();
+			}
+		}
+	}
+}
+
+bool CNetServer::Wait(std::chrono::nanoseconds Timeout)
+{
+	if(!m_pRecvThread)
+		return net_socket_read_wait(m_Socket, Timeout);
+
+	std::unique_lock<std::mutex> Lock(m_RecvWaitMutex);
+	return m_RecvWaitCond.wait_for(Lock, Timeout, [this]() { return m_RecvQueueRead.load() != m_RecvQueueWrite.load(); });
+}
+
 /*
 	TODO: chopp up this function into smaller working parts
 */
@@ -592,41 +766,16 @@ int CNetServer::Recv(CNetChunk *pChunk, SECURITY_TOKEN *pResponseToken)
 		if(m_RecvUnpacker.FetchChunk(pChunk))
 			return 1;
 
-		// TODO: empty the recvinfo
-		unsigned char *pData;
-		int Bytes = net_udp_recv(m_Socket, &Addr, &pData);
-
-		// no more packets for now
-		if(Bytes <= 0)
-			break;
-
-		// check if we just should drop the packet
-		char aBuf[128];
-		if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
-		{
-			// banned, reply with a message
-			CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1, NET_SECURITY_TOKEN_UNSUPPORTED);
-			continue;
-		}
-
-		// Check size and unpack packet flags early so we can determine the sixup
-		// state correctly for connection-oriented packets before unpacking them.
-		std::optional<int> Flags = CNetBase::UnpackPacketFlags(pData, Bytes);
-		if(!Flags)
-		{
-			continue;
-		}
-
+		int Slot = -1;
+		bool Sixup = false;
 		SECURITY_TOKEN Token;
-		int Slot = (*Flags & NET_PACKETFLAG_CONNLESS) == 0 ? GetClientSlot(Addr) : -1;
-		bool Sixup = Slot != -1 && m_aSlots[Slot].m_Connection.m_Sixup;
-		if(CNetBase::UnpackPacket(pData, Bytes, &m_RecvUnpacker.m_Data, Sixup, &Token, pResponseToken) == 0)
+		int Result = m_pRecvThread ? ReadQueuedPacket(&Addr, &Slot, &Sixup, &Token, pResponseToken) : ReadPacket(&Addr, &Slot, &Sixup, &Token, pResponseToken);
+		if(Result < 0)
+			break;
+		if(Result == 0)
 		{
 			if(m_RecvUnpacker.m_Data.m_Flags & NET_PACKETFLAG_CONNLESS)
 			{
-				if(Sixup && Token != GetToken(Addr) && Token != GetGlobalToken())
-					continue;
-
 				pChunk->m_Flags = NETSENDFLAG_CONNLESS;
 				pChunk->m_ClientId = -1;
 				pChunk->m_Address = Addr;
@@ -57,7 +57,7 @@ int CSnapshot::GetExternalItemType(int InternalType) const
 
 int CSnapshot::GetItemIndex(int Key) const
 {
-	// TODO: OPT: this should not be a linear search. very bad
+	// linear search, use CSnapshotIndex for repeated lookups
 	for(int i = 0; i < m_NumItems; i++)
 	{
 		if(GetItem(i)->Key() == Key)
@@ -159,6 +159,128 @@ bool CSnapshot::IsValid(size_t ActualSize) const
 	return true;
 }
 
+// CSnapshotIndex
+
+CSnapshotIndex::CSnapshotIndex()
+{
+	Build(CSnapshot::EmptySnapshot());
+}
+
+unsigned CSnapshotIndex::HashKey(int Key)
+{
+	// fibonacci hashing, the table size is a power of two
+	return ((unsigned)Key * 2654435769u) >> (32 - 11);
+}
+
+void CSnapshotIndex::Build(const CSnapshot *pSnapshot)
+{
+	static_assert(HASH_SIZE == 1 << 11, "hash shift does not match the hash size");
+	dbg_assert(pSnapshot->NumItems() <= CSnapshot::MAX_ITEMS, "too many snapshot items to index");
+	m_pSnapshot = pSnapshot;
+	for(auto &Index : m_aIndices)
+		Index = -1;
+	m_NumExtendedTypes = 0;
+	m_ExtendedTypesOverflow = false;
+
+	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	{
+		const CSnapshotItem *pItem = pSnapshot->GetItem(i);
+		const int Key = pItem->Key();
+
+		// linear probing, the first item with a key wins like in CSnapshot::GetItemIndex
+		unsigned Slot = HashKey(Key);
+		bool Duplicate = false;
+		while(m_aIndices[Slot] != -1)
+		{
+			if(m_aKeys[Slot] == Key)
+			{
+				Duplicate = true;
+				break;
+			}
+			Slot = (Slot + 1) & (HASH_SIZE - 1);
+		}
+		if(Duplicate)
+			continue;
+		m_aKeys[Slot] = Key;
+		m_aIndices[Slot] = i;
+
+		if(pItem->Type() == 0 && pItem->Id() >= CSnapshot::OFFSET_UUID_TYPE) // NETOBJTYPE_EX
+		{
+			if(m_NumExtendedTypes == MAX_EXTENDED_TYPES)
+			{
+				m_ExtendedTypesOverflow = true;
+				continue;
+			}
+			CExtendedType &ExtendedType = m_aExtendedTypes[m_NumExtendedTypes++];
+			ExtendedType.m_InternalType = pItem->Id();
+			ExtendedType.m_ExternalType = pItem->Id();
+			if(pSnapshot->GetItemSize(i) >= (int)sizeof(CUuid))
+			{
+				CUuid Uuid;
+				for(size_t b = 0; b < sizeof(CUuid) / sizeof(int32_t); b++)
+					uint_to_bytes_be(&Uuid.m_aData[b * sizeof(int32_t)], pItem->Data()[b]);
+				ExtendedType.m_ExternalType = g_UuidManager.LookupUuid(Uuid);
+			}
+		}
+	}
+}
+
+int CSnapshotIndex::GetItemIndex(int Key) const
+{
+	unsigned Slot = HashKey(Key);
+	while(m_aIndices[Slot] != -1)
+	{
+		if(m_aKeys[Slot] == Key)
+			return m_aIndices[Slot];
+		Slot = (Slot + 1) & (HASH_SIZE - 1);
+	}
+	return -1;
+}
+
+int CSnapshotIndex::GetItemType(int Index) const
+{
+	return GetExternalItemType(m_pSnapshot->GetItem(Index)->Type());
+}
+
+int CSnapshotIndex::GetExternalItemType(int InternalType) const
+{
+	if(InternalType < CSnapshot::OFFSET_UUID_TYPE)
+		return InternalType;
+	if(m_ExtendedTypesOverflow)
+		return m_pSnapshot->GetExternalItemType(InternalType);
+
+	for(int i = 0; i < m_NumExtendedTypes; i++)
+	{
+		if(m_aExtendedTypes[i].m_InternalType == InternalType)
+			return m_aExtendedTypes[i].m_ExternalType;
+	}
+	return InternalType;
+}
+
+const void *CSnapshotIndex::FindItem(int Type, int Id) const
+{
+	int InternalType = Type;
+	if(Type >= OFFSET_UUID)
+	{
+		if(m_ExtendedTypesOverflow)
+			return m_pSnapshot->FindItem(Type, Id);
+
+		InternalType = -1;
+		for(int i = 0; i < m_NumExtendedTypes; i++)
+		{
+			if(m_aExtendedTypes[i].m_ExternalType == Type)
+			{
+				InternalType = m_aExtendedTypes[i].m_InternalType;
+				break;
+			}
+		}
+		if(InternalType == -1)
+			return nullptr;
+	}
+	const int Index = GetItemIndex((InternalType << 16) | Id);
+	return Index < 0 ? nullptr : m_pSnapshot->GetItem(Index)->Data();
+}
+
 // CSnapshotDelta
 
 enum
@@ -515,6 +637,9 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 	CSnapshotBuilder Builder;
 	Builder.Init();
 
+	CSnapshotIndex FromSnapIndex;
+	FromSnapIndex.Build(pFrom);
+
 	// unpack deleted stuff
 	int *pDeleted = pData;
 	if(pDelta->m_NumDeletedItems < 0)
@@ -589,7 +714,7 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 		if(!pNewData)
 			return -302;
 
-		const int FromIndex = pFrom->GetItemIndex(Key);
+		const int FromIndex = FromSnapIndex.GetItemIndex(Key);
 		if(FromIndex != -1)
 		{
 			// we got an update so we need to apply the diff
@@ -624,6 +749,7 @@ void CSnapshotStorage::PurgeAll()
 		CHolder *pNext = m_pFirst->m_pNext;
 		free(m_pFirst->m_pSnap);
 		free(m_pFirst->m_pAltSnap);
+		delete m_pFirst->m_pAltSnapIndex;
 		free(m_pFirst);
 		m_pFirst = pNext;
 	}
@@ -641,6 +767,7 @@ void CSnapshotStorage::PurgeUntil(int Tick)
 			return; // no more to remove
 		free(pHolder->m_pSnap);
 		free(pHolder->m_pAltSnap);
+		delete pHolder->m_pAltSnapIndex;
 		free(pHolder);
 
 		// did we come to the end of the list?
@@ -675,11 +802,14 @@ void CSnapshotStorage::Add(int Tick, int64_t Tagtime, size_t DataSize, const voi
 		pHolder->m_pAltSnap = static_cast<CSnapshot *>(malloc(AltDataSize));
 		mem_copy(pHolder->m_pAltSnap, pAltData, AltDataSize);
 		pHolder->m_AltSnapSize = AltDataSize;
+		pHolder->m_pAltSnapIndex = new CSnapshotIndex();
+		pHolder->m_pAltSnapIndex->Build(pHolder->m_pAltSnap);
 	}
 	else
 	{
 		pHolder->m_pAltSnap = nullptr;
 		pHolder->m_AltSnapSize = 0;
+		pHolder->m_pAltSnapIndex = nullptr;
 	}
 
 	// link
@@ -862,3 +992,65 @@ void *CSnapshotBuilder::NewItem(int Type, int Id, int Size)
 	mem_zero(pObj->Data(), Size);
 	return pObj->Data();
 }
+
+// CSnapshotItemPool
+
+CSnapshotItemPool::CSnapshotItemPool()
+{
+	m_DataSize = 0;
+	m_Overflow = false;
+}
+
+void CSnapshotItemPool::Clear()
+{
+	m_DataSize = 0;
+	m_Overflow = false;
+	m_vGroupOffsets.clear();
+}
+
+int CSnapshotItemPool::NewGroup()
+{
+	m_vGroupOffsets.push_back(m_DataSize);
+	return m_vGroupOffsets.size() - 1;
+}
+
+void *CSnapshotItemPool::NewItem(int Type, int Id, int Size)
+{
+	dbg_assert(!m_vGroupOffsets.empty(), "no group to add the item to");
+	dbg_assert(Size >= 0, "invalid item size");
+
+	if(m_DataSize + sizeof(CItemHeader) + Size > (size_t)MAX_DATA_SIZE)
+	{
+		m_Overflow = true;
+		return nullptr;
+	}
+
+	// allocated lazily, most worlds never use a pool
+	if(!m_pData)
+		m_pData = std::make_unique<char[]>(MAX_DATA_SIZE);
+
+	CItemHeader *pItem = (CItemHeader *)(m_pData.get() + m_DataSize);
+	pItem->m_Type = Type;
+	pItem->m_Id = Id;
+	pItem->m_Size = Size;
+	m_DataSize += sizeof(CItemHeader) + Size;
+
+	mem_zero(pItem->Data(), Size);
+	return pItem->Data();
+}
+
+bool CSnapshotItemPool::AddGroup(CSnapshotBuilder *pBuilder, int Group) const
+{
+	dbg_assert(Group >= 0 && Group < NumGroups(), "group out of range");
+	const int End = Group + 1 < NumGroups() ? m_vGroupOffsets[Group + 1] : m_DataSize;
+	for(int Offset = m_vGroupOffsets[Group]; Offset < End;)
+	{
+		const CItemHeader *pItem = (const CItemHeader *)(m_pData.get() + Offset);
+		void *pObj = pBuilder->NewItem(pItem->m_Type, pItem->m_Id, pItem->m_Size);
+		if(!pObj)
+			return false;
+		mem_copy(pObj, pItem->Data(), pItem->m_Size);
+		Offset += sizeof(CItemHeader) + pItem->m_Size;
+	}
+	return true;
+}
@@ -5,6 +5,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include <game/generated/protocol.h>
 #include <game/generated/protocol7.h>
@@ -68,6 +70,49 @@ public:
 	static const CSnapshot *EmptySnapshot() { return &ms_EmptySnapshot; }
 };
 
+// CSnapshotIndex
+
+// Lookup table for the items of one snapshot, so that finding an item by
+// key or type does not need to scan all items. The item types of extended
+// items are resolved once when the index is built. The index must be
+// rebuilt whenever the snapshot changes.
+class CSnapshotIndex
+{
+	enum
+	{
+		HASH_SIZE = CSnapshot::MAX_ITEMS * 2,
+		MAX_EXTENDED_TYPES = 64,
+	};
+
+	const CSnapshot *m_pSnapshot = CSnapshot::EmptySnapshot();
+
+	int m_aKeys[HASH_SIZE];
+	short m_aIndices[HASH_SIZE];
+
+	class CExtendedType
+	{
+	public:
+		int m_InternalType;
+		int m_ExternalType;
+	};
+	CExtendedType m_aExtendedTypes[MAX_EXTENDED_TYPES];
+	int m_NumExtendedTypes = 0;
+	bool m_ExtendedTypesOverflow = false;
+
+	static unsigned HashKey(int Key);
+
+public:
+	CSnapshotIndex();
+
+	void Build(const CSnapshot *pSnapshot);
+	const CSnapshot *Snapshot() const { return m_pSnapshot; }
+
+	int GetItemIndex(int Key) const;
+	int GetItemType(int Index) const;
+	int GetExternalItemType(int InternalType) const;
+	const void *FindItem(int Type, int Id) const;
+};
+
 // CSnapshotDelta
 
 class CSnapshotDelta
@@ -128,6 +173,8 @@ public:
 
 		CSnapshot *m_pSnap;
 		CSnapshot *m_pAltSnap;
+
+		CSnapshotIndex *m_pAltSnapIndex;
 	};
 
 	CHolder *m_pFirst;
@@ -178,4 +225,48 @@ public:
 	int Finish(void *pSnapdata);
 };
 
+// CSnapshotItemPool
+
+// Stores snapshot items in groups so that they can be created once and
+// then added to the snapshots of several clients.
+class CSnapshotItemPool
+{
+	class CItemHeader
+	{
+	public:
+		int m_Type;
+		int m_Id;
+		int m_Size;
+
+		int *Data() { return (int *)(this + 1); }
+		const int *Data() const { return (const int *)(this + 1); }
+	};
+
+	std::unique_ptr<char[]> m_pData;
+	int m_DataSize;
+	bool m_Overflow;
+
+	std::vector<int> m_vGroupOffsets;
+
+public:
+	enum
+	{
+		MAX_DATA_SIZE = CSnapshot::MAX_SIZE * 4
+	};
+
+	CSnapshotItemPool();
+
+	void Clear();
+	bool Overflow() const { return m_Overflow; }
+	int NumGroups() const { return m_vGroupOffsets.size(); }
+
+	// starts a new group, all following items are added to it
+	int NewGroup();
+	void *NewItem(int Type, int Id, int Size);
+
+	// adds the items of the group to the builder, stops at the first
+	// item that does not fit like the snap code of the entities does
+	bool AddGroup(CSnapshotBuilder *pBuilder, int Group) const;
+};
+
 #endif // ENGINE_SNAPSHOT_H
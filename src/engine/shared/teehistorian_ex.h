@@ -11,5 +11,22 @@ enum
 	OFFSET_GAME_UUID
 };
 
+// chunk types of the teehistorian stream, written negated
+enum
+{
+	TEEHISTORIAN_NONE,
+	TEEHISTORIAN_FINISH,
+	TEEHISTORIAN_TICK_SKIP,
+	TEEHISTORIAN_PLAYER_NEW,
+	TEEHISTORIAN_PLAYER_OLD,
+	TEEHISTORIAN_INPUT_DIFF,
+	TEEHISTORIAN_INPUT_NEW,
+	TEEHISTORIAN_MESSAGE,
+	TEEHISTORIAN_JOIN,
+	TEEHISTORIAN_DROP,
+	TEEHISTORIAN_CONSOLE_COMMAND,
+	TEEHISTORIAN_EX,
+};
+
 void RegisterTeehistorianUuids(class CUuidManager *pManager);
 #endif // ENGINE_SHARED_TEEHISTORIAN_EX_H
@@ -0,0 +1,506 @@
+#include "teehistorian_reader.h"
+
+#include <engine/shared/compression.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/teehistorian_ex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+static const CUuid TEEHISTORIAN_UUID = CalculateUuid("teehistorian@ddnet.tw");
+static const CUuid TEEHISTORIAN_INDEX_UUID = CalculateUuid("teehistorian-index@ddnet.tw");
+static const CUuid UUID_TEEHISTORIAN_PLAYER_TEAM = CalculateUuid("teehistorian-player-team@ddnet.tw");
+static const CUuid UUID_TEEHISTORIAN_TEAM_PRACTICE = CalculateUuid("teehistorian-team-practice@ddnet.tw");
+
+static const int NUM_INPUT_INTS = sizeof(CNetObj_PlayerInput) / sizeof(int32_t);
+
+static void PackOffset(CAbstractPacker *pPacker, int64_t Offset)
+{
+	pPacker->AddInt(Offset >> 31);
+	pPacker->AddInt(Offset & 0x7fffffff);
+}
+
+static int64_t UnpackOffset(CUnpacker *pUnpacker)
+{
+	const int64_t High = pUnpacker->GetInt();
+	const int64_t Low = pUnpacker->GetInt();
+	return (High << 31) | Low;
+}
+
+void CTeeHistorianIndex::PackHeader(CAbstractPacker *pPacker, CUuid GameUuid)
+{
+	pPacker->AddRaw(&TEEHISTORIAN_INDEX_UUID, sizeof(TEEHISTORIAN_INDEX_UUID));
+	pPacker->AddRaw(&GameUuid, sizeof(GameUuid));
+}
+
+void CTeeHistorianIndex::PackKeyframe(CAbstractPacker *pPacker, const CKeyframe *pKeyframe)
+{
+	pPacker->AddInt(RECORD_KEYFRAME);
+	pPacker->AddInt(pKeyframe->m_Tick);
+	pPacker->AddInt(pKeyframe->m_StreamTick);
+	PackOffset(pPacker, pKeyframe->m_Offset);
+
+	// only players and teams that differ from the initial state
+	int NumPlayers = 0;
+	for(const CPlayer &Player : pKeyframe->m_aPlayers)
+		if(Player.m_Alive || Player.m_Team != 0 || Player.m_HaveInput)
+			NumPlayers++;
+	pPacker->AddInt(NumPlayers);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CPlayer &Player = pKeyframe->m_aPlayers[i];
+		if(!Player.m_Alive && Player.m_Team == 0 && !Player.m_HaveInput)
+			continue;
+		pPacker->AddInt(i);
+		pPacker->AddInt(Player.m_Alive);
+		pPacker->AddInt(Player.m_X);
+		pPacker->AddInt(Player.m_Y);
+		pPacker->AddInt(Player.m_Team);
+		pPacker->AddInt(Player.m_HaveInput);
+		if(Player.m_HaveInput)
+			for(int j = 0; j < NUM_INPUT_INTS; j++)
+				pPacker->AddInt(((const int *)&Player.m_Input)[j]);
+	}
+
+	const int NumPractice = std::count(std::begin(pKeyframe->m_aPractice), std::end(pKeyframe->m_aPractice), true);
+	pPacker->AddInt(NumPractice);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		if(pKeyframe->m_aPractice[i])
+			pPacker->AddInt(i);
+}
+
+void CTeeHistorianIndex::PackEvent(CAbstractPacker *pPacker, const CEvent *pEvent)
+{
+	pPacker->AddInt(pEvent->m_Type);
+	pPacker->AddInt(pEvent->m_Tick);
+	PackOffset(pPacker, pEvent->m_Offset);
+	pPacker->AddInt(pEvent->m_ClientId);
+}
+
+bool CTeeHistorianIndex::Load(const void *pData, int64_t DataSize)
+{
+	m_vKeyframes.clear();
+	m_vEvents.clear();
+
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	if(DataSize < (int64_t)(2 * sizeof(CUuid)) || mem_comp(pBytes, &TEEHISTORIAN_INDEX_UUID, sizeof(CUuid)) != 0)
+		return false;
+	mem_copy(&m_GameUuid, pBytes + sizeof(CUuid), sizeof(CUuid));
+	pBytes += 2 * sizeof(CUuid);
+	DataSize -= 2 * sizeof(CUuid);
+
+	if(DataSize > std::numeric_limits<int>::max())
+		return false;
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(pBytes, DataSize);
+	while(true)
+	{
+		const int Type = Unpacker.GetIntOrDefault(0);
+		if(Type == 0)
+			break;
+		if(Type == RECORD_KEYFRAME)
+		{
+			CKeyframe &Keyframe = m_vKeyframes.emplace_back();
+			mem_zero(&Keyframe, sizeof(Keyframe));
+			Keyframe.m_Tick = Unpacker.GetInt();
+			Keyframe.m_StreamTick = Unpacker.GetInt();
+			Keyframe.m_Offset = UnpackOffset(&Unpacker);
+			const int NumPlayers = Unpacker.GetInt();
+			for(int i = 0; i < NumPlayers && !Unpacker.Error(); i++)
+			{
+				const int ClientId = Unpacker.GetInt();
+				if(ClientId < 0 || ClientId >= MAX_CLIENTS)
+					return false;
+				CPlayer &Player = Keyframe.m_aPlayers[ClientId];
+				Player.m_Alive = Unpacker.GetInt();
+				Player.m_X = Unpacker.GetInt();
+				Player.m_Y = Unpacker.GetInt();
+				Player.m_Team = Unpacker.GetInt();
+				Player.m_HaveInput = Unpacker.GetInt();
+				if(Player.m_HaveInput)
+					for(int j = 0; j < NUM_INPUT_INTS; j++)
+						((int *)&Player.m_Input)[j] = Unpacker.GetInt();
+			}
+			const int NumPractice = Unpacker.GetInt();
+			for(int i = 0; i < NumPractice && !Unpacker.Error(); i++)
+			{
+				const int Team = Unpacker.GetInt();
+				if(Team < 0 || Team >= MAX_CLIENTS)
+					return false;
+				Keyframe.m_aPractice[Team] = true;
+			}
+			// the binary search needs the keyframes in order
+			if(m_vKeyframes.size() > 1 && m_vKeyframes[m_vKeyframes.size() - 2].m_Tick >= Keyframe.m_Tick)
+				return false;
+		}
+		else if(Type == RECORD_JOIN || Type == RECORD_DROP)
+		{
+			CEvent &Event = m_vEvents.emplace_back();
+			Event.m_Type = Type;
+			Event.m_Tick = Unpacker.GetInt();
+			Event.m_Offset = UnpackOffset(&Unpacker);
+			Event.m_ClientId = Unpacker.GetInt();
+		}
+		else
+		{
+			return false;
+		}
+		if(Unpacker.Error())
+			return false;
+	}
+	return true;
+}
+
+bool CTeeHistorianIndex::Load(IOHANDLE File)
+{
+	void *pData;
+	unsigned DataSize;
+	if(!io_read_all(File, &pData, &DataSize))
+		return false;
+	const bool Result = Load(pData, DataSize);
+	free(pData);
+	return Result;
+}
+
+const CTeeHistorianIndex::CKeyframe *CTeeHistorianIndex::FindKeyframe(int Tick) const
+{
+	const auto It = std::upper_bound(m_vKeyframes.begin(), m_vKeyframes.end(), Tick, [](int Value, const CKeyframe &Keyframe) { return Value < Keyframe.m_Tick; });
+	if(It == m_vKeyframes.begin())
+		return nullptr;
+	return &*(It - 1);
+}
+
+int CTeeHistorianIndex::FindEvent(int Tick) const
+{
+	const auto It = std::lower_bound(m_vEvents.begin(), m_vEvents.end(), Tick, [](const CEvent &Event, int Value) { return Event.m_Tick < Value; });
+	return It - m_vEvents.begin();
+}
+
+CTeeHistorianReader::CTeeHistorianReader() :
+	m_pData(nullptr),
+	m_DataSize(0),
+	m_MappedSize(0),
+	m_HeaderSize(0),
+	m_Pos(0)
+{
+	ResetState();
+}
+
+CTeeHistorianReader::~CTeeHistorianReader()
+{
+	Close();
+}
+
+bool CTeeHistorianReader::Open(IOHANDLE File)
+{
+	Close();
+	const int64_t Length = io_length(File);
+	if(Length <= 0)
+		return false;
+	void *pData = io_map(File, Length);
+	if(!pData)
+		return false;
+	if(!Open(pData, Length))
+	{
+		io_unmap(pData, Length);
+		return false;
+	}
+	m_MappedSize = Length;
+	return true;
+}
+
+bool CTeeHistorianReader::Open(const void *pData, int64_t DataSize)
+{
+	Close();
+	m_pData = (const unsigned char *)pData;
+	m_DataSize = DataSize;
+
+	// the header is the uuid followed by a null-terminated json object
+	if(m_DataSize < (int64_t)sizeof(CUuid) || mem_comp(m_pData, &TEEHISTORIAN_UUID, sizeof(CUuid)) != 0)
+	{
+		Close();
+		return false;
+	}
+	const unsigned char *pEnd = (const unsigned char *)memchr(m_pData + sizeof(CUuid), 0, m_DataSize - sizeof(CUuid));
+	if(!pEnd)
+	{
+		Close();
+		return false;
+	}
+	m_HeaderSize = pEnd + 1 - m_pData;
+	m_Pos = m_HeaderSize;
+	ResetState();
+	return true;
+}
+
+void CTeeHistorianReader::Close()
+{
+	if(m_MappedSize)
+		io_unmap((void *)m_pData, m_MappedSize);
+	m_pData = nullptr;
+	m_DataSize = 0;
+	m_MappedSize = 0;
+	m_HeaderSize = 0;
+	m_Pos = 0;
+	ResetState();
+}
+
+void CTeeHistorianReader::ResetState()
+{
+	// tick 0 is implicit at the start, any player record starts tick 1
+	m_Tick = 0;
+	m_PrevPlayerCid = MAX_CLIENTS;
+	m_Finished = false;
+	m_Error = false;
+	mem_zero(m_aPlayers, sizeof(m_aPlayers));
+	mem_zero(m_aPractice, sizeof(m_aPractice));
+}
+
+bool CTeeHistorianReader::ReadInt(int *pInt)
+{
+	const int Size = std::min<int64_t>(m_DataSize - m_Pos, CVariableInt::MAX_BYTES_PACKED);
+	if(Size <= 0)
+		return false;
+	const unsigned char *pNext = CVariableInt::Unpack(m_pData + m_Pos, pInt, Size);
+	if(!pNext)
+		return false;
+	m_Pos = pNext - m_pData;
+	return true;
+}
+
+bool CTeeHistorianReader::ReadRaw(int64_t Size, const unsigned char **ppData)
+{
+	if(Size < 0 || Size > m_DataSize - m_Pos)
+		return false;
+	if(ppData)
+		*ppData = m_pData + m_Pos;
+	m_Pos += Size;
+	return true;
+}
+
+bool CTeeHistorianReader::ReadString()
+{
+	const void *pEnd = memchr(m_pData + m_Pos, 0, m_DataSize - m_Pos);
+	if(!pEnd)
+		return false;
+	m_Pos = (const unsigned char *)pEnd + 1 - m_pData;
+	return true;
+}
+
+int CTeeHistorianReader::PeekTick()
+{
+	if(m_Finished || m_Error)
+		return -1;
+	const int64_t Start = m_Pos;
+	int Type;
+	int Tick = m_Tick;
+	if(!ReadInt(&Type))
+	{
+		Tick = -1;
+	}
+	else if(Type == -TEEHISTORIAN_FINISH)
+	{
+		Tick = -1;
+	}
+	else if(Type == -TEEHISTORIAN_TICK_SKIP)
+	{
+		int Dt;
+		Tick = ReadInt(&Dt) ? m_Tick + Dt + 1 : -1;
+	}
+	else if(Type >= 0 || Type == -TEEHISTORIAN_PLAYER_NEW || Type == -TEEHISTORIAN_PLAYER_OLD)
+	{
+		// player records are sorted by client id, a smaller one starts the next tick
+		int ClientId = Type;
+		if(Type < 0 && !ReadInt(&ClientId))
+			Tick = -1;
+		else if(ClientId <= m_PrevPlayerCid)
+			Tick = m_Tick + 1;
+	}
+	m_Pos = Start;
+	return Tick;
+}
+
+bool CTeeHistorianReader::ReadRecord()
+{
+	int Type;
+	if(!ReadInt(&Type))
+		return false;
+
+	if(Type >= 0 || Type == -TEEHISTORIAN_PLAYER_NEW || Type == -TEEHISTORIAN_PLAYER_OLD)
+	{
+		int ClientId = Type;
+		if(Type < 0 && !ReadInt(&ClientId))
+			return false;
+		if(ClientId < 0 || ClientId >= MAX_CLIENTS)
+			return false;
+		if(ClientId <= m_PrevPlayerCid)
+			m_Tick++;
+		m_PrevPlayerCid = ClientId;
+
+		CTeeHistorianIndex::CPlayer &Player = m_aPlayers[ClientId];
+		if(Type == -TEEHISTORIAN_PLAYER_OLD)
+		{
+			Player.m_Alive = false;
+			Player.m_X = 0;
+			Player.m_Y = 0;
+			return true;
+		}
+		int X, Y;
+		if(!ReadInt(&X) || !ReadInt(&Y))
+			return false;
+		if(Type >= 0)
+		{
+			Player.m_X += X;
+			Player.m_Y += Y;
+		}
+		else
+		{
+			Player.m_X = X;
+			Player.m_Y = Y;
+		}
+		Player.m_Alive = true;
+		return true;
+	}
+
+	int ClientId;
+	switch(-Type)
+	{
+	case TEEHISTORIAN_FINISH:
+		m_Finished = true;
+		return true;
+	case TEEHISTORIAN_TICK_SKIP:
+	{
+		int Dt;
+		if(!ReadInt(&Dt))
+			return false;
+		m_Tick += Dt + 1;
+		m_PrevPlayerCid = -1;
+		return true;
+	}
+	case TEEHISTORIAN_INPUT_DIFF:
+	case TEEHISTORIAN_INPUT_NEW:
+	{
+		if(!ReadInt(&ClientId) || ClientId < 0 || ClientId >= MAX_CLIENTS)
+			return false;
+		CTeeHistorianIndex::CPlayer &Player = m_aPlayers[ClientId];
+		int *pInput = (int *)&Player.m_Input;
+		for(int i = 0; i < NUM_INPUT_INTS; i++)
+		{
+			int Value;
+			if(!ReadInt(&Value))
+				return false;
+			// addition with wrapping by casting to unsigned
+			pInput[i] = Type == -TEEHISTORIAN_INPUT_DIFF ? (int)((unsigned)pInput[i] + (unsigned)Value) : Value;
+		}
+		Player.m_HaveInput = true;
+		return true;
+	}
+	case TEEHISTORIAN_MESSAGE:
+	{
+		int Size;
+		return ReadInt(&ClientId) && ReadInt(&Size) && ReadRaw(Size);
+	}
+	case TEEHISTORIAN_JOIN:
+		return ReadInt(&ClientId);
+	case TEEHISTORIAN_DROP:
+		return ReadInt(&ClientId) && ReadString();
+	case TEEHISTORIAN_CONSOLE_COMMAND:
+	{
+		int FlagMask, NumArgs;
+		if(!ReadInt(&ClientId) || !ReadInt(&FlagMask) || !ReadString() || !ReadInt(&NumArgs))
+			return false;
+		for(int i = 0; i < NumArgs; i++)
+			if(!ReadString())
+				return false;
+		return true;
+	}
+	case TEEHISTORIAN_EX:
+	{
+		const unsigned char *pUuid;
+		const unsigned char *pData;
+		int Size;
+		if(!ReadRaw(sizeof(CUuid), &pUuid) || !ReadInt(&Size) || !ReadRaw(Size, &pData))
+			return false;
+		const bool PlayerTeam = mem_comp(pUuid, &UUID_TEEHISTORIAN_PLAYER_TEAM, sizeof(CUuid)) == 0;
+		const bool TeamPractice = mem_comp(pUuid, &UUID_TEEHISTORIAN_TEAM_PRACTICE, sizeof(CUuid)) == 0;
+		if(PlayerTeam || TeamPractice)
+		{
+			CUnpacker Unpacker;
+			Unpacker.Reset(pData, Size);
+			const int Id = Unpacker.GetInt();
+			const int Value = Unpacker.GetInt();
+			if(Unpacker.Error() || Id < 0 || Id >= MAX_CLIENTS)
+				return false;
+			if(PlayerTeam)
+				m_aPlayers[Id].m_Team = Value;
+			else
+				m_aPractice[Id] = Value;
+		}
+		return true;
+	}
+	}
+	return false;
+}
+
+bool CTeeHistorianReader::ReadTick()
+{
+	const int Tick = PeekTick();
+	if(Tick < 0)
+		return false;
+	while(PeekTick() == Tick)
+	{
+		if(!ReadRecord())
+		{
+			m_Error = true;
+			return false;
+		}
+	}
+	// consume the finish record so that Finished reports it
+	if(!m_Error && m_Pos < m_DataSize && PeekTick() < 0)
+	{
+		int Type;
+		const int64_t Start = m_Pos;
+		if(ReadInt(&Type) && Type == -TEEHISTORIAN_FINISH)
+			m_Finished = true;
+		else
+			m_Pos = Start;
+	}
+	return true;
+}
+
+bool CTeeHistorianReader::Seek(const CTeeHistorianIndex *pIndex, int Tick)
+{
+	if(!m_pData)
+		return false;
+
+	// continue from the current position if that is closer than the keyframe
+	const bool Behind = m_Error || m_Tick > Tick;
+	const CTeeHistorianIndex::CKeyframe *pKeyframe = pIndex ? pIndex->FindKeyframe(Tick) : nullptr;
+	if(pKeyframe && (Behind || pKeyframe->m_StreamTick > m_Tick) && pKeyframe->m_Offset >= m_HeaderSize && pKeyframe->m_Offset <= m_DataSize)
+	{
+		ResetState();
+		m_Pos = pKeyframe->m_Offset;
+		m_Tick = pKeyframe->m_StreamTick;
+		// the keyframe tick starts with an explicit tick skip
+		m_PrevPlayerCid = -1;
+		mem_copy(m_aPlayers, pKeyframe->m_aPlayers, sizeof(m_aPlayers));
+		mem_copy(m_aPractice, pKeyframe->m_aPractice, sizeof(m_aPractice));
+	}
+	else if(Behind)
+	{
+		ResetState();
+		m_Pos = m_HeaderSize;
+	}
+
+	while(true)
+	{
+		const int NextTick = PeekTick();
+		if(NextTick < 0 || NextTick > Tick)
+			break;
+		if(!ReadTick())
+			break;
+	}
+	return !m_Error;
+}
@@ -0,0 +1,131 @@
+#ifndef ENGINE_SHARED_TEEHISTORIAN_READER_H
+#define ENGINE_SHARED_TEEHISTORIAN_READER_H
+
+#include <base/system.h>
+
+#include <engine/shared/protocol.h>
+#include <engine/shared/uuid_manager.h>
+
+#include <game/generated/protocol.h>
+
+#include <vector>
+
+class CAbstractPacker;
+
+// Sidecar index of a teehistorian file. Keyframes hold the complete
+// decoder state at the start of a tick together with the offset of that
+// tick in the uncompressed stream, events point at player joins and drops.
+class CTeeHistorianIndex
+{
+public:
+	enum
+	{
+		RECORD_KEYFRAME = 1,
+		RECORD_JOIN,
+		RECORD_DROP,
+	};
+
+	class CPlayer
+	{
+	public:
+		bool m_Alive;
+		int m_X;
+		int m_Y;
+		int m_Team;
+		bool m_HaveInput;
+		CNetObj_PlayerInput m_Input;
+	};
+
+	class CKeyframe
+	{
+	public:
+		int m_Tick;
+		// last tick written to the stream before the keyframe
+		int m_StreamTick;
+		int64_t m_Offset;
+		CPlayer m_aPlayers[MAX_CLIENTS];
+		bool m_aPractice[MAX_CLIENTS];
+	};
+
+	class CEvent
+	{
+	public:
+		int m_Type;
+		int m_Tick;
+		int64_t m_Offset;
+		int m_ClientId;
+	};
+
+	static void PackHeader(CAbstractPacker *pPacker, CUuid GameUuid);
+	static void PackKeyframe(CAbstractPacker *pPacker, const CKeyframe *pKeyframe);
+	static void PackEvent(CAbstractPacker *pPacker, const CEvent *pEvent);
+
+	bool Load(const void *pData, int64_t DataSize);
+	bool Load(IOHANDLE File);
+
+	CUuid GameUuid() const { return m_GameUuid; }
+	const std::vector<CKeyframe> &Keyframes() const { return m_vKeyframes; }
+	const std::vector<CEvent> &Events() const { return m_vEvents; }
+
+	// last keyframe at or before the tick, nullptr if there is none
+	const CKeyframe *FindKeyframe(int Tick) const;
+	// index of the first event at or after the tick
+	int FindEvent(int Tick) const;
+
+private:
+	CUuid m_GameUuid;
+	std::vector<CKeyframe> m_vKeyframes;
+	std::vector<CEvent> m_vEvents;
+};
+
+// Decodes the player state of an uncompressed teehistorian stream tick by
+// tick. With an index, Seek starts from the closest keyframe instead of
+// the beginning of the file.
+class CTeeHistorianReader
+{
+public:
+	CTeeHistorianReader();
+	~CTeeHistorianReader();
+
+	// maps the file into memory, the handle can be closed afterwards
+	bool Open(IOHANDLE File);
+	// reads from the data without copying it
+	bool Open(const void *pData, int64_t DataSize);
+	void Close();
+
+	// reads the records of the next tick, false at the end of the stream
+	bool ReadTick();
+	// decodes up to the end of the tick, or the last tick before it that
+	// has any records
+	bool Seek(const CTeeHistorianIndex *pIndex, int Tick);
+	// tick of the next record, -1 at the end of the stream
+	int PeekTick();
+
+	int Tick() const { return m_Tick; }
+	const CTeeHistorianIndex::CPlayer &Player(int ClientId) const { return m_aPlayers[ClientId]; }
+	bool Practice(int Team) const { return m_aPractice[Team]; }
+	bool Finished() const { return m_Finished; }
+	bool Error() const { return m_Error; }
+
+private:
+	void ResetState();
+	bool ReadInt(int *pInt);
+	bool ReadRaw(int64_t Size, const unsigned char **ppData = nullptr);
+	bool ReadString();
+	bool ReadRecord();
+
+	const unsigned char *m_pData;
+	int64_t m_DataSize;
+	int64_t m_MappedSize;
+	int64_t m_HeaderSize;
+	int64_t m_Pos;
+
+	int m_Tick;
+	int m_PrevPlayerCid;
+	bool m_Finished;
+	bool m_Error;
+	CTeeHistorianIndex::CPlayer m_aPlayers[MAX_CLIENTS];
+	bool m_aPractice[MAX_CLIENTS];
+};
+
+#endif // ENGINE_SHARED_TEEHISTORIAN_READER_H
@@ -614,6 +614,7 @@ void CGameClient::OnReset()
 
 	m_PredictedTick = -1;
 	std::fill(std::begin(m_aLastNewPredictedTick), std::end(m_aLastNewPredictedTick), -1);
+	m_PredictionHistory.Reset();
 
 	m_LastRoundStartTick = -1;
 	m_LastRaceTick = -1;
@@ -1198,6 +1199,9 @@ void CGameClient::OnMessage(int MsgId, CUnpacker *pUnpacker, int Conn, bool Dumm
 	{
 		CNetMsg_Sv_PreInput *pMsg = (CNetMsg_Sv_PreInput *)pRawMsg;
 		m_aClients[pMsg->m_Owner].m_aPreInputs[pMsg->m_IntendedTick % 200] = *pMsg;
+		// the ticks predicted without this input have to be predicted again
+		if(pMsg->m_IntendedTick <= m_PredictionHistory.m_LastTick)
+			m_PredictionHistory.Reset();
 	}
 }
 
@@ -2330,6 +2334,62 @@ void CGameClient::UpdateEditorIngameMoved()
 	}
 }
 
+bool CGameClient::IsUnpredicted(int Type, CEntity *pEnt) const
+{
+	// inactive players and entities from other teams
+	if(Type == CGameWorld::ENTTYPE_CHARACTER)
+	{
+		CCharacter *pChar = (CCharacter *)pEnt;
+		const int ClientId = pChar->GetCid();
+		return (!m_Snap.m_aCharacters[ClientId].m_Active && pChar->m_SnapTicks > 10) || IsOtherTeam(ClientId);
+	}
+	if(Type == CGameWorld::ENTTYPE_PROJECTILE)
+		return IsOtherTeam(((CProjectile *)pEnt)->GetOwner());
+	return false;
+}
+
+int CGameClient::ContinuePredictionTick(int PredictionTick)
+{
+	const CPredictionHistory &History = m_PredictionHistory;
+	if(!g_Config.m_ClPredictIncremental || !History.m_Valid)
+		return -1;
+	if(History.m_LocalClientId != m_Snap.m_LocalClientId ||
+		History.m_DummyId != (PredictDummy() ? m_PredictedDummyId : -1) ||
+		History.m_IsDummySwapping != m_IsDummySwapping ||
+		History.m_Dummy != g_Config.m_ClDummy)
+		return -1;
+	// the ticks before the last one are changed to allow movement in freeze
+	if(g_Config.m_ClPredictFreeze == 2)
+		return -1;
+
+	const int GameTick = Client()->GameTick(g_Config.m_ClDummy);
+	const int PredGameTick = Client()->PredGameTick(g_Config.m_ClDummy);
+	if(PredGameTick < History.m_LastTick || GameTick > History.m_LastTick || GameTick < History.m_BaseTick)
+		return -1;
+	// the previous characters are fetched at the prediction tick
+	if(PredictionTick <= History.m_LastTick && PredictionTick != History.m_PredictionTick)
+		return -1;
+	if(m_PredictedWorld.m_pParent != &m_GameWorld || m_GameWorld.m_pChild != &m_PredictedWorld)
+		return -1;
+	if(mem_comp(History.m_aTuningList, m_aTuningList, sizeof(m_aTuningList)) != 0)
+		return -1;
+
+	// no new snapshot since the last prediction
+	if(m_PredictedWorld.m_IsValidCopy)
+		return History.m_LastTick + 1;
+
+	// the new snapshot has to match what we predicted for its tick
+	if(History.m_aTicks[GameTick % 200] != GameTick)
+		return -1;
+	const uint64_t Hash = m_GameWorld.StateHash([this](int Type, CEntity *pEnt) { return IsUnpredicted(Type, pEnt); });
+	if(Hash != History.m_aHashes[GameTick % 200])
+		return -1;
+
+	m_PredictedWorld.m_IsValidCopy = true;
+	m_PredictionHistory.m_BaseTick = GameTick;
+	return History.m_LastTick + 1;
+}
+
 void CGameClient::OnPredict()
 {
 	// store the previous values so we can detect prediction errors
@@ -2338,11 +2398,15 @@ void CGameClient::OnPredict()
 
 	// we can't predict without our own id or own character
 	if(m_Snap.m_LocalClientId == -1 || !m_Snap.m_aCharacters[m_Snap.m_LocalClientId].m_Active)
+	{
+		m_PredictionHistory.Reset();
 		return;
+	}
 
 	// don't predict anything if we are paused
 	if(m_Snap.m_pGameInfoObj && m_Snap.m_pGameInfoObj->m_GameStateFlags & GAMESTATEFLAG_PAUSED)
 	{
+		m_PredictionHistory.Reset();
 		if(m_Snap.m_pLocalCharacter)
 		{
 			m_PredictedChar.Read(m_Snap.m_pLocalCharacter);
@@ -2362,23 +2426,35 @@ void CGameClient::OnPredict()
 
 	// init
 	bool Dummy = g_Config.m_ClDummy ^ m_IsDummySwapping;
-	m_PredictedWorld.CopyWorld(&m_GameWorld);
+	int PredictionTick = Client()->GetPredictionTick();
+	int FirstTick = ContinuePredictionTick(PredictionTick);
+	if(FirstTick == -1)
+	{
+		m_PredictedWorld.CopyWorld(&m_GameWorld);
 
-	// don't predict inactive players, or entities from other teams
-	for(int i = 0; i < MAX_CLIENTS; i++)
-		if(CCharacter *pChar = m_PredictedWorld.GetCharacterById(i))
-			if((!m_Snap.m_aCharacters[i].m_Active && pChar->m_SnapTicks > 10) || IsOtherTeam(i))
-				pChar->Destroy();
+		// don't predict inactive players, or entities from other teams
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			if(CCharacter *pChar = m_PredictedWorld.GetCharacterById(i))
+				if(IsUnpredicted(CGameWorld::ENTTYPE_CHARACTER, pChar))
+					pChar->Destroy();
 
-	CProjectile *pProjNext = nullptr;
-	for(CProjectile *pProj = (CProjectile *)m_PredictedWorld.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = pProjNext)
-	{
-		pProjNext = (CProjectile *)pProj->TypeNext();
-		if(IsOtherTeam(pProj->GetOwner()))
+		CProjectile *pProjNext = nullptr;
+		for(CProjectile *pProj = (CProjectile *)m_PredictedWorld.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = pProjNext)
 		{
-			pProj->Destroy();
+			pProjNext = (CProjectile *)pProj->TypeNext();
+			if(IsUnpredicted(CGameWorld::ENTTYPE_PROJECTILE, pProj))
+			{
+				pProj->Destroy();
+			}
 		}
+
+		const int GameTick = Client()->GameTick(g_Config.m_ClDummy);
+		m_PredictionHistory.m_BaseTick = GameTick;
+		m_PredictionHistory.m_aTicks[GameTick % 200] = GameTick;
+		m_PredictionHistory.m_aHashes[GameTick % 200] = m_PredictedWorld.StateHash();
+		FirstTick = GameTick + 1;
 	}
+	m_PredictionHistory.m_Valid = false;
 
 	CCharacter *pLocalChar = m_PredictedWorld.GetCharacterById(m_Snap.m_LocalClientId);
 	if(!pLocalChar)
@@ -2387,9 +2463,8 @@ void CGameClient::OnPredict()
 	if(PredictDummy())
 		pDummyChar = m_PredictedWorld.GetCharacterById(m_PredictedDummyId);
 
-	int PredictionTick = Client()->GetPredictionTick();
 	// predict
-	for(int Tick = Client()->GameTick(g_Config.m_ClDummy) + 1; Tick <= Client()->PredGameTick(g_Config.m_ClDummy); Tick++)
+	for(int Tick = FirstTick; Tick <= Client()->PredGameTick(g_Config.m_ClDummy); Tick++)
 	{
 		// fetch the previous characters
 		if(Tick == PredictionTick)
@@ -2518,6 +2593,9 @@ void CGameClient::OnPredict()
 				m_aClients[i].m_aPredTick[Tick % 200] = Tick;
 			}
 
+		m_PredictionHistory.m_aTicks[Tick % 200] = Tick;
+		m_PredictionHistory.m_aHashes[Tick % 200] = m_PredictedWorld.StateHash();
+
 		// check if we want to trigger effects
 		if(Tick > m_aLastNewPredictedTick[Dummy])
 		{
@@ -2551,6 +2629,16 @@ void CGameClient::OnPredict()
 		}
 	}
 
+	m_PredictionHistory.m_Valid = true;
+	m_PredictionHistory.m_LastTick = Client()->PredGameTick(g_Config.m_ClDummy);
+	m_PredictionHistory.m_PredictionTick = PredictionTick;
+	m_PredictionHistory.m_LocalClientId = m_Snap.m_LocalClientId;
+	m_PredictionHistory.m_DummyId = PredictDummy() ? m_PredictedDummyId : -1;
+	m_PredictionHistory.m_IsDummySwapping = m_IsDummySwapping;
+	m_PredictionHistory.m_Dummy = g_Config.m_ClDummy;
+	if(g_Config.m_ClPredictIncremental)
+		mem_copy(m_PredictionHistory.m_aTuningList, m_aTuningList, sizeof(m_aTuningList));
+
 	// detect mispredictions of other players and make corrections smoother when possible
 	if(g_Config.m_ClAntiPingSmooth && Predict() && AntiPingPlayers() && m_NewTick && m_PredictedTick >= MIN_TICK && absolute(m_PredictedTick - Client()->PredGameTick(g_Config.m_ClDummy)) <= 1 && absolute(Client()->GameTick(g_Config.m_ClDummy) - Client()->PrevGameTick(g_Config.m_ClDummy)) <= 2)
 	{
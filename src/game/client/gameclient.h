@@ -220,6 +220,30 @@ private:
 	int m_PredictedTick;
 	int m_aLastNewPredictedTick[NUM_DUMMIES];
 
+	// state hashes of the ticks predicted last time, to continue the
+	// prediction instead of starting over when the new snapshot matches
+	class CPredictionHistory
+	{
+	public:
+		bool m_Valid = false;
+		int m_BaseTick = -1;
+		int m_LastTick = -1;
+		int m_PredictionTick = -1;
+		int m_LocalClientId = -1;
+		int m_DummyId = -1;
+		int m_IsDummySwapping = 0;
+		int m_Dummy = 0;
+		int m_aTicks[200] = {};
+		uint64_t m_aHashes[200] = {};
+		// the tune zones aren't part of the world state, so they are compared on their own
+		CTuningParams m_aTuningList[NUM_TUNEZONES];
+
+		void Reset() { m_Valid = false; }
+	};
+	CPredictionHistory m_PredictionHistory;
+	bool IsUnpredicted(int Type, CEntity *pEnt) const;
+	int ContinuePredictionTick(int PredictionTick);
+
 	int m_LastRoundStartTick;
 	int m_LastRaceTick;
 
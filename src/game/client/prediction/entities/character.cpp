@@ -4,6 +4,7 @@
 #include <game/collision.h>
 #include <game/generated/client_data.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 #include "character.h"
 #include "laser.h"
@@ -601,7 +602,7 @@ void CCharacter::TickDeferred()
 {
 	m_Core.Move();
 	m_Core.Quantize();
-	m_Pos = m_Core.m_Pos;
+	SetPos(m_Core.m_Pos);
 }
 
 bool CCharacter::TakeDamage(vec2 Force, int Dmg, int From, int Weapon)
@@ -1116,11 +1117,11 @@ void CCharacter::DDRacePostCoreTick()
 	HandleSkippableTiles(CurrentIndex);
 
 	// handle Anti-Skip tiles
-	std::vector<int> vIndices = Collision()->GetMapIndices(m_PrevPos, m_Pos);
-	if(!vIndices.empty())
-		for(int Index : vIndices)
-			HandleTiles(Index);
-	else
+	int NumIndices = Collision()->ForEachMapIndex(m_PrevPos, m_Pos, [this](int Index) {
+		HandleTiles(Index);
+		return true;
+	});
+	if(!NumIndices)
 	{
 		HandleTiles(CurrentIndex);
 	}
@@ -1236,7 +1237,8 @@ CCharacter::CCharacter(CGameWorld *pGameWorld, int Id, CNetObj_Character *pChar,
 	m_LastWeapon = WEAPON_HAMMER;
 	m_QueuedWeapon = -1;
 	m_LastRefillJumps = false;
-	m_PrevPrevPos = m_PrevPos = m_Pos = vec2(pChar->m_X, pChar->m_Y);
+	SetPos(vec2(pChar->m_X, pChar->m_Y));
+	m_PrevPrevPos = m_PrevPos = m_Pos;
 	m_Core.Reset();
 	m_Core.Init(&GameWorld()->m_Core, GameWorld()->Collision(), GameWorld()->Teams());
 	m_Core.m_Id = Id;
@@ -1416,7 +1418,7 @@ void CCharacter::Read(CNetObj_Character *pChar, CNetObj_DDNetCharacter *pExtende
 	}
 
 	vec2 PosBefore = m_Pos;
-	m_Pos = m_Core.m_Pos;
+	SetPos(m_Core.m_Pos);
 
 	if(distance(PosBefore, m_Pos) > 2.f) // misprediction, don't use prevpos
 		m_PrevPos = m_Pos;
@@ -1483,6 +1485,18 @@ bool CCharacter::Match(CCharacter *pChar) const
 	return distance(pChar->m_Core.m_Pos, m_Core.m_Pos) <= 32.f;
 }
 
+void CCharacter::HashState(CStateHash &Hash) const
+{
+	Hash.AddCharacterCore(m_Core);
+	Hash.Add(m_FreezeTime);
+	Hash.Add(m_AttackTick);
+	Hash.Add(m_NinjaJetpack);
+	Hash.Add(m_TeleCheckpoint);
+	Hash.Add(m_StrongWeakId);
+	Hash.Add(m_TuneZone);
+	Hash.Add(m_TuneZoneOverride);
+}
+
 void CCharacter::SetActiveWeapon(int ActiveWeapon)
 {
 	if(ActiveWeapon < WEAPON_HAMMER || ActiveWeapon >= NUM_WEAPONS)
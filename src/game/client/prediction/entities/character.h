@@ -123,6 +123,7 @@ public:
 	bool m_CanMoveInFreeze;
 
 	bool Match(CCharacter *pChar) const;
+	void HashState(CStateHash &Hash) const override;
 	void ResetPrediction();
 	void SetTuneZone(int Zone);
 	int GetOverriddenTuneZone() const;
@@ -4,6 +4,7 @@
 #include <game/client/laser_data.h>
 #include <game/collision.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 CDoor::CDoor(CGameWorld *pGameWorld, int Id, const CLaserData *pData) :
 	CEntity(pGameWorld, CGameWorld::ENTTYPE_DOOR)
@@ -72,3 +73,9 @@ bool CDoor::Match(const CDoor *pDoor) const
 {
 	return pDoor->m_Pos == m_Pos && pDoor->m_To == m_To && pDoor->m_Number == m_Number;
 }
+
+void CDoor::HashState(CStateHash &Hash) const
+{
+	Hash.Add(m_To);
+	Hash.Add(m_Number);
+}
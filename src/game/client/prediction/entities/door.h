@@ -18,6 +18,7 @@ public:
 	void ResetCollision();
 	bool Match(const CDoor *pDoor) const;
 	void Read(const CLaserData *pData);
+	void HashState(CStateHash &Hash) const override;
 
 	void Destroy() override;
 };
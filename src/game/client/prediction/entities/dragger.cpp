@@ -8,6 +8,7 @@
 #include <game/collision.h>
 #include <game/generated/protocol.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 void CDragger::Tick()
 {
@@ -153,3 +154,10 @@ bool CDragger::Match(CDragger *pDragger)
 {
 	return pDragger->m_Strength == m_Strength && pDragger->m_Number == m_Number && pDragger->m_IgnoreWalls == m_IgnoreWalls;
 }
+
+void CDragger::HashState(CStateHash &Hash) const
+{
+	Hash.Add(m_Strength);
+	Hash.Add(m_Number);
+	Hash.Add(m_IgnoreWalls);
+}
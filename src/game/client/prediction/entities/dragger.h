@@ -22,6 +22,7 @@ public:
 	bool Match(CDragger *pDragger);
 	void Read(const CLaserData *pData);
 	float GetStrength() { return m_Strength; }
+	void HashState(CStateHash &Hash) const override;
 
 	void Tick() override;
 };
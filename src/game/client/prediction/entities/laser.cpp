@@ -6,6 +6,7 @@
 #include <game/collision.h>
 #include <game/generated/protocol.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 #include <engine/shared/config.h>
 
@@ -212,6 +213,16 @@ bool CLaser::Match(CLaser *pLaser)
 	return DirError <= 2.f;
 }
 
+void CLaser::HashState(CStateHash &Hash) const
+{
+	Hash.Add(round_to_int(m_From.x));
+	Hash.Add(round_to_int(m_From.y));
+	Hash.Add(m_EvalTick);
+	Hash.Add(m_Owner);
+	Hash.Add(m_Type);
+	Hash.Add(m_TuneZone);
+}
+
 CLaserData CLaser::GetData() const
 {
 	CLaserData Result;
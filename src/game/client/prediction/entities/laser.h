@@ -22,6 +22,7 @@ public:
 	CLaser(CGameWorld *pGameWorld, int Id, CLaserData *pLaser);
 	bool Match(CLaser *pLaser);
 	CLaserData GetData() const;
+	void HashState(CStateHash &Hash) const override;
 
 protected:
 	bool HitCharacter(vec2 From, vec2 To);
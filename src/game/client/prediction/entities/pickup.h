@@ -17,6 +17,7 @@ public:
 	CPickup(CGameWorld *pGameWorld, int Id, const CPickupData *pPickup);
 	void FillInfo(CNetObj_Pickup *pPickup);
 	bool Match(CPickup *pPickup);
+	void HashState(CStateHash &Hash) const override;
 	bool InDDNetTile() { return m_IsCoreActive; }
 
 	int Type() const { return m_Type; }
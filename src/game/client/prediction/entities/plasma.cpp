@@ -5,6 +5,7 @@
 #include <game/client/laser_data.h>
 #include <game/collision.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 const float PLASMA_ACCEL = 1.1f;
 
@@ -37,6 +38,15 @@ bool CPlasma::Match(const CPlasma *pPlasma) const
 	       pPlasma->m_Explosive == m_Explosive && pPlasma->m_Freeze == m_Freeze && pPlasma->m_ForClientId == m_ForClientId;
 }
 
+void CPlasma::HashState(CStateHash &Hash) const
+{
+	Hash.Add(m_EvalTick);
+	Hash.Add(m_Number);
+	Hash.Add(m_Explosive);
+	Hash.Add(m_Freeze);
+	Hash.Add(m_ForClientId);
+}
+
 void CPlasma::Read(const CLaserData *pData)
 {
 	m_Pos = pData->m_From;
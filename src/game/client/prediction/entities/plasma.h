@@ -24,6 +24,7 @@ public:
 
 	bool Match(const CPlasma *pPlasma) const;
 	void Read(const CLaserData *pData);
+	void HashState(CStateHash &Hash) const override;
 
 	void Reset();
 	void Tick() override;
@@ -6,6 +6,7 @@
 #include <game/collision.h>
 #include <game/generated/protocol.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 #include "character.h"
 #include "projectile.h"
@@ -224,3 +225,14 @@ bool CProjectile::Match(CProjectile *pProj)
 		return false;
 	return true;
 }
+
+void CProjectile::HashState(CStateHash &Hash) const
+{
+	Hash.Add(m_Type);
+	Hash.Add(m_StartTick);
+	Hash.Add(m_Owner);
+	Hash.Add(m_Explosive);
+	Hash.Add(m_Bouncing);
+	Hash.Add(m_Freeze);
+	Hash.Add(m_TuneZone);
+}
@@ -32,6 +32,7 @@ public:
 	void Tick() override;
 
 	bool Match(CProjectile *pProj);
+	void HashState(CStateHash &Hash) const override;
 	void SetBouncing(int Value);
 
 	const vec2 &GetDirection() { return m_Direction; }
@@ -36,6 +36,13 @@ CEntity::~CEntity()
 		GameWorld()->RemoveEntity(this);
 }
 
+void CEntity::SetPos(vec2 Pos)
+{
+	m_Pos = Pos;
+	if(GameWorld())
+		GameWorld()->UpdateEntityPos(this);
+}
+
 bool CEntity::GameLayerClipped(vec2 CheckPos)
 {
 	return round_to_int(CheckPos.x) / 32 < -200 || round_to_int(CheckPos.x) / 32 > Collision()->GetWidth() + 200 ||
@@ -9,14 +9,19 @@
 
 #include "gameworld.h"
 
+class CStateHash;
+
 class CEntity
 {
 	MACRO_ALLOC_HEAP()
 
 private:
 	friend CGameWorld; // entity list handling
+	template<typename TEntity>
+	friend class CSpatialGrid;
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
+	CSpatialGridItem m_GridItem;
 
 protected:
 	CGameWorld *m_pGameWorld;
@@ -40,12 +45,17 @@ public:
 	CEntity *TypePrev() { return m_pPrevTypeEntity; }
 	const vec2 &GetPos() const { return m_Pos; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
+	// positions of characters and pickups must be changed with this, so
+	// that the game world can find them by position
+	void SetPos(vec2 Pos);
 	virtual bool CanCollide(int ClientId) { return true; }
 
 	virtual void Destroy() { delete this; }
 	virtual void PreTick() {}
 	virtual void Tick() {}
 	virtual void TickDeferred() {}
+	// the state that the snapshot delivers, to find out if a prediction still holds
+	virtual void HashState(CStateHash &Hash) const {}
 
 	bool GameLayerClipped(vec2 CheckPos);
 	float m_ProximityRadius;
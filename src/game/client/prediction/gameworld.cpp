@@ -16,6 +16,7 @@
 #include <game/client/projectile_data.h>
 #include <game/mapbugs.h>
 #include <game/mapitems.h>
+#include <game/state_hash.h>
 
 #include <algorithm>
 #include <utility>
@@ -38,6 +39,12 @@ CGameWorld::CGameWorld()
 CGameWorld::~CGameWorld()
 {
 	Clear();
+	for(auto &vpFreeEntities : m_avpFreeEntities)
+	{
+		for(CEntity *pEnt : vpFreeEntities)
+			delete pEnt;
+		vpFreeEntities.clear();
+	}
 	if(m_pChild && m_pChild->m_pParent == this)
 	{
 		OnModified();
@@ -61,23 +68,48 @@ CEntity *CGameWorld::FindLast(int Type)
 	return pLast;
 }
 
+void CGameWorld::UpdateEntityPos(CEntity *pEnt)
+{
+	m_aEntityGrids[pEnt->m_ObjType].Move(pEnt);
+}
+
+template<typename F>
+void CGameWorld::ForEachEntityInArea(int Type, vec2 Min, vec2 Max, F &&Func)
+{
+	// visits the entities in list order, stops when Func returns true
+#ifdef CONF_DEBUG
+	for(CEntity *pCur = m_apFirstEntityTypes[Type]; pCur; pCur = pCur->m_pNextTypeEntity)
+		dbg_assert(m_aEntityGrids[Type].IsCellCurrent(pCur), "entity moved without SetPos, type=%d id=%d", Type, pCur->GetId());
+#endif
+	if(HasEntityGrid(Type) && m_aEntityGrids[Type].Query(Min, Max, m_vpGridResult))
+	{
+		for(CEntity *pEnt : m_vpGridResult)
+			if(Func(pEnt))
+				return;
+		return;
+	}
+	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		if(Func(pEnt))
+			return;
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
 	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
-	{
+	ForEachEntityInArea(Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), [&](CEntity *pEnt) {
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
 		{
 			if(ppEnts)
 				ppEnts[Num] = pEnt;
 			Num++;
 			if(Num == Max)
-				break;
+				return true;
 		}
-	}
+		return false;
+	});
 
 	return Num;
 }
@@ -113,6 +145,11 @@ void CGameWorld::InsertEntity(CEntity *pEnt, bool Last)
 		pEnt->m_pNextTypeEntity = nullptr;
 	}
 
+	if(HasEntityGrid(pEnt->m_ObjType))
+		m_aEntityGrids[pEnt->m_ObjType].Insert(pEnt, Last ? m_NextLastEntityOrder-- : m_NextFirstEntityOrder++);
+	else
+		pEnt->m_GridItem.m_pGrid = nullptr;
+
 	if(pEnt->m_ObjType == ENTTYPE_CHARACTER)
 	{
 		auto *pChar = (CCharacter *)pEnt;
@@ -147,6 +184,9 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = nullptr;
 	pEnt->m_pPrevTypeEntity = nullptr;
 
+	if(HasEntityGrid(pEnt->m_ObjType))
+		m_aEntityGrids[pEnt->m_ObjType].Remove(pEnt);
+
 	if(pEnt->m_pParent)
 	{
 		if(m_IsValidCopy && m_pParent && m_pParent->m_pChild == this)
@@ -257,17 +297,20 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CEntity *pClosest = nullptr;
 
-	CEntity *pEntity = FindFirst(Type);
-	for(; pEntity; pEntity = pEntity->TypeNext())
-	{
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return nullptr;
+
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+	ForEachEntityInArea(Type, Min, Max, [&](CEntity *pEntity) {
 		if(pEntity == pNotThis)
-			continue;
+			return false;
 
 		if(pThisOnly && pEntity != pThisOnly)
-			continue;
+			return false;
 
 		if(CollideWith != -1 && !pEntity->CanCollide(CollideWith))
-			continue;
+			return false;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pEntity->m_Pos, IntersectPos))
@@ -284,7 +327,8 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 				}
 			}
 		}
-	}
+		return false;
+	});
 
 	return pClosest;
 }
@@ -292,11 +336,12 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CEntity *pNotThis)
 {
 	std::vector<CCharacter *> vpCharacters;
-	CCharacter *pChr = (CCharacter *)FindFirst(CGameWorld::ENTTYPE_CHARACTER);
-	for(; pChr; pChr = (CCharacter *)pChr->TypeNext())
-	{
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+	ForEachEntityInArea(ENTTYPE_CHARACTER, Min, Max, [&](CEntity *pEnt) {
+		CCharacter *pChr = (CCharacter *)pEnt;
 		if(pChr == pNotThis)
-			continue;
+			return false;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pChr->m_Pos, IntersectPos))
@@ -307,7 +352,8 @@ std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1
 				vpCharacters.push_back(pChr);
 			}
 		}
-	}
+		return false;
+	});
 	return vpCharacters;
 }
 
@@ -487,7 +533,7 @@ void CGameWorld::NetObjAdd(int ObjId, int ObjType, const void *pObjData, const C
 		{
 			if(NetPickup.Match(pPickup))
 			{
-				pPickup->m_Pos = NetPickup.m_Pos;
+				pPickup->SetPos(NetPickup.m_Pos);
 				pPickup->Keep();
 				return;
 			}
@@ -589,7 +635,8 @@ void CGameWorld::NetObjEnd()
 				if(CCharacter *pHookedChar = GetCharacterById(pChar->m_Core.HookedPlayer()))
 					if(pHookedChar->m_MarkedForDestroy)
 					{
-						pHookedChar->m_Pos = pHookedChar->m_Core.m_Pos = pChar->m_Core.m_HookPos;
+						pHookedChar->m_Core.m_Pos = pChar->m_Core.m_HookPos;
+						pHookedChar->SetPos(pChar->m_Core.m_HookPos);
 						pHookedChar->ResetVelocity();
 						mem_zero(&pHookedChar->m_SavedInput, sizeof(pHookedChar->m_SavedInput));
 						pHookedChar->m_SavedInput.m_TargetY = -1;
@@ -615,6 +662,33 @@ void CGameWorld::NetObjEnd()
 	}
 }
 
+void CGameWorld::ReleaseEntities()
+{
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		while(CEntity *pEnt = m_apFirstEntityTypes[Type])
+		{
+			// same as the destructor, without freeing the entity
+			RemoveEntity(pEnt);
+			if(Type == ENTTYPE_CHARACTER)
+				RemoveCharacter((CCharacter *)pEnt);
+			m_avpFreeEntities[Type].push_back(pEnt);
+		}
+	}
+}
+
+template<typename T>
+CEntity *CGameWorld::CopyEntity(CEntity *pFrom)
+{
+	std::vector<CEntity *> &vpFreeEntities = m_avpFreeEntities[pFrom->m_ObjType];
+	if(vpFreeEntities.empty())
+		return new T(*((T *)pFrom));
+	T *pCopy = (T *)vpFreeEntities.back();
+	vpFreeEntities.pop_back();
+	*pCopy = *((T *)pFrom);
+	return pCopy;
+}
+
 void CGameWorld::CopyWorld(CGameWorld *pFrom)
 {
 	if(pFrom == this || !pFrom)
@@ -636,8 +710,8 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 	m_pMapBugs = pFrom->m_pMapBugs;
 	m_Teams = pFrom->m_Teams;
 	m_Core.m_vSwitchers = pFrom->m_Core.m_vSwitchers;
-	// delete the previous entities
-	Clear();
+	// keep the previous entities for reuse
+	ReleaseEntities();
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
 		m_apCharacters[i] = nullptr;
@@ -650,17 +724,17 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 		{
 			CEntity *pCopy = nullptr;
 			if(Type == ENTTYPE_PROJECTILE)
-				pCopy = new CProjectile(*((CProjectile *)pEnt));
+				pCopy = CopyEntity<CProjectile>(pEnt);
 			else if(Type == ENTTYPE_LASER)
-				pCopy = new CLaser(*((CLaser *)pEnt));
+				pCopy = CopyEntity<CLaser>(pEnt);
 			else if(Type == ENTTYPE_DRAGGER)
-				pCopy = new CDragger(*((CDragger *)pEnt));
+				pCopy = CopyEntity<CDragger>(pEnt);
 			else if(Type == ENTTYPE_CHARACTER)
-				pCopy = new CCharacter(*((CCharacter *)pEnt));
+				pCopy = CopyEntity<CCharacter>(pEnt);
 			else if(Type == ENTTYPE_PICKUP)
-				pCopy = new CPickup(*((CPickup *)pEnt));
+				pCopy = CopyEntity<CPickup>(pEnt);
 			else if(Type == ENTTYPE_PLASMA)
-				pCopy = new CPlasma(*((CPlasma *)pEnt));
+				pCopy = CopyEntity<CPlasma>(pEnt);
 			if(pCopy)
 			{
 				pCopy->m_pParent = pEnt;
@@ -750,6 +824,50 @@ CEntity *CGameWorld::FindMatch(int ObjId, int ObjType, const void *pObjData)
 	return nullptr;
 }
 
+uint64_t CGameWorld::StateHash(const std::function<bool(int Type, CEntity *pEnt)> &Skip)
+{
+	CStateHash Hash;
+	const int aConfig[] = {
+		m_WorldConfig.m_IsDDRace,
+		m_WorldConfig.m_IsVanilla,
+		m_WorldConfig.m_IsFNG,
+		m_WorldConfig.m_InfiniteAmmo,
+		m_WorldConfig.m_PredictTiles,
+		m_WorldConfig.m_PredictFreeze,
+		m_WorldConfig.m_PredictWeapons,
+		m_WorldConfig.m_PredictDDRace,
+		m_WorldConfig.m_IsSolo,
+		m_WorldConfig.m_UseTuneZones,
+		m_WorldConfig.m_BugDDRaceInput,
+		m_WorldConfig.m_NoWeakHookAndBounce,
+	};
+	Hash.AddData(aConfig, sizeof(aConfig));
+	Hash.AddData(m_Core.m_aTuning, sizeof(m_Core.m_aTuning));
+	Hash.AddSwitchers(m_Core.m_vSwitchers);
+	Hash.AddTeams(m_Teams);
+
+	// doors aren't copied, the predicted worlds use them through the shared collision
+	CGameWorld *pDoorWorld = this;
+	while(pDoorWorld->m_pParent)
+		pDoorWorld = pDoorWorld->m_pParent;
+
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		CGameWorld *pWorld = Type == ENTTYPE_DOOR ? pDoorWorld : this;
+		for(CEntity *pEnt = pWorld->FindFirst(Type); pEnt; pEnt = pEnt->TypeNext())
+		{
+			if(Skip && Skip(Type, pEnt))
+				continue;
+			Hash.Add(Type);
+			Hash.Add(pEnt->GetId());
+			Hash.Add(round_to_int(pEnt->GetPos().x));
+			Hash.Add(round_to_int(pEnt->GetPos().y));
+			pEnt->HashState(Hash);
+		}
+	}
+	return Hash.Hash();
+}
+
 void CGameWorld::OnModified() const
 {
 	if(m_pChild)
@@ -4,8 +4,10 @@
 #define GAME_CLIENT_PREDICTION_GAMEWORLD_H
 
 #include <game/gamecore.h>
+#include <game/spatial_grid.h>
 #include <game/teamscore.h>
 
+#include <functional>
 #include <list>
 #include <vector>
 
@@ -45,6 +47,7 @@ public:
 	CEntity *IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Type, vec2 &NewPos, const CEntity *pNotThis = nullptr, int CollideWith = -1, const CEntity *pThisOnly = nullptr);
 	void InsertEntity(CEntity *pEntity, bool Last = false);
 	void RemoveEntity(CEntity *pEntity);
+	void UpdateEntityPos(CEntity *pEntity);
 	void RemoveCharacter(CCharacter *pChar);
 	void Tick();
 
@@ -100,6 +103,10 @@ public:
 	void CopyWorld(CGameWorld *pFrom);
 	CEntity *FindMatch(int ObjId, int ObjType, const void *pObjData);
 	void Clear();
+	// hash of the state that snapshots contain and of the settings that
+	// change how the world is ticked, to detect mispredictions. Entities
+	// for which Skip returns true are left out.
+	uint64_t StateHash(const std::function<bool(int Type, CEntity *pEnt)> &Skip = nullptr);
 
 	CTuningParams *m_pTuningList;
 	CTuningParams *TuningList() { return m_pTuningList; }
@@ -111,9 +118,27 @@ public:
 private:
 	void RemoveEntities();
 
+	// entities of previous copies, CopyWorld assigns to them instead of
+	// allocating new ones
+	std::vector<CEntity *> m_avpFreeEntities[NUM_ENTTYPES];
+	void ReleaseEntities();
+	template<typename T>
+	CEntity *CopyEntity(CEntity *pFrom);
+
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// positions of the entity types that are searched by position, the
+	// order values follow the entity lists
+	CSpatialGrid<CEntity> m_aEntityGrids[NUM_ENTTYPES];
+	int64_t m_NextFirstEntityOrder = 0;
+	int64_t m_NextLastEntityOrder = -1;
+	std::vector<CEntity *> m_vpGridResult;
+
+	static bool HasEntityGrid(int Type) { return Type == ENTTYPE_CHARACTER || Type == ENTTYPE_PICKUP; }
+	template<typename F>
+	void ForEachEntityInArea(int Type, vec2 Min, vec2 Max, F &&Func);
+
 	CCharacter *m_apCharacters[MAX_CLIENTS];
 };
 
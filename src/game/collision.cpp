@@ -39,6 +39,7 @@ vec2 ClampVel(int MoveRestriction, vec2 Vel)
 CCollision::CCollision()
 {
 	m_pDoor = nullptr;
+	m_pColFlags = nullptr;
 	Unload();
 }
 
@@ -119,6 +120,10 @@ void CCollision::Init(class CLayers *pLayers)
 		}
 	}
 
+	m_pColFlags = new uint16_t[m_Width * m_Height];
+	for(int i = 0; i < m_Width * m_Height; i++)
+		m_pColFlags[i] = ComputeColFlags(i);
+
 	if(m_pTele)
 	{
 		for(int i = 0; i < m_Width * m_Height; i++)
@@ -169,6 +174,40 @@ void CCollision::Unload()
 	m_pTune = nullptr;
 	delete[] m_pDoor;
 	m_pDoor = nullptr;
+	delete[] m_pColFlags;
+	m_pColFlags = nullptr;
+}
+
+int CCollision::ComputeColFlags(int Index) const
+{
+	int Flags = 0;
+	const int GameIndex = m_pTiles[Index].m_Index;
+	if(GameIndex == TILE_SOLID || GameIndex == TILE_NOHOOK)
+		Flags |= COLFLAG_SOLID;
+	if(GameIndex == TILE_NOHOOK)
+		Flags |= COLFLAG_NOHOOK;
+	if(GameIndex == TILE_NOLASER)
+		Flags |= COLFLAG_NOLASER;
+	if(m_pFront && m_pFront[Index].m_Index == TILE_NOLASER)
+		Flags |= COLFLAG_FRONT_NOLASER;
+
+	for(int LayerIndex : {GameIndex, m_pFront ? (int)m_pFront[Index].m_Index : (int)TILE_AIR})
+	{
+		if(LayerIndex == TILE_DEATH)
+			Flags |= COLFLAG_DEATH;
+		else if(LayerIndex == TILE_FREEZE || LayerIndex == TILE_DFREEZE || LayerIndex == TILE_LFREEZE)
+			Flags |= COLFLAG_FREEZE;
+		else if(LayerIndex == TILE_THROUGH)
+			Flags |= COLFLAG_THROUGH;
+		else if(LayerIndex == TILE_THROUGH_ALL || LayerIndex == TILE_THROUGH_CUT || LayerIndex == TILE_THROUGH_DIR)
+			Flags |= COLFLAG_HOOKTHROUGH;
+	}
+
+	if(m_pTele && m_pTele[Index].m_Type)
+		Flags |= COLFLAG_TELE;
+	if(m_pSpeedup && m_pSpeedup[Index].m_Force > 0)
+		Flags |= COLFLAG_SPEEDUP;
+	return Flags;
 }
 
 void CCollision::FillAntibot(CAntibotMapData *pMapData) const
@@ -326,30 +365,70 @@ int CCollision::GetTile(int x, int y) const
 	return 0;
 }
 
-// TODO: rewrite this smarter!
-int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
+// Beyond this the float spacing of the positions gets too coarse for the
+// margin used when skipping samples.
+static constexpr float MAX_SKIP_COORDINATE = 1 << 20;
+
+// Number of samples after Pos that certainly stay in the tile (Nx, Ny).
+// Samples are only counted while they keep LowMargin and HighMargin pixels
+// of distance to the lower and upper tile borders. The margins have to
+// cover the rounding of the sample positions to pixels plus a pixel of
+// float error.
+static int SamplesInTile(const CCollision *pCollision, int Nx, int Ny, float LowMargin, float HighMargin, vec2 Pos, vec2 Step, int MaxSamples)
+{
+	float Samples = MaxSamples;
+	// the outermost tiles extend to infinity because of the clamping
+	if(Step.x > 0.0f && Nx < pCollision->GetWidth() - 1)
+		Samples = minimum(Samples, ((Nx + 1) * 32 - HighMargin - Pos.x) / Step.x);
+	else if(Step.x < 0.0f && Nx > 0)
+		Samples = minimum(Samples, (Pos.x - (Nx * 32 + LowMargin)) / -Step.x);
+	if(Step.y > 0.0f && Ny < pCollision->GetHeight() - 1)
+		Samples = minimum(Samples, ((Ny + 1) * 32 - HighMargin - Pos.y) / Step.y);
+	else if(Step.y < 0.0f && Ny > 0)
+		Samples = minimum(Samples, (Pos.y - (Ny * 32 + LowMargin)) / -Step.y);
+	return Samples > 0.0f ? (int)Samples : 0;
+}
+
+static bool CanSkipSamples(const CCollision *pCollision, vec2 Pos0, vec2 Pos1)
 {
-	float Distance = distance(Pos0, Pos1);
-	int End(Distance + 1);
-	vec2 Last = Pos0;
-	for(int i = 0; i <= End; i++)
+	return pCollision->GameLayer() &&
+	       absolute(Pos0.x) < MAX_SKIP_COORDINATE && absolute(Pos0.y) < MAX_SKIP_COORDINATE &&
+	       absolute(Pos1.x) < MAX_SKIP_COORDINATE && absolute(Pos1.y) < MAX_SKIP_COORDINATE;
+}
+
+// Samples the segment at mix(Pos0, Pos1, i / Divisor) for i below
+// NumSamples until Hit returns true for a sample. After a miss,
+// HitInTile tells whether another sample in the same tile could still
+// hit. If not, the samples that round into that tile are skipped. Every
+// sample that is checked is computed like before, so the results are
+// exactly the same as checking every sample.
+template<typename THit, typename THitInTile>
+static int IntersectSamples(const CCollision *pCollision, vec2 Pos0, vec2 Pos1, int NumSamples, float Divisor, vec2 *pOutCollision, vec2 *pOutBeforeCollision, THit &&Hit, THitInTile &&HitInTile)
+{
+	const bool Skip = CanSkipSamples(pCollision, Pos0, Pos1);
+	const vec2 Step = (Pos1 - Pos0) / Divisor;
+	for(int i = 0; i < NumSamples; i++)
 	{
-		float a = i / (float)End;
-		vec2 Pos = mix(Pos0, Pos1, a);
+		vec2 Pos = mix(Pos0, Pos1, i / Divisor);
 		// Temporary position for checking collision
 		int ix = round_to_int(Pos.x);
 		int iy = round_to_int(Pos.y);
 
-		if(CheckPoint(ix, iy))
+		int Result;
+		if(Hit(Pos, ix, iy, &Result))
 		{
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			return GetCollisionAt(ix, iy);
+				*pOutBeforeCollision = i == 0 ? Pos0 : mix(Pos0, Pos1, (i - 1) / Divisor);
+			return Result;
+		}
+		if(Skip && !HitInTile(ix, iy))
+		{
+			int Nx = std::clamp(ix / 32, 0, pCollision->GetWidth() - 1);
+			int Ny = std::clamp(iy / 32, 0, pCollision->GetHeight() - 1);
+			i += SamplesInTile(pCollision, Nx, Ny, 0.5f, 1.5f, Pos, Step, NumSamples - 1 - i);
 		}
-
-		Last = Pos;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -358,112 +437,98 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 	return 0;
 }
 
+// all hits of these only depend on the tile of the sample
+static bool TileOnly(int x, int y)
+{
+	return false;
+}
+
+int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	return IntersectSamples(
+		this, Pos0, Pos1, End + 1, End, pOutCollision, pOutBeforeCollision,
+		[&](vec2 Pos, int ix, int iy, int *pResult) {
+			if(!CheckPoint(ix, iy))
+				return false;
+			*pResult = GetCollisionAt(ix, iy);
+			return true;
+		},
+		TileOnly);
+}
+
 int CCollision::IntersectLineTeleHook(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr) const
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
-	vec2 Last = Pos0;
 	int dx = 0, dy = 0; // Offset for checking the "through" tile
 	ThroughOffset(Pos0, Pos1, &dx, &dy);
-	for(int i = 0; i <= End; i++)
-	{
-		float a = i / (float)End;
-		vec2 Pos = mix(Pos0, Pos1, a);
-		// Temporary position for checking collision
-		int ix = round_to_int(Pos.x);
-		int iy = round_to_int(Pos.y);
-
-		int Index = GetPureMapIndex(Pos);
-		if(pTeleNr)
-		{
-			if(g_Config.m_SvOldTeleportHook)
-				*pTeleNr = IsTeleport(Index);
-			else
-				*pTeleNr = IsTeleportHook(Index);
-		}
-		if(pTeleNr && *pTeleNr)
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			return TILE_TELEINHOOK;
-		}
-
-		int hit = 0;
-		if(CheckPoint(ix, iy))
-		{
-			if(!IsThrough(ix, iy, dx, dy, Pos0, Pos1))
-				hit = GetCollisionAt(ix, iy);
-		}
-		else if(IsHookBlocker(ix, iy, Pos0, Pos1))
-		{
-			hit = TILE_NOHOOK;
-		}
-		if(hit)
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			return hit;
-		}
+	if(pTeleNr)
+		*pTeleNr = 0;
+	return IntersectSamples(
+		this, Pos0, Pos1, End + 1, End, pOutCollision, pOutBeforeCollision,
+		[&](vec2 Pos, int ix, int iy, int *pResult) {
+			int Index = GetPureMapIndex(Pos);
+			if(pTeleNr)
+			{
+				if(g_Config.m_SvOldTeleportHook)
+					*pTeleNr = IsTeleport(Index);
+				else
+					*pTeleNr = IsTeleportHook(Index);
+			}
+			if(pTeleNr && *pTeleNr)
+			{
+				*pResult = TILE_TELEINHOOK;
+				return true;
+			}
 
-		Last = Pos;
-	}
-	if(pOutCollision)
-		*pOutCollision = Pos1;
-	if(pOutBeforeCollision)
-		*pOutBeforeCollision = Pos1;
-	return 0;
+			int hit = 0;
+			if(CheckPoint(ix, iy))
+			{
+				if(!IsThrough(ix, iy, dx, dy, Pos0, Pos1))
+					hit = GetCollisionAt(ix, iy);
+			}
+			else if(IsHookBlocker(ix, iy, Pos0, Pos1))
+			{
+				hit = TILE_NOHOOK;
+			}
+			*pResult = hit;
+			return hit != 0;
+		},
+		// through tiles are looked up next to the sample
+		[&](int ix, int iy) { return CheckPoint(ix, iy); });
 }
 
 int CCollision::IntersectLineTeleWeapon(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr) const
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance + 1);
-	vec2 Last = Pos0;
-	for(int i = 0; i <= End; i++)
-	{
-		float a = i / (float)End;
-		vec2 Pos = mix(Pos0, Pos1, a);
-		// Temporary position for checking collision
-		int ix = round_to_int(Pos.x);
-		int iy = round_to_int(Pos.y);
-
-		int Index = GetPureMapIndex(Pos);
-		if(pTeleNr)
-		{
-			if(g_Config.m_SvOldTeleportWeapons)
-				*pTeleNr = IsTeleport(Index);
-			else
-				*pTeleNr = IsTeleportWeapon(Index);
-		}
-		if(pTeleNr && *pTeleNr)
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			return TILE_TELEINWEAPON;
-		}
-
-		if(CheckPoint(ix, iy))
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			return GetCollisionAt(ix, iy);
-		}
+	if(pTeleNr)
+		*pTeleNr = 0;
+	return IntersectSamples(
+		this, Pos0, Pos1, End + 1, End, pOutCollision, pOutBeforeCollision,
+		[&](vec2 Pos, int ix, int iy, int *pResult) {
+			int Index = GetPureMapIndex(Pos);
+			if(pTeleNr)
+			{
+				if(g_Config.m_SvOldTeleportWeapons)
+					*pTeleNr = IsTeleport(Index);
+				else
+					*pTeleNr = IsTeleportWeapon(Index);
+			}
+			if(pTeleNr && *pTeleNr)
+			{
+				*pResult = TILE_TELEINWEAPON;
+				return true;
+			}
 
-		Last = Pos;
-	}
-	if(pOutCollision)
-		*pOutCollision = Pos1;
-	if(pOutBeforeCollision)
-		*pOutBeforeCollision = Pos1;
-	return 0;
+			if(!CheckPoint(ix, iy))
+				return false;
+			*pResult = GetCollisionAt(ix, iy);
+			return true;
+		},
+		TileOnly);
 }
 
 // TODO: OPT: rewrite this smarter!
@@ -598,24 +663,33 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, vec2 Elast
 
 int CCollision::IsSolid(int x, int y) const
 {
-	int index = GetTile(x, y);
-	return index == TILE_SOLID || index == TILE_NOHOOK;
+	if(!m_pColFlags)
+		return 0;
+
+	int Nx = std::clamp(x / 32, 0, m_Width - 1);
+	int Ny = std::clamp(y / 32, 0, m_Height - 1);
+	return (m_pColFlags[Ny * m_Width + Nx] & COLFLAG_SOLID) != 0;
 }
 
 bool CCollision::IsThrough(int x, int y, int OffsetX, int OffsetY, vec2 Pos0, vec2 Pos1) const
 {
 	int pos = GetPureMapIndex(x, y);
-	if(m_pFront && (m_pFront[pos].m_Index == TILE_THROUGH_ALL || m_pFront[pos].m_Index == TILE_THROUGH_CUT))
-		return true;
-	if(m_pFront && m_pFront[pos].m_Index == TILE_THROUGH_DIR && ((m_pFront[pos].m_Flags == ROTATION_0 && Pos0.y > Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_90 && Pos0.x < Pos1.x) || (m_pFront[pos].m_Flags == ROTATION_180 && Pos0.y < Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_270 && Pos0.x > Pos1.x)))
-		return true;
+	if(m_pColFlags[pos] & COLFLAG_HOOKTHROUGH)
+	{
+		if(m_pFront && (m_pFront[pos].m_Index == TILE_THROUGH_ALL || m_pFront[pos].m_Index == TILE_THROUGH_CUT))
+			return true;
+		if(m_pFront && m_pFront[pos].m_Index == TILE_THROUGH_DIR && ((m_pFront[pos].m_Flags == ROTATION_0 && Pos0.y > Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_90 && Pos0.x < Pos1.x) || (m_pFront[pos].m_Flags == ROTATION_180 && Pos0.y < Pos1.y) || (m_pFront[pos].m_Flags == ROTATION_270 && Pos0.x > Pos1.x)))
+			return true;
+	}
 	int offpos = GetPureMapIndex(x + OffsetX, y + OffsetY);
-	return m_pTiles[offpos].m_Index == TILE_THROUGH || (m_pFront && m_pFront[offpos].m_Index == TILE_THROUGH);
+	return m_pColFlags[offpos] & COLFLAG_THROUGH;
 }
 
 bool CCollision::IsHookBlocker(int x, int y, vec2 Pos0, vec2 Pos1) const
 {
 	int pos = GetPureMapIndex(x, y);
+	if(!(m_pColFlags[pos] & COLFLAG_HOOKTHROUGH))
+		return false;
 	if(m_pTiles[pos].m_Index == TILE_THROUGH_ALL || (m_pFront && m_pFront[pos].m_Index == TILE_THROUGH_ALL))
 		return true;
 	if(m_pTiles[pos].m_Index == TILE_THROUGH_DIR && ((m_pTiles[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) ||
@@ -638,17 +712,27 @@ int CCollision::IsWallJump(int Index) const
 
 int CCollision::IsNoLaser(int x, int y) const
 {
-	return (CCollision::GetTile(x, y) == TILE_NOLASER);
+	if(!m_pColFlags)
+		return 0;
+
+	int Nx = std::clamp(x / 32, 0, m_Width - 1);
+	int Ny = std::clamp(y / 32, 0, m_Height - 1);
+	return (m_pColFlags[Ny * m_Width + Nx] & COLFLAG_NOLASER) != 0;
 }
 
 int CCollision::IsFrontNoLaser(int x, int y) const
 {
-	return (CCollision::GetFrontTile(x, y) == TILE_NOLASER);
+	if(!m_pColFlags)
+		return 0;
+
+	int Nx = std::clamp(x / 32, 0, m_Width - 1);
+	int Ny = std::clamp(y / 32, 0, m_Height - 1);
+	return (m_pColFlags[Ny * m_Width + Nx] & COLFLAG_FRONT_NOLASER) != 0;
 }
 
 int CCollision::IsTeleport(int Index) const
 {
-	if(Index < 0 || !m_pTele)
+	if(Index < 0 || !(m_pColFlags[Index] & COLFLAG_TELE))
 		return 0;
 
 	if(m_pTele[Index].m_Type == TILE_TELEIN)
@@ -700,7 +784,7 @@ int CCollision::IsTeleCheckpoint(int Index) const
 
 int CCollision::IsTeleportWeapon(int Index) const
 {
-	if(Index < 0 || !m_pTele)
+	if(Index < 0 || !(m_pColFlags[Index] & COLFLAG_TELE))
 		return 0;
 
 	if(m_pTele[Index].m_Type == TILE_TELEINWEAPON)
@@ -711,7 +795,7 @@ int CCollision::IsTeleportWeapon(int Index) const
 
 int CCollision::IsTeleportHook(int Index) const
 {
-	if(Index < 0 || !m_pTele)
+	if(Index < 0 || !(m_pColFlags[Index] & COLFLAG_TELE))
 		return 0;
 
 	if(m_pTele[Index].m_Type == TILE_TELEINHOOK)
@@ -722,13 +806,10 @@ int CCollision::IsTeleportHook(int Index) const
 
 int CCollision::IsSpeedup(int Index) const
 {
-	if(Index < 0 || !m_pSpeedup)
+	if(Index < 0 || !(m_pColFlags[Index] & COLFLAG_SPEEDUP))
 		return 0;
 
-	if(m_pSpeedup[Index].m_Force > 0)
-		return Index;
-
-	return 0;
+	return Index;
 }
 
 int CCollision::IsTune(int Index) const
@@ -912,9 +993,8 @@ int CCollision::GetMapIndex(vec2 Pos) const
 		return -1;
 }
 
-std::vector<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices) const
+int CCollision::ForEachMapIndex(vec2 PrevPos, vec2 Pos, CALLBACK_MAPINDEX pfnVisit, void *pUser) const
 {
-	std::vector<int> vIndices;
 	float d = distance(PrevPos, Pos);
 	int End(d + 1);
 	if(!d)
@@ -925,33 +1005,36 @@ std::vector<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxI
 
 		if(TileExists(Index))
 		{
-			vIndices.push_back(Index);
-			return vIndices;
+			pfnVisit(Index, pUser);
+			return 1;
 		}
-		else
-			return vIndices;
+		return 0;
 	}
-	else
+
+	// all samples in a tile give the same index, so only the first one of
+	// each tile has to be looked at
+	const bool Skip = CanSkipSamples(this, PrevPos, Pos);
+	const vec2 Step = (Pos - PrevPos) / d;
+	int NumVisited = 0;
+	int LastIndex = 0;
+	for(int i = 0; i < End; i++)
 	{
-		int LastIndex = 0;
-		for(int i = 0; i < End; i++)
+		float a = i / d;
+		vec2 Tmp = mix(PrevPos, Pos, a);
+		int Nx = std::clamp((int)Tmp.x / 32, 0, m_Width - 1);
+		int Ny = std::clamp((int)Tmp.y / 32, 0, m_Height - 1);
+		int Index = Ny * m_Width + Nx;
+		if(TileExists(Index) && LastIndex != Index)
 		{
-			float a = i / d;
-			vec2 Tmp = mix(PrevPos, Pos, a);
-			int Nx = std::clamp((int)Tmp.x / 32, 0, m_Width - 1);
-			int Ny = std::clamp((int)Tmp.y / 32, 0, m_Height - 1);
-			int Index = Ny * m_Width + Nx;
-			if(TileExists(Index) && LastIndex != Index)
-			{
-				if(MaxIndices && vIndices.size() > MaxIndices)
-					return vIndices;
-				vIndices.push_back(Index);
-				LastIndex = Index;
-			}
+			NumVisited++;
+			if(!pfnVisit(Index, pUser))
+				return NumVisited;
+			LastIndex = Index;
 		}
-
-		return vIndices;
+		if(Skip)
+			i += SamplesInTile(this, Nx, Ny, 1.0f, 1.0f, Tmp, Step, End - 1 - i);
 	}
+	return NumVisited;
 }
 
 vec2 CCollision::GetPos(int Index) const
@@ -1080,6 +1163,7 @@ void CCollision::SetCollisionAt(float x, float y, int Index)
 	int Ny = std::clamp(round_to_int(y) / 32, 0, m_Height - 1);
 
 	m_pTiles[Ny * m_Width + Nx].m_Index = Index;
+	m_pColFlags[Ny * m_Width + Nx] = ComputeColFlags(Ny * m_Width + Nx);
 }
 
 void CCollision::SetDoorCollisionAt(float x, float y, int Type, int Flags, int Number)
@@ -1141,92 +1225,62 @@ void ThroughOffset(vec2 Pos0, vec2 Pos1, int *pOffsetX, int *pOffsetY)
 int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float d = distance(Pos0, Pos1);
-	vec2 Last = Pos0;
-
-	for(int i = 0, id = std::ceil(d); i < id; i++)
-	{
-		float a = i / d;
-		vec2 Pos = mix(Pos0, Pos1, a);
-		int Nx = std::clamp(round_to_int(Pos.x) / 32, 0, m_Width - 1);
-		int Ny = std::clamp(round_to_int(Pos.y) / 32, 0, m_Height - 1);
-		if(GetIndex(Nx, Ny) == TILE_SOLID || GetIndex(Nx, Ny) == TILE_NOHOOK || GetIndex(Nx, Ny) == TILE_NOLASER || GetFrontIndex(Nx, Ny) == TILE_NOLASER)
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			if(GetFrontIndex(Nx, Ny) == TILE_NOLASER)
-				return GetFrontCollisionAt(Pos.x, Pos.y);
-			else
-				return GetCollisionAt(Pos.x, Pos.y);
-		}
-		Last = Pos;
-	}
-	if(pOutCollision)
-		*pOutCollision = Pos1;
-	if(pOutBeforeCollision)
-		*pOutBeforeCollision = Pos1;
-	return 0;
+	return IntersectSamples(
+		this, Pos0, Pos1, std::ceil(d), d, pOutCollision, pOutBeforeCollision,
+		[&](vec2 Pos, int ix, int iy, int *pResult) {
+			int Nx = std::clamp(ix / 32, 0, m_Width - 1);
+			int Ny = std::clamp(iy / 32, 0, m_Height - 1);
+			if(GetIndex(Nx, Ny) == TILE_SOLID || GetIndex(Nx, Ny) == TILE_NOHOOK || GetIndex(Nx, Ny) == TILE_NOLASER || GetFrontIndex(Nx, Ny) == TILE_NOLASER)
+			{
+				if(GetFrontIndex(Nx, Ny) == TILE_NOLASER)
+					*pResult = GetFrontCollisionAt(Pos.x, Pos.y);
+				else
+					*pResult = GetCollisionAt(Pos.x, Pos.y);
+				return true;
+			}
+			return false;
+		},
+		TileOnly);
 }
 
 int CCollision::IntersectNoLaserNoWalls(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float d = distance(Pos0, Pos1);
-	vec2 Last = Pos0;
-
-	for(int i = 0, id = std::ceil(d); i < id; i++)
-	{
-		float a = (float)i / d;
-		vec2 Pos = mix(Pos0, Pos1, a);
-		if(IsNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)) || IsFrontNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)))
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			if(IsNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)))
-				return GetCollisionAt(Pos.x, Pos.y);
-			else
-				return GetFrontCollisionAt(Pos.x, Pos.y);
-		}
-		Last = Pos;
-	}
-	if(pOutCollision)
-		*pOutCollision = Pos1;
-	if(pOutBeforeCollision)
-		*pOutBeforeCollision = Pos1;
-	return 0;
+	return IntersectSamples(
+		this, Pos0, Pos1, std::ceil(d), d, pOutCollision, pOutBeforeCollision,
+		[&](vec2 Pos, int ix, int iy, int *pResult) {
+			if(IsNoLaser(ix, iy) || IsFrontNoLaser(ix, iy))
+			{
+				if(IsNoLaser(ix, iy))
+					*pResult = GetCollisionAt(Pos.x, Pos.y);
+				else
+					*pResult = GetFrontCollisionAt(Pos.x, Pos.y);
+				return true;
+			}
+			return false;
+		},
+		TileOnly);
 }
 
 int CCollision::IntersectAir(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float d = distance(Pos0, Pos1);
-	vec2 Last = Pos0;
-
-	for(int i = 0, id = std::ceil(d); i < id; i++)
-	{
-		float a = (float)i / d;
-		vec2 Pos = mix(Pos0, Pos1, a);
-		if(IsSolid(round_to_int(Pos.x), round_to_int(Pos.y)) || (!GetTile(round_to_int(Pos.x), round_to_int(Pos.y)) && !GetFrontTile(round_to_int(Pos.x), round_to_int(Pos.y))))
-		{
-			if(pOutCollision)
-				*pOutCollision = Pos;
-			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			if(!GetTile(round_to_int(Pos.x), round_to_int(Pos.y)) && !GetFrontTile(round_to_int(Pos.x), round_to_int(Pos.y)))
-				return -1;
-			else if(!GetTile(round_to_int(Pos.x), round_to_int(Pos.y)))
-				return GetTile(round_to_int(Pos.x), round_to_int(Pos.y));
-			else
-				return GetFrontTile(round_to_int(Pos.x), round_to_int(Pos.y));
-		}
-		Last = Pos;
-	}
-	if(pOutCollision)
-		*pOutCollision = Pos1;
-	if(pOutBeforeCollision)
-		*pOutBeforeCollision = Pos1;
-	return 0;
+	return IntersectSamples(
+		this, Pos0, Pos1, std::ceil(d), d, pOutCollision, pOutBeforeCollision,
+		[&](vec2 Pos, int ix, int iy, int *pResult) {
+			if(IsSolid(ix, iy) || (!GetTile(ix, iy) && !GetFrontTile(ix, iy)))
+			{
+				if(!GetTile(ix, iy) && !GetFrontTile(ix, iy))
+					*pResult = -1;
+				else if(!GetTile(ix, iy))
+					*pResult = GetTile(ix, iy);
+				else
+					*pResult = GetFrontTile(ix, iy);
+				return true;
+			}
+			return false;
+		},
+		TileOnly);
 }
 
 int CCollision::IsTimeCheckpoint(int Index) const
@@ -6,7 +6,9 @@
 #include <base/vmath.h>
 #include <engine/shared/protocol.h>
 
+#include <cstdint>
 #include <map>
+#include <type_traits>
 #include <vector>
 
 class CTile;
@@ -25,9 +27,25 @@ enum
 	CANTMOVE_DOWN = 1 << 3,
 };
 
+// properties of a map tile combined from all its layers, see CCollision::GetColFlags
+enum
+{
+	COLFLAG_SOLID = 1 << 0, // game TILE_SOLID or TILE_NOHOOK
+	COLFLAG_NOHOOK = 1 << 1, // game TILE_NOHOOK
+	COLFLAG_NOLASER = 1 << 2, // game TILE_NOLASER
+	COLFLAG_FRONT_NOLASER = 1 << 3, // front TILE_NOLASER
+	COLFLAG_DEATH = 1 << 4, // game or front TILE_DEATH
+	COLFLAG_FREEZE = 1 << 5, // game or front TILE_FREEZE, TILE_DFREEZE or TILE_LFREEZE
+	COLFLAG_THROUGH = 1 << 6, // game or front TILE_THROUGH
+	COLFLAG_HOOKTHROUGH = 1 << 7, // game or front TILE_THROUGH_ALL, TILE_THROUGH_CUT or TILE_THROUGH_DIR
+	COLFLAG_TELE = 1 << 8, // any tele tile
+	COLFLAG_SPEEDUP = 1 << 9, // speedup with a force
+};
+
 vec2 ClampVel(int MoveRestriction, vec2 Vel);
 
 typedef bool (*CALLBACK_SWITCHACTIVE)(int Number, void *pUser);
+typedef bool (*CALLBACK_MAPINDEX)(int Index, void *pUser);
 struct CAntibotMapData;
 
 class CCollision
@@ -73,9 +91,26 @@ public:
 	int GetTile(int x, int y) const;
 	int GetFrontTile(int x, int y) const;
 	int Entity(int x, int y, int Layer) const;
+	int GetColFlags(int Index) const { return Index < 0 ? 0 : m_pColFlags[Index]; }
 	int GetPureMapIndex(float x, float y) const;
 	int GetPureMapIndex(vec2 Pos) const { return GetPureMapIndex(Pos.x, Pos.y); }
-	std::vector<int> GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices = 0) const;
+	/**
+	 * Visits the indices of the non-empty tiles passed on the way from
+	 * PrevPos to Pos, in order and without allocating. Stops early when
+	 * the callback returns false.
+	 *
+	 * @return The number of visited indices
+	 */
+	int ForEachMapIndex(vec2 PrevPos, vec2 Pos, CALLBACK_MAPINDEX pfnVisit, void *pUser) const;
+	template<typename TVisit>
+	int ForEachMapIndex(vec2 PrevPos, vec2 Pos, TVisit &&Visit) const
+	{
+		return ForEachMapIndex(
+			PrevPos, Pos, [](int Index, void *pUser) {
+				return (*static_cast<std::remove_reference_t<TVisit> *>(pUser))(Index);
+			},
+			&Visit);
+	}
 	int GetMapIndex(vec2 Pos) const;
 	bool TileExists(int Index) const;
 	bool TileExistsNext(int Index) const;
@@ -157,6 +192,10 @@ private:
 	CTuneTile *m_pTune;
 	CDoorTile *m_pDoor;
 
+	// COLFLAG_* of every tile, so hot checks don't have to look at all layers
+	uint16_t *m_pColFlags;
+	int ComputeColFlags(int Index) const;
+
 	// TILE_TELEIN
 	std::map<int, std::vector<vec2>> m_TeleIns;
 	// TILE_TELEOUT
@@ -9,6 +9,7 @@
 #include <base/system.h>
 #include <engine/shared/config.h>
 
+#include <cmath>
 #include <limits>
 
 const char *CTuningParams::ms_apNames[] =
@@ -348,8 +349,13 @@ void CCharacterCore::Tick(bool UseInput, bool DoDeferredTick)
 		if(!m_HookHitDisabled && m_pWorld && m_Tuning.m_PlayerHooking && (m_HookState == HOOK_FLYING || !m_NewHook))
 		{
 			float Distance = 0.0f;
+			// only characters close to the hook's way can be hit
+			const float HitRange = PhysicalSize() + 2.0f + 1.0f;
+			const std::bitset<MAX_CLIENTS> Candidates = m_pWorld->CharactersNear(m_HookPos, NewPos, HitRange);
 			for(int i = 0; i < MAX_CLIENTS; i++)
 			{
+				if(!Candidates[i])
+					continue;
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 				if(!pCharCore || pCharCore == this || (!(m_Super || pCharCore->m_Super) && ((m_Id != -1 && !m_pTeams->CanCollide(i, m_Id)) || pCharCore->m_Solo || m_Solo)))
 					continue;
@@ -461,8 +467,15 @@ void CCharacterCore::TickDeferred()
 {
 	if(m_pWorld)
 	{
+		// only close characters collide, but the hooked one is dragged from afar
+		const float CollisionRange = PhysicalSize() * 1.25f + 1.0f;
+		std::bitset<MAX_CLIENTS> Candidates = m_pWorld->CharactersNear(m_Pos, m_Pos, CollisionRange);
+		if(in_range(m_HookedPlayer, 0, MAX_CLIENTS - 1))
+			Candidates.set(m_HookedPlayer);
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
+			if(!Candidates[i])
+				continue;
 			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 			if(!pCharCore)
 				continue;
@@ -568,19 +581,32 @@ void CCharacterCore::Move()
 		float Distance = distance(m_Pos, NewPos);
 		if(Distance > 0)
 		{
+			// only characters close to the way can block it, find them once
+			// instead of for every step
+			const std::bitset<MAX_CLIENTS> Nearby = m_pWorld->CharactersNear(m_Pos, NewPos, PhysicalSize() + 1.0f);
+			int aBlockers[MAX_CLIENTS];
+			int NumBlockers = 0;
+			for(int p = 0; p < MAX_CLIENTS; p++)
+			{
+				if(!Nearby[p])
+					continue;
+				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
+				if(!pCharCore || pCharCore == this)
+					continue;
+				if((!(pCharCore->m_Super || m_Super) && (m_Solo || pCharCore->m_Solo || pCharCore->m_CollisionDisabled || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, p)))))
+					continue;
+				aBlockers[NumBlockers++] = p;
+			}
+
 			int End = Distance + 1;
 			vec2 LastPos = m_Pos;
-			for(int i = 0; i < End; i++)
+			for(int i = 0; NumBlockers > 0 && i < End; i++)
 			{
 				float a = i / Distance;
 				vec2 Pos = mix(m_Pos, NewPos, a);
-				for(int p = 0; p < MAX_CLIENTS; p++)
+				for(int b = 0; b < NumBlockers; b++)
 				{
-					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-					if(!pCharCore || pCharCore == this)
-						continue;
-					if((!(pCharCore->m_Super || m_Super) && (m_Solo || pCharCore->m_Solo || pCharCore->m_CollisionDisabled || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, p)))))
-						continue;
+					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[aBlockers[b]];
 					float D = distance(Pos, pCharCore->m_Pos);
 					if(D < PhysicalSize())
 					{
@@ -739,6 +765,77 @@ bool CCharacterCore::IsSwitchActiveCb(int Number, void *pUser)
 	return false;
 }
 
+// characters further out than this are not sorted into the grid, so
+// the grid coordinates don't overflow
+static constexpr float MAX_CHARACTER_BUCKET_COORDINATE = 1e7f;
+
+static bool InCharacterBucketRange(vec2 Pos)
+{
+	return absolute(Pos.x) < MAX_CHARACTER_BUCKET_COORDINATE && absolute(Pos.y) < MAX_CHARACTER_BUCKET_COORDINATE;
+}
+
+static int CharacterBucketHash(int CellX, int CellY, int NumBuckets)
+{
+	return ((unsigned)CellX * 73856093u ^ (unsigned)CellY * 19349663u) % NumBuckets;
+}
+
+void CWorldCore::UpdateCharacterBuckets()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CCharacterCore *pCharacter = m_apCharacters[i];
+		if(pCharacter == m_apBucketCharacters[i] && (!pCharacter || pCharacter->m_Pos == m_aBucketPositions[i]))
+			continue;
+
+		int Bucket = -1;
+		if(pCharacter)
+		{
+			if(InCharacterBucketRange(pCharacter->m_Pos))
+			{
+				int CellX = std::floor(pCharacter->m_Pos.x / CHARACTER_BUCKET_SIZE);
+				int CellY = std::floor(pCharacter->m_Pos.y / CHARACTER_BUCKET_SIZE);
+				Bucket = CharacterBucketHash(CellX, CellY, NUM_CHARACTER_BUCKETS);
+			}
+			else
+				Bucket = CHARACTER_BUCKET_EVERYWHERE;
+			m_aBucketPositions[i] = pCharacter->m_Pos;
+		}
+		if(Bucket != m_aCharacterBucket[i])
+		{
+			if(m_aCharacterBucket[i] != -1)
+				m_aCharacterBuckets[m_aCharacterBucket[i]].reset(i);
+			if(Bucket != -1)
+				m_aCharacterBuckets[Bucket].set(i);
+			m_aCharacterBucket[i] = Bucket;
+		}
+		m_apBucketCharacters[i] = pCharacter;
+	}
+}
+
+std::bitset<MAX_CLIENTS> CWorldCore::CharactersNear(vec2 From, vec2 To, float Range)
+{
+	UpdateCharacterBuckets();
+
+	const vec2 Min = vec2(minimum(From.x, To.x) - Range, minimum(From.y, To.y) - Range);
+	const vec2 Max = vec2(maximum(From.x, To.x) + Range, maximum(From.y, To.y) + Range);
+	std::bitset<MAX_CLIENTS> Candidates = m_aCharacterBuckets[CHARACTER_BUCKET_EVERYWHERE];
+	if(!InCharacterBucketRange(Min) || !InCharacterBucketRange(Max))
+		return Candidates.set();
+
+	const int MinX = std::floor(Min.x / CHARACTER_BUCKET_SIZE);
+	const int MinY = std::floor(Min.y / CHARACTER_BUCKET_SIZE);
+	const int MaxX = std::floor(Max.x / CHARACTER_BUCKET_SIZE);
+	const int MaxY = std::floor(Max.y / CHARACTER_BUCKET_SIZE);
+	// a big box covers every bucket anyway
+	if((int64_t)(MaxX - MinX + 1) * (MaxY - MinY + 1) >= NUM_CHARACTER_BUCKETS)
+		return Candidates.set();
+
+	for(int y = MinY; y <= MaxY; y++)
+		for(int x = MinX; x <= MaxX; x++)
+			Candidates |= m_aCharacterBuckets[CharacterBucketHash(x, y, NUM_CHARACTER_BUCKETS)];
+	return Candidates;
+}
+
 void CWorldCore::InitSwitchers(int HighestSwitchNumber)
 {
 	if(HighestSwitchNumber > 0)
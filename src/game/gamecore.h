@@ -5,6 +5,7 @@
 
 #include <base/vmath.h>
 
+#include <bitset>
 #include <set>
 #include <vector>
 
@@ -152,6 +153,14 @@ public:
 			pCharacter = nullptr;
 		}
 		m_pPrng = nullptr;
+		for(auto &pCharacter : m_apBucketCharacters)
+		{
+			pCharacter = nullptr;
+		}
+		for(auto &Bucket : m_aCharacterBucket)
+		{
+			Bucket = -1;
+		}
 	}
 
 	int RandomOr0(int BelowThis)
@@ -170,8 +179,41 @@ public:
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
 	CPrng *m_pPrng;
 
+	/**
+	 * Finds the characters that might be close to the box spanned by two
+	 * positions. The result can contain more characters, but never misses
+	 * one of m_apCharacters that is within the range.
+	 *
+	 * @param From One corner of the box
+	 * @param To The opposite corner of the box
+	 * @param Range How far around the box to look
+	 *
+	 * @return The ids of the candidates
+	 */
+	std::bitset<MAX_CLIENTS> CharactersNear(vec2 From, vec2 To, float Range);
+
 	void InitSwitchers(int HighestSwitchNumber);
 	std::vector<SSwitchers> m_vSwitchers;
+
+private:
+	enum
+	{
+		CHARACTER_BUCKET_SIZE = 256,
+		NUM_CHARACTER_BUCKETS = 64,
+		// for characters too far away to be sorted into a bucket
+		CHARACTER_BUCKET_EVERYWHERE = NUM_CHARACTER_BUCKETS,
+	};
+
+	void UpdateCharacterBuckets();
+
+	// Characters sorted by their position into a grid that is hashed into
+	// a fixed number of buckets. Characters move around between the
+	// queries, so the buckets are checked against m_apCharacters before
+	// every query.
+	std::bitset<MAX_CLIENTS> m_aCharacterBuckets[NUM_CHARACTER_BUCKETS + 1];
+	const class CCharacterCore *m_apBucketCharacters[MAX_CLIENTS];
+	vec2 m_aBucketPositions[MAX_CLIENTS];
+	int m_aCharacterBucket[MAX_CLIENTS];
 };
 
 class CCharacterCore
@@ -0,0 +1,196 @@
+#include "physics_replay.h"
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/linereader.h>
+#include <engine/shared/teehistorian_reader.h>
+
+#include <game/state_hash.h>
+
+#include <algorithm>
+
+CPhysicsReplay::CPhysicsReplay(CCollision *pCollision, CTeeHistorianReader *pReader) :
+	m_pCollision(pCollision),
+	m_pReader(pReader),
+	m_Tick(pReader->Tick()),
+	m_aCores()
+{
+	ReadRecordedState();
+}
+
+int CPhysicsReplay::NumCharacters() const
+{
+	return std::count_if(std::begin(m_World.m_apCharacters), std::end(m_World.m_apCharacters), [](const CCharacterCore *pCore) {
+		return pCore != nullptr;
+	});
+}
+
+bool CPhysicsReplay::Tick()
+{
+	const int NextTick = m_pReader->PeekTick();
+	if(NextTick < 0)
+		return false;
+
+	// nothing to simulate until a character spawns
+	m_Tick = NumCharacters() ? m_Tick + 1 : NextTick;
+
+	// same order as the server with weak hook, all inputs first, then all moves
+	for(CCharacterCore *pCore : m_World.m_apCharacters)
+		if(pCore)
+			pCore->Tick(true);
+	for(CCharacterCore *pCore : m_World.m_apCharacters)
+	{
+		if(pCore)
+		{
+			pCore->Move();
+			pCore->Quantize();
+		}
+	}
+
+	if(!m_pReader->Seek(nullptr, m_Tick))
+		return false;
+	ReadRecordedState();
+	return true;
+}
+
+void CPhysicsReplay::ReadRecordedState()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CTeeHistorianIndex::CPlayer &Player = m_pReader->Player(i);
+		if(Player.m_Team >= TEAM_FLOCK && Player.m_Team <= TEAM_SUPER)
+			m_Teams.Team(i, Player.m_Team);
+		CCharacterCore &Core = m_aCores[i];
+		const vec2 RecordedPos = vec2(Player.m_X, Player.m_Y);
+		if(!Player.m_Alive)
+		{
+			m_World.m_apCharacters[i] = nullptr;
+		}
+		else if(!m_World.m_apCharacters[i])
+		{
+			Core.Init(&m_World, m_pCollision, &m_Teams);
+			Core.m_Id = i;
+			Core.Reset();
+			Core.m_ActiveWeapon = WEAPON_GUN;
+			Core.m_Pos = RecordedPos;
+			m_World.m_apCharacters[i] = &Core;
+		}
+		else if(distance(Core.m_Pos, RecordedPos) > RESYNC_DISTANCE)
+		{
+			Core.m_Pos = RecordedPos;
+		}
+		// applied in the next tick, like the inputs the server got between two ticks
+		if(Player.m_HaveInput)
+			Core.m_Input = Player.m_Input;
+	}
+}
+
+uint64_t CPhysicsReplay::StateHash() const
+{
+	CStateHash Hasher;
+	Hasher.Add(m_Tick);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CCharacterCore *pCore = m_World.m_apCharacters[i];
+		if(!pCore)
+			continue;
+		Hasher.Add(i);
+		Hasher.Add(pCore->m_Pos);
+		Hasher.Add(pCore->m_Vel);
+		Hasher.Add(pCore->m_HookPos);
+		Hasher.Add(pCore->m_HookDir);
+		Hasher.Add(pCore->m_HookTeleBase);
+		Hasher.Add(pCore->m_HookTick);
+		Hasher.Add(pCore->m_HookState);
+		Hasher.Add(pCore->HookedPlayer());
+		Hasher.Add((int)pCore->m_AttachedPlayers.size());
+		for(int AttachedPlayer : pCore->m_AttachedPlayers)
+			Hasher.Add(AttachedPlayer);
+		Hasher.Add(pCore->m_ActiveWeapon);
+		for(const auto &Weapon : pCore->m_aWeapons)
+		{
+			Hasher.Add(Weapon.m_AmmoRegenStart);
+			Hasher.Add(Weapon.m_Ammo);
+			Hasher.Add(Weapon.m_Ammocost);
+			Hasher.Add(Weapon.m_Got);
+		}
+		Hasher.Add(pCore->m_Ninja.m_ActivationDir);
+		Hasher.Add(pCore->m_Ninja.m_ActivationTick);
+		Hasher.Add(pCore->m_Ninja.m_CurrentMoveTime);
+		Hasher.Add(pCore->m_Ninja.m_OldVelAmount);
+		Hasher.Add(pCore->m_NewHook);
+		Hasher.Add(pCore->m_Jumped);
+		Hasher.Add(pCore->m_JumpedTotal);
+		Hasher.Add(pCore->m_Jumps);
+		Hasher.Add(pCore->m_Direction);
+		Hasher.Add(pCore->m_Angle);
+		Hasher.Add(pCore->m_TriggeredEvents);
+		Hasher.Add(pCore->m_Colliding);
+		Hasher.Add(pCore->m_LeftWall);
+		Hasher.Add(pCore->m_Solo);
+		Hasher.Add(pCore->m_Jetpack);
+		Hasher.Add(pCore->m_CollisionDisabled);
+		Hasher.Add(pCore->m_EndlessHook);
+		Hasher.Add(pCore->m_EndlessJump);
+		Hasher.Add(pCore->m_Super);
+		Hasher.Add(pCore->m_FreezeStart);
+		Hasher.Add(pCore->m_FreezeEnd);
+		Hasher.Add(pCore->m_IsInFreeze);
+		Hasher.Add(pCore->m_DeepFrozen);
+		Hasher.Add(pCore->m_LiveFrozen);
+	}
+	return Hasher.Hash();
+}
+
+int CPhysicsTrace::FirstMismatch(const CPhysicsTrace &Other) const
+{
+	const size_t Size = minimum(m_vEntries.size(), Other.m_vEntries.size());
+	for(size_t i = 0; i < Size; i++)
+	{
+		const CEntry &Entry = m_vEntries[i];
+		const CEntry &OtherEntry = Other.m_vEntries[i];
+		if(Entry.m_Tick != OtherEntry.m_Tick || Entry.m_Hash != OtherEntry.m_Hash)
+			return minimum(Entry.m_Tick, OtherEntry.m_Tick);
+	}
+	// one trace ends early
+	if(m_vEntries.size() > Size)
+		return m_vEntries[Size].m_Tick;
+	if(Other.m_vEntries.size() > Size)
+		return Other.m_vEntries[Size].m_Tick;
+	return -1;
+}
+
+bool CPhysicsTrace::Load(IOHANDLE File)
+{
+	m_vEntries.clear();
+	CLineReader LineReader;
+	if(!LineReader.OpenFile(File))
+		return false;
+	while(const char *pLine = LineReader.Get())
+	{
+		if(pLine[0] == '\0')
+			continue;
+		const char *pHash = str_find(pLine, " ");
+		unsigned char aHash[sizeof(uint64_t)];
+		if(!pHash || str_hex_decode(aHash, sizeof(aHash), pHash + 1) != 0)
+			return false;
+		uint64_t Hash = 0;
+		for(unsigned char Byte : aHash)
+			Hash = (Hash << 8) | Byte;
+		Add(str_toint(pLine), Hash);
+	}
+	return true;
+}
+
+bool CPhysicsTrace::Save(IOHANDLE File) const
+{
+	for(const CEntry &Entry : m_vEntries)
+	{
+		char aLine[64];
+		str_format(aLine, sizeof(aLine), "%d %016llx", Entry.m_Tick, (unsigned long long)Entry.m_Hash);
+		if(io_write(File, aLine, str_length(aLine)) != (unsigned)str_length(aLine) || !io_write_newline(File))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,79 @@
+#ifndef GAME_PHYSICS_REPLAY_H
+#define GAME_PHYSICS_REPLAY_H
+
+#include <base/types.h>
+
+#include <game/gamecore.h>
+#include <game/teamscore.h>
+
+#include <cstdint>
+#include <vector>
+
+class CCollision;
+class CTeeHistorianReader;
+
+// Runs the inputs recorded in a teehistorian stream through CWorldCore and
+// CCharacterCore, so that changes to the physics can be checked to give
+// the same results bit for bit. Only the cores are simulated, without the
+// tiles, weapons and gameplay of the server, so a character is put back
+// to its recorded position when it spawns and when it drifted further
+// than RESYNC_DISTANCE away from it.
+class CPhysicsReplay
+{
+public:
+	enum
+	{
+		RESYNC_DISTANCE = 64,
+	};
+
+	CPhysicsReplay(CCollision *pCollision, CTeeHistorianReader *pReader);
+
+	// simulates the next tick with the inputs recorded before it, ticks
+	// without any characters are skipped. False at the end of the stream
+	// or if it could not be read.
+	bool Tick();
+
+	int GameTick() const { return m_Tick; }
+	int NumCharacters() const;
+	const CCharacterCore *Character(int ClientId) const { return m_World.m_apCharacters[ClientId]; }
+	// hash of the complete core state of all characters after the last tick
+	uint64_t StateHash() const;
+
+private:
+	void ReadRecordedState();
+
+	CCollision *m_pCollision;
+	CTeeHistorianReader *m_pReader;
+	int m_Tick;
+
+	CWorldCore m_World;
+	CTeamsCore m_Teams;
+	CCharacterCore m_aCores[MAX_CLIENTS];
+};
+
+// The state hashes of every tick of a replay. Saved as text, one tick and
+// its hash per line.
+class CPhysicsTrace
+{
+public:
+	class CEntry
+	{
+	public:
+		int m_Tick;
+		uint64_t m_Hash;
+	};
+
+	void Add(int Tick, uint64_t Hash) { m_vEntries.push_back({Tick, Hash}); }
+	const std::vector<CEntry> &Entries() const { return m_vEntries; }
+
+	// first tick at which the traces differ, -1 if they are the same
+	int FirstMismatch(const CPhysicsTrace &Other) const;
+
+	bool Load(IOHANDLE File);
+	bool Save(IOHANDLE File) const;
+
+private:
+	std::vector<CEntry> m_vEntries;
+};
+
+#endif // GAME_PHYSICS_REPLAY_H
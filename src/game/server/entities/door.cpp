@@ -80,3 +80,16 @@ void CDoor::Snap(int SnappingClient)
 	GameServer()->SnapLaserObject(CSnapContext(SnappingClientVersion, Server()->IsSixup(SnappingClient), SnappingClient), GetId(),
 		m_Pos, From, StartTick, -1, LASERTYPE_DOOR, 0, m_Number);
 }
+
+bool CDoor::SnapShared(const CSnapContext &Context, CSnapVisibility *pVisibility)
+{
+	// old clients need the switch state of the snapping client
+	if(Context.GetClientVersion() < VERSION_DDNET_ENTITY_NETOBJS)
+		return false;
+
+	pVisibility->AddPosition(m_Pos);
+	pVisibility->AddPosition(m_To);
+	GameServer()->SnapLaserObject(Context, GetId(),
+		m_Pos, m_To, -1, -1, LASERTYPE_DOOR, 0, m_Number);
+	return true;
+}
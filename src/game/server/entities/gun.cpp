@@ -174,3 +174,17 @@ void CGun::Snap(int SnappingClient)
 	GameServer()->SnapLaserObject(CSnapContext(SnappingClientVersion, Server()->IsSixup(SnappingClient), SnappingClient), GetId(),
 		m_Pos, m_Pos, StartTick, -1, LASERTYPE_GUN, Subtype, m_Number);
 }
+
+bool CGun::SnapShared(const CSnapContext &Context, CSnapVisibility *pVisibility)
+{
+	// old clients need the switch state of the snapping client
+	if(Context.GetClientVersion() < VERSION_DDNET_ENTITY_NETOBJS)
+		return false;
+
+	int Subtype = (m_Explosive ? 1 : 0) | (m_Freeze ? 2 : 0);
+
+	pVisibility->AddPosition(m_Pos);
+	GameServer()->SnapLaserObject(Context, GetId(),
+		m_Pos, m_Pos, -1, -1, LASERTYPE_GUN, Subtype, m_Number);
+	return true;
+}
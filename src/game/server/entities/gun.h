@@ -36,6 +36,7 @@ public:
 	void Reset() override;
 	void Tick() override;
 	void Snap(int SnappingClient) override;
+	bool SnapShared(const CSnapContext &Context, CSnapVisibility *pVisibility) override;
 };
 
 #endif // GAME_SERVER_ENTITIES_GUN_H
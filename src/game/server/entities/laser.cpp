@@ -319,6 +319,26 @@ void CLaser::Snap(int SnappingClient)
 		m_Pos, m_From, m_EvalTick, m_Owner, LaserType, 0, m_Number);
 }
 
+bool CLaser::SnapShared(const CSnapContext &Context, CSnapVisibility *pVisibility)
+{
+	CCharacter *pOwnerChar = nullptr;
+	if(m_Owner >= 0)
+		pOwnerChar = GameServer()->GetPlayerChar(m_Owner);
+	if(!pOwnerChar)
+		return true;
+
+	pVisibility->AddPosition(m_Pos);
+	pVisibility->AddPosition(m_From);
+	if(pOwnerChar->IsAlive())
+		pVisibility->m_Mask = pOwnerChar->TeamMask();
+
+	int LaserType = m_Type == WEAPON_LASER ? LASERTYPE_RIFLE : m_Type == WEAPON_SHOTGUN ? LASERTYPE_SHOTGUN : -1;
+
+	GameServer()->SnapLaserObject(Context, GetId(),
+		m_Pos, m_From, m_EvalTick, m_Owner, LaserType, 0, m_Number);
+	return true;
+}
+
 void CLaser::SwapClients(int Client1, int Client2)
 {
 	m_Owner = m_Owner == Client1 ? Client2 : m_Owner == Client2 ? Client1 : m_Owner;
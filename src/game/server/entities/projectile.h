@@ -29,6 +29,7 @@ public:
 	void Tick() override;
 	void TickPaused() override;
 	void Snap(int SnappingClient) override;
+	bool SnapShared(const CSnapContext &Context, CSnapVisibility *pVisibility) override;
 	void SwapClients(int Client1, int Client2) override;
 
 private:
@@ -12,6 +12,7 @@
 
 class CCollision;
 class CGameContext;
+struct CSnapContext;
 
 /*
 	Class: Entity
@@ -23,8 +24,11 @@ class CEntity
 
 private:
 	friend CGameWorld; // entity list handling
+	template<typename TEntity>
+	friend class CSpatialGrid;
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
+	CSpatialGridItem m_GridItem;
 
 	/* Identity */
 	CGameWorld *m_pGameWorld;
@@ -76,6 +80,16 @@ public: // TODO: Maybe make protected
 	const vec2 &GetPos() const { return m_Pos; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
 
+	/* Setters */
+
+	/*
+		Function: SetPos
+			Moves the entity. Positions of characters and pickups
+			must be changed with this function, so that the game
+			world can find them by position.
+	*/
+	void SetPos(vec2 Pos);
+
 	/* Other functions */
 
 	/*
@@ -123,6 +137,25 @@ public: // TODO: Maybe make protected
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapShared
+			Called once per tick and snap context to snap the entity
+			for all clients of that context at once. The items are
+			added to the snapshot of every client that passes the
+			visibility check.
+
+		Arguments:
+			Context - Client version and protocol the items are
+				created for.
+			pVisibility - Filled with the clients that may receive
+				the items.
+
+		Returns:
+			False if the snap of the entity depends on more than the
+			visibility, Snap is called for every client then.
+	*/
+	virtual bool SnapShared(const CSnapContext &Context, CSnapVisibility *pVisibility) { return false; }
+
 	/*
 		Function: SwapClients
 			Called when two players have swapped their client ids.
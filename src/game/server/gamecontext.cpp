@@ -126,6 +126,8 @@ void CGameContext::Construct(int Resetting)
 
 	m_aDeleteTempfile[0] = 0;
 	m_TeeHistorianActive = false;
+	m_pTeeHistorianWriter = nullptr;
+	m_pTeeHistorianIndexWriter = nullptr;
 }
 
 void CGameContext::Destruct(int Resetting)
@@ -193,12 +195,6 @@ void CGameContext::Clear()
 	m_VoteMutes = VoteMutes;
 }
 
-void CGameContext::TeeHistorianWrite(const void *pData, int DataSize, void *pUser)
-{
-	CGameContext *pSelf = (CGameContext *)pUser;
-	aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
-}
-
 void CGameContext::CommandCallback(int ClientId, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser)
 {
 	CGameContext *pSelf = (CGameContext *)pUser;
@@ -793,6 +789,36 @@ void CGameContext::SendBroadcast(const char *pText, int ClientId, bool IsImporta
 	m_apPlayers[ClientId]->m_LastBroadcastImportance = IsImportant;
 }
 
+// Returns the map a vote command changes to, if it is a plain map change.
+static bool VoteChangesMap(const char *pCommand, char *pMap, int MapSize)
+{
+	const char *pArg = str_startswith(pCommand, "change_map ");
+	if(!pArg)
+		pArg = str_startswith(pCommand, "sv_map ");
+	if(!pArg)
+		return false;
+
+	pArg = str_skip_whitespaces_const(pArg);
+	const char *pEnd;
+	if(*pArg == '"')
+	{
+		pArg++;
+		pEnd = str_find(pArg, "\"");
+	}
+	else
+	{
+		pEnd = str_find(pArg, ";");
+	}
+	if(!pEnd)
+		pEnd = pArg + str_length(pArg);
+	while(pEnd > pArg && (pEnd[-1] == ' ' || pEnd[-1] == '\t'))
+		pEnd--;
+	if(pEnd == pArg)
+		return false;
+	str_truncate(pMap, MapSize, pArg, pEnd - pArg);
+	return true;
+}
+
 void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char *pReason, const char *pSixupDesc)
 {
 	// reset votes
@@ -814,6 +840,11 @@ void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char
 	str_copy(m_aVoteReason, pReason, sizeof(m_aVoteReason));
 	SendVoteSet(-1);
 	m_VoteUpdate = true;
+
+	// load the map while the vote is running so the change does not stall
+	char aMap[MAX_MAP_LENGTH];
+	if(VoteChangesMap(pCommand, aMap, sizeof(aMap)))
+		Server()->PreloadMap(aMap);
 }
 
 void CGameContext::EndVote()
@@ -1036,7 +1067,7 @@ void CGameContext::OnTick()
 
 	if(m_TeeHistorianActive)
 	{
-		int Error = aio_error(m_pTeeHistorianFile);
+		int Error = m_pTeeHistorianWriter->Error();
 		if(Error)
 		{
 			dbg_msg("teehistorian", "error writing to file, err=%d", Error);
@@ -1048,6 +1079,9 @@ void CGameContext::OnTick()
 			m_TeeHistorian.EndInputs();
 			m_TeeHistorian.EndTick();
 		}
+		m_pTeeHistorianWriter->EndFrame();
+		if(m_pTeeHistorianIndexWriter)
+			m_pTeeHistorianIndexWriter->EndFrame();
 		m_TeeHistorian.BeginTick(Server()->Tick());
 		m_TeeHistorian.BeginPlayers();
 	}
@@ -4087,20 +4121,22 @@ void CGameContext::OnInit(const void *pPersistentData)
 		FormatUuid(m_GameUuid, aGameUuid, sizeof(aGameUuid));
 
 		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian", aGameUuid);
+		const int Compression = g_Config.m_SvTeeHistorianCompression ? CTeeHistorianWriter::COMPRESSION_GZIP : CTeeHistorianWriter::COMPRESSION_NONE;
+		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian%s", aGameUuid, Compression == CTeeHistorianWriter::COMPRESSION_GZIP ? ".gz" : "");
 
 		IOHANDLE THFile = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 		if(!THFile)
 		{
 			dbg_msg("teehistorian", "failed to open '%s'", aFilename);
 			Server()->SetErrorShutdown("teehistorian open error");
+			m_TeeHistorianActive = false;
 			return;
 		}
 		else
 		{
 			dbg_msg("teehistorian", "recording to '%s'", aFilename);
 		}
-		m_pTeeHistorianFile = aio_new(THFile);
+		m_pTeeHistorianWriter = new CTeeHistorianWriter(THFile, Compression, (size_t)g_Config.m_SvTeeHistorianQueueSize * 1024);
 
 		char aVersion[128];
 		if(GIT_SHORTREV_HASH)
@@ -4141,7 +4177,23 @@ void CGameContext::OnInit(const void *pPersistentData)
 			mem_zero(&GameInfo.m_PrevGameUuid, sizeof(GameInfo.m_PrevGameUuid));
 		}
 
-		m_TeeHistorian.Reset(&GameInfo, TeeHistorianWrite, this);
+		if(g_Config.m_SvTeeHistorianIndex)
+		{
+			// keyframes point into the uncompressed stream
+			str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian.index", aGameUuid);
+			IOHANDLE IndexFile = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+			if(IndexFile)
+			{
+				m_pTeeHistorianIndexWriter = new CTeeHistorianWriter(IndexFile, CTeeHistorianWriter::COMPRESSION_NONE, (size_t)g_Config.m_SvTeeHistorianQueueSize * 1024);
+				m_TeeHistorian.SetIndex(g_Config.m_SvTeeHistorianIndex * Server()->TickSpeed(), CTeeHistorianWriter::WriteCallback, m_pTeeHistorianIndexWriter);
+			}
+			else
+			{
+				dbg_msg("teehistorian", "failed to open '%s', not writing an index", aFilename);
+			}
+		}
+
+		m_TeeHistorian.Reset(&GameInfo, CTeeHistorianWriter::WriteCallback, m_pTeeHistorianWriter);
 
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
@@ -4433,15 +4485,24 @@ void CGameContext::OnShutdown(void *pPersistentData)
 	if(m_TeeHistorianActive)
 	{
 		m_TeeHistorian.Finish();
-		aio_close(m_pTeeHistorianFile);
-		aio_wait(m_pTeeHistorianFile);
-		int Error = aio_error(m_pTeeHistorianFile);
+		int Error = m_pTeeHistorianWriter->Close();
 		if(Error)
 		{
 			dbg_msg("teehistorian", "error closing file, err=%d", Error);
 			Server()->SetErrorShutdown("teehistorian close error");
 		}
-		aio_free(m_pTeeHistorianFile);
+		const CTeeHistorianWriter::CStats Stats = m_pTeeHistorianWriter->Stats();
+		dbg_msg("teehistorian", "wrote %" PRId64 " bytes as %" PRId64 " bytes, queue peak=%" PRIzu " bytes, stalls=%d (%.1fms)",
+			Stats.m_InputBytes, Stats.m_OutputBytes, Stats.m_PeakQueuedBytes, Stats.m_NumStalls, Stats.m_StallTime * 1000.0 / time_freq());
+		delete m_pTeeHistorianWriter;
+		m_pTeeHistorianWriter = nullptr;
+		if(m_pTeeHistorianIndexWriter)
+		{
+			if(m_pTeeHistorianIndexWriter->Close())
+				dbg_msg("teehistorian", "error closing index file");
+			delete m_pTeeHistorianIndexWriter;
+			m_pTeeHistorianIndexWriter = nullptr;
+		}
 	}
 
 	// Stop any demos being recorded.
@@ -4492,6 +4553,11 @@ void CGameContext::LoadMapSettings()
 	Console()->ExecuteFile(aBuf, IConsole::CLIENT_ID_NO_GAME);
 }
 
+void CGameContext::OnPreSnap()
+{
+	m_World.ClearSharedSnaps();
+}
+
 void CGameContext::OnSnap(int ClientId, bool GlobalSnap)
 {
 	// sixup should only snap during global snap
@@ -120,7 +120,8 @@ class CGameContext : public IGameServer
 
 	bool m_TeeHistorianActive;
 	CTeeHistorian m_TeeHistorian;
-	ASYNCIO *m_pTeeHistorianFile;
+	CTeeHistorianWriter *m_pTeeHistorianWriter;
+	CTeeHistorianWriter *m_pTeeHistorianIndexWriter;
 	CUuid m_GameUuid;
 	CMapBugs m_MapBugs;
 	CPrng m_Prng;
@@ -128,7 +129,6 @@ class CGameContext : public IGameServer
 	bool m_Resetting;
 
 	static void CommandCallback(int ClientId, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser);
-	static void TeeHistorianWrite(const void *pData, int DataSize, void *pUser);
 
 	static void ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static void ConToggleTuneParam(IConsole::IResult *pResult, void *pUserData);
@@ -321,6 +321,7 @@ public:
 	void OnShutdown(void *pPersistentData) override;
 
 	void OnTick() override;
+	void OnPreSnap() override;
 	void OnSnap(int ClientId, bool GlobalSnap) override;
 	void OnPostGlobalSnap() override;
 
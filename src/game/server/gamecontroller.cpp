@@ -385,7 +385,7 @@ bool IGameController::OnEntity(int Index, int x, int y, int Layer, int Flags, bo
 	{
 		int PickupFlags = TileFlagsToPickupFlags(Flags);
 		CPickup *pPickup = new CPickup(&GameServer()->m_World, Type, SubType, Layer, Number, PickupFlags);
-		pPickup->m_Pos = Pos;
+		pPickup->SetPos(Pos);
 		return true; // NOLINT(clang-analyzer-unix.Malloc)
 	}
 
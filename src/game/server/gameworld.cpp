@@ -6,12 +6,102 @@
 #include "entity.h"
 #include "gamecontext.h"
 #include "gamecontroller.h"
+#include "player.h"
 
 #include <engine/shared/config.h>
 
 #include <algorithm>
+#include <cmath>
 #include <utility>
 
+void CSnapVisibility::AddPosition(vec2 Pos)
+{
+	dbg_assert(m_NumPositions < MAX_POSITIONS, "too many snap visibility positions");
+	m_aPositions[m_NumPositions++] = Pos;
+}
+
+bool CSnapVisibility::IsVisible(const CGameContext *pGameServer, int SnappingClient) const
+{
+	if(SnappingClient != SERVER_DEMO_CLIENT && !m_Mask.test(SnappingClient))
+		return false;
+	for(int i = 0; i < m_NumPositions; i++)
+	{
+		if(!NetworkClipped(pGameServer, SnappingClient, m_aPositions[i]))
+			return true;
+	}
+	return false;
+}
+
+int CSnapViewIndex::CellCoord(float Value)
+{
+	const float Cell = std::floor(Value / CELL_SIZE);
+	return (int)std::clamp(Cell, (float)-MAX_CELL, (float)MAX_CELL);
+}
+
+void CSnapViewIndex::Clear()
+{
+	m_vCells.clear();
+	m_vAlways.clear();
+}
+
+void CSnapViewIndex::Add(int Entry, const CSnapVisibility &Visibility)
+{
+	for(int i = 0; i < Visibility.m_NumPositions; i++)
+	{
+		const vec2 Pos = Visibility.m_aPositions[i];
+		// NaN positions are never network clipped
+		if(!std::isfinite(Pos.x) || !std::isfinite(Pos.y))
+		{
+			AddAlways(Entry);
+			return;
+		}
+	}
+	for(int i = 0; i < Visibility.m_NumPositions; i++)
+	{
+		const vec2 Pos = Visibility.m_aPositions[i];
+		m_vCells.emplace_back(CellKey(CellCoord(Pos.x), CellCoord(Pos.y)), Entry);
+	}
+}
+
+void CSnapViewIndex::AddAlways(int Entry)
+{
+	m_vAlways.push_back(Entry);
+}
+
+void CSnapViewIndex::Finish()
+{
+	std::sort(m_vCells.begin(), m_vCells.end());
+}
+
+bool CSnapViewIndex::Query(vec2 ViewPos, vec2 ShowDistance, std::vector<int> &vResult) const
+{
+	// also rejects NaN, which would make everything visible
+	if(!(absolute(ViewPos.x) <= MAX_VIEW && absolute(ViewPos.y) <= MAX_VIEW &&
+		   ShowDistance.x >= 0.0f && ShowDistance.x <= MAX_VIEW && ShowDistance.y >= 0.0f && ShowDistance.y <= MAX_VIEW))
+		return false;
+
+	const int MinX = CellCoord(ViewPos.x - ShowDistance.x - VIEW_MARGIN);
+	const int MinY = CellCoord(ViewPos.y - ShowDistance.y - VIEW_MARGIN);
+	const int MaxX = CellCoord(ViewPos.x + ShowDistance.x + VIEW_MARGIN);
+	const int MaxY = CellCoord(ViewPos.y + ShowDistance.y + VIEW_MARGIN);
+	if(MaxY - MinY + 1 > MAX_QUERY_ROWS)
+		return false;
+
+	vResult.clear();
+	for(int CellY = MinY; CellY <= MaxY; CellY++)
+	{
+		const int64_t First = CellKey(MinX, CellY);
+		const int64_t Last = CellKey(MaxX, CellY);
+		auto It = std::lower_bound(m_vCells.begin(), m_vCells.end(), First, [](const std::pair<int64_t, int> &Cell, int64_t Key) { return Cell.first < Key; });
+		for(; It != m_vCells.end() && It->first <= Last; ++It)
+			vResult.push_back(It->second);
+	}
+	vResult.insert(vResult.end(), m_vAlways.begin(), m_vAlways.end());
+	std::sort(vResult.begin(), vResult.end());
+	vResult.erase(std::unique(vResult.begin(), vResult.end()), vResult.end());
+	return true;
+}
+
 //////////////////////////////////////////////////
 // game world
 //////////////////////////////////////////////////
@@ -47,23 +137,48 @@ CEntity *CGameWorld::FindFirst(int Type)
 	return Type < 0 || Type >= NUM_ENTTYPES ? nullptr : m_apFirstEntityTypes[Type];
 }
 
+void CGameWorld::UpdateEntityPos(CEntity *pEnt)
+{
+	m_aEntityGrids[pEnt->m_ObjType].Move(pEnt);
+}
+
+template<typename F>
+void CGameWorld::ForEachEntityInArea(int Type, vec2 Min, vec2 Max, F &&Func)
+{
+	// visits the entities in list order, stops when Func returns true
+#ifdef CONF_DEBUG
+	for(CEntity *pCur = m_apFirstEntityTypes[Type]; pCur; pCur = pCur->m_pNextTypeEntity)
+		dbg_assert(m_aEntityGrids[Type].IsCellCurrent(pCur), "entity moved without SetPos, type=%d id=%d", Type, pCur->GetId());
+#endif
+	if(HasEntityGrid(Type) && m_aEntityGrids[Type].Query(Min, Max, m_vpGridResult))
+	{
+		for(CEntity *pEnt : m_vpGridResult)
+			if(Func(pEnt))
+				return;
+		return;
+	}
+	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		if(Func(pEnt))
+			return;
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
 	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
-	{
+	ForEachEntityInArea(Type, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), [&](CEntity *pEnt) {
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
 		{
 			if(ppEnts)
 				ppEnts[Num] = pEnt;
 			Num++;
 			if(Num == Max)
-				break;
+				return true;
 		}
-	}
+		return false;
+	});
 
 	return Num;
 }
@@ -81,6 +196,11 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = nullptr;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	if(HasEntityGrid(pEnt->m_ObjType))
+		m_aEntityGrids[pEnt->m_ObjType].Insert(pEnt, m_NextEntityOrder++);
+
+	ClearSharedSnaps();
 }
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
@@ -103,9 +223,74 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = nullptr;
 	pEnt->m_pPrevTypeEntity = nullptr;
+
+	m_aEntityGrids[pEnt->m_ObjType].Remove(pEnt);
+
+	ClearSharedSnaps();
 }
 
 //
+void CGameWorld::ClearSharedSnaps()
+{
+	m_NumSharedSnaps = 0;
+}
+
+const CGameWorld::CSharedSnap *CGameWorld::SharedSnap(int SnappingClient)
+{
+	if(!Config()->m_SvSharedSnap || SnappingClient == SERVER_DEMO_CLIENT)
+		return nullptr;
+
+	const int ClientVersion = GameServer()->GetClientVersion(SnappingClient);
+	const bool Sixup = Server()->IsSixup(SnappingClient);
+	for(int i = 0; i < m_NumSharedSnaps; i++)
+	{
+		const CSharedSnap &SharedSnap = m_aSharedSnaps[i];
+		if(SharedSnap.m_ClientVersion == ClientVersion && SharedSnap.m_Sixup == Sixup)
+			return SharedSnap.m_Pool.Overflow() ? nullptr : &SharedSnap;
+	}
+	if(m_NumSharedSnaps == MAX_SHARED_SNAPS)
+		return nullptr;
+
+	CSharedSnap &SharedSnap = m_aSharedSnaps[m_NumSharedSnaps++];
+	SharedSnap.m_ClientVersion = ClientVersion;
+	SharedSnap.m_Sixup = Sixup;
+	SharedSnap.m_Pool.Clear();
+	SharedSnap.m_vEntries.clear();
+
+	// same order as the per client snap below
+	const CSnapContext Context(ClientVersion, Sixup, SERVER_DEMO_CLIENT);
+	Server()->SnapSetItemPool(&SharedSnap.m_Pool);
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
+		if(i == ENTTYPE_CHARACTER)
+			continue;
+
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		{
+			CSharedSnapEntry Entry;
+			Entry.m_pEntity = pEnt;
+			Entry.m_Group = SharedSnap.m_Pool.NewGroup();
+			if(!pEnt->SnapShared(Context, &Entry.m_Visibility))
+				Entry.m_Group = -1;
+			SharedSnap.m_vEntries.push_back(Entry);
+		}
+	}
+	Server()->SnapSetItemPool(nullptr);
+
+	SharedSnap.m_ViewIndex.Clear();
+	for(int i = 0; i < (int)SharedSnap.m_vEntries.size(); i++)
+	{
+		const CSharedSnapEntry &Entry = SharedSnap.m_vEntries[i];
+		if(Entry.m_Group == -1)
+			SharedSnap.m_ViewIndex.AddAlways(i);
+		else
+			SharedSnap.m_ViewIndex.Add(i, Entry.m_Visibility);
+	}
+	SharedSnap.m_ViewIndex.Finish();
+
+	return SharedSnap.m_Pool.Overflow() ? nullptr : &SharedSnap;
+}
+
 void CGameWorld::Snap(int SnappingClient)
 {
 	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt;)
@@ -115,6 +300,31 @@ void CGameWorld::Snap(int SnappingClient)
 		pEnt = m_pNextTraverseEntity;
 	}
 
+	const CSharedSnap *pSharedSnap = SharedSnap(SnappingClient);
+	if(pSharedSnap)
+	{
+		const auto SnapEntry = [&](const CSharedSnapEntry &Entry) {
+			if(Entry.m_Group == -1)
+				Entry.m_pEntity->Snap(SnappingClient);
+			else if(Entry.m_Visibility.IsVisible(GameServer(), SnappingClient))
+				Server()->SnapAddItemPoolGroup(&pSharedSnap->m_Pool, Entry.m_Group);
+		};
+
+		// only visit the entries close to the view, in the same order
+		const CPlayer *pPlayer = GameServer()->m_apPlayers[SnappingClient];
+		if(!pPlayer->m_ShowAll && pSharedSnap->m_ViewIndex.Query(pPlayer->m_ViewPos, pPlayer->m_ShowDistance, m_vSnapViewEntries))
+		{
+			for(int Entry : m_vSnapViewEntries)
+				SnapEntry(pSharedSnap->m_vEntries[Entry]);
+		}
+		else
+		{
+			for(const CSharedSnapEntry &Entry : pSharedSnap->m_vEntries)
+				SnapEntry(Entry);
+		}
+		return;
+	}
+
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 	{
 		if(i == ENTTYPE_CHARACTER)
@@ -291,17 +501,20 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CEntity *pClosest = nullptr;
 
-	CEntity *pEntity = FindFirst(Type);
-	for(; pEntity; pEntity = pEntity->TypeNext())
-	{
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return nullptr;
+
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+	ForEachEntityInArea(Type, Min, Max, [&](CEntity *pEntity) {
 		if(pEntity == pNotThis)
-			continue;
+			return false;
 
 		if(pThisOnly && pEntity != pThisOnly)
-			continue;
+			return false;
 
 		if(CollideWith != -1 && !pEntity->CanCollide(CollideWith))
-			continue;
+			return false;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pEntity->m_Pos, IntersectPos))
@@ -318,7 +531,8 @@ CEntity *CGameWorld::IntersectEntity(vec2 Pos0, vec2 Pos1, float Radius, int Typ
 				}
 			}
 		}
-	}
+		return false;
+	});
 
 	return pClosest;
 }
@@ -329,11 +543,10 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 	float ClosestRange = Radius * 2;
 	CCharacter *pClosest = nullptr;
 
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
-	{
+	ForEachEntityInArea(ENTTYPE_CHARACTER, Pos - vec2(Radius, Radius), Pos + vec2(Radius, Radius), [&](CEntity *pEnt) {
+		CCharacter *p = (CCharacter *)pEnt;
 		if(p == pNotThis)
-			continue;
+			return false;
 
 		float Len = distance(Pos, p->m_Pos);
 		if(Len < p->m_ProximityRadius + Radius)
@@ -344,7 +557,8 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 				pClosest = p;
 			}
 		}
-	}
+		return false;
+	});
 
 	return pClosest;
 }
@@ -352,11 +566,12 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CEntity *pNotThis)
 {
 	std::vector<CCharacter *> vpCharacters;
-	CCharacter *pChr = (CCharacter *)FindFirst(CGameWorld::ENTTYPE_CHARACTER);
-	for(; pChr; pChr = (CCharacter *)pChr->TypeNext())
-	{
+	const vec2 Min = vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Radius, Radius);
+	const vec2 Max = vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Radius, Radius);
+	ForEachEntityInArea(ENTTYPE_CHARACTER, Min, Max, [&](CEntity *pEnt) {
+		CCharacter *pChr = (CCharacter *)pEnt;
 		if(pChr == pNotThis)
-			continue;
+			return false;
 
 		vec2 IntersectPos;
 		if(closest_point_on_line(Pos0, Pos1, pChr->m_Pos, IntersectPos))
@@ -367,7 +582,8 @@ std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1
 				vpCharacters.push_back(pChr);
 			}
 		}
-	}
+		return false;
+	});
 	return vpCharacters;
 }
 
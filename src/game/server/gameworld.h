@@ -3,14 +3,91 @@
 #ifndef GAME_SERVER_GAMEWORLD_H
 #define GAME_SERVER_GAMEWORLD_H
 
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
 #include <game/gamecore.h>
+#include <game/spatial_grid.h>
 
 #include "save.h"
 
+#include <utility>
 #include <vector>
 
 class CEntity;
 class CCharacter;
+class CGameContext;
+
+/*
+	Class: CSnapVisibility
+		Describes which clients receive the shared snap of an entity.
+		A client receives it if at least one of the positions is not
+		network clipped for it and it is part of the mask.
+*/
+class CSnapVisibility
+{
+public:
+	enum
+	{
+		MAX_POSITIONS = 2,
+	};
+
+	vec2 m_aPositions[MAX_POSITIONS];
+	int m_NumPositions = 0;
+	CClientMask m_Mask = CClientMask().set();
+
+	void AddPosition(vec2 Pos);
+	bool IsVisible(const CGameContext *pGameServer, int SnappingClient) const;
+};
+
+/*
+	Class: CSnapViewIndex
+		Sorts the shared snap entries by the cells of their visibility
+		positions, so that a client's view only has to check the entries
+		close to it instead of all of them.
+*/
+class CSnapViewIndex
+{
+	enum
+	{
+		CELL_SIZE = 512,
+		MAX_CELL = 1 << 20,
+		MAX_QUERY_ROWS = 32,
+	};
+	// views further away fall back to checking all entries, this keeps
+	// the float error of the view rectangle below the margin
+	static constexpr float MAX_VIEW = 1000000.0f;
+	static constexpr float VIEW_MARGIN = 1.0f;
+
+	// (cell key, entry index), sorted by cell key
+	std::vector<std::pair<int64_t, int>> m_vCells;
+	// entries that have to be checked for every view
+	std::vector<int> m_vAlways;
+
+	static int CellCoord(float Value);
+	static int64_t CellKey(int CellX, int CellY) { return (int64_t)CellY << 32 | (uint32_t)(CellX + MAX_CELL); }
+
+public:
+	void Clear();
+	void Add(int Entry, const CSnapVisibility &Visibility);
+	void AddAlways(int Entry);
+	void Finish();
+
+	/*
+		Function: Query
+			Finds the entries that might be visible from the view.
+
+		Arguments:
+			ViewPos - Center of the view.
+			ShowDistance - Half size of the view.
+			vResult - Receives the entry indices in ascending order.
+
+		Returns:
+			False if the view is too large or not finite, the caller has
+			to check all entries then.
+	*/
+	bool Query(vec2 ViewPos, vec2 ShowDistance, std::vector<int> &vResult) const;
+};
 
 /*
 	Class: Game World
@@ -37,6 +114,44 @@ private:
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// positions of the entity types that are searched by position, the
+	// order values follow the entity lists
+	CSpatialGrid<CEntity> m_aEntityGrids[NUM_ENTTYPES];
+	int64_t m_NextEntityOrder = 0;
+	std::vector<CEntity *> m_vpGridResult;
+
+	static bool HasEntityGrid(int Type) { return Type == ENTTYPE_CHARACTER || Type == ENTTYPE_PICKUP; }
+	template<typename F>
+	void ForEachEntityInArea(int Type, vec2 Min, vec2 Max, F &&Func);
+
+	// entities snapped once per tick for all clients with the same
+	// version and protocol, see CEntity::SnapShared
+	enum
+	{
+		MAX_SHARED_SNAPS = 4,
+	};
+	struct CSharedSnapEntry
+	{
+		CEntity *m_pEntity;
+		// -1 if the entity has to be snapped per client
+		int m_Group;
+		CSnapVisibility m_Visibility;
+	};
+	class CSharedSnap
+	{
+	public:
+		int m_ClientVersion;
+		bool m_Sixup;
+		CSnapshotItemPool m_Pool;
+		std::vector<CSharedSnapEntry> m_vEntries;
+		CSnapViewIndex m_ViewIndex;
+	};
+	CSharedSnap m_aSharedSnaps[MAX_SHARED_SNAPS];
+	int m_NumSharedSnaps = 0;
+
+	const CSharedSnap *SharedSnap(int SnappingClient);
+	std::vector<int> m_vSnapViewEntries;
+
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
 	class IServer *m_pServer;
@@ -57,6 +172,12 @@ public:
 
 	CEntity *FindFirst(int Type);
 
+	/*
+		Function: UpdateEntityPos
+			Called by CEntity::SetPos after the position of an entity changed.
+	*/
+	void UpdateEntityPos(CEntity *pEnt);
+
 	/*
 		Function: FindEntities
 			Finds entities close to a position and returns them in a list.
@@ -155,6 +276,13 @@ public:
 	*/
 	void Snap(int SnappingClient);
 
+	/*
+		Function: ClearSharedSnaps
+			Invalidates the shared snaps of the last tick. Has to be
+			called before the first snap of a tick.
+	*/
+	void ClearSharedSnaps();
+
 	/*
 		Function: Tick
 			Calls Tick on all the entities in the world to progress
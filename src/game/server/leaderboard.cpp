@@ -0,0 +1,64 @@
+#include "leaderboard.h"
+
+#include <base/system.h>
+
+#include <algorithm>
+
+static bool EntryLess(const CLeaderboard::CEntry &Left, const CLeaderboard::CEntry &Right)
+{
+	if(Left.m_Time != Right.m_Time)
+		return Left.m_Time < Right.m_Time;
+	return Left.m_Name < Right.m_Name;
+}
+
+void CLeaderboard::Clear()
+{
+	m_vEntries.clear();
+	m_BestTimes.clear();
+}
+
+void CLeaderboard::Load(std::vector<CEntry> &&vEntries)
+{
+	Clear();
+	m_vEntries = std::move(vEntries);
+	std::sort(m_vEntries.begin(), m_vEntries.end(), EntryLess);
+	// the best time of a player comes first, drop the others
+	m_vEntries.erase(std::remove_if(m_vEntries.begin(), m_vEntries.end(), [this](const CEntry &Entry) {
+		return !m_BestTimes.emplace(Entry.m_Name, Entry.m_Time).second;
+	}),
+		m_vEntries.end());
+}
+
+bool CLeaderboard::Insert(const char *pName, float Time)
+{
+	auto [It, Inserted] = m_BestTimes.emplace(pName, Time);
+	if(!Inserted)
+	{
+		if(It->second <= Time)
+			return false;
+		CEntry Old{It->second, It->first};
+		auto OldIt = std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Old, EntryLess);
+		dbg_assert(OldIt != m_vEntries.end() && OldIt->m_Name == Old.m_Name, "leaderboard entry missing");
+		m_vEntries.erase(OldIt);
+		It->second = Time;
+	}
+	CEntry New{Time, pName};
+	m_vEntries.insert(std::upper_bound(m_vEntries.begin(), m_vEntries.end(), New, EntryLess), std::move(New));
+	return true;
+}
+
+std::optional<float> CLeaderboard::Time(const char *pName) const
+{
+	auto It = m_BestTimes.find(pName);
+	if(It == m_BestTimes.end())
+		return std::nullopt;
+	return It->second;
+}
+
+int CLeaderboard::Rank(float Time) const
+{
+	auto It = std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Time, [](const CEntry &Entry, float Value) {
+		return Entry.m_Time < Value;
+	});
+	return 1 + (It - m_vEntries.begin());
+}
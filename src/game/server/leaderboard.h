@@ -0,0 +1,45 @@
+#ifndef GAME_SERVER_LEADERBOARD_H
+#define GAME_SERVER_LEADERBOARD_H
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Best time of every player on a map. The entries are kept sorted by time,
+// so the rank of a time is found by binary search and the n-th place by
+// indexing. Ranks match SQL's RANK(): players with equal times share a rank.
+class CLeaderboard
+{
+public:
+	class CEntry
+	{
+	public:
+		float m_Time;
+		std::string m_Name;
+	};
+
+	void Clear();
+	// replaces all entries, keeps the best time if a player occurs twice
+	void Load(std::vector<CEntry> &&vEntries);
+	// returns true if the time is a new best time of the player
+	bool Insert(const char *pName, float Time);
+
+	int NumEntries() const { return m_vEntries.size(); }
+	// entries ordered by time, ties are ordered by name
+	const CEntry &Entry(int Index) const { return m_vEntries[Index]; }
+	// 0 if nobody finished yet
+	float BestTime() const { return m_vEntries.empty() ? 0.0f : m_vEntries.front().m_Time; }
+
+	std::optional<float> Time(const char *pName) const;
+	// 1 + number of players with a better time
+	int Rank(float Time) const;
+	// rank of the entry at the index
+	int RankOfEntry(int Index) const { return Rank(m_vEntries[Index].m_Time); }
+
+private:
+	std::vector<CEntry> m_vEntries;
+	std::unordered_map<std::string, float> m_BestTimes;
+};
+
+#endif // GAME_SERVER_LEADERBOARD_H
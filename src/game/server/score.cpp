@@ -1,3 +1,4 @@
+#include <base/math.h>
 #include <base/system.h>
 #include <engine/server/databases/connection_pool.h>
 #include <engine/shared/config.h>
@@ -8,6 +9,7 @@
 #include <game/server/gamemodes/DDRace.h>
 #include <game/team_state.h>
 
+#include <cmath>
 #include <memory>
 
 #include "player.h"
@@ -72,8 +74,12 @@ void CScore::GeneratePassphrase(char *pBuf, int BufSize)
 CScore::CScore(CGameContext *pGameServer, CDbConnectionPool *pPool) :
 	m_pPool(pPool),
 	m_pGameServer(pGameServer),
-	m_pServer(pGameServer->Server())
+	m_pServer(pGameServer->Server()),
+	m_aLeaderboardServer(""),
+	m_LeaderboardLoaded(false),
+	m_LeaderboardReloadTick(0)
 {
+	UpdateLeaderboard();
 	LoadBestTime();
 
 	uint64_t aSeed[2];
@@ -113,11 +119,183 @@ void CScore::LoadBestTime()
 	auto LoadBestTimeResult = std::make_shared<CScoreLoadBestTimeResult>();
 	m_pGameServer->m_pController->m_pLoadBestTimeResult = LoadBestTimeResult;
 
+	if(UpdateLeaderboard())
+	{
+		LoadBestTimeResult->m_CurrentRecord = m_GlobalLeaderboard.BestTime();
+		LoadBestTimeResult->m_Success = true;
+		LoadBestTimeResult->m_Completed = true;
+		return;
+	}
+
 	auto Tmp = std::make_unique<CSqlLoadBestTimeRequest>(LoadBestTimeResult);
 	str_copy(Tmp->m_aMap, Server()->GetMapName(), sizeof(Tmp->m_aMap));
 	m_pPool->Execute(CScoreWorker::LoadBestTime, std::move(Tmp), "load best time");
 }
 
+void CScore::LoadLeaderboard()
+{
+	m_pLeaderboardResult = std::make_shared<CScoreLeaderboardResult>();
+	m_LeaderboardReloadTick = Server()->Tick() + (int64_t)g_Config.m_SvLeaderboardCache * Server()->TickSpeed();
+	// finishes written from now on might be missing in the result
+	m_vSavedFinishes.clear();
+
+	auto Tmp = std::make_unique<CSqlLeaderboardRequest>(m_pLeaderboardResult);
+	str_copy(Tmp->m_aMap, Server()->GetMapName(), sizeof(Tmp->m_aMap));
+	str_copy(Tmp->m_aServer, g_Config.m_SvSqlServerName, sizeof(Tmp->m_aServer));
+	m_pPool->Execute(CScoreWorker::LoadLeaderboard, std::move(Tmp), "load leaderboard");
+}
+
+bool CScore::UpdateLeaderboard()
+{
+	if(!g_Config.m_SvLeaderboardCache)
+		return false;
+
+	for(auto It = m_vPendingFinishes.begin(); It != m_vPendingFinishes.end();)
+	{
+		if(!It->m_pResult->m_Completed)
+		{
+			++It;
+			continue;
+		}
+		if(It->m_pResult->m_Success)
+		{
+			InsertFinish(It->m_Entry);
+			m_vSavedFinishes.push_back(It->m_Entry);
+		}
+		It = m_vPendingFinishes.erase(It);
+	}
+
+	if(m_pLeaderboardResult != nullptr && m_pLeaderboardResult->m_Completed)
+	{
+		if(m_pLeaderboardResult->m_Success)
+		{
+			m_GlobalLeaderboard.Load(std::move(m_pLeaderboardResult->m_vGlobal));
+			m_RegionalLeaderboard.Load(std::move(m_pLeaderboardResult->m_vRegional));
+			for(const auto &Finish : m_vSavedFinishes)
+				InsertFinish(Finish);
+			m_LeaderboardLoaded = true;
+		}
+		m_pLeaderboardResult = nullptr;
+	}
+
+	char aServer[sizeof(m_aLeaderboardServer)];
+	str_copy(aServer, g_Config.m_SvSqlServerName);
+	if(str_comp(aServer, m_aLeaderboardServer) != 0)
+	{
+		// the regional leaderboard is of another region
+		str_copy(m_aLeaderboardServer, aServer);
+		m_LeaderboardLoaded = false;
+		m_pLeaderboardResult = nullptr;
+		m_LeaderboardReloadTick = 0;
+	}
+
+	// reload from time to time to see the finishes on other servers, this
+	// also retries failed loads
+	if(m_pLeaderboardResult == nullptr && Server()->Tick() >= m_LeaderboardReloadTick)
+		LoadLeaderboard();
+	return m_LeaderboardLoaded;
+}
+
+void CScore::InsertFinish(const CLeaderboard::CEntry &Finish)
+{
+	m_GlobalLeaderboard.Insert(Finish.m_Name.c_str(), Finish.m_Time);
+	// finishes are saved with the name of this server
+	m_RegionalLeaderboard.Insert(Finish.m_Name.c_str(), Finish.m_Time);
+}
+
+void CScore::LeaderboardRank(CScorePlayerResult *pResult, const char *pName, const char *pRequestingPlayer) const
+{
+	std::optional<float> Time = m_GlobalLeaderboard.Time(pName);
+	if(!Time.has_value())
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s is not ranked", pName);
+		return;
+	}
+
+	int Rank = m_GlobalLeaderboard.Rank(*Time);
+	int NumEntries = m_GlobalLeaderboard.NumEntries();
+	// same as PERCENT_RANK() in the query
+	float PercentRank = NumEntries > 1 ? (float)(Rank - 1) / (NumEntries - 1) : 0.0f;
+	int BetterThanPercent = std::floor(100.0f - 100.0f * PercentRank);
+	char aTime[128];
+	str_time_float(*Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+	if(g_Config.m_SvHideScore)
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"Your time: %s, better than %d%%", aTime, BetterThanPercent);
+		return;
+	}
+
+	pResult->m_MessageKind = CScorePlayerResult::ALL;
+	if(str_comp_nocase(pRequestingPlayer, pName) == 0)
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s - %s - better than %d%%",
+			pName, aTime, BetterThanPercent);
+	}
+	else
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s - %s - better than %d%% - requested by %s",
+			pName, aTime, BetterThanPercent, pRequestingPlayer);
+	}
+
+	if(g_Config.m_SvRegionalRankings)
+	{
+		char aRegionalRank[16];
+		std::optional<float> RegionalTime = m_RegionalLeaderboard.Time(pName);
+		if(RegionalTime.has_value())
+			str_format(aRegionalRank, sizeof(aRegionalRank), "rank %d", m_RegionalLeaderboard.Rank(*RegionalTime));
+		else
+			str_copy(aRegionalRank, "unranked");
+		str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
+			"Global rank %d - %s %s",
+			Rank, m_aLeaderboardServer, aRegionalRank);
+	}
+	else
+	{
+		str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
+			"Global rank %d", Rank);
+	}
+}
+
+void CScore::LeaderboardTop(CScorePlayerResult *pResult, int Offset) const
+{
+	int LimitStart = maximum(absolute(Offset) - 1, 0);
+	auto &aaMessages = pResult->m_Data.m_aaMessages;
+
+	int Line = 0;
+	auto ShowEntries = [&](const CLeaderboard &Leaderboard, int Count) {
+		for(int i = LimitStart; i < LimitStart + Count && i < Leaderboard.NumEntries(); i++)
+		{
+			// negative offsets count from the last place
+			int Index = Offset >= 0 ? i : Leaderboard.NumEntries() - 1 - i;
+			const CLeaderboard::CEntry &Entry = Leaderboard.Entry(Index);
+			char aTime[32];
+			str_time_float(Entry.m_Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+			str_format(aaMessages[Line], sizeof(aaMessages[Line]),
+				"%d. %s Time: %s", Leaderboard.RankOfEntry(Index), Entry.m_Name.c_str(), aTime);
+			Line++;
+		}
+	};
+
+	str_copy(aaMessages[Line], "------------ Global Top ------------", sizeof(aaMessages[Line]));
+	Line++;
+	ShowEntries(m_GlobalLeaderboard, 5);
+
+	if(!g_Config.m_SvRegionalRankings)
+	{
+		str_copy(aaMessages[Line], "-----------------------------------------", sizeof(aaMessages[Line]));
+		return;
+	}
+
+	str_format(aaMessages[Line], sizeof(aaMessages[Line]),
+		"------------ %s Top ------------", m_aLeaderboardServer);
+	Line++;
+	ShowEntries(m_RegionalLeaderboard, 3);
+}
+
 void CScore::LoadPlayerData(int ClientId, const char *pName)
 {
 	ExecPlayerThread(CScoreWorker::LoadPlayerData, "load player data", ClientId, pName, 0);
@@ -164,7 +342,10 @@ void CScore::SaveScore(int ClientId, int TimeTicks, const char *pTimestamp, cons
 	for(int i = 0; i < NUM_CHECKPOINTS; i++)
 		Tmp->m_aCurrentTimeCp[i] = aTimeCp[i];
 
-	m_pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(Tmp), "save score");
+	if(g_Config.m_SvLeaderboardCache)
+		m_vPendingFinishes.push_back({pCurPlayer->m_ScoreFinishResult, {RoundTime(Tmp->m_Time), Tmp->m_aName}});
+
+	m_pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(Tmp), "save score", /* Batch */ true);
 }
 
 void CScore::SaveTeamScore(int Team, int *pClientIds, unsigned int Size, int TimeTicks, const char *pTimestamp)
@@ -190,13 +371,23 @@ void CScore::SaveTeamScore(int Team, int *pClientIds, unsigned int Size, int Tim
 	str_copy(Tmp->m_aMap, Server()->GetMapName(), sizeof(Tmp->m_aMap));
 	Tmp->m_TeamrankUuid = RandomUuid();
 
-	m_pPool->ExecuteWrite(CScoreWorker::SaveTeamScore, std::move(Tmp), "save team score");
+	m_pPool->ExecuteWrite(CScoreWorker::SaveTeamScore, std::move(Tmp), "save team score", /* Batch */ true);
 }
 
 void CScore::ShowRank(int ClientId, const char *pName)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
+	if(UpdateLeaderboard())
+	{
+		auto pResult = NewSqlPlayerResult(ClientId);
+		if(pResult == nullptr)
+			return;
+		LeaderboardRank(pResult.get(), pName, Server()->ClientName(ClientId));
+		pResult->m_Success = true;
+		pResult->m_Completed = true;
+		return;
+	}
 	ExecPlayerThread(CScoreWorker::ShowRank, "show rank", ClientId, pName, 0);
 }
 
@@ -211,6 +402,16 @@ void CScore::ShowTop(int ClientId, int Offset)
 {
 	if(RateLimitPlayer(ClientId))
 		return;
+	if(UpdateLeaderboard())
+	{
+		auto pResult = NewSqlPlayerResult(ClientId);
+		if(pResult == nullptr)
+			return;
+		LeaderboardTop(pResult.get(), Offset);
+		pResult->m_Success = true;
+		pResult->m_Completed = true;
+		return;
+	}
 	ExecPlayerThread(CScoreWorker::ShowTop, "show top5", ClientId, "", Offset);
 }
 
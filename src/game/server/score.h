@@ -3,6 +3,7 @@
 
 #include <game/prng.h>
 
+#include "leaderboard.h"
 #include "scoreworker.h"
 
 class CDbConnectionPool;
@@ -38,6 +39,34 @@ class CScore
 	// returns true if the player should be rate limited
 	bool RateLimitPlayer(int ClientId);
 
+	// best times of the current map, answer /rank, /top5 and the server
+	// record without a database query once loaded
+	CLeaderboard m_GlobalLeaderboard;
+	CLeaderboard m_RegionalLeaderboard;
+	char m_aLeaderboardServer[5];
+	bool m_LeaderboardLoaded;
+	int64_t m_LeaderboardReloadTick;
+	std::shared_ptr<CScoreLeaderboardResult> m_pLeaderboardResult;
+
+	class CFinish
+	{
+	public:
+		std::shared_ptr<CScorePlayerResult> m_pResult;
+		CLeaderboard::CEntry m_Entry;
+	};
+	// finishes that are still being written
+	std::vector<CFinish> m_vPendingFinishes;
+	// finishes written since the last leaderboard load was queued
+	std::vector<CLeaderboard::CEntry> m_vSavedFinishes;
+
+	void LoadLeaderboard();
+	// applies completed loads and writes, returns true if the leaderboard
+	// can answer queries
+	bool UpdateLeaderboard();
+	void InsertFinish(const CLeaderboard::CEntry &Finish);
+	void LeaderboardRank(CScorePlayerResult *pResult, const char *pName, const char *pRequestingPlayer) const;
+	void LeaderboardTop(CScorePlayerResult *pResult, int Offset) const;
+
 public:
 	CScore(CGameContext *pGameServer, CDbConnectionPool *pPool);
 
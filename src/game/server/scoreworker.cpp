@@ -15,6 +15,11 @@ static const CUuid UUID_NO_SAVE_ID =
 	{{0x6b, 0x40, 0x7e, 0x81, 0x8b, 0x77, 0x3e, 0x04,
 		0xa2, 0x07, 0x8d, 0xa1, 0x7f, 0x37, 0xd0, 0x00}};
 
+float RoundTime(float Time)
+{
+	return std::round(Time * 100.0f) / 100.0f;
+}
+
 CScorePlayerResult::CScorePlayerResult()
 {
 	SetVariant(Variant::DIRECT);
@@ -170,6 +175,48 @@ bool CScoreWorker::LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGame
 	return true;
 }
 
+bool CScoreWorker::LoadLeaderboard(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
+{
+	const auto *pData = dynamic_cast<const CSqlLeaderboardRequest *>(pGameData);
+	auto *pResult = dynamic_cast<CScoreLeaderboardResult *>(pGameData->m_pResult.get());
+
+	char aServerLike[16];
+	str_format(aServerLike, sizeof(aServerLike), "%%%s%%", pData->m_aServer);
+	const char *pAny = "%";
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf),
+		"SELECT Name, MIN(Time) "
+		"FROM %s_race "
+		"WHERE Map = ? "
+		"AND Server LIKE ? "
+		"GROUP BY Name",
+		pSqlServer->GetPrefix());
+
+	for(auto *pvEntries : {&pResult->m_vGlobal, &pResult->m_vRegional})
+	{
+		if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+		{
+			return false;
+		}
+		pSqlServer->BindString(1, pData->m_aMap);
+		pSqlServer->BindString(2, pvEntries == &pResult->m_vGlobal ? pAny : aServerLike);
+
+		bool End;
+		while(pSqlServer->Step(&End, pError, ErrorSize) && !End)
+		{
+			char aName[MAX_NAME_LENGTH];
+			pSqlServer->GetString(1, aName, sizeof(aName));
+			pvEntries->push_back({pSqlServer->GetFloat(2), aName});
+		}
+		if(!End)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 // update stuff
 bool CScoreWorker::LoadPlayerData(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
@@ -617,32 +664,27 @@ bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameDat
 		"	cp1, cp2, cp3, cp4, cp5, cp6, cp7, cp8, cp9, cp10, cp11, cp12, cp13, "
 		"	cp14, cp15, cp16, cp17, cp18, cp19, cp20, cp21, cp22, cp23, cp24, cp25, "
 		"	GameId, DDNet7) "
-		"VALUES (?, ?, %s, %.2f, ?, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
-		"	%.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, "
+		"VALUES (?, ?, %s, ?, ?, "
+		"	?, ?, ?, ?, ?, ?, ?, ?, ?, "
+		"	?, ?, ?, ?, ?, ?, ?, ?, ?, "
+		"	?, ?, ?, ?, ?, ?, ?, "
 		"	?, %s)",
 		pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
 		w == Write::NORMAL ? "" : "_backup",
-		pSqlServer->InsertTimestampAsUtc(), pData->m_Time,
-		pData->m_aCurrentTimeCp[0], pData->m_aCurrentTimeCp[1], pData->m_aCurrentTimeCp[2],
-		pData->m_aCurrentTimeCp[3], pData->m_aCurrentTimeCp[4], pData->m_aCurrentTimeCp[5],
-		pData->m_aCurrentTimeCp[6], pData->m_aCurrentTimeCp[7], pData->m_aCurrentTimeCp[8],
-		pData->m_aCurrentTimeCp[9], pData->m_aCurrentTimeCp[10], pData->m_aCurrentTimeCp[11],
-		pData->m_aCurrentTimeCp[12], pData->m_aCurrentTimeCp[13], pData->m_aCurrentTimeCp[14],
-		pData->m_aCurrentTimeCp[15], pData->m_aCurrentTimeCp[16], pData->m_aCurrentTimeCp[17],
-		pData->m_aCurrentTimeCp[18], pData->m_aCurrentTimeCp[19], pData->m_aCurrentTimeCp[20],
-		pData->m_aCurrentTimeCp[21], pData->m_aCurrentTimeCp[22], pData->m_aCurrentTimeCp[23],
-		pData->m_aCurrentTimeCp[24], pSqlServer->False());
+		pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
 	if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 	{
 		return false;
 	}
-	pSqlServer->BindString(1, pData->m_aMap);
-	pSqlServer->BindString(2, pData->m_aName);
-	pSqlServer->BindString(3, pData->m_aTimestamp);
-	pSqlServer->BindString(4, g_Config.m_SvSqlServerName);
-	pSqlServer->BindString(5, pData->m_aGameUuid);
+	int Idx = 1;
+	pSqlServer->BindString(Idx++, pData->m_aMap);
+	pSqlServer->BindString(Idx++, pData->m_aName);
+	pSqlServer->BindString(Idx++, pData->m_aTimestamp);
+	pSqlServer->BindFloat(Idx++, RoundTime(pData->m_Time));
+	pSqlServer->BindString(Idx++, g_Config.m_SvSqlServerName);
+	for(float TimeCp : pData->m_aCurrentTimeCp)
+		pSqlServer->BindFloat(Idx++, RoundTime(TimeCp));
+	pSqlServer->BindString(Idx++, pData->m_aGameUuid);
 	pSqlServer->Print();
 	int NumInserted;
 	return pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize);
@@ -766,15 +808,16 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 			if(pData->m_Time < Time)
 			{
 				str_format(aBuf, sizeof(aBuf),
-					"UPDATE %s_teamrace SET Time=%.2f, Timestamp=%s, DDNet7=%s, GameId=? WHERE Id = ?",
-					pSqlServer->GetPrefix(), pData->m_Time, pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
+					"UPDATE %s_teamrace SET Time=?, Timestamp=%s, DDNet7=%s, GameId=? WHERE Id = ?",
+					pSqlServer->GetPrefix(), pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
 				if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 				{
 					return false;
 				}
-				pSqlServer->BindString(1, pData->m_aTimestamp);
-				pSqlServer->BindString(2, pData->m_aGameUuid);
-				pSqlServer->BindBlob(3, Teamrank.m_TeamId.m_aData, sizeof(Teamrank.m_TeamId.m_aData));
+				pSqlServer->BindFloat(1, RoundTime(pData->m_Time));
+				pSqlServer->BindString(2, pData->m_aTimestamp);
+				pSqlServer->BindString(3, pData->m_aGameUuid);
+				pSqlServer->BindBlob(4, Teamrank.m_TeamId.m_aData, sizeof(Teamrank.m_TeamId.m_aData));
 				pSqlServer->Print();
 				int NumUpdated;
 				if(!pSqlServer->ExecuteUpdate(&NumUpdated, pError, ErrorSize))
@@ -793,10 +836,10 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 		// if no entry found... create a new one
 		str_format(aBuf, sizeof(aBuf),
 			"%s INTO %s_teamrace%s(Map, Name, Timestamp, Time, Id, GameId, DDNet7) "
-			"VALUES (?, ?, %s, %.2f, ?, ?, %s)",
+			"VALUES (?, ?, %s, ?, ?, ?, %s)",
 			pSqlServer->InsertIgnore(), pSqlServer->GetPrefix(),
 			w == Write::NORMAL ? "" : "_backup",
-			pSqlServer->InsertTimestampAsUtc(), pData->m_Time, pSqlServer->False());
+			pSqlServer->InsertTimestampAsUtc(), pSqlServer->False());
 		if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 		{
 			return false;
@@ -804,10 +847,11 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 		pSqlServer->BindString(1, pData->m_aMap);
 		pSqlServer->BindString(2, pData->m_aaNames[i]);
 		pSqlServer->BindString(3, pData->m_aTimestamp);
+		pSqlServer->BindFloat(4, RoundTime(pData->m_Time));
 		// copy uuid, because mysql BindBlob doesn't support const buffers
 		CUuid TeamrankId = pData->m_TeamrankUuid;
-		pSqlServer->BindBlob(4, TeamrankId.m_aData, sizeof(TeamrankId.m_aData));
-		pSqlServer->BindString(5, pData->m_aGameUuid);
+		pSqlServer->BindBlob(5, TeamrankId.m_aData, sizeof(TeamrankId.m_aData));
+		pSqlServer->BindString(6, pData->m_aGameUuid);
 		pSqlServer->Print();
 		int NumInserted;
 		if(!pSqlServer->ExecuteUpdate(&NumInserted, pError, ErrorSize))
@@ -1035,10 +1079,9 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 		"  WINDOW w AS (ORDER BY MIN(Time))"
 		") as a "
 		"ORDER BY Ranking %s "
-		"LIMIT %d, ?",
+		"LIMIT ?, ?",
 		pSqlServer->GetPrefix(),
-		pOrder,
-		LimitStart);
+		pOrder);
 
 	if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 	{
@@ -1046,7 +1089,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	}
 	pSqlServer->BindString(1, pData->m_aMap);
 	pSqlServer->BindString(2, pAny);
-	pSqlServer->BindInt(3, 5);
+	pSqlServer->BindInt(3, LimitStart);
+	pSqlServer->BindInt(4, 5);
 
 	// show top
 	int Line = 0;
@@ -1084,7 +1128,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	}
 	pSqlServer->BindString(1, pData->m_aMap);
 	pSqlServer->BindString(2, aServerLike);
-	pSqlServer->BindInt(3, 3);
+	pSqlServer->BindInt(3, LimitStart);
+	pSqlServer->BindInt(4, 3);
 
 	str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
 		"------------ %s Top ------------", pData->m_aServer);
@@ -1139,18 +1184,19 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 		"  ) as l1 "
 		"  WHERE Server LIKE ? "
 		"  ORDER BY Ranking %s "
-		"  LIMIT %d, ?"
+		"  LIMIT ?, ?"
 		") as l2 "
 		"INNER JOIN %s_teamrace as r ON l2.Id = r.Id "
 		"ORDER BY Ranking %s, r.Id, Name ASC",
-		pSqlServer->GetPrefix(), pSqlServer->GetPrefix(), pOrder, LimitStart, pSqlServer->GetPrefix(), pOrder);
+		pSqlServer->GetPrefix(), pSqlServer->GetPrefix(), pOrder, pSqlServer->GetPrefix(), pOrder);
 	if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 	{
 		return false;
 	}
 	pSqlServer->BindString(1, pData->m_aMap);
 	pSqlServer->BindString(2, pAny);
-	pSqlServer->BindInt(3, 5);
+	pSqlServer->BindInt(3, LimitStart);
+	pSqlServer->BindInt(4, 5);
 
 	int Line = 0;
 	str_copy(paMessages[Line++], "------- Team Top 5 -------", sizeof(paMessages[Line]));
@@ -1183,7 +1229,8 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 	}
 	pSqlServer->BindString(1, pData->m_aMap);
 	pSqlServer->BindString(2, aServerLike);
-	pSqlServer->BindInt(3, 3);
+	pSqlServer->BindInt(3, LimitStart);
+	pSqlServer->BindInt(4, 3);
 
 	str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
 		"----- %s Team Top -----", pData->m_aServer);
@@ -1228,11 +1275,11 @@ bool CScoreWorker::ShowPlayerTeamTop5(IDbConnection *pSqlServer, const ISqlData
 		"  FROM %s_teamrace "
 		"  WHERE Map = ? AND Name = ? "
 		"  ORDER BY Time %s "
-		"  LIMIT %d, 5 "
+		"  LIMIT ?, 5 "
 		") AS l ON TeamRank.Id = l.Id "
 		"INNER JOIN %s_teamrace AS r ON l.Id = r.Id "
 		"ORDER BY Time %s, l.Id, Name ASC",
-		pSqlServer->GetPrefix(), pSqlServer->GetPrefix(), pOrder, LimitStart, pSqlServer->GetPrefix(), pOrder);
+		pSqlServer->GetPrefix(), pSqlServer->GetPrefix(), pOrder, pSqlServer->GetPrefix(), pOrder);
 	if(!pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
 	{
 		return false;
@@ -1240,6 +1287,7 @@ bool CScoreWorker::ShowPlayerTeamTop5(IDbConnection *pSqlServer, const ISqlData
 	pSqlServer->BindString(1, pData->m_aMap);
 	pSqlServer->BindString(2, pData->m_aMap);
 	pSqlServer->BindString(3, pData->m_aName);
+	pSqlServer->BindInt(4, LimitStart);
 
 	bool End;
 	if(!pSqlServer->Step(&End, pError, ErrorSize))
@@ -11,6 +11,7 @@
 #include <engine/server/databases/connection_pool.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/uuid_manager.h>
+#include <game/server/leaderboard.h>
 #include <game/server/save.h>
 #include <game/voting.h>
 
@@ -23,6 +24,9 @@ enum
 	TIMESTAMP_STR_LENGTH = 20, // 2019-04-02 19:38:36
 };
 
+// times are stored with two decimals, like when they were formatted into the query
+float RoundTime(float Time);
+
 struct CScorePlayerResult : ISqlResult
 {
 	CScorePlayerResult();
@@ -83,6 +87,24 @@ struct CSqlLoadBestTimeRequest : ISqlData
 	char m_aMap[MAX_MAP_LENGTH];
 };
 
+struct CScoreLeaderboardResult : ISqlResult
+{
+	std::vector<CLeaderboard::CEntry> m_vGlobal;
+	// times set on servers of the requested region
+	std::vector<CLeaderboard::CEntry> m_vRegional;
+};
+
+struct CSqlLeaderboardRequest : ISqlData
+{
+	CSqlLeaderboardRequest(std::shared_ptr<CScoreLeaderboardResult> pResult) :
+		ISqlData(std::move(pResult))
+	{
+	}
+
+	char m_aMap[MAX_MAP_LENGTH];
+	char m_aServer[5];
+};
+
 struct CSqlPlayerRequest : ISqlData
 {
 	CSqlPlayerRequest(std::shared_ptr<CScorePlayerResult> pResult) :
@@ -282,6 +304,7 @@ struct CTeamrank
 struct CScoreWorker
 {
 	static bool LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
+	static bool LoadLeaderboard(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 
 	static bool RandomMap(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool RandomUnfinishedMap(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
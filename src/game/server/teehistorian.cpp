@@ -1,14 +1,20 @@
 #include "teehistorian.h"
 
+#include <base/log.h>
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/shared/config.h>
 #include <engine/shared/json.h>
 #include <engine/shared/packer.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/teehistorian_ex.h>
+#include <engine/shared/teehistorian_reader.h>
 
 #include <game/gamecore.h>
 
+#include <zlib.h>
+
 class CTeehistorianPacker : public CAbstractPacker
 {
 public:
@@ -30,27 +36,14 @@ static const char TEEHISTORIAN_VERSION_MINOR[] = "11";
 #include <engine/shared/teehistorian_ex_chunks.h>
 #undef UUID
 
-enum
-{
-	TEEHISTORIAN_NONE,
-	TEEHISTORIAN_FINISH,
-	TEEHISTORIAN_TICK_SKIP,
-	TEEHISTORIAN_PLAYER_NEW,
-	TEEHISTORIAN_PLAYER_OLD,
-	TEEHISTORIAN_INPUT_DIFF,
-	TEEHISTORIAN_INPUT_NEW,
-	TEEHISTORIAN_MESSAGE,
-	TEEHISTORIAN_JOIN,
-	TEEHISTORIAN_DROP,
-	TEEHISTORIAN_CONSOLE_COMMAND,
-	TEEHISTORIAN_EX,
-};
-
 CTeeHistorian::CTeeHistorian()
 {
 	m_State = STATE_START;
 	m_pfnWriteCallback = nullptr;
 	m_pWriteCallbackUserdata = nullptr;
+	m_pfnIndexCallback = nullptr;
+	m_pIndexCallbackUserdata = nullptr;
+	m_KeyframeInterval = 0;
 }
 
 void CTeeHistorian::Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCallback, void *pUser)
@@ -79,12 +72,29 @@ void CTeeHistorian::Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCal
 	}
 	m_pfnWriteCallback = pfnWriteCallback;
 	m_pWriteCallbackUserdata = pUser;
+	m_Offset = 0;
+	m_LastKeyframeTick = -1;
 
 	WriteHeader(pGameInfo);
+	if(m_pfnIndexCallback)
+	{
+		CTeehistorianPacker Buffer;
+		Buffer.Reset();
+		CTeeHistorianIndex::PackHeader(&Buffer, pGameInfo->m_GameUuid);
+		WriteIndex(Buffer.Data(), Buffer.Size());
+	}
 
 	m_State = STATE_START;
 }
 
+void CTeeHistorian::SetIndex(int KeyframeInterval, WRITE_CALLBACK pfnIndexCallback, void *pUser)
+{
+	dbg_assert(KeyframeInterval > 0, "invalid keyframe interval");
+	m_KeyframeInterval = KeyframeInterval;
+	m_pfnIndexCallback = pfnIndexCallback;
+	m_pIndexCallbackUserdata = pUser;
+}
+
 void CTeeHistorian::WriteHeader(const CGameInfo *pGameInfo)
 {
 	Write(&TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID));
@@ -262,6 +272,11 @@ void CTeeHistorian::BeginPlayers()
 	// by not overwriting m_MaxClientId during RecordPlayer
 	m_MaxClientId = -1;
 
+	if(m_pfnIndexCallback && (m_LastKeyframeTick < 0 || m_Tick - m_LastKeyframeTick >= m_KeyframeInterval))
+	{
+		WriteKeyframe();
+	}
+
 	m_State = STATE_PLAYERS;
 }
 
@@ -394,6 +409,66 @@ void CTeeHistorian::RecordTeamPractice(int Team, bool Practice)
 void CTeeHistorian::Write(const void *pData, int DataSize)
 {
 	m_pfnWriteCallback(pData, DataSize, m_pWriteCallbackUserdata);
+	m_Offset += DataSize;
+}
+
+void CTeeHistorian::WriteKeyframe()
+{
+	CTeeHistorianIndex::CKeyframe Keyframe;
+	Keyframe.m_Tick = m_Tick;
+	Keyframe.m_StreamTick = m_LastWrittenTick;
+	Keyframe.m_Offset = m_Offset;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CTeehistorianPlayer &PrevPlayer = m_aPrevPlayers[i];
+		CTeeHistorianIndex::CPlayer &Player = Keyframe.m_aPlayers[i];
+		Player.m_Alive = PrevPlayer.m_Alive;
+		Player.m_X = PrevPlayer.m_Alive ? PrevPlayer.m_X : 0;
+		Player.m_Y = PrevPlayer.m_Alive ? PrevPlayer.m_Y : 0;
+		Player.m_Team = PrevPlayer.m_Team;
+		Player.m_HaveInput = PrevPlayer.m_UniqueClientId != 0;
+		if(Player.m_HaveInput)
+			Player.m_Input = PrevPlayer.m_Input;
+		else
+			mem_zero(&Player.m_Input, sizeof(Player.m_Input));
+		Keyframe.m_aPractice[i] = m_aPrevTeams[i].m_Practice;
+	}
+
+	CTeehistorianPacker Buffer;
+	Buffer.Reset();
+	CTeeHistorianIndex::PackKeyframe(&Buffer, &Keyframe);
+	WriteIndex(Buffer.Data(), Buffer.Size());
+	m_LastKeyframeTick = m_Tick;
+
+	if(m_Debug)
+	{
+		dbg_msg("teehistorian", "keyframe tick=%d offset=%" PRId64, m_Tick, m_Offset);
+	}
+
+	// readers start decoding at the keyframe, which needs an explicit tick
+	WriteTick();
+}
+
+void CTeeHistorian::WriteEvent(int Type, int ClientId)
+{
+	if(!m_pfnIndexCallback)
+		return;
+
+	CTeeHistorianIndex::CEvent Event;
+	Event.m_Type = Type;
+	Event.m_Tick = m_Tick;
+	Event.m_Offset = m_Offset;
+	Event.m_ClientId = ClientId;
+
+	CTeehistorianPacker Buffer;
+	Buffer.Reset();
+	CTeeHistorianIndex::PackEvent(&Buffer, &Event);
+	WriteIndex(Buffer.Data(), Buffer.Size());
+}
+
+void CTeeHistorian::WriteIndex(const void *pData, int DataSize)
+{
+	m_pfnIndexCallback(pData, DataSize, m_pIndexCallbackUserdata);
 }
 
 void CTeeHistorian::EnsureTickWritten()
@@ -511,6 +586,7 @@ void CTeeHistorian::RecordPlayerJoin(int ClientId, int Protocol)
 {
 	dbg_assert(Protocol == PROTOCOL_6 || Protocol == PROTOCOL_7, "invalid version");
 	EnsureTickWritten();
+	WriteEvent(CTeeHistorianIndex::RECORD_JOIN, ClientId);
 
 	{
 		CTeehistorianPacker Buffer;
@@ -572,6 +648,7 @@ void CTeeHistorian::RecordPlayerReady(int ClientId)
 void CTeeHistorian::RecordPlayerDrop(int ClientId, const char *pReason)
 {
 	EnsureTickWritten();
+	WriteEvent(CTeeHistorianIndex::RECORD_DROP, ClientId);
 
 	CTeehistorianPacker Buffer;
 	Buffer.Reset();
@@ -877,3 +954,166 @@ void CTeeHistorian::Finish()
 
 	Write(Buffer.Data(), Buffer.Size());
 }
+
+CTeeHistorianWriter::CTeeHistorianWriter(IOHANDLE File, int Compression, size_t MaxQueuedBytes) :
+	m_File(File),
+	m_Compression(Compression),
+	m_MaxQueuedBytes(MaxQueuedBytes),
+	m_pStream(nullptr),
+	m_Error(0),
+	m_Closing(false),
+	m_Stats{},
+	m_LastStallWarning(0)
+{
+	if(m_Compression == COMPRESSION_GZIP)
+	{
+		m_pStream = new z_stream;
+		mem_zero(m_pStream, sizeof(*m_pStream));
+		// 16 added to the window bits writes a gzip header
+		const int Result = deflateInit2(m_pStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+		dbg_assert(Result == Z_OK, "teehistorian zlib init failed with error %d", Result);
+	}
+	m_pThread = thread_init(WriterThread, this, "teehistorian");
+}
+
+CTeeHistorianWriter::~CTeeHistorianWriter()
+{
+	if(m_File)
+		Close();
+}
+
+void CTeeHistorianWriter::WriteCallback(const void *pData, int DataSize, void *pUser)
+{
+	((CTeeHistorianWriter *)pUser)->Write(pData, DataSize);
+}
+
+void CTeeHistorianWriter::Write(const void *pData, int DataSize)
+{
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	m_vFrame.insert(m_vFrame.end(), pBytes, pBytes + DataSize);
+}
+
+void CTeeHistorianWriter::EndFrame()
+{
+	if(m_vFrame.empty())
+		return;
+
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	if(m_Stats.m_QueuedBytes > m_MaxQueuedBytes)
+	{
+		// the disk can't keep up, wait instead of losing data
+		const int64_t StallStart = time_get();
+		m_DoneCond.wait(Lock, [this]() { return m_Stats.m_QueuedBytes <= m_MaxQueuedBytes; });
+		const int64_t Now = time_get();
+		m_Stats.m_NumStalls++;
+		m_Stats.m_StallTime += Now - StallStart;
+		if(!m_LastStallWarning || Now - m_LastStallWarning > 10 * time_freq())
+		{
+			m_LastStallWarning = Now;
+			log_warn("teehistorian", "writing is too slow, waited %.1fms for the queue (stalls=%d)", (Now - StallStart) * 1000.0 / time_freq(), m_Stats.m_NumStalls);
+		}
+	}
+
+	m_Stats.m_InputBytes += m_vFrame.size();
+	m_Stats.m_QueuedBytes += m_vFrame.size();
+	m_Stats.m_PeakQueuedBytes = maximum(m_Stats.m_PeakQueuedBytes, m_Stats.m_QueuedBytes);
+	m_vQueue.push_back(std::move(m_vFrame));
+	if(!m_vFreeBuffers.empty())
+	{
+		m_vFrame = std::move(m_vFreeBuffers.back());
+		m_vFreeBuffers.pop_back();
+	}
+	else
+	{
+		m_vFrame = std::vector<unsigned char>();
+	}
+	m_vFrame.clear();
+	Lock.unlock();
+	m_QueueCond.notify_one();
+}
+
+int CTeeHistorianWriter::Close()
+{
+	dbg_assert(m_File != nullptr, "teehistorian writer closed twice");
+	EndFrame();
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_Closing = true;
+	}
+	m_QueueCond.notify_one();
+	thread_wait(m_pThread);
+
+	if(m_pStream)
+	{
+		deflateEnd(m_pStream);
+		delete m_pStream;
+		m_pStream = nullptr;
+	}
+	if(io_close(m_File) != 0)
+		m_Error = 1;
+	m_File = nullptr;
+	return m_Error;
+}
+
+CTeeHistorianWriter::CStats CTeeHistorianWriter::Stats()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	return m_Stats;
+}
+
+void CTeeHistorianWriter::WriterThread(void *pUser)
+{
+	CTeeHistorianWriter *pSelf = (CTeeHistorianWriter *)pUser;
+	std::unique_lock<std::mutex> Lock(pSelf->m_Mutex);
+	while(true)
+	{
+		pSelf->m_QueueCond.wait(Lock, [pSelf]() { return !pSelf->m_vQueue.empty() || pSelf->m_Closing; });
+		if(pSelf->m_vQueue.empty())
+			break;
+		std::vector<unsigned char> vData = std::move(pSelf->m_vQueue.front());
+		pSelf->m_vQueue.pop_front();
+		Lock.unlock();
+
+		if(pSelf->m_Compression == COMPRESSION_GZIP)
+			pSelf->Compress(vData, false);
+		else
+			pSelf->WriteFile(vData.data(), vData.size());
+
+		Lock.lock();
+		pSelf->m_Stats.m_QueuedBytes -= vData.size();
+		pSelf->m_vFreeBuffers.push_back(std::move(vData));
+		pSelf->m_DoneCond.notify_one();
+	}
+	Lock.unlock();
+
+	if(pSelf->m_Compression == COMPRESSION_GZIP)
+		pSelf->Compress({}, true);
+}
+
+void CTeeHistorianWriter::Compress(const std::vector<unsigned char> &vData, bool Finish)
+{
+	unsigned char aOutput[64 * 1024];
+	m_pStream->next_in = (Bytef *)vData.data();
+	m_pStream->avail_in = vData.size();
+	// flush after every frame so that complete ticks can be decompressed
+	const int Flush = Finish ? Z_FINISH : Z_SYNC_FLUSH;
+	int Result;
+	do
+	{
+		m_pStream->next_out = aOutput;
+		m_pStream->avail_out = sizeof(aOutput);
+		Result = deflate(m_pStream, Flush);
+		dbg_assert(Result != Z_STREAM_ERROR, "teehistorian zlib compression failed");
+		WriteFile(aOutput, sizeof(aOutput) - m_pStream->avail_out);
+	} while(m_pStream->avail_out == 0 || (Finish && Result != Z_STREAM_END));
+}
+
+void CTeeHistorianWriter::WriteFile(const void *pData, size_t DataSize)
+{
+	if(DataSize == 0)
+		return;
+	if(io_write(m_File, pData, DataSize) != DataSize)
+		m_Error = 1;
+	const std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_Stats.m_OutputBytes += DataSize;
+}
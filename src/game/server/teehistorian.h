@@ -2,11 +2,17 @@
 #define GAME_SERVER_TEEHISTORIAN_H
 
 #include <base/hash.h>
+#include <base/system.h>
 #include <engine/console.h>
 #include <engine/shared/protocol.h>
 #include <game/generated/protocol.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <ctime>
+#include <deque>
+#include <mutex>
+#include <vector>
 
 class CConfig;
 class CTuningParams;
@@ -50,6 +56,9 @@ public:
 	CTeeHistorian();
 
 	void Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCallback, void *pUser);
+	// writes a `CTeeHistorianIndex` with a keyframe every `KeyframeInterval`
+	// ticks, must be set before `Reset`
+	void SetIndex(int KeyframeInterval, WRITE_CALLBACK pfnIndexCallback, void *pUser);
 	void Finish();
 
 	bool Starting() const { return m_State == STATE_START; }
@@ -103,6 +112,9 @@ private:
 	void EnsureTickWritten();
 	void WriteTick();
 	void Write(const void *pData, int DataSize);
+	void WriteKeyframe();
+	void WriteEvent(int Type, int ClientId);
+	void WriteIndex(const void *pData, int DataSize);
 
 	enum
 	{
@@ -136,6 +148,11 @@ private:
 
 	WRITE_CALLBACK m_pfnWriteCallback;
 	void *m_pWriteCallbackUserdata;
+	WRITE_CALLBACK m_pfnIndexCallback;
+	void *m_pIndexCallbackUserdata;
+	int m_KeyframeInterval;
+	int m_LastKeyframeTick;
+	int64_t m_Offset;
 
 	int m_State;
 
@@ -148,4 +165,66 @@ private:
 	CTeam m_aPrevTeams[MAX_CLIENTS];
 };
 
+// Writes the teehistorian stream to a file on a background thread,
+// optionally compressed as gzip. The data of a tick is collected and
+// handed to the thread in one frame, the compressed stream is flushed
+// after every frame so that a file cut off by a crash can still be read
+// up to the last complete tick. If the thread falls behind by more than
+// the given number of bytes, EndFrame waits for it.
+class CTeeHistorianWriter
+{
+public:
+	enum
+	{
+		COMPRESSION_NONE,
+		COMPRESSION_GZIP,
+	};
+
+	struct CStats
+	{
+		int64_t m_InputBytes;
+		int64_t m_OutputBytes;
+		size_t m_QueuedBytes;
+		size_t m_PeakQueuedBytes;
+		int m_NumStalls;
+		int64_t m_StallTime;
+	};
+
+	CTeeHistorianWriter(IOHANDLE File, int Compression, size_t MaxQueuedBytes);
+	~CTeeHistorianWriter();
+
+	// can be passed as `CTeeHistorian::WRITE_CALLBACK` with the writer as user data
+	static void WriteCallback(const void *pData, int DataSize, void *pUser);
+	void Write(const void *pData, int DataSize);
+	void EndFrame();
+	// writes the remaining data and closes the file, returns the error
+	int Close();
+
+	int Error() const { return m_Error.load(); }
+	CStats Stats();
+
+private:
+	static void WriterThread(void *pUser);
+	void Compress(const std::vector<unsigned char> &vData, bool Finish);
+	void WriteFile(const void *pData, size_t DataSize);
+
+	IOHANDLE m_File;
+	int m_Compression;
+	size_t m_MaxQueuedBytes;
+	void *m_pThread;
+	struct z_stream_s *m_pStream;
+	std::atomic_int m_Error;
+
+	std::vector<unsigned char> m_vFrame;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_QueueCond;
+	std::condition_variable m_DoneCond;
+	std::deque<std::vector<unsigned char>> m_vQueue;
+	std::vector<std::vector<unsigned char>> m_vFreeBuffers;
+	bool m_Closing;
+	CStats m_Stats;
+	int64_t m_LastStallWarning;
+};
+
 #endif // GAME_SERVER_TEEHISTORIAN_H
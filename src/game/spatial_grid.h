@@ -0,0 +1,172 @@
+#ifndef GAME_SPATIAL_GRID_H
+#define GAME_SPATIAL_GRID_H
+
+#include <base/vmath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Position of an entity in a CSpatialGrid, stored in the entity itself.
+class CSpatialGridItem
+{
+public:
+	const void *m_pGrid = nullptr;
+	int m_CellX = 0;
+	int m_CellY = 0;
+	int64_t m_Order = 0;
+};
+
+// Uniform grid over the positions of the entities of one type. The cells
+// are hashed into a fixed number of buckets, so the grid does not depend
+// on the map size. The entity type needs a CSpatialGridItem m_GridItem
+// member and the GetPos and GetProximityRadius getters.
+//
+// Query results are sorted by descending order value. The game worlds
+// use the position in their entity list as order, so that walking the
+// query result visits the entities in the same order as walking the list.
+template<typename TEntity>
+class CSpatialGrid
+{
+	enum
+	{
+		CELL_SIZE = 256,
+		NUM_BUCKETS = 512,
+		MAX_CELL = 1 << 20,
+		// larger areas are faster to check by walking the whole list
+		MAX_QUERY_CELLS = 64,
+	};
+
+	std::vector<std::vector<TEntity *>> m_vvpBuckets;
+	float m_MaxProximityRadius = 0.0f;
+	int m_NumEntities = 0;
+
+	static int CellCoord(float Value)
+	{
+		const float Cell = std::floor(Value / CELL_SIZE);
+		if(Cell != Cell) // NaN
+			return 0;
+		return (int)std::clamp(Cell, (float)-MAX_CELL, (float)MAX_CELL);
+	}
+
+	static unsigned BucketIndex(int CellX, int CellY)
+	{
+		return ((unsigned)CellX * 73856093u ^ (unsigned)CellY * 19349663u) % NUM_BUCKETS;
+	}
+
+	bool RemoveFromBucket(TEntity *pEntity)
+	{
+		const CSpatialGridItem &Item = pEntity->m_GridItem;
+		std::vector<TEntity *> &vpBucket = m_vvpBuckets[BucketIndex(Item.m_CellX, Item.m_CellY)];
+		auto It = std::find(vpBucket.begin(), vpBucket.end(), pEntity);
+		if(It == vpBucket.end())
+			return false;
+		*It = vpBucket.back();
+		vpBucket.pop_back();
+		return true;
+	}
+
+	void AddToBucket(TEntity *pEntity)
+	{
+		CSpatialGridItem &Item = pEntity->m_GridItem;
+		Item.m_CellX = CellCoord(pEntity->GetPos().x);
+		Item.m_CellY = CellCoord(pEntity->GetPos().y);
+		m_vvpBuckets[BucketIndex(Item.m_CellX, Item.m_CellY)].push_back(pEntity);
+	}
+
+public:
+	void Clear()
+	{
+		for(auto &vpBucket : m_vvpBuckets)
+			vpBucket.clear();
+		m_MaxProximityRadius = 0.0f;
+		m_NumEntities = 0;
+	}
+
+	void Insert(TEntity *pEntity, int64_t Order)
+	{
+		if(m_vvpBuckets.empty())
+			m_vvpBuckets.resize(NUM_BUCKETS);
+		Remove(pEntity);
+		pEntity->m_GridItem.m_pGrid = this;
+		pEntity->m_GridItem.m_Order = Order;
+		AddToBucket(pEntity);
+		m_MaxProximityRadius = std::max(m_MaxProximityRadius, pEntity->GetProximityRadius());
+		m_NumEntities++;
+	}
+
+	void Remove(TEntity *pEntity)
+	{
+		if(pEntity->m_GridItem.m_pGrid != this)
+			return;
+		pEntity->m_GridItem.m_pGrid = nullptr;
+		if(RemoveFromBucket(pEntity))
+			m_NumEntities--;
+	}
+
+	// must be called after the position of an entity in the grid changed
+	void Move(TEntity *pEntity)
+	{
+		const CSpatialGridItem &Item = pEntity->m_GridItem;
+		if(Item.m_pGrid != this)
+			return;
+		if(Item.m_CellX == CellCoord(pEntity->GetPos().x) && Item.m_CellY == CellCoord(pEntity->GetPos().y))
+			return;
+		if(RemoveFromBucket(pEntity))
+			AddToBucket(pEntity);
+	}
+
+	// false if the entity was moved without Move, queries would miss it
+	bool IsCellCurrent(const TEntity *pEntity) const
+	{
+		const CSpatialGridItem &Item = pEntity->m_GridItem;
+		if(Item.m_pGrid != this)
+			return true;
+		return Item.m_CellX == CellCoord(pEntity->GetPos().x) && Item.m_CellY == CellCoord(pEntity->GetPos().y);
+	}
+
+	// Finds all entities whose proximity radius might overlap the area.
+	// Returns false if the area covers too many cells, the caller has to
+	// check all entities then.
+	bool Query(vec2 Min, vec2 Max, std::vector<TEntity *> &vpResult) const
+	{
+		vpResult.clear();
+		if(m_NumEntities == 0)
+			return true;
+
+		// one extra unit against rounding in the intersection tests
+		const float Margin = m_MaxProximityRadius + 1.0f;
+		Min -= vec2(Margin, Margin);
+		Max += vec2(Margin, Margin);
+		if(!(Min.x <= Max.x) || !(Min.y <= Max.y))
+			return false;
+
+		const int MinX = CellCoord(Min.x);
+		const int MinY = CellCoord(Min.y);
+		const int MaxX = CellCoord(Max.x);
+		const int MaxY = CellCoord(Max.y);
+		if((int64_t)(MaxX - MinX + 1) * (MaxY - MinY + 1) > MAX_QUERY_CELLS)
+			return false;
+
+		for(int CellY = MinY; CellY <= MaxY; CellY++)
+		{
+			for(int CellX = MinX; CellX <= MaxX; CellX++)
+			{
+				// other cells can share the bucket
+				for(TEntity *pEntity : m_vvpBuckets[BucketIndex(CellX, CellY)])
+				{
+					if(pEntity->m_GridItem.m_CellX == CellX && pEntity->m_GridItem.m_CellY == CellY)
+						vpResult.push_back(pEntity);
+				}
+			}
+		}
+
+		std::sort(vpResult.begin(), vpResult.end(), [](const TEntity *pA, const TEntity *pB) {
+			return pA->m_GridItem.m_Order > pB->m_GridItem.m_Order;
+		});
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "state_hash.h"
+
+#include <game/gamecore.h>
+#include <game/teamscore.h>
+
+void CStateHash::AddCharacterCore(const CCharacterCore &Core)
+{
+	CNetObj_CharacterCore Net = {};
+	Core.Write(&Net);
+	AddData(&Net, sizeof(Net));
+
+	const bool aFlags[] = {
+		Core.m_Solo,
+		Core.m_Jetpack,
+		Core.m_CollisionDisabled,
+		Core.m_EndlessHook,
+		Core.m_EndlessJump,
+		Core.m_HammerHitDisabled,
+		Core.m_GrenadeHitDisabled,
+		Core.m_LaserHitDisabled,
+		Core.m_ShotgunHitDisabled,
+		Core.m_HookHitDisabled,
+		Core.m_Super,
+		Core.m_Invincible,
+		Core.m_HasTelegunGun,
+		Core.m_HasTelegunGrenade,
+		Core.m_HasTelegunLaser,
+		Core.m_IsInFreeze,
+		Core.m_DeepFrozen,
+		Core.m_LiveFrozen,
+	};
+	for(bool Flag : aFlags)
+		Add(Flag);
+	for(const auto &Weapon : Core.m_aWeapons)
+		Add(Weapon.m_Got);
+	// the snapshot only has the ammo of the active weapon
+	Add(Core.m_ActiveWeapon);
+	if(Core.m_ActiveWeapon >= 0 && Core.m_ActiveWeapon < NUM_WEAPONS)
+		Add(Core.m_aWeapons[Core.m_ActiveWeapon].m_Ammo);
+	Add(Core.m_FreezeStart);
+	Add(Core.m_FreezeEnd);
+	Add(Core.m_Jumps);
+	Add(Core.m_JumpedTotal);
+	Add(Core.m_Ninja.m_ActivationTick);
+}
+
+void CStateHash::AddSwitchers(const std::vector<SSwitchers> &vSwitchers)
+{
+	Add(vSwitchers.size());
+	for(const SSwitchers &Switcher : vSwitchers)
+	{
+		// m_aLastUpdateTick only tells the client when the snapshot changed it
+		Add(Switcher.m_Initial);
+		for(int Team = 0; Team < NUM_DDRACE_TEAMS; Team++)
+		{
+			Add(Switcher.m_aStatus[Team]);
+			Add(Switcher.m_aEndTick[Team]);
+			Add(Switcher.m_aType[Team]);
+		}
+	}
+}
+
+void CStateHash::AddTeams(const CTeamsCore &Teams)
+{
+	Add(Teams.m_IsDDRace16);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		Add(Teams.Team(i));
+		Add(Teams.GetSolo(i));
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef GAME_STATE_HASH_H
+#define GAME_STATE_HASH_H
+
+#include <base/vmath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+class CCharacterCore;
+class CTeamsCore;
+struct SSwitchers;
+
+// 64-bit FNV-1a over game state, to check that two simulations ended up
+// the same. Floats are hashed by their bits.
+class CStateHash
+{
+	uint64_t m_Hash = 0xcbf29ce484222325ull;
+
+public:
+	void AddData(const void *pData, size_t Size)
+	{
+		const unsigned char *pBytes = (const unsigned char *)pData;
+		for(size_t i = 0; i < Size; i++)
+			m_Hash = (m_Hash ^ pBytes[i]) * 0x100000001b3ull;
+	}
+
+	template<typename T>
+	void Add(const T &Value)
+	{
+		static_assert(std::is_arithmetic_v<T>, "only hash values without padding");
+		AddData(&Value, sizeof(Value));
+	}
+
+	void Add(vec2 Value)
+	{
+		Add(Value.x);
+		Add(Value.y);
+	}
+
+	// the core state that the character and ddnet character snapshot items carry
+	void AddCharacterCore(const CCharacterCore &Core);
+	void AddSwitchers(const std::vector<SSwitchers> &vSwitchers);
+	void AddTeams(const CTeamsCore &Teams);
+
+	uint64_t Hash() const { return m_Hash; }
+};
+
+#endif // GAME_STATE_HASH_H
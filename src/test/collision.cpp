@@ -0,0 +1,658 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+#include <engine/map.h>
+#include <engine/shared/config.h>
+#include <engine/shared/datafile.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <random>
+#include <string>
+
+// The per-pixel implementations the intersect functions had before they
+// skipped tiles. The results must stay exactly the same.
+
+static int RefIntersectLine(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+
+		if(Collision.CheckPoint(ix, iy))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Collision.GetCollisionAt(ix, iy);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int RefIntersectLineTeleHook(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	int dx = 0, dy = 0;
+	ThroughOffset(Pos0, Pos1, &dx, &dy);
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+
+		int Index = Collision.GetPureMapIndex(Pos);
+		if(g_Config.m_SvOldTeleportHook)
+			*pTeleNr = Collision.IsTeleport(Index);
+		else
+			*pTeleNr = Collision.IsTeleportHook(Index);
+		if(*pTeleNr)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return TILE_TELEINHOOK;
+		}
+
+		int hit = 0;
+		if(Collision.CheckPoint(ix, iy))
+		{
+			if(!Collision.IsThrough(ix, iy, dx, dy, Pos0, Pos1))
+				hit = Collision.GetCollisionAt(ix, iy);
+		}
+		else if(Collision.IsHookBlocker(ix, iy, Pos0, Pos1))
+		{
+			hit = TILE_NOHOOK;
+		}
+		if(hit)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return hit;
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int RefIntersectLineTeleWeapon(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+
+		int Index = Collision.GetPureMapIndex(Pos);
+		if(g_Config.m_SvOldTeleportWeapons)
+			*pTeleNr = Collision.IsTeleport(Index);
+		else
+			*pTeleNr = Collision.IsTeleportWeapon(Index);
+		if(*pTeleNr)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return TILE_TELEINWEAPON;
+		}
+
+		if(Collision.CheckPoint(ix, iy))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Collision.GetCollisionAt(ix, iy);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int RefIntersectNoLaser(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float d = distance(Pos0, Pos1);
+	vec2 Last = Pos0;
+	for(int i = 0, id = std::ceil(d); i < id; i++)
+	{
+		float a = i / d;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int Nx = std::clamp(round_to_int(Pos.x) / 32, 0, Collision.GetWidth() - 1);
+		int Ny = std::clamp(round_to_int(Pos.y) / 32, 0, Collision.GetHeight() - 1);
+		if(Collision.GetIndex(Nx, Ny) == TILE_SOLID || Collision.GetIndex(Nx, Ny) == TILE_NOHOOK || Collision.GetIndex(Nx, Ny) == TILE_NOLASER || Collision.GetFrontIndex(Nx, Ny) == TILE_NOLASER)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			if(Collision.GetFrontIndex(Nx, Ny) == TILE_NOLASER)
+				return Collision.GetFrontCollisionAt(Pos.x, Pos.y);
+			else
+				return Collision.GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int RefIntersectNoLaserNoWalls(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float d = distance(Pos0, Pos1);
+	vec2 Last = Pos0;
+	for(int i = 0, id = std::ceil(d); i < id; i++)
+	{
+		float a = (float)i / d;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+		if(Collision.IsNoLaser(ix, iy) || Collision.IsFrontNoLaser(ix, iy))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			if(Collision.IsNoLaser(ix, iy))
+				return Collision.GetCollisionAt(Pos.x, Pos.y);
+			else
+				return Collision.GetFrontCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int RefIntersectAir(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float d = distance(Pos0, Pos1);
+	vec2 Last = Pos0;
+	for(int i = 0, id = std::ceil(d); i < id; i++)
+	{
+		float a = (float)i / d;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+		if(Collision.IsSolid(ix, iy) || (!Collision.GetTile(ix, iy) && !Collision.GetFrontTile(ix, iy)))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			if(!Collision.GetTile(ix, iy) && !Collision.GetFrontTile(ix, iy))
+				return -1;
+			else if(!Collision.GetTile(ix, iy))
+				return Collision.GetTile(ix, iy);
+			else
+				return Collision.GetFrontTile(ix, iy);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static std::vector<int> RefGetMapIndices(const CCollision &Collision, vec2 PrevPos, vec2 Pos)
+{
+	std::vector<int> vIndices;
+	float d = distance(PrevPos, Pos);
+	int End(d + 1);
+	if(!d)
+	{
+		int Nx = std::clamp((int)Pos.x / 32, 0, Collision.GetWidth() - 1);
+		int Ny = std::clamp((int)Pos.y / 32, 0, Collision.GetHeight() - 1);
+		int Index = Ny * Collision.GetWidth() + Nx;
+		if(Collision.TileExists(Index))
+			vIndices.push_back(Index);
+		return vIndices;
+	}
+	int LastIndex = 0;
+	for(int i = 0; i < End; i++)
+	{
+		float a = i / d;
+		vec2 Tmp = mix(PrevPos, Pos, a);
+		int Nx = std::clamp((int)Tmp.x / 32, 0, Collision.GetWidth() - 1);
+		int Ny = std::clamp((int)Tmp.y / 32, 0, Collision.GetHeight() - 1);
+		int Index = Ny * Collision.GetWidth() + Nx;
+		if(Collision.TileExists(Index) && LastIndex != Index)
+		{
+			vIndices.push_back(Index);
+			LastIndex = Index;
+		}
+	}
+	return vIndices;
+}
+
+static bool RefIsThrough(const CCollision &Collision, int x, int y, int OffsetX, int OffsetY, vec2 Pos0, vec2 Pos1)
+{
+	const CTile *pTiles = Collision.GameLayer();
+	const CTile *pFront = Collision.FrontLayer();
+	int pos = Collision.GetPureMapIndex(x, y);
+	if(pFront && (pFront[pos].m_Index == TILE_THROUGH_ALL || pFront[pos].m_Index == TILE_THROUGH_CUT))
+		return true;
+	if(pFront && pFront[pos].m_Index == TILE_THROUGH_DIR && ((pFront[pos].m_Flags == ROTATION_0 && Pos0.y > Pos1.y) || (pFront[pos].m_Flags == ROTATION_90 && Pos0.x < Pos1.x) || (pFront[pos].m_Flags == ROTATION_180 && Pos0.y < Pos1.y) || (pFront[pos].m_Flags == ROTATION_270 && Pos0.x > Pos1.x)))
+		return true;
+	int offpos = Collision.GetPureMapIndex(x + OffsetX, y + OffsetY);
+	return pTiles[offpos].m_Index == TILE_THROUGH || (pFront && pFront[offpos].m_Index == TILE_THROUGH);
+}
+
+static bool RefIsHookBlocker(const CCollision &Collision, int x, int y, vec2 Pos0, vec2 Pos1)
+{
+	const CTile *pTiles = Collision.GameLayer();
+	const CTile *pFront = Collision.FrontLayer();
+	int pos = Collision.GetPureMapIndex(x, y);
+	if(pTiles[pos].m_Index == TILE_THROUGH_ALL || (pFront && pFront[pos].m_Index == TILE_THROUGH_ALL))
+		return true;
+	if(pTiles[pos].m_Index == TILE_THROUGH_DIR && ((pTiles[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) || (pTiles[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) || (pTiles[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) || (pTiles[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
+		return true;
+	if(pFront && pFront[pos].m_Index == TILE_THROUGH_DIR && ((pFront[pos].m_Flags == ROTATION_0 && Pos0.y < Pos1.y) || (pFront[pos].m_Flags == ROTATION_90 && Pos0.x > Pos1.x) || (pFront[pos].m_Flags == ROTATION_180 && Pos0.y > Pos1.y) || (pFront[pos].m_Flags == ROTATION_270 && Pos0.x < Pos1.x)))
+		return true;
+	return false;
+}
+
+// Compares the checks that use the collision flags with the layers, on
+// every tile of the map.
+static void ExpectFlagsMatchLayers(const CCollision &Collision)
+{
+	const CTile *pTiles = Collision.GameLayer();
+	const CTile *pFront = Collision.FrontLayer();
+	const CTeleTile *pTele = Collision.TeleLayer();
+	const CSpeedupTile *pSpeedup = Collision.SpeedupLayer();
+	const vec2 aDirections[] = {vec2(1, 0), vec2(-1, 0), vec2(0, 1), vec2(0, -1)};
+
+	for(int Ny = 0; Ny < Collision.GetHeight(); Ny++)
+	{
+		for(int Nx = 0; Nx < Collision.GetWidth(); Nx++)
+		{
+			const int Index = Ny * Collision.GetWidth() + Nx;
+			const int x = Nx * 32 + 16;
+			const int y = Ny * 32 + 16;
+			const int Flags = Collision.GetColFlags(Index);
+			const int GameIndex = pTiles[Index].m_Index;
+			const int FrontIndex = pFront ? pFront[Index].m_Index : (int)TILE_AIR;
+			SCOPED_TRACE(testing::Message() << "tile " << Nx << ", " << Ny);
+
+			const int Tile = Collision.GetTile(x, y);
+			EXPECT_EQ(Collision.IsSolid(x, y), Tile == TILE_SOLID || Tile == TILE_NOHOOK);
+			EXPECT_EQ(Collision.IsNoLaser(x, y), Tile == TILE_NOLASER);
+			EXPECT_EQ(Collision.IsFrontNoLaser(x, y), Collision.GetFrontTile(x, y) == TILE_NOLASER);
+			EXPECT_EQ((Flags & COLFLAG_NOHOOK) != 0, GameIndex == TILE_NOHOOK);
+			EXPECT_EQ((Flags & COLFLAG_DEATH) != 0, GameIndex == TILE_DEATH || FrontIndex == TILE_DEATH);
+			EXPECT_EQ((Flags & COLFLAG_FREEZE) != 0, GameIndex == TILE_FREEZE || GameIndex == TILE_DFREEZE || GameIndex == TILE_LFREEZE || FrontIndex == TILE_FREEZE || FrontIndex == TILE_DFREEZE || FrontIndex == TILE_LFREEZE);
+
+			const int TeleType = pTele ? pTele[Index].m_Type : 0;
+			const int TeleNumber = pTele ? pTele[Index].m_Number : 0;
+			EXPECT_EQ(Collision.IsTeleport(Index), TeleType == TILE_TELEIN ? TeleNumber : 0);
+			EXPECT_EQ(Collision.IsTeleportWeapon(Index), TeleType == TILE_TELEINWEAPON ? TeleNumber : 0);
+			EXPECT_EQ(Collision.IsTeleportHook(Index), TeleType == TILE_TELEINHOOK ? TeleNumber : 0);
+			EXPECT_EQ(Collision.IsSpeedup(Index), pSpeedup && pSpeedup[Index].m_Force > 0 ? Index : 0);
+
+			for(vec2 Direction : aDirections)
+			{
+				const vec2 Pos0(x, y);
+				const vec2 Pos1 = Pos0 + Direction * 32.0f;
+				int dx, dy;
+				ThroughOffset(Pos0, Pos1, &dx, &dy);
+				EXPECT_EQ(Collision.IsThrough(x, y, dx, dy, Pos0, Pos1), RefIsThrough(Collision, x, y, dx, dy, Pos0, Pos1));
+				EXPECT_EQ(Collision.IsHookBlocker(x, y, Pos0, Pos1), RefIsHookBlocker(Collision, x, y, Pos0, Pos1));
+			}
+			if(::testing::Test::HasFailure())
+				return;
+		}
+	}
+}
+
+static void AddTileLayer(CDataFileWriter &Writer, int Id, int Width, int Height, int Flags, int Data, int TeleData, int FrontData)
+{
+	CMapItemLayerTilemap Layer;
+	mem_zero(&Layer, sizeof(Layer));
+	Layer.m_Layer.m_Type = LAYERTYPE_TILES;
+	Layer.m_Version = 3;
+	Layer.m_Width = Width;
+	Layer.m_Height = Height;
+	Layer.m_Flags = Flags;
+	Layer.m_ColorEnv = -1;
+	Layer.m_Image = -1;
+	Layer.m_Data = Data;
+	Layer.m_Tele = TeleData;
+	Layer.m_Speedup = -1;
+	Layer.m_Front = FrontData;
+	Layer.m_Switch = -1;
+	Layer.m_Tune = -1;
+	Writer.AddItem(MAPITEMTYPE_LAYER, Id, sizeof(Layer), &Layer);
+}
+
+// Writes a map with random game, front and tele layers. Most tiles are
+// empty so that lines travel through several tiles before hitting.
+static void WriteRandomMap(IStorage *pStorage, const char *pFilename, int Width, int Height, std::mt19937 &Rng)
+{
+	static const int s_aGameTiles[] = {TILE_SOLID, TILE_DEATH, TILE_NOHOOK, TILE_NOLASER, TILE_THROUGH_CUT, TILE_THROUGH, TILE_THROUGH_ALL, TILE_THROUGH_DIR, TILE_FREEZE, TILE_UNFREEZE};
+	static const int s_aFrontTiles[] = {TILE_DEATH, TILE_NOLASER, TILE_THROUGH_CUT, TILE_THROUGH, TILE_THROUGH_ALL, TILE_THROUGH_DIR};
+	static const int s_aTeleTypes[] = {TILE_TELEIN, TILE_TELEINEVIL, TILE_TELEINWEAPON, TILE_TELEINHOOK};
+	std::uniform_int_distribution<int> Percent(0, 99);
+
+	std::vector<CTile> vGame(Width * Height);
+	std::vector<CTile> vFront(Width * Height);
+	std::vector<CTeleTile> vTele(Width * Height);
+	for(int i = 0; i < Width * Height; i++)
+	{
+		mem_zero(&vGame[i], sizeof(vGame[i]));
+		mem_zero(&vFront[i], sizeof(vFront[i]));
+		mem_zero(&vTele[i], sizeof(vTele[i]));
+		if(Percent(Rng) < 12)
+		{
+			vGame[i].m_Index = s_aGameTiles[Rng() % std::size(s_aGameTiles)];
+			vGame[i].m_Flags = (Rng() % 4) * ROTATION_90;
+		}
+		if(Percent(Rng) < 5)
+		{
+			vFront[i].m_Index = s_aFrontTiles[Rng() % std::size(s_aFrontTiles)];
+			vFront[i].m_Flags = (Rng() % 4) * ROTATION_90;
+		}
+		if(Percent(Rng) < 2)
+		{
+			vTele[i].m_Type = s_aTeleTypes[Rng() % std::size(s_aTeleTypes)];
+			vTele[i].m_Number = 1 + Rng() % 5;
+		}
+	}
+
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, pFilename));
+
+	CMapItemVersion Version;
+	Version.m_Version = 1;
+	Writer.AddItem(MAPITEMTYPE_VERSION, 0, sizeof(Version), &Version);
+
+	CMapItemGroup_v1 Group;
+	mem_zero(&Group, sizeof(Group));
+	Group.m_Version = 1;
+	Group.m_ParallaxX = 100;
+	Group.m_ParallaxY = 100;
+	Group.m_NumLayers = 3;
+	Writer.AddItem(MAPITEMTYPE_GROUP, 0, sizeof(Group), &Group);
+
+	const int GameData = Writer.AddData(vGame.size() * sizeof(CTile), vGame.data());
+	const int FrontData = Writer.AddData(vFront.size() * sizeof(CTile), vFront.data());
+	const int TeleData = Writer.AddData(vTele.size() * sizeof(CTeleTile), vTele.data());
+	// tile data of the entity layers is unused, but has to be there
+	const int EmptyData = Writer.AddData(vFront.size() * sizeof(CTile), std::vector<CTile>(vFront.size()).data());
+
+	AddTileLayer(Writer, 0, Width, Height, TILESLAYERFLAG_GAME, GameData, -1, -1);
+	AddTileLayer(Writer, 1, Width, Height, TILESLAYERFLAG_FRONT, EmptyData, -1, FrontData);
+	AddTileLayer(Writer, 2, Width, Height, TILESLAYERFLAG_TELE, EmptyData, TeleData, -1);
+
+	Writer.Finish();
+}
+
+class CollisionIntersect : public ::testing::Test
+{
+protected:
+	std::unique_ptr<IStorage> m_pStorage;
+	CTestInfo m_Info;
+	std::unique_ptr<IEngineMap> m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+	std::mt19937 m_Rng{0};
+
+	CollisionIntersect() :
+		m_pStorage(CreateLocalStorage()),
+		m_pMap(CreateEngineMap())
+	{
+	}
+
+	void SetUp() override
+	{
+		ASSERT_NE(m_pStorage, nullptr);
+		WriteRandomMap(m_pStorage.get(), m_Info.m_aFilename, 60, 45, m_Rng);
+		CDataFileReader Reader;
+		ASSERT_TRUE(m_pMap->Prepare(m_pStorage.get(), m_Info.m_aFilename, &Reader, false));
+		m_pMap->LoadPrepared(std::move(Reader));
+		m_Layers.Init(m_pMap.get(), false);
+		ASSERT_NE(m_Layers.FrontLayer(), nullptr);
+		ASSERT_NE(m_Layers.TeleLayer(), nullptr);
+		m_Collision.Init(&m_Layers);
+	}
+
+	void TearDown() override
+	{
+		m_Collision.Unload();
+		m_pMap->Unload();
+		if(!HasFailure())
+			m_pStorage->RemoveFile(m_Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+
+	// Random coordinate, often placed around tile borders and map edges.
+	float RandomCoordinate(int Tiles)
+	{
+		switch(m_Rng() % 4)
+		{
+		case 0:
+			return std::uniform_real_distribution<float>(-200.0f, Tiles * 32 + 200.0f)(m_Rng);
+		case 1:
+		{
+			static const float s_aBorderOffsets[] = {-1.5f, -0.5f, -0.25f, 0.0f, 0.25f, 0.5f, 1.5f};
+			return (int)(m_Rng() % (Tiles + 3) - 1) * 32 + s_aBorderOffsets[m_Rng() % std::size(s_aBorderOffsets)];
+		}
+		case 2:
+			return std::uniform_real_distribution<float>(-5000.0f, 5000.0f)(m_Rng);
+		default:
+			return (int)(m_Rng() % (Tiles * 32));
+		}
+	}
+
+	void RandomLine(vec2 *pPos0, vec2 *pPos1)
+	{
+		*pPos0 = vec2(RandomCoordinate(m_Collision.GetWidth()), RandomCoordinate(m_Collision.GetHeight()));
+		switch(m_Rng() % 4)
+		{
+		case 0:
+			// axis aligned
+			*pPos1 = *pPos0;
+			if(m_Rng() % 2)
+				pPos1->x = RandomCoordinate(m_Collision.GetWidth());
+			else
+				pPos1->y = RandomCoordinate(m_Collision.GetHeight());
+			break;
+		case 1:
+			// short, like a single tick of movement
+			*pPos1 = *pPos0 + vec2(std::uniform_real_distribution<float>(-40.0f, 40.0f)(m_Rng), std::uniform_real_distribution<float>(-40.0f, 40.0f)(m_Rng));
+			break;
+		default:
+			*pPos1 = vec2(RandomCoordinate(m_Collision.GetWidth()), RandomCoordinate(m_Collision.GetHeight()));
+		}
+	}
+};
+
+TEST_F(CollisionIntersect, Line)
+{
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 Pos0, Pos1;
+		RandomLine(&Pos0, &Pos1);
+		vec2 Col, Before, RefCol, RefBefore;
+		int Result = m_Collision.IntersectLine(Pos0, Pos1, &Col, &Before);
+		int RefResult = RefIntersectLine(m_Collision, Pos0, Pos1, &RefCol, &RefBefore);
+		ASSERT_EQ(Result, RefResult) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+		ASSERT_EQ(Col, RefCol);
+		ASSERT_EQ(Before, RefBefore);
+	}
+}
+
+TEST_F(CollisionIntersect, LineTeleHook)
+{
+	for(int OldTeleportHook = 0; OldTeleportHook <= 1; OldTeleportHook++)
+	{
+		g_Config.m_SvOldTeleportHook = OldTeleportHook;
+		for(int i = 0; i < 20000; i++)
+		{
+			vec2 Pos0, Pos1;
+			RandomLine(&Pos0, &Pos1);
+			vec2 Col, Before, RefCol, RefBefore;
+			int TeleNr = -1, RefTeleNr = -1;
+			int Result = m_Collision.IntersectLineTeleHook(Pos0, Pos1, &Col, &Before, &TeleNr);
+			int RefResult = RefIntersectLineTeleHook(m_Collision, Pos0, Pos1, &RefCol, &RefBefore, &RefTeleNr);
+			ASSERT_EQ(Result, RefResult) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+			ASSERT_EQ(TeleNr, RefTeleNr);
+			ASSERT_EQ(Col, RefCol);
+			ASSERT_EQ(Before, RefBefore);
+		}
+	}
+	g_Config.m_SvOldTeleportHook = 0;
+}
+
+TEST_F(CollisionIntersect, LineTeleWeapon)
+{
+	for(int OldTeleportWeapons = 0; OldTeleportWeapons <= 1; OldTeleportWeapons++)
+	{
+		g_Config.m_SvOldTeleportWeapons = OldTeleportWeapons;
+		for(int i = 0; i < 20000; i++)
+		{
+			vec2 Pos0, Pos1;
+			RandomLine(&Pos0, &Pos1);
+			vec2 Col, Before, RefCol, RefBefore;
+			int TeleNr = -1, RefTeleNr = -1;
+			int Result = m_Collision.IntersectLineTeleWeapon(Pos0, Pos1, &Col, &Before, &TeleNr);
+			int RefResult = RefIntersectLineTeleWeapon(m_Collision, Pos0, Pos1, &RefCol, &RefBefore, &RefTeleNr);
+			ASSERT_EQ(Result, RefResult) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+			ASSERT_EQ(TeleNr, RefTeleNr);
+			ASSERT_EQ(Col, RefCol);
+			ASSERT_EQ(Before, RefBefore);
+		}
+	}
+	g_Config.m_SvOldTeleportWeapons = 0;
+}
+
+TEST_F(CollisionIntersect, Laser)
+{
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 Pos0, Pos1;
+		RandomLine(&Pos0, &Pos1);
+		vec2 Col, Before, RefCol, RefBefore;
+
+		int Result = m_Collision.IntersectNoLaser(Pos0, Pos1, &Col, &Before);
+		int RefResult = RefIntersectNoLaser(m_Collision, Pos0, Pos1, &RefCol, &RefBefore);
+		ASSERT_EQ(Result, RefResult) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+		ASSERT_EQ(Col, RefCol);
+		ASSERT_EQ(Before, RefBefore);
+
+		Result = m_Collision.IntersectNoLaserNoWalls(Pos0, Pos1, &Col, &Before);
+		RefResult = RefIntersectNoLaserNoWalls(m_Collision, Pos0, Pos1, &RefCol, &RefBefore);
+		ASSERT_EQ(Result, RefResult) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+		ASSERT_EQ(Col, RefCol);
+		ASSERT_EQ(Before, RefBefore);
+	}
+}
+
+TEST_F(CollisionIntersect, Air)
+{
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 Pos0, Pos1;
+		RandomLine(&Pos0, &Pos1);
+		vec2 Col, Before, RefCol, RefBefore;
+		int Result = m_Collision.IntersectAir(Pos0, Pos1, &Col, &Before);
+		int RefResult = RefIntersectAir(m_Collision, Pos0, Pos1, &RefCol, &RefBefore);
+		ASSERT_EQ(Result, RefResult) << "from (" << Pos0.x << ", " << Pos0.y << ") to (" << Pos1.x << ", " << Pos1.y << ")";
+		ASSERT_EQ(Col, RefCol);
+		ASSERT_EQ(Before, RefBefore);
+	}
+}
+
+TEST_F(CollisionIntersect, MapIndices)
+{
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 PrevPos, Pos;
+		RandomLine(&PrevPos, &Pos);
+		if(i % 10 == 0)
+			PrevPos = Pos;
+		std::vector<int> vIndices;
+		int NumIndices = m_Collision.ForEachMapIndex(PrevPos, Pos, [&](int Index) {
+			vIndices.push_back(Index);
+			return true;
+		});
+		std::vector<int> vRefIndices = RefGetMapIndices(m_Collision, PrevPos, Pos);
+		ASSERT_EQ(vIndices, vRefIndices) << "from (" << PrevPos.x << ", " << PrevPos.y << ") to (" << Pos.x << ", " << Pos.y << ")";
+		ASSERT_EQ(NumIndices, (int)vRefIndices.size());
+
+		// stopping early visits a prefix
+		if(vRefIndices.size() >= 2)
+		{
+			int Stop = 1 + m_Rng() % (vRefIndices.size() - 1);
+			vIndices.clear();
+			NumIndices = m_Collision.ForEachMapIndex(PrevPos, Pos, [&](int Index) {
+				vIndices.push_back(Index);
+				return (int)vIndices.size() < Stop;
+			});
+			EXPECT_EQ(NumIndices, Stop);
+			ASSERT_EQ(vIndices, std::vector<int>(vRefIndices.begin(), vRefIndices.begin() + Stop));
+		}
+	}
+}
+
+TEST_F(CollisionIntersect, Flags)
+{
+	ExpectFlagsMatchLayers(m_Collision);
+
+	// flags follow tiles changed by lasers
+	m_Collision.SetCollisionAt(16, 16, TILE_SOLID);
+	EXPECT_TRUE(m_Collision.IsSolid(16, 16));
+	m_Collision.SetCollisionAt(16, 16, TILE_NOLASER);
+	EXPECT_FALSE(m_Collision.IsSolid(16, 16));
+	EXPECT_TRUE(m_Collision.IsNoLaser(16, 16));
+	ExpectFlagsMatchLayers(m_Collision);
+}
+
+TEST(CollisionFlags, BundledMaps)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage = Info.CreateTestStorage();
+	ASSERT_NE(pStorage, nullptr);
+
+	std::vector<std::string> vMaps;
+	pStorage->ListDirectory(
+		IStorage::TYPE_ALL, "maps", [](const char *pName, int IsDir, int DirType, void *pUser) {
+			if(!IsDir && str_endswith(pName, ".map"))
+				static_cast<std::vector<std::string> *>(pUser)->emplace_back(pName);
+			return 0;
+		},
+		&vMaps);
+	ASSERT_FALSE(vMaps.empty());
+
+	for(const std::string &Map : vMaps)
+	{
+		SCOPED_TRACE(Map);
+		char aPath[IO_MAX_PATH_LENGTH];
+		str_format(aPath, sizeof(aPath), "maps/%s", Map.c_str());
+		std::unique_ptr<IEngineMap> pMap(CreateEngineMap());
+		CDataFileReader Reader;
+		ASSERT_TRUE(pMap->Prepare(pStorage.get(), aPath, &Reader, false));
+		pMap->LoadPrepared(std::move(Reader));
+
+		CLayers Layers;
+		Layers.Init(pMap.get(), false);
+		CCollision Collision;
+		Collision.Init(&Layers);
+		ExpectFlagsMatchLayers(Collision);
+		ASSERT_FALSE(HasFailure());
+	}
+}
@@ -0,0 +1,147 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/server/databases/connection.h>
+#include <engine/server/databases/connection_pool.h>
+#include <engine/shared/config.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+class CTestPoolResult : public ISqlResult
+{
+};
+
+class CTestPoolData : public ISqlData
+{
+public:
+	CTestPoolData(std::shared_ptr<CTestPoolResult> pResult, int Index) :
+		ISqlData(std::move(pResult)), m_Index(Index)
+	{
+	}
+	int m_Index;
+};
+
+class DbConnectionPool : public ::testing::Test
+{
+public:
+	CTestInfo m_Info;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+
+	// the pool reads these from the global config, restored afterwards
+	int m_SavedReadWorkers;
+	int m_SavedBatchSize;
+	int m_SavedBatchWindow;
+
+	static std::atomic_bool ms_FastReadDone;
+	static std::mutex ms_WriteMutex;
+	static std::vector<int> ms_vWrites;
+
+	DbConnectionPool()
+	{
+		m_Info.Filename(m_aFilename, sizeof(m_aFilename), ".sqlite");
+		m_SavedReadWorkers = g_Config.m_SvSqlReadWorkers;
+		m_SavedBatchSize = g_Config.m_SvSqlBatchSize;
+		m_SavedBatchWindow = g_Config.m_SvSqlBatchWindow;
+		g_Config.m_SvSqlReadWorkers = 2;
+		g_Config.m_SvSqlBatchSize = 4;
+		g_Config.m_SvSqlBatchWindow = 0;
+		ms_FastReadDone = false;
+		ms_vWrites.clear();
+	}
+
+	~DbConnectionPool()
+	{
+		g_Config.m_SvSqlReadWorkers = m_SavedReadWorkers;
+		g_Config.m_SvSqlBatchSize = m_SavedBatchSize;
+		g_Config.m_SvSqlBatchWindow = m_SavedBatchWindow;
+		for(const char *pSuffix : {"", "-wal", "-shm"})
+		{
+			char aBuf[IO_MAX_PATH_LENGTH];
+			str_format(aBuf, sizeof(aBuf), "%s%s", m_aFilename, pSuffix);
+			fs_remove(aBuf);
+		}
+	}
+
+	// waits until the read was done by another worker
+	static bool SlowRead(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
+	{
+		for(int i = 0; i < 1000 && !ms_FastReadDone; i++)
+			std::this_thread::sleep_for(10ms);
+		str_copy(pError, "fast read didn't run in parallel", ErrorSize);
+		return ms_FastReadDone;
+	}
+
+	static bool FastRead(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
+	{
+		ms_FastReadDone = true;
+		return true;
+	}
+
+	static bool RecordWrite(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+	{
+		const auto *pData = dynamic_cast<const CTestPoolData *>(pGameData);
+		std::unique_lock<std::mutex> Lock(ms_WriteMutex);
+		ms_vWrites.push_back(pData->m_Index);
+		return true;
+	}
+
+	static bool WaitFor(const std::shared_ptr<CTestPoolResult> &pResult)
+	{
+		for(int i = 0; i < 1000 && !pResult->m_Completed; i++)
+			std::this_thread::sleep_for(10ms);
+		return pResult->m_Completed;
+	}
+};
+
+std::atomic_bool DbConnectionPool::ms_FastReadDone;
+std::mutex DbConnectionPool::ms_WriteMutex;
+std::vector<int> DbConnectionPool::ms_vWrites;
+
+TEST_F(DbConnectionPool, ParallelReads)
+{
+	CDbConnectionPool Pool;
+	Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, m_aFilename);
+
+	auto pSlowResult = std::make_shared<CTestPoolResult>();
+	auto pFastResult = std::make_shared<CTestPoolResult>();
+	Pool.Execute(SlowRead, std::make_unique<CTestPoolData>(pSlowResult, 0), "slow read");
+	Pool.Execute(FastRead, std::make_unique<CTestPoolData>(pFastResult, 1), "fast read");
+
+	ASSERT_TRUE(WaitFor(pFastResult));
+	EXPECT_TRUE(pFastResult->m_Success);
+	ASSERT_TRUE(WaitFor(pSlowResult));
+	EXPECT_TRUE(pSlowResult->m_Success);
+	Pool.OnShutdown();
+}
+
+TEST_F(DbConnectionPool, WriteOrder)
+{
+	CDbConnectionPool Pool;
+	Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, m_aFilename);
+
+	const int NumWrites = 20;
+	std::vector<std::shared_ptr<CTestPoolResult>> vpResults;
+	for(int i = 0; i < NumWrites; i++)
+	{
+		vpResults.push_back(std::make_shared<CTestPoolResult>());
+		// mix batched and single writes
+		Pool.ExecuteWrite(RecordWrite, std::make_unique<CTestPoolData>(vpResults.back(), i), "record write", i % 5 != 0);
+	}
+	for(const auto &pResult : vpResults)
+	{
+		ASSERT_TRUE(WaitFor(pResult));
+		EXPECT_TRUE(pResult->m_Success);
+	}
+	Pool.OnShutdown();
+
+	ASSERT_EQ(ms_vWrites.size(), (size_t)NumWrites);
+	for(int i = 0; i < NumWrites; i++)
+		EXPECT_EQ(ms_vWrites[i], i);
+}
@@ -2,6 +2,8 @@
 #include <gtest/gtest.h>
 #include <memory>
 
+#include <base/system.h>
+
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 #include <game/mapitems_ex.h>
@@ -109,3 +111,66 @@ TEST(Datafile, StringData)
 		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
 	}
 }
+
+TEST(Datafile, Mapped)
+{
+	std::unique_ptr<IStorage> pStorage = CreateLocalStorage();
+	ASSERT_NE(pStorage, nullptr) << "Error creating local storage";
+
+	CTestInfo Info;
+
+	char aData[4096];
+	for(int i = 0; i < (int)sizeof(aData); i++)
+		aData[i] = i % 7;
+
+	{
+		CDataFileWriter Writer;
+		ASSERT_TRUE(Writer.Open(pStorage.get(), Info.m_aFilename));
+
+		EXPECT_EQ(Writer.AddData(sizeof(aData), aData), 0);
+		EXPECT_EQ(Writer.AddDataString("Abc"), 1);
+
+		Writer.Finish();
+	}
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+		CDataFileReader MappedReader;
+		ASSERT_TRUE(MappedReader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL, true));
+
+		EXPECT_EQ(Reader.MappedFile(), nullptr);
+		ASSERT_NE(MappedReader.MappedFile(), nullptr);
+		EXPECT_EQ(MappedReader.MapSize(), Reader.MapSize());
+		EXPECT_EQ(MappedReader.Sha256(), Reader.Sha256());
+		EXPECT_EQ(MappedReader.Crc(), Reader.Crc());
+
+		// the mapping is the file itself
+		void *pFile;
+		unsigned FileSize;
+		ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_ALL, &pFile, &FileSize));
+		ASSERT_EQ(FileSize, (unsigned)MappedReader.MapSize());
+		EXPECT_EQ(mem_comp(MappedReader.MappedFile(), pFile, FileSize), 0);
+		free(pFile);
+
+		ASSERT_EQ(MappedReader.NumData(), 2);
+		ASSERT_EQ(MappedReader.GetDataSize(0), (int)sizeof(aData));
+		EXPECT_EQ(mem_comp(MappedReader.GetData(0), aData, sizeof(aData)), 0);
+		EXPECT_STREQ(MappedReader.GetDataString(1), "Abc");
+
+		MappedReader.UnloadData(0);
+		EXPECT_EQ(mem_comp(MappedReader.GetData(0), aData, sizeof(aData)), 0);
+		char *pReplaced = (char *)malloc(4);
+		str_copy(pReplaced, "Def", 4);
+		MappedReader.ReplaceData(1, pReplaced, 4);
+		EXPECT_STREQ(MappedReader.GetDataString(1), "Def");
+
+		Reader.Close();
+		MappedReader.Close();
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
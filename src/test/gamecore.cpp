@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <game/gamecore.h>
+
+#include <random>
+#include <vector>
+
+static bool InRange(vec2 Pos, vec2 From, vec2 To, float Range)
+{
+	return Pos.x >= minimum(From.x, To.x) - Range && Pos.x <= maximum(From.x, To.x) + Range &&
+	       Pos.y >= minimum(From.y, To.y) - Range && Pos.y <= maximum(From.y, To.y) + Range;
+}
+
+TEST(WorldCore, CharactersNear)
+{
+	CWorldCore World;
+	std::vector<CCharacterCore> vCores(2 * MAX_CLIENTS);
+	std::mt19937 Rng(0);
+	std::uniform_real_distribution<float> Coordinate(-500.0f, 3000.0f);
+	std::uniform_real_distribution<float> Offset(-40.0f, 40.0f);
+
+	for(int Round = 0; Round < 5000; Round++)
+	{
+		// characters join, leave, move and teleport between the queries
+		for(int n = 0; n < 20; n++)
+		{
+			const int i = Rng() % MAX_CLIENTS;
+			CCharacterCore &Core = vCores[i + (Rng() % 2) * MAX_CLIENTS];
+			switch(Rng() % 5)
+			{
+			case 0:
+				World.m_apCharacters[i] = nullptr;
+				break;
+			case 1:
+				Core.m_Pos = vec2(Coordinate(Rng), Coordinate(Rng));
+				World.m_apCharacters[i] = &Core;
+				break;
+			case 2:
+			case 3:
+				if(World.m_apCharacters[i])
+					World.m_apCharacters[i]->m_Pos += vec2(Offset(Rng), Offset(Rng));
+				break;
+			case 4:
+				if(World.m_apCharacters[i])
+					World.m_apCharacters[i]->m_Pos = vec2(Rng() % 2 ? 1e9f : -1e9f, Coordinate(Rng));
+				break;
+			}
+		}
+
+		const vec2 From(Coordinate(Rng), Coordinate(Rng));
+		const vec2 To = Rng() % 2 ? From : From + vec2(Offset(Rng), Offset(Rng)) * 10.0f;
+		const float Range = Rng() % 100;
+		const std::bitset<MAX_CLIENTS> Candidates = World.CharactersNear(From, To, Range);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(World.m_apCharacters[i] && InRange(World.m_apCharacters[i]->m_Pos, From, To, Range))
+			{
+				ASSERT_TRUE(Candidates[i]) << "round " << Round << ", character " << i;
+			}
+		}
+	}
+}
+
+TEST(WorldCore, CharactersNearSelective)
+{
+	CWorldCore World;
+	std::vector<CCharacterCore> vCores(MAX_CLIENTS);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		vCores[i].m_Pos = vec2((i % 16) * 1000.0f, (i / 16) * 1000.0f);
+		World.m_apCharacters[i] = &vCores[i];
+	}
+
+	const std::bitset<MAX_CLIENTS> Candidates = World.CharactersNear(vec2(5000.0f, 3000.0f), vec2(5000.0f, 3000.0f), 50.0f);
+	EXPECT_TRUE(Candidates[3 * 16 + 5]);
+	EXPECT_LT(Candidates.count(), 8u);
+
+	// a huge box or a position far out can't be narrowed down
+	EXPECT_TRUE(World.CharactersNear(vec2(0.0f, 0.0f), vec2(1e6f, 1e6f), 0.0f).all());
+	EXPECT_TRUE(World.CharactersNear(vec2(1e9f, 0.0f), vec2(1e9f, 0.0f), 0.0f).all());
+}
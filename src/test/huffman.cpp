@@ -3,6 +3,9 @@
 #include <base/system.h>
 #include <engine/shared/huffman.h>
 
+#include <algorithm>
+#include <random>
+
 TEST(Huffman, CompressionShouldNotChangeData)
 {
 	CHuffman Huffman;
@@ -46,3 +49,278 @@ TEST(Huffman, CompressionCompatible)
 	EXPECT_EQ(match, 0) << "The compression is not compatible with older/other implementations anymore";
 	EXPECT_EQ(Size, 15);
 }
+
+// The byte-at-a-time implementation that CHuffman replaced, the new one
+// must produce exactly the same output and return values.
+class CReferenceHuffman
+{
+	enum
+	{
+		HUFFMAN_EOF_SYMBOL = 256,
+		HUFFMAN_MAX_SYMBOLS = HUFFMAN_EOF_SYMBOL + 1,
+		HUFFMAN_MAX_NODES = HUFFMAN_MAX_SYMBOLS * 2 - 1,
+		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTSIZE = (1 << HUFFMAN_LUTBITS),
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1)
+	};
+
+	struct CNode
+	{
+		unsigned m_Bits;
+		unsigned m_NumBits;
+		unsigned short m_aLeafs[2];
+		unsigned char m_Symbol;
+	};
+
+	struct CConstructNode
+	{
+		unsigned short m_NodeId;
+		int m_Frequency;
+	};
+
+	CNode m_aNodes[HUFFMAN_MAX_NODES] = {};
+	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE] = {};
+	CNode *m_pStartNode;
+	int m_NumNodes;
+
+	void Setbits_r(CNode *pNode, int Bits, unsigned Depth)
+	{
+		if(pNode->m_aLeafs[1] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeafs[1]], Bits | (1 << Depth), Depth + 1);
+		if(pNode->m_aLeafs[0] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeafs[0]], Bits, Depth + 1);
+		if(pNode->m_NumBits)
+		{
+			pNode->m_Bits = Bits;
+			pNode->m_NumBits = Depth;
+		}
+	}
+
+public:
+	CReferenceHuffman()
+	{
+		CConstructNode aNodesLeftStorage[HUFFMAN_MAX_SYMBOLS];
+		CConstructNode *apNodesLeft[HUFFMAN_MAX_SYMBOLS];
+		int NumNodesLeft = HUFFMAN_MAX_SYMBOLS;
+		for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+		{
+			m_aNodes[i].m_NumBits = 0xFFFFFFFF;
+			m_aNodes[i].m_Symbol = i;
+			m_aNodes[i].m_aLeafs[0] = 0xffff;
+			m_aNodes[i].m_aLeafs[1] = 0xffff;
+			aNodesLeftStorage[i].m_Frequency = i == HUFFMAN_EOF_SYMBOL ? 1 : CHuffman::ms_aFreqTable[i];
+			aNodesLeftStorage[i].m_NodeId = i;
+			apNodesLeft[i] = &aNodesLeftStorage[i];
+		}
+		m_NumNodes = HUFFMAN_MAX_SYMBOLS;
+		while(NumNodesLeft > 1)
+		{
+			std::stable_sort(apNodesLeft, apNodesLeft + NumNodesLeft, [](const CConstructNode *pNode1, const CConstructNode *pNode2) {
+				return pNode2->m_Frequency < pNode1->m_Frequency;
+			});
+			m_aNodes[m_NumNodes].m_NumBits = 0;
+			m_aNodes[m_NumNodes].m_aLeafs[0] = apNodesLeft[NumNodesLeft - 1]->m_NodeId;
+			m_aNodes[m_NumNodes].m_aLeafs[1] = apNodesLeft[NumNodesLeft - 2]->m_NodeId;
+			apNodesLeft[NumNodesLeft - 2]->m_NodeId = m_NumNodes;
+			apNodesLeft[NumNodesLeft - 2]->m_Frequency = apNodesLeft[NumNodesLeft - 1]->m_Frequency + apNodesLeft[NumNodesLeft - 2]->m_Frequency;
+			m_NumNodes++;
+			NumNodesLeft--;
+		}
+		m_pStartNode = &m_aNodes[m_NumNodes - 1];
+		Setbits_r(m_pStartNode, 0, 0);
+
+		for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
+		{
+			unsigned Bits = i;
+			int k;
+			CNode *pNode = m_pStartNode;
+			for(k = 0; k < HUFFMAN_LUTBITS; k++)
+			{
+				pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+				Bits >>= 1;
+				if(pNode->m_NumBits)
+				{
+					m_apDecodeLut[i] = pNode;
+					break;
+				}
+			}
+			if(k == HUFFMAN_LUTBITS)
+				m_apDecodeLut[i] = pNode;
+		}
+	}
+
+	int Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
+	{
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned char *pDst = (unsigned char *)pOutput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+		auto &&LoadSymbol = [&](int Symbol) {
+			Bits |= m_aNodes[Symbol].m_Bits << Bitcount;
+			Bitcount += m_aNodes[Symbol].m_NumBits;
+		};
+		auto &&Write = [&]() {
+			while(Bitcount >= 8)
+			{
+				*pDst++ = (unsigned char)(Bits & 0xff);
+				if(pDst == pDstEnd)
+					return false;
+				Bits >>= 8;
+				Bitcount -= 8;
+			}
+			return true;
+		};
+		while(pSrc != pSrcEnd)
+		{
+			LoadSymbol(*pSrc++);
+			if(!Write())
+				return -1;
+		}
+		LoadSymbol(HUFFMAN_EOF_SYMBOL);
+		if(!Write())
+			return -1;
+		*pDst++ = Bits;
+		return (int)(pDst - (const unsigned char *)pOutput);
+	}
+
+	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
+	{
+		unsigned char *pDst = (unsigned char *)pOutput;
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+		const CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
+		while(true)
+		{
+			while(Bitcount < 24 && pSrc != pSrcEnd)
+			{
+				Bits |= (*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
+			const CNode *pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
+			if(pNode->m_NumBits)
+			{
+				Bits >>= pNode->m_NumBits;
+				Bitcount -= pNode->m_NumBits;
+			}
+			else
+			{
+				Bits >>= HUFFMAN_LUTBITS;
+				Bitcount -= HUFFMAN_LUTBITS;
+				while(true)
+				{
+					pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+					Bitcount--;
+					Bits >>= 1;
+					if(pNode->m_NumBits)
+						break;
+					if(Bitcount == 0)
+						return -1;
+				}
+			}
+			if(pNode == pEof)
+				break;
+			if(pDst == pDstEnd)
+				return -1;
+			*pDst++ = pNode->m_Symbol;
+		}
+		return (int)(pDst - (const unsigned char *)pOutput);
+	}
+};
+
+// Mostly zeros and small numbers like in snapshot deltas, sometimes
+// arbitrary bytes.
+static void FillPayload(std::mt19937 &Rng, unsigned char *pData, int Size)
+{
+	const bool Uniform = Rng() % 4 == 0;
+	for(int i = 0; i < Size; i++)
+	{
+		if(Uniform)
+			pData[i] = Rng();
+		else
+			pData[i] = Rng() % 3 ? 0 : Rng() % 8 ? Rng() % 64 : Rng();
+	}
+}
+
+TEST(Huffman, CompressMatchesReference)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	static CReferenceHuffman s_Reference;
+	std::mt19937 Rng(1);
+
+	unsigned char aInput[1500];
+	unsigned char aCompressed[4096];
+	unsigned char aExpected[4096];
+	for(int Run = 0; Run < 2000; Run++)
+	{
+		const int InputSize = Rng() % (sizeof(aInput) + 1);
+		FillPayload(Rng, aInput, InputSize);
+
+		// sometimes make the output buffer too small
+		const int OutputSize = Run % 2 ? sizeof(aCompressed) : 1 + Rng() % (InputSize + 4);
+		const int Size = Huffman.Compress(aInput, InputSize, aCompressed, OutputSize);
+		const int ExpectedSize = s_Reference.Compress(aInput, InputSize, aExpected, OutputSize);
+		ASSERT_EQ(Size, ExpectedSize) << "InputSize=" << InputSize << " OutputSize=" << OutputSize;
+		if(Size > 0)
+		{
+			ASSERT_EQ(mem_comp(aCompressed, aExpected, Size), 0);
+		}
+	}
+}
+
+TEST(Huffman, DecompressMatchesReference)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	static CReferenceHuffman s_Reference;
+	std::mt19937 Rng(2);
+
+	unsigned char aInput[1500];
+	unsigned char aCompressed[4096];
+	unsigned char aDecompressed[2048];
+	unsigned char aExpected[2048];
+	for(int Run = 0; Run < 4000; Run++)
+	{
+		const int InputSize = Rng() % (sizeof(aInput) + 1);
+		FillPayload(Rng, aInput, InputSize);
+		int CompressedSize = Huffman.Compress(aInput, InputSize, aCompressed, sizeof(aCompressed));
+		ASSERT_GT(CompressedSize, 0);
+
+		// valid data, truncated data, data with flipped bits and garbage
+		switch(Run % 4)
+		{
+		case 1:
+			CompressedSize = Rng() % (CompressedSize + 1);
+			break;
+		case 2:
+			for(int i = 0; i < 3; i++)
+				aCompressed[Rng() % CompressedSize] ^= 1 << (Rng() % 8);
+			break;
+		case 3:
+			CompressedSize = Rng() % 64;
+			for(int i = 0; i < CompressedSize; i++)
+				aCompressed[i] = Rng();
+			break;
+		}
+
+		// sometimes make the output buffer too small
+		const int OutputSize = Run % 8 < 6 ? sizeof(aDecompressed) : Rng() % (InputSize + 8);
+		const int Size = Huffman.Decompress(aCompressed, CompressedSize, aDecompressed, OutputSize);
+		const int ExpectedSize = s_Reference.Decompress(aCompressed, CompressedSize, aExpected, OutputSize);
+		ASSERT_EQ(Size, ExpectedSize) << "Run=" << Run << " CompressedSize=" << CompressedSize << " OutputSize=" << OutputSize;
+		if(Size > 0)
+		{
+			ASSERT_EQ(mem_comp(aDecompressed, aExpected, Size), 0);
+		}
+		if(Run % 4 == 0 && OutputSize >= InputSize)
+		{
+			ASSERT_EQ(Size, InputSize);
+			ASSERT_EQ(mem_comp(aDecompressed, aInput, InputSize), 0);
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/server/leaderboard.h>
+
+#include <random>
+
+TEST(Leaderboard, Empty)
+{
+	CLeaderboard Leaderboard;
+	EXPECT_EQ(Leaderboard.NumEntries(), 0);
+	EXPECT_EQ(Leaderboard.BestTime(), 0.0f);
+	EXPECT_FALSE(Leaderboard.Time("nameless tee").has_value());
+	EXPECT_EQ(Leaderboard.Rank(10.0f), 1);
+}
+
+TEST(Leaderboard, Load)
+{
+	CLeaderboard Leaderboard;
+	Leaderboard.Load({{30.0f, "b"}, {20.0f, "a"}, {10.0f, "b"}, {20.0f, "c"}});
+	ASSERT_EQ(Leaderboard.NumEntries(), 3);
+	EXPECT_EQ(Leaderboard.Entry(0).m_Name, "b");
+	EXPECT_EQ(Leaderboard.Entry(1).m_Name, "a");
+	EXPECT_EQ(Leaderboard.Entry(2).m_Name, "c");
+	EXPECT_EQ(Leaderboard.BestTime(), 10.0f);
+	EXPECT_EQ(Leaderboard.Time("b"), 10.0f);
+}
+
+TEST(Leaderboard, SharedRank)
+{
+	CLeaderboard Leaderboard;
+	Leaderboard.Load({{10.0f, "a"}, {20.0f, "b"}, {20.0f, "c"}, {30.0f, "d"}});
+	EXPECT_EQ(Leaderboard.RankOfEntry(0), 1);
+	EXPECT_EQ(Leaderboard.RankOfEntry(1), 2);
+	EXPECT_EQ(Leaderboard.RankOfEntry(2), 2);
+	EXPECT_EQ(Leaderboard.RankOfEntry(3), 4);
+}
+
+TEST(Leaderboard, Insert)
+{
+	CLeaderboard Leaderboard;
+	EXPECT_TRUE(Leaderboard.Insert("a", 20.0f));
+	EXPECT_TRUE(Leaderboard.Insert("b", 30.0f));
+	EXPECT_FALSE(Leaderboard.Insert("b", 40.0f));
+	EXPECT_FALSE(Leaderboard.Insert("b", 30.0f));
+	EXPECT_EQ(Leaderboard.Rank(*Leaderboard.Time("b")), 2);
+
+	EXPECT_TRUE(Leaderboard.Insert("b", 10.0f));
+	ASSERT_EQ(Leaderboard.NumEntries(), 2);
+	EXPECT_EQ(Leaderboard.Entry(0).m_Name, "b");
+	EXPECT_EQ(Leaderboard.BestTime(), 10.0f);
+	EXPECT_EQ(Leaderboard.Rank(*Leaderboard.Time("a")), 2);
+}
+
+TEST(Leaderboard, Random)
+{
+	std::mt19937 Rng(0);
+	std::uniform_int_distribution<int> NameDist(0, 49);
+	std::uniform_int_distribution<int> TimeDist(1, 100);
+
+	CLeaderboard Leaderboard;
+	std::vector<float> vBestTimes(50, 0.0f);
+	for(int i = 0; i < 1000; i++)
+	{
+		int Player = NameDist(Rng);
+		float Time = TimeDist(Rng);
+		char aName[16];
+		str_format(aName, sizeof(aName), "%d", Player);
+		bool Better = vBestTimes[Player] == 0.0f || Time < vBestTimes[Player];
+		EXPECT_EQ(Leaderboard.Insert(aName, Time), Better);
+		if(Better)
+			vBestTimes[Player] = Time;
+	}
+
+	for(int Player = 0; Player < 50; Player++)
+	{
+		char aName[16];
+		str_format(aName, sizeof(aName), "%d", Player);
+		ASSERT_EQ(Leaderboard.Time(aName), vBestTimes[Player]);
+		int Rank = 1;
+		for(float Time : vBestTimes)
+			Rank += Time < vBestTimes[Player];
+		EXPECT_EQ(Leaderboard.Rank(vBestTimes[Player]), Rank);
+	}
+	for(int i = 1; i < Leaderboard.NumEntries(); i++)
+		EXPECT_LE(Leaderboard.Entry(i - 1).m_Time, Leaderboard.Entry(i).m_Time);
+}
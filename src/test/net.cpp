@@ -2,7 +2,10 @@
 
 #include <base/system.h>
 
+#include <engine/shared/network.h>
+
 #include <chrono>
+#include <memory>
 
 using namespace std::chrono_literals;
 
@@ -52,3 +55,100 @@ TEST(Net, Ipv4AndIpv6Work)
 	net_udp_close(Socket1);
 	net_udp_close(Socket2);
 }
+
+TEST(Net, SendBatchKeepsOrder)
+{
+	NETADDR Bindaddr = {};
+	NETSOCKET Socket1;
+	NETSOCKET Socket2;
+
+	Bindaddr.type = NETTYPE_IPV4;
+	Socket2 = net_udp_create(Bindaddr);
+	do
+	{
+		Bindaddr.port = secure_rand() % 64511 + 1024;
+	} while(!(Socket1 = net_udp_create(Bindaddr)));
+
+	NETADDR Target;
+	ASSERT_FALSE(net_addr_from_str(&Target, "127.0.0.1"));
+	Target.port = Bindaddr.port;
+
+	// more packets than fit into one batch, the last one is sent directly
+	const int NumPackets = 150;
+	for(int i = 0; i < NumPackets - 1; i++)
+		EXPECT_EQ(net_udp_send_batch(Socket2, &Target, &i, sizeof(i)), (int)sizeof(i));
+	const int Last = NumPackets - 1;
+	EXPECT_EQ(net_udp_send(Socket2, &Target, &Last, sizeof(Last)), (int)sizeof(Last));
+	net_udp_flush(Socket2);
+
+	NETADDR Addr;
+	unsigned char *pData;
+	for(int i = 0; i < NumPackets; i++)
+	{
+		while(true)
+		{
+			int Bytes = net_udp_recv(Socket1, &Addr, &pData);
+			if(Bytes > 0)
+			{
+				ASSERT_EQ(Bytes, (int)sizeof(i));
+				int Received;
+				mem_copy(&Received, pData, sizeof(Received));
+				EXPECT_EQ(Received, i);
+				break;
+			}
+			ASSERT_EQ(net_socket_read_wait(Socket1, 10s), 1);
+		}
+	}
+
+	net_udp_close(Socket1);
+	net_udp_close(Socket2);
+}
+
+TEST(Net, ServerRecvThread)
+{
+	CNetBase::Init();
+
+	NETADDR Bindaddr = {};
+	Bindaddr.type = NETTYPE_IPV4;
+	NETSOCKET Client = net_udp_create(Bindaddr);
+	ASSERT_TRUE(Client);
+
+	std::unique_ptr<CNetServer> pServer = std::make_unique<CNetServer>();
+	CNetServer &Server = *pServer;
+	do
+	{
+		Bindaddr.port = secure_rand() % 64511 + 1024;
+	} while(!Server.Open(Bindaddr, nullptr, 1, 1, true));
+
+	NETADDR Target;
+	ASSERT_FALSE(net_addr_from_str(&Target, "127.0.0.1"));
+	Target.port = Bindaddr.port;
+
+	// invalid packets are dropped by the receive thread
+	const unsigned char aGarbage[] = {0xff, 0xff};
+	net_udp_send(Client, &Target, aGarbage, sizeof(aGarbage));
+	const int NumPackets = 50;
+	for(int i = 0; i < NumPackets; i++)
+		CNetBase::SendPacketConnless(Client, &Target, &i, sizeof(i), false, nullptr);
+
+	CNetChunk Chunk;
+	SECURITY_TOKEN ResponseToken = NET_SECURITY_TOKEN_UNKNOWN;
+	int Received = 0;
+	while(Received < NumPackets && Server.Wait(10s))
+	{
+		while(Server.Recv(&Chunk, &ResponseToken))
+		{
+			EXPECT_EQ(Chunk.m_ClientId, -1);
+			ASSERT_EQ(Chunk.m_DataSize, (int)sizeof(Received));
+			int Value;
+			mem_copy(&Value, Chunk.m_pData, sizeof(Value));
+			EXPECT_EQ(Value, Received);
+			Received++;
+		}
+	}
+	EXPECT_EQ(Received, NumPackets);
+	EXPECT_FALSE(Server.Wait(10ms));
+
+	Server.Close();
+	net_udp_close(Client);
+}
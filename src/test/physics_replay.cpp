@@ -0,0 +1,300 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/map.h>
+#include <engine/shared/config.h>
+#include <engine/shared/datafile.h>
+#include <engine/shared/teehistorian_reader.h>
+#include <engine/shared/uuid_manager.h>
+#include <engine/storage.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+#include <game/physics_replay.h>
+#include <game/server/teehistorian.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+class PhysicsReplay : public ::testing::Test
+{
+protected:
+	enum
+	{
+		NUM_TICKS = 600,
+		NUM_PLAYERS = 8,
+	};
+
+	CTestInfo m_Info;
+	std::unique_ptr<IStorage> m_pStorage;
+	std::unique_ptr<IEngineMap> m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	std::vector<unsigned char> m_vBuffer;
+	// recorded characters after every tick, nullptr if not alive
+	std::vector<std::vector<std::unique_ptr<CNetObj_CharacterCore>>> m_vvRecorded;
+	int m_NumHooked = 0;
+
+	static void Write(const void *pData, int DataSize, void *pUser)
+	{
+		std::vector<unsigned char> &vBuffer = *(std::vector<unsigned char> *)pUser;
+		vBuffer.insert(vBuffer.end(), (const unsigned char *)pData, (const unsigned char *)pData + DataSize);
+	}
+
+	void SetUp() override
+	{
+		m_Info.m_DeleteTestStorageFilesOnSuccess = true;
+		m_pStorage = m_Info.CreateTestStorage();
+		ASSERT_NE(m_pStorage, nullptr);
+		m_pMap = std::unique_ptr<IEngineMap>(CreateEngineMap());
+		CDataFileReader Reader;
+		ASSERT_TRUE(m_pMap->Prepare(m_pStorage.get(), "maps/coverage.map", &Reader, false));
+		m_pMap->LoadPrepared(std::move(Reader));
+		m_Layers.Init(m_pMap.get(), true);
+		m_Collision.Init(&m_Layers);
+		Record();
+	}
+
+	void TearDown() override
+	{
+		m_Collision.Unload();
+		m_pMap->Unload();
+	}
+
+	// simulates close characters and records them like the server does
+	void Record()
+	{
+		std::mt19937 Rng(0);
+		std::vector<vec2> vSpawns;
+		const vec2 Size = CCharacterCore::PhysicalSizeVec2();
+		vec2 Center;
+		do
+			Center = vec2(Rng() % (m_Collision.GetWidth() * 32), Rng() % (m_Collision.GetHeight() * 32));
+		while(m_Collision.TestBox(Center, Size));
+		while(vSpawns.size() < NUM_PLAYERS)
+		{
+			const vec2 Pos = Center + vec2((int)(Rng() % 300) - 150, (int)(Rng() % 300) - 150);
+			if(!m_Collision.TestBox(Pos, Size))
+				vSpawns.push_back(Pos);
+		}
+
+		CUuidManager UuidManager;
+		CTuningParams Tuning;
+		CTeeHistorian::CGameInfo GameInfo;
+		mem_zero(&GameInfo, sizeof(GameInfo));
+		GameInfo.m_GameUuid = CalculateUuid("physics-replay-test@ddnet.tw");
+		GameInfo.m_pServerVersion = "DDNet test";
+		GameInfo.m_pPrngDescription = "";
+		GameInfo.m_pServerName = "";
+		GameInfo.m_pGameType = "";
+		GameInfo.m_pMapName = "coverage";
+		GameInfo.m_pConfig = &g_Config;
+		GameInfo.m_pTuning = &Tuning;
+		GameInfo.m_pUuids = &UuidManager;
+		CTeeHistorian TeeHistorian;
+		TeeHistorian.Reset(&GameInfo, Write, &m_vBuffer);
+
+		CWorldCore World;
+		CTeamsCore Teams;
+		std::vector<CCharacterCore> vCores(NUM_PLAYERS);
+		m_vvRecorded.resize(NUM_TICKS + 1);
+		for(int Tick = 1; Tick <= NUM_TICKS; Tick++)
+		{
+			for(CCharacterCore *pCore : World.m_apCharacters)
+				if(pCore)
+					pCore->Tick(true);
+			for(CCharacterCore *pCore : World.m_apCharacters)
+			{
+				if(pCore)
+				{
+					pCore->Move();
+					pCore->Quantize();
+					m_NumHooked += pCore->HookedPlayer() != -1;
+				}
+			}
+
+			// players spawn one after another, the last one dies for a while
+			for(int i = 0; i < NUM_PLAYERS; i++)
+			{
+				const bool Alive = Tick >= 10 + i * 5 && (i != NUM_PLAYERS - 1 || Tick < 200 || Tick >= 260);
+				if(!Alive)
+				{
+					World.m_apCharacters[i] = nullptr;
+				}
+				else if(!World.m_apCharacters[i])
+				{
+					vCores[i].Init(&World, &m_Collision, &Teams);
+					vCores[i].m_Id = i;
+					vCores[i].Reset();
+					vCores[i].m_ActiveWeapon = WEAPON_GUN;
+					vCores[i].m_Pos = vSpawns[i];
+					World.m_apCharacters[i] = &vCores[i];
+				}
+			}
+
+			TeeHistorian.BeginTick(Tick);
+			TeeHistorian.BeginPlayers();
+			m_vvRecorded[Tick].resize(NUM_PLAYERS);
+			if(Tick == 100)
+			{
+				// the first two players play in their own team and don't collide with the others
+				Teams.Team(0, 1);
+				Teams.Team(1, 1);
+				TeeHistorian.RecordPlayerTeam(0, 1);
+				TeeHistorian.RecordPlayerTeam(1, 1);
+			}
+			for(int i = 0; i < NUM_PLAYERS; i++)
+			{
+				if(World.m_apCharacters[i])
+				{
+					m_vvRecorded[Tick][i] = std::make_unique<CNetObj_CharacterCore>();
+					World.m_apCharacters[i]->Write(m_vvRecorded[Tick][i].get());
+					TeeHistorian.RecordPlayer(i, m_vvRecorded[Tick][i].get());
+				}
+				else
+				{
+					TeeHistorian.RecordDeadPlayer(i);
+				}
+			}
+			TeeHistorian.EndPlayers();
+
+			TeeHistorian.BeginInputs();
+			for(int i = 0; i < NUM_PLAYERS; i++)
+			{
+				if(!World.m_apCharacters[i])
+					continue;
+				// run around and hook the next player
+				CNetObj_PlayerInput Input = {};
+				Input.m_Direction = (i + Tick / 40) % 3 - 1;
+				Input.m_Jump = (Tick + i) % 30 < 2;
+				Input.m_Hook = (Tick + i * 7) % 50 < 35;
+				const CCharacterCore *pTarget = World.m_apCharacters[(i + 1) % NUM_PLAYERS];
+				const vec2 Target = pTarget ? pTarget->m_Pos - vCores[i].m_Pos : vec2(0.0f, -1.0f);
+				Input.m_TargetX = (int)Target.x;
+				Input.m_TargetY = Input.m_TargetX == 0 && (int)Target.y == 0 ? -1 : (int)Target.y;
+				TeeHistorian.RecordPlayerInput(i, i + 1, &Input);
+				vCores[i].m_Input = Input;
+			}
+			TeeHistorian.EndInputs();
+			TeeHistorian.EndTick();
+		}
+		TeeHistorian.Finish();
+	}
+
+	CPhysicsTrace ReplayTrace(CTeeHistorianReader &Reader)
+	{
+		CPhysicsTrace Trace;
+		CPhysicsReplay Replay(&m_Collision, &Reader);
+		while(Replay.Tick())
+			Trace.Add(Replay.GameTick(), Replay.StateHash());
+		EXPECT_TRUE(Reader.Finished());
+		EXPECT_FALSE(Reader.Error());
+		return Trace;
+	}
+};
+
+TEST_F(PhysicsReplay, MatchesRecording)
+{
+	ASSERT_GT(m_NumHooked, 0);
+	CTeeHistorianReader Reader;
+	ASSERT_TRUE(Reader.Open(m_vBuffer.data(), m_vBuffer.size()));
+	CPhysicsReplay Replay(&m_Collision, &Reader);
+
+	// the ticks without players are skipped
+	int ExpectedTick = 10;
+	while(Replay.Tick())
+	{
+		ASSERT_EQ(Replay.GameTick(), ExpectedTick);
+		int NumAlive = 0;
+		for(int i = 0; i < NUM_PLAYERS; i++)
+		{
+			const CNetObj_CharacterCore *pRecorded = m_vvRecorded[ExpectedTick][i].get();
+			const CCharacterCore *pCharacter = Replay.Character(i);
+			ASSERT_EQ(pCharacter != nullptr, pRecorded != nullptr) << "tick=" << ExpectedTick << " cid=" << i;
+			if(!pRecorded)
+				continue;
+			NumAlive++;
+			CNetObj_CharacterCore Replayed = {};
+			pCharacter->Write(&Replayed);
+			ASSERT_EQ(mem_comp(&Replayed, pRecorded, sizeof(Replayed)), 0) << "tick=" << ExpectedTick << " cid=" << i;
+		}
+		EXPECT_EQ(Replay.NumCharacters(), NumAlive);
+		ExpectedTick++;
+	}
+	EXPECT_EQ(ExpectedTick, NUM_TICKS + 1);
+	EXPECT_TRUE(Reader.Finished());
+	EXPECT_FALSE(Reader.Error());
+}
+
+TEST_F(PhysicsReplay, Deterministic)
+{
+	CTeeHistorianReader Reader;
+	ASSERT_TRUE(Reader.Open(m_vBuffer.data(), m_vBuffer.size()));
+	const CPhysicsTrace Trace = ReplayTrace(Reader);
+	ASSERT_EQ(Trace.Entries().size(), NUM_TICKS - 9u);
+
+	ASSERT_TRUE(Reader.Seek(nullptr, 0));
+	const CPhysicsTrace Again = ReplayTrace(Reader);
+	EXPECT_EQ(Trace.FirstMismatch(Again), -1);
+
+	// a change of the map right next to a character shows up in the trace
+	ASSERT_TRUE(Reader.Seek(nullptr, 0));
+	CPhysicsReplay Replay(&m_Collision, &Reader);
+	while(Replay.GameTick() < 300)
+		ASSERT_TRUE(Replay.Tick());
+	const vec2 Pos = Replay.Character(2)->m_Pos;
+	for(int y = -1; y <= 1; y++)
+		m_Collision.SetCollisionAt(Pos.x, Pos.y + y * 32.0f, TILE_SOLID);
+	ASSERT_TRUE(Reader.Seek(nullptr, 0));
+	const CPhysicsTrace Changed = ReplayTrace(Reader);
+	EXPECT_NE(Trace.FirstMismatch(Changed), -1);
+	EXPECT_LE(Trace.FirstMismatch(Changed), 301);
+}
+
+TEST(PhysicsTrace, FirstMismatch)
+{
+	CPhysicsTrace Trace;
+	for(int Tick = 5; Tick < 20; Tick++)
+		Trace.Add(Tick, Tick * 0x123456789ull);
+	CPhysicsTrace Other = Trace;
+	EXPECT_EQ(Trace.FirstMismatch(Other), -1);
+
+	Other.Add(20, 0);
+	EXPECT_EQ(Trace.FirstMismatch(Other), 20);
+	EXPECT_EQ(Other.FirstMismatch(Trace), 20);
+
+	CPhysicsTrace Changed;
+	for(const CPhysicsTrace::CEntry &Entry : Trace.Entries())
+		Changed.Add(Entry.m_Tick, Entry.m_Tick >= 12 ? ~Entry.m_Hash : Entry.m_Hash);
+	EXPECT_EQ(Trace.FirstMismatch(Changed), 12);
+}
+
+TEST(PhysicsTrace, SaveLoad)
+{
+	CTestInfo Info;
+	CPhysicsTrace Trace;
+	Trace.Add(1, 0);
+	Trace.Add(2, 0xfedcba9876543210ull);
+	Trace.Add(1000000, 42);
+
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_TRUE(Trace.Save(File));
+	io_close(File);
+
+	CPhysicsTrace Loaded;
+	ASSERT_TRUE(Loaded.Load(io_open(Info.m_aFilename, IOFLAG_READ)));
+	ASSERT_EQ(Loaded.Entries().size(), 3u);
+	EXPECT_EQ(Loaded.Entries()[1].m_Hash, 0xfedcba9876543210ull);
+	EXPECT_EQ(Trace.FirstMismatch(Loaded), -1);
+
+	File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_write(File, "1 xyz\n", 6);
+	io_close(File);
+	EXPECT_FALSE(Loaded.Load(io_open(Info.m_aFilename, IOFLAG_READ)));
+	fs_remove(Info.m_aFilename);
+}
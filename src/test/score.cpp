@@ -198,6 +198,28 @@ TEST_P(SingleScore, RankServer)
 	ExpectLines(m_pPlayerResult, {"nameless tee - 01:40.00 - better than 100% - requested by brainless tee", "Global rank 1"}, true);
 }
 
+TEST_P(SingleScore, LoadLeaderboard)
+{
+	InsertRank(120.0);
+	auto pResult = std::make_shared<CScoreLeaderboardResult>();
+	CSqlLeaderboardRequest Request(pResult);
+	str_copy(Request.m_aMap, "Kobra 3", sizeof(Request.m_aMap));
+	str_copy(Request.m_aServer, "GER", sizeof(Request.m_aServer));
+	ASSERT_TRUE(CScoreWorker::LoadLeaderboard(m_pConn, &Request, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_EQ(pResult->m_vGlobal.size(), 1u);
+	EXPECT_EQ(pResult->m_vGlobal[0].m_Name, "nameless tee");
+	EXPECT_EQ(pResult->m_vGlobal[0].m_Time, 100.0f);
+	EXPECT_TRUE(pResult->m_vRegional.empty());
+
+	pResult = std::make_shared<CScoreLeaderboardResult>();
+	CSqlLeaderboardRequest RegionalRequest(pResult);
+	str_copy(RegionalRequest.m_aMap, "Kobra 3", sizeof(RegionalRequest.m_aMap));
+	str_copy(RegionalRequest.m_aServer, "USA", sizeof(RegionalRequest.m_aServer));
+	ASSERT_TRUE(CScoreWorker::LoadLeaderboard(m_pConn, &RegionalRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_EQ(pResult->m_vRegional.size(), 1u);
+	EXPECT_EQ(pResult->m_vRegional[0].m_Time, 100.0f);
+}
+
 TEST_P(SingleScore, LoadPlayerData)
 {
 	InsertRank(120.0, true);
@@ -609,6 +631,50 @@ TEST_P(RandomMap, UnfinishedDoesntExist)
 	EXPECT_STREQ(m_pRandomMapResult->m_aMessage, "nameless tee has no more unfinished maps on this server!");
 }
 
+struct Transaction : public Score
+{
+	int NumRanks()
+	{
+		EXPECT_TRUE(m_pConn->PrepareStatement("SELECT COUNT(*) FROM record_race", m_aError, sizeof(m_aError))) << m_aError;
+		bool End = true;
+		EXPECT_TRUE(m_pConn->Step(&End, m_aError, sizeof(m_aError))) << m_aError;
+		EXPECT_FALSE(End);
+		return m_pConn->GetInt(1);
+	}
+};
+
+TEST_P(Transaction, Commit)
+{
+	ASSERT_TRUE(m_pConn->BeginTransaction(m_aError, sizeof(m_aError))) << m_aError;
+	// the second insert reuses the cached statement with different values
+	InsertRank(100.0f);
+	InsertRank(50.0f, true);
+	ASSERT_TRUE(m_pConn->CommitTransaction(m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(NumRanks(), 2);
+
+	str_copy(m_PlayerRequest.m_aMap, "Kobra 3", sizeof(m_PlayerRequest.m_aMap));
+	str_copy(m_PlayerRequest.m_aRequestingPlayer, "brainless tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+	str_copy(m_PlayerRequest.m_aServer, "GER", sizeof(m_PlayerRequest.m_aServer));
+	m_PlayerRequest.m_Offset = 0;
+	g_Config.m_SvRegionalRankings = false;
+	ASSERT_TRUE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult,
+		{"------------ Global Top ------------",
+			"1. nameless tee Time: 50.00",
+			"-----------------------------------------"});
+}
+
+TEST_P(Transaction, Rollback)
+{
+	InsertRank(100.0f);
+	ASSERT_TRUE(m_pConn->BeginTransaction(m_aError, sizeof(m_aError))) << m_aError;
+	InsertRank(50.0f);
+	InsertRank(70.0f);
+	EXPECT_EQ(NumRanks(), 3);
+	ASSERT_TRUE(m_pConn->RollbackTransaction(m_aError, sizeof(m_aError))) << m_aError;
+	EXPECT_EQ(NumRanks(), 1);
+}
+
 auto g_pSqliteConn = CreateSqliteConnection(":memory:", true);
 #if defined(CONF_TEST_MYSQL)
 CMysqlConfig gMysqlConfig{
@@ -650,3 +716,4 @@ INSTANTIATE(MapInfo);
 INSTANTIATE(MapVote);
 INSTANTIATE(Points);
 INSTANTIATE(RandomMap);
+INSTANTIATE(Transaction);
@@ -83,3 +83,44 @@ TEST(Snapshot, CrcOverflow)
 
 	ASSERT_EQ(pSnapshot->Crc(), 1);
 }
+
+TEST(Snapshot, IndexMatchesLinearSearch)
+{
+	CSnapshotBuilder Builder;
+	Builder.Init();
+
+	for(int i = 0; i < 300; i++)
+	{
+		CNetObj_Flag *pFlag = (CNetObj_Flag *)Builder.NewItem(CNetObj_Flag::ms_MsgId, i * 7, sizeof(CNetObj_Flag));
+		ASSERT_FALSE(pFlag == nullptr);
+		pFlag->m_X = i;
+	}
+	for(int i = 0; i < 10; i++)
+	{
+		CNetObj_DDNetCharacter *pCharacter = (CNetObj_DDNetCharacter *)Builder.NewItem(NETOBJTYPE_DDNETCHARACTER, i, sizeof(CNetObj_DDNetCharacter));
+		ASSERT_FALSE(pCharacter == nullptr);
+		pCharacter->m_Flags = i;
+	}
+
+	char aData[CSnapshot::MAX_SIZE];
+	CSnapshot *pSnapshot = (CSnapshot *)aData;
+	Builder.Finish(pSnapshot);
+
+	CSnapshotIndex Index;
+	Index.Build(pSnapshot);
+
+	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	{
+		const CSnapshotItem *pItem = pSnapshot->GetItem(i);
+		EXPECT_EQ(Index.GetItemIndex(pItem->Key()), pSnapshot->GetItemIndex(pItem->Key()));
+		EXPECT_EQ(Index.GetItemType(i), pSnapshot->GetItemType(i));
+		EXPECT_EQ(Index.GetExternalItemType(pItem->Type()), pSnapshot->GetExternalItemType(pItem->Type()));
+	}
+	for(int Id = 0; Id < 2200; Id++)
+	{
+		EXPECT_EQ(Index.FindItem(NETOBJTYPE_FLAG, Id), pSnapshot->FindItem(NETOBJTYPE_FLAG, Id));
+		EXPECT_EQ(Index.FindItem(NETOBJTYPE_DDNETCHARACTER, Id), pSnapshot->FindItem(NETOBJTYPE_DDNETCHARACTER, Id));
+		EXPECT_EQ(Index.FindItem(NETOBJTYPE_DDNETPLAYER, Id), nullptr);
+	}
+	EXPECT_EQ(Index.GetItemIndex(-1), -1);
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <game/gamecore.h>
+#include <game/mapitems.h>
+#include <game/state_hash.h>
+#include <game/teamscore.h>
+
+#include <functional>
+#include <vector>
+
+// the incremental prediction starts over when the hashes of the predicted
+// and the received world differ, so every change must show up in the hash
+class StateHash : public ::testing::Test
+{
+protected:
+	CWorldCore m_World;
+	CTeamsCore m_Teams;
+	CCharacterCore m_Core;
+
+	StateHash()
+	{
+		m_Core.Init(&m_World, nullptr, &m_Teams);
+		m_Core.Reset();
+		m_Core.m_Pos = vec2(100.0f, 200.0f);
+		m_Core.m_Direction = 0;
+		m_Core.m_Angle = 0;
+		m_Core.m_Ninja.m_ActivationTick = 0;
+		for(auto &Weapon : m_Core.m_aWeapons)
+		{
+			Weapon.m_Got = false;
+			Weapon.m_Ammo = 0;
+		}
+		m_Core.m_aWeapons[WEAPON_GUN].m_Got = true;
+		m_Core.m_aWeapons[WEAPON_GUN].m_Ammo = 10;
+		m_Core.m_ActiveWeapon = WEAPON_GUN;
+		m_World.m_vSwitchers.resize(4);
+		for(SSwitchers &Switcher : m_World.m_vSwitchers)
+		{
+			Switcher.m_Initial = true;
+			for(int Team = 0; Team < NUM_DDRACE_TEAMS; Team++)
+			{
+				Switcher.m_aStatus[Team] = true;
+				Switcher.m_aEndTick[Team] = 0;
+				Switcher.m_aType[Team] = 0;
+				Switcher.m_aLastUpdateTick[Team] = 0;
+			}
+		}
+	}
+
+	uint64_t Hash() const
+	{
+		CStateHash Hash;
+		Hash.AddSwitchers(m_World.m_vSwitchers);
+		Hash.AddTeams(m_Teams);
+		Hash.AddCharacterCore(m_Core);
+		return Hash.Hash();
+	}
+
+	void ExpectChanged(const std::function<void()> &Change, const char *pWhat)
+	{
+		const uint64_t Before = Hash();
+		Change();
+		EXPECT_NE(Hash(), Before) << pWhat;
+	}
+};
+
+TEST_F(StateHash, Equal)
+{
+	EXPECT_EQ(Hash(), Hash());
+
+	// only the client tracks when the snapshot changed a switch
+	const uint64_t Before = Hash();
+	m_World.m_vSwitchers[1].m_aLastUpdateTick[0] = 50;
+	EXPECT_EQ(Hash(), Before);
+}
+
+TEST_F(StateHash, Switchers)
+{
+	ExpectChanged([&] { m_World.m_vSwitchers[2].m_aStatus[0] = false; }, "status");
+	ExpectChanged([&] { m_World.m_vSwitchers[2].m_aEndTick[0] = 100; }, "end tick");
+	ExpectChanged([&] { m_World.m_vSwitchers[3].m_aType[5] = TILE_SWITCHTIMEDOPEN; }, "type");
+	ExpectChanged([&] { m_World.m_vSwitchers.pop_back(); }, "count");
+}
+
+TEST_F(StateHash, Teams)
+{
+	ExpectChanged([&] { m_Teams.Team(3, 1); }, "team");
+	ExpectChanged([&] { m_Teams.SetSolo(3, true); }, "solo");
+}
+
+TEST_F(StateHash, CharacterFlags)
+{
+	ExpectChanged([&] { m_Core.m_Jetpack = true; }, "jetpack");
+	ExpectChanged([&] { m_Core.m_EndlessHook = true; }, "endless hook");
+	ExpectChanged([&] { m_Core.m_EndlessJump = true; }, "endless jump");
+	ExpectChanged([&] { m_Core.m_Solo = true; }, "solo");
+	ExpectChanged([&] { m_Core.m_CollisionDisabled = true; }, "collision disabled");
+	ExpectChanged([&] { m_Core.m_HookHitDisabled = true; }, "hook hit disabled");
+	ExpectChanged([&] { m_Core.m_Jumps = 5; }, "jumps");
+	ExpectChanged([&] { m_Core.m_DeepFrozen = true; }, "deep frozen");
+	ExpectChanged([&] { m_Core.m_FreezeEnd = 300; }, "freeze end");
+	ExpectChanged([&] { m_Core.m_aWeapons[WEAPON_LASER].m_Got = true; }, "weapon owned");
+	ExpectChanged([&] { m_Core.m_aWeapons[WEAPON_GUN].m_Ammo = 9; }, "ammo");
+	ExpectChanged([&] { m_Core.m_Ninja.m_ActivationTick = 42; }, "ninja");
+}
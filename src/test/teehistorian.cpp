@@ -1,3 +1,4 @@
+#include "test.h"
 #include <gtest/gtest.h>
 
 #include <base/detect.h>
@@ -5,10 +6,13 @@
 #include <engine/server.h>
 #include <engine/shared/config.h>
 #include <game/gamecore.h>
+#include <engine/shared/teehistorian_reader.h>
 #include <game/server/teehistorian.h>
 
 #include <vector>
 
+#include <zlib.h>
+
 void RegisterGameUuids(CUuidManager *pManager);
 
 class TeeHistorian : public ::testing::Test
@@ -21,6 +25,7 @@ protected:
 	CTeeHistorian::CGameInfo m_GameInfo;
 
 	std::vector<unsigned char> m_vBuffer;
+	std::vector<unsigned char> m_vIndexBuffer;
 
 	enum
 	{
@@ -95,6 +100,12 @@ protected:
 		WriteBuffer(pThis->m_vBuffer, pData, DataSize);
 	}
 
+	static void WriteIndex(const void *pData, int DataSize, void *pUser)
+	{
+		TeeHistorian *pThis = (TeeHistorian *)pUser;
+		WriteBuffer(pThis->m_vIndexBuffer, pData, DataSize);
+	}
+
 	void Reset(const CTeeHistorian::CGameInfo *pGameInfo)
 	{
 		m_vBuffer.clear();
@@ -904,3 +915,224 @@ TEST_F(TeeHistorian, PrevGameUuid)
 	EXPECT_STREQ(JsonPrevGameUuid, "fe19c218-f555-4002-a273-126c59ccc17a");
 	json_value_free(pJson);
 }
+
+// reads a file written by CTeeHistorianWriter, gzip or uncompressed
+static bool ReadTeeHistorianFile(const char *pFilename, std::vector<unsigned char> &vOutput)
+{
+	void *pData;
+	unsigned DataSize;
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return false;
+	const bool Read = io_read_all(File, &pData, &DataSize);
+	io_close(File);
+	if(!Read)
+		return false;
+
+	vOutput.clear();
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	if(DataSize < 2 || pBytes[0] != 0x1f || pBytes[1] != 0x8b)
+	{
+		vOutput.assign(pBytes, pBytes + DataSize);
+		free(pData);
+		return true;
+	}
+
+	z_stream Stream;
+	mem_zero(&Stream, sizeof(Stream));
+	// 32 added to the window bits detects the gzip header
+	inflateInit2(&Stream, 15 + 32);
+	Stream.next_in = (Bytef *)pData;
+	Stream.avail_in = DataSize;
+	int Result;
+	do
+	{
+		unsigned char aBuf[4096];
+		Stream.next_out = aBuf;
+		Stream.avail_out = sizeof(aBuf);
+		Result = inflate(&Stream, Z_NO_FLUSH);
+		vOutput.insert(vOutput.end(), aBuf, aBuf + sizeof(aBuf) - Stream.avail_out);
+	} while(Result == Z_OK);
+	inflateEnd(&Stream);
+	free(pData);
+	return Result == Z_STREAM_END;
+}
+
+static void ExpectWriterOutput(int Compression, size_t MaxQueuedBytes, const std::vector<unsigned char> &vData, const std::vector<size_t> &vFrameEnds)
+{
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	CTeeHistorianWriter Writer(File, Compression, MaxQueuedBytes);
+	size_t Start = 0;
+	for(size_t End : vFrameEnds)
+	{
+		CTeeHistorianWriter::WriteCallback(vData.data() + Start, End - Start, &Writer);
+		Writer.EndFrame();
+		Start = End;
+	}
+	Writer.Write(vData.data() + Start, vData.size() - Start);
+	EXPECT_EQ(Writer.Close(), 0);
+
+	const CTeeHistorianWriter::CStats Stats = Writer.Stats();
+	EXPECT_EQ(Stats.m_InputBytes, (int64_t)vData.size());
+	EXPECT_EQ(Stats.m_QueuedBytes, 0u);
+	if(Compression == CTeeHistorianWriter::COMPRESSION_NONE)
+		EXPECT_EQ(Stats.m_OutputBytes, (int64_t)vData.size());
+	else
+		EXPECT_LT(Stats.m_OutputBytes, (int64_t)vData.size());
+
+	std::vector<unsigned char> vRead;
+	ASSERT_TRUE(ReadTeeHistorianFile(Info.m_aFilename, vRead));
+	fs_remove(Info.m_aFilename);
+	EXPECT_TRUE(vRead == vData);
+}
+
+TEST_F(TeeHistorian, Writer)
+{
+	std::vector<size_t> vFrameEnds;
+	for(int t = 1; t <= 200; t++)
+	{
+		Tick(t);
+		for(int i = 0; i < 16; i++)
+			Player(i, t * (i + 1), 100 - t);
+		vFrameEnds.push_back(m_vBuffer.size());
+	}
+	Finish();
+
+	ExpectWriterOutput(CTeeHistorianWriter::COMPRESSION_NONE, 1024 * 1024, m_vBuffer, vFrameEnds);
+	ExpectWriterOutput(CTeeHistorianWriter::COMPRESSION_GZIP, 1024 * 1024, m_vBuffer, vFrameEnds);
+	// a queue smaller than a frame makes every frame wait for the thread
+	ExpectWriterOutput(CTeeHistorianWriter::COMPRESSION_GZIP, 1, m_vBuffer, vFrameEnds);
+}
+
+TEST_F(TeeHistorian, IndexSeek)
+{
+	const int NUM_TICKS = 600;
+	const int NUM_PLAYERS = 8;
+	m_TH.SetIndex(50, WriteIndex, this);
+	Reset(&m_GameInfo);
+
+	// expected state after every tick, ticks that are not recorded keep the previous one
+	std::vector<std::vector<CTeeHistorianIndex::CPlayer>> vvExpected(NUM_TICKS + 1, std::vector<CTeeHistorianIndex::CPlayer>(NUM_PLAYERS));
+	std::vector<CTeeHistorianIndex::CPlayer> vState(NUM_PLAYERS);
+	mem_zero(vState.data(), vState.size() * sizeof(vState[0]));
+	std::vector<int> vJoinTicks;
+	for(int t = 1; t <= NUM_TICKS; t++)
+	{
+		// no records at all for a while, which is written as a tick skip
+		if(t > 300 && t < 320)
+		{
+			vvExpected[t] = vState;
+			continue;
+		}
+
+		Tick(t);
+		for(int i = 0; i < NUM_PLAYERS; i++)
+		{
+			CTeeHistorianIndex::CPlayer &State = vState[i];
+			if((t / (20 + i * 7)) % 3 == 2)
+			{
+				DeadPlayer(i);
+				State.m_Alive = false;
+				State.m_X = 0;
+				State.m_Y = 0;
+				continue;
+			}
+			// odd players only move every other tick
+			if(!State.m_Alive || i % 2 == 0 || t % 2 == 0)
+			{
+				State.m_X = i * 100 + t;
+				State.m_Y = (t * t * (i + 1)) % 1000 - 500;
+			}
+			Player(i, State.m_X, State.m_Y);
+			State.m_Alive = true;
+		}
+		if(t % 37 == 0)
+		{
+			const int ClientId = t % NUM_PLAYERS;
+			vState[ClientId].m_Team = t % 5;
+			m_TH.RecordPlayerTeam(ClientId, vState[ClientId].m_Team);
+		}
+		Inputs();
+		for(int i = 0; i < NUM_PLAYERS; i++)
+		{
+			if(!vState[i].m_Alive || t % (i + 2) != 0)
+				continue;
+			CNetObj_PlayerInput &Input = vState[i].m_Input;
+			Input.m_Direction = (t / 3) % 3 - 1;
+			Input.m_TargetX = t * 3 - i;
+			Input.m_TargetY = -t;
+			Input.m_Jump = t % 2;
+			vState[i].m_HaveInput = true;
+			m_TH.RecordPlayerInput(i, i + 1, &Input);
+		}
+		if(t % 90 == 0)
+		{
+			m_TH.RecordPlayerJoin(t / 90, CTeeHistorian::PROTOCOL_6);
+			m_TH.RecordPlayerDrop(t / 90 + 1, "test");
+			vJoinTicks.push_back(t);
+		}
+		vvExpected[t] = vState;
+	}
+	Finish();
+
+	CTeeHistorianIndex Index;
+	ASSERT_TRUE(Index.Load(m_vIndexBuffer.data(), m_vIndexBuffer.size()));
+	EXPECT_EQ(Index.GameUuid(), m_GameInfo.m_GameUuid);
+	// ticks 1, 51, ..., 251 and 320, 370, ..., 570 after the skipped ticks
+	ASSERT_EQ(Index.Keyframes().size(), 12u);
+	EXPECT_EQ(Index.Keyframes()[6].m_Tick, 320);
+	EXPECT_EQ(Index.FindKeyframe(0), nullptr);
+	EXPECT_EQ(Index.FindKeyframe(319)->m_Tick, 251);
+	EXPECT_EQ(Index.FindKeyframe(1000)->m_Tick, 570);
+	ASSERT_EQ(Index.Events().size(), 2 * vJoinTicks.size());
+	for(size_t i = 0; i < vJoinTicks.size(); i++)
+	{
+		const int First = Index.FindEvent(vJoinTicks[i]);
+		EXPECT_EQ(First, (int)(2 * i));
+		EXPECT_EQ(Index.Events()[First].m_Type, CTeeHistorianIndex::RECORD_JOIN);
+		EXPECT_EQ(Index.Events()[First].m_Tick, vJoinTicks[i]);
+		EXPECT_EQ(Index.Events()[First].m_ClientId, vJoinTicks[i] / 90);
+		EXPECT_EQ(Index.Events()[First + 1].m_Type, CTeeHistorianIndex::RECORD_DROP);
+	}
+
+	const auto ExpectState = [&](const CTeeHistorianReader &Reader, int Tick) {
+		for(int i = 0; i < NUM_PLAYERS; i++)
+		{
+			const CTeeHistorianIndex::CPlayer &Expected = vvExpected[Tick][i];
+			const CTeeHistorianIndex::CPlayer &Player = Reader.Player(i);
+			EXPECT_EQ(Player.m_Alive, Expected.m_Alive) << "tick=" << Tick << " cid=" << i;
+			EXPECT_EQ(Player.m_X, Expected.m_X) << "tick=" << Tick << " cid=" << i;
+			EXPECT_EQ(Player.m_Y, Expected.m_Y) << "tick=" << Tick << " cid=" << i;
+			EXPECT_EQ(Player.m_Team, Expected.m_Team) << "tick=" << Tick << " cid=" << i;
+			EXPECT_EQ(Player.m_HaveInput, Expected.m_HaveInput) << "tick=" << Tick << " cid=" << i;
+			if(Expected.m_HaveInput)
+			{
+				EXPECT_EQ(mem_comp(&Player.m_Input, &Expected.m_Input, sizeof(Expected.m_Input)), 0) << "tick=" << Tick << " cid=" << i;
+			}
+		}
+	};
+
+	// decode the whole stream
+	CTeeHistorianReader Reader;
+	ASSERT_TRUE(Reader.Open(m_vBuffer.data(), m_vBuffer.size()));
+	int NumTicks = 0;
+	while(Reader.ReadTick())
+	{
+		ASSERT_LE(Reader.Tick(), NUM_TICKS);
+		ExpectState(Reader, Reader.Tick());
+		NumTicks++;
+	}
+	EXPECT_TRUE(Reader.Finished());
+	EXPECT_FALSE(Reader.Error());
+	EXPECT_EQ(NumTicks, NUM_TICKS - 19);
+
+	// jump around, forwards and backwards
+	for(int Tick : {550, 1, 49, 50, 51, 299, 300, 310, 320, 100, 600, 0, 451, 250})
+	{
+		ASSERT_TRUE(Reader.Seek(&Index, Tick));
+		EXPECT_LE(Reader.Tick(), Tick);
+		ExpectState(Reader, Tick);
+	}
+}
@@ -0,0 +1,668 @@
+// Connects many headless clients to a local server to measure how many
+// players it can carry. Every client does the full handshake and map
+// download, then sends input at the tick rate and acks the snapshots it
+// received, like a real client.
+
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/message.h>
+#include <engine/shared/config.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/protocol_ex.h>
+#include <engine/shared/snapshot.h>
+#include <engine/shared/uuid_manager.h>
+
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const char *TOOL_NAME = "loadgen";
+
+class CLoadgenOptions
+{
+public:
+	int m_NumClients = 16;
+	int m_ClientsPerAddress = 4;
+	int m_Duration = 30;
+	bool m_RandomInput = false;
+	const char *m_pServer = "127.0.0.1:8303";
+	const char *m_pPassword = "";
+};
+
+class CLoadClient
+{
+public:
+	enum
+	{
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_INGAME,
+		STATE_OFFLINE,
+	};
+
+	class CSnapshotArrival
+	{
+	public:
+		int m_Tick;
+		int64_t m_Time;
+	};
+
+	int m_Index;
+	CNetClient m_NetClient;
+	int m_State = STATE_CONNECTING;
+	char m_aError[128] = "";
+	std::mt19937 m_Rng;
+
+	// map download
+	int m_MapCrc = 0;
+	int m_MapSize = 0;
+	int m_MapChunk = 0;
+	std::vector<unsigned char> m_vMapData;
+
+	// snapshots
+	CSnapshotStorage m_SnapshotStorage;
+	int m_AckGameTick = -1;
+	int m_CurrentRecvTick = 0;
+	uint64_t m_SnapshotParts = 0;
+	int m_SnapshotIncomingDataSize = 0;
+	unsigned char m_aSnapshotIncomingData[CSnapshot::MAX_SIZE];
+	int64_t m_LastSnapshotTime = 0;
+	std::vector<CSnapshotArrival> m_vSnapshotArrivals;
+	int m_SnapshotErrors = 0;
+
+	// input
+	CNetObj_PlayerInput m_Input = {};
+	int64_t m_NextInputTime = 0;
+	int m_InputCount = 0;
+	int64_t m_aInputSendTime[200] = {0};
+	int m_aInputTick[200] = {0};
+	std::vector<int64_t> m_vInputRoundTrips;
+
+	CLoadClient(int Index) :
+		m_Index(Index), m_Rng(Index)
+	{
+	}
+
+	bool Open(const NETADDR &ServerAddr, int ClientsPerAddress)
+	{
+		// the server limits the number of clients per address, spread
+		// the clients over the loopback network where that is possible
+		NETADDR BindAddr = {};
+		if(ServerAddr.type == NETTYPE_IPV4 && ServerAddr.ip[0] == 127)
+		{
+			const int Address = m_Index / ClientsPerAddress;
+			BindAddr.type = NETTYPE_IPV4;
+			BindAddr.ip[0] = 127;
+			BindAddr.ip[1] = 0;
+			BindAddr.ip[2] = Address / 254;
+			BindAddr.ip[3] = 1 + Address % 254;
+			if(m_NetClient.Open(BindAddr))
+				return true;
+		}
+		BindAddr = {};
+		BindAddr.type = NETTYPE_ALL;
+		return m_NetClient.Open(BindAddr);
+	}
+
+	void Connect(const NETADDR &ServerAddr)
+	{
+		m_NetClient.Connect(&ServerAddr, 1);
+	}
+
+	void Close()
+	{
+		if(m_State != STATE_OFFLINE)
+			m_NetClient.Disconnect("load test finished");
+		m_NetClient.Close();
+	}
+
+	void SendMsg(CMsgPacker *pMsg, int Flags)
+	{
+		CPacker Packer;
+		Packer.Reset();
+		if(pMsg->m_MsgId < OFFSET_UUID)
+		{
+			Packer.AddInt((pMsg->m_MsgId << 1) | (pMsg->m_System ? 1 : 0));
+		}
+		else
+		{
+			Packer.AddInt(pMsg->m_System ? 1 : 0); // NETMSG_EX, NETMSGTYPE_EX
+			g_UuidManager.PackUuid(pMsg->m_MsgId, &Packer);
+		}
+		Packer.AddRaw(pMsg->Data(), pMsg->Size());
+
+		CNetChunk Packet = {};
+		Packet.m_ClientId = 0;
+		Packet.m_pData = Packer.Data();
+		Packet.m_DataSize = Packer.Size();
+		if(Flags & MSGFLAG_VITAL)
+			Packet.m_Flags |= NETSENDFLAG_VITAL;
+		if(Flags & MSGFLAG_FLUSH)
+			Packet.m_Flags |= NETSENDFLAG_FLUSH;
+		m_NetClient.Send(&Packet);
+	}
+
+	void SendInfo(const char *pPassword)
+	{
+		const CUuid ConnectionId = RandomUuid();
+		CMsgPacker MsgVer(NETMSG_CLIENTVER, true);
+		MsgVer.AddRaw(&ConnectionId, sizeof(ConnectionId));
+		MsgVer.AddInt(DDNET_VERSION_NUMBER);
+		MsgVer.AddString(GAME_NAME " " GAME_RELEASE_VERSION " (loadgen)");
+		SendMsg(&MsgVer, MSGFLAG_VITAL);
+
+		CMsgPacker Msg(NETMSG_INFO, true);
+		Msg.AddString(GAME_NETVERSION);
+		Msg.AddString(pPassword);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void SendMapRequest()
+	{
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA, true);
+		Msg.AddInt(m_MapChunk);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void SendStartInfo()
+	{
+		char aName[16];
+		str_format(aName, sizeof(aName), "loadgen %d", m_Index);
+		CNetMsg_Cl_StartInfo Msg;
+		Msg.m_pName = aName;
+		Msg.m_pClan = "";
+		Msg.m_Country = -1;
+		Msg.m_pSkin = "default";
+		Msg.m_UseCustomColor = 0;
+		Msg.m_ColorBody = 0;
+		Msg.m_ColorFeet = 0;
+		CMsgPacker Packer(&Msg);
+		if(!Msg.Pack(&Packer))
+			SendMsg(&Packer, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void UpdateInput(int Tick, bool Random)
+	{
+		if(Random)
+		{
+			if(m_Rng() % 25 == 0)
+				m_Input.m_Direction = (int)(m_Rng() % 3) - 1;
+			m_Input.m_Jump = m_Rng() % 20 == 0;
+			if(m_Rng() % 10 == 0)
+				m_Input.m_Hook = !m_Input.m_Hook;
+			m_Input.m_Fire += m_Rng() % 15 == 0 ? 1 : 0;
+			m_Input.m_TargetX = (int)(m_Rng() % 601) - 300;
+			m_Input.m_TargetY = (int)(m_Rng() % 601) - 300;
+		}
+		else
+		{
+			// run back and forth, jump and hook in a fixed rhythm
+			const int Phase = Tick + m_Index * 7;
+			m_Input.m_Direction = (Phase / 50) % 2 ? 1 : -1;
+			m_Input.m_Jump = Phase % 25 == 0;
+			m_Input.m_Hook = Phase % 60 < 30;
+			m_Input.m_Fire = Phase / 50;
+			const float Angle = Phase * 0.05f;
+			m_Input.m_TargetX = (int)(std::cos(Angle) * 200);
+			m_Input.m_TargetY = (int)(std::sin(Angle) * 200);
+		}
+		m_Input.m_WantedWeapon = 0;
+		m_Input.m_PlayerFlags = PLAYERFLAG_PLAYING;
+	}
+
+	void SendInput(int64_t Now, bool Random)
+	{
+		// predict the tick the server is at when the input arrives
+		const int PredTick = m_CurrentRecvTick + 1 + (int)((Now - m_LastSnapshotTime) * SERVER_TICK_SPEED / time_freq());
+		UpdateInput(PredTick, Random);
+
+		CMsgPacker Msg(NETMSG_INPUT, true);
+		Msg.AddInt(m_AckGameTick);
+		Msg.AddInt(PredTick);
+		Msg.AddInt(sizeof(m_Input));
+		const int *pData = (const int *)&m_Input;
+		for(size_t i = 0; i < sizeof(m_Input) / sizeof(int); i++)
+			Msg.AddInt(pData[i]);
+		SendMsg(&Msg, MSGFLAG_FLUSH);
+
+		m_aInputTick[m_InputCount % std::size(m_aInputTick)] = PredTick;
+		m_aInputSendTime[m_InputCount % std::size(m_aInputSendTime)] = Now;
+		m_InputCount++;
+	}
+
+	void SetError(const char *pError)
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+		str_copy(m_aError, pError);
+		m_State = STATE_OFFLINE;
+		m_NetClient.Disconnect(pError);
+	}
+
+	void OnSnapshot(int Msg, CUnpacker &Unpacker, CSnapshotDelta &SnapshotDelta, int64_t Now)
+	{
+		const int GameTick = Unpacker.GetInt();
+		const int DeltaTick = GameTick - Unpacker.GetInt();
+		int NumParts = 1;
+		int Part = 0;
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = Unpacker.GetInt();
+			Part = Unpacker.GetInt();
+		}
+		unsigned Crc = 0;
+		int PartSize = 0;
+		if(Msg != NETMSG_SNAPEMPTY)
+		{
+			Crc = Unpacker.GetInt();
+			PartSize = Unpacker.GetInt();
+		}
+		const unsigned char *pData = Unpacker.GetRaw(PartSize);
+		if(Unpacker.Error() || NumParts < 1 || NumParts > CSnapshot::MAX_PARTS || Part < 0 || Part >= NumParts || PartSize < 0 || PartSize > MAX_SNAPSHOT_PACKSIZE)
+			return;
+		if(GameTick < m_CurrentRecvTick || GameTick <= m_AckGameTick)
+			return;
+
+		if(GameTick != m_CurrentRecvTick)
+		{
+			m_SnapshotParts = 0;
+			m_CurrentRecvTick = GameTick;
+			m_SnapshotIncomingDataSize = 0;
+		}
+		mem_copy(m_aSnapshotIncomingData + Part * MAX_SNAPSHOT_PACKSIZE, pData, std::clamp(PartSize, 0, (int)sizeof(m_aSnapshotIncomingData) - Part * MAX_SNAPSHOT_PACKSIZE));
+		m_SnapshotParts |= (uint64_t)1 << Part;
+		if(Part == NumParts - 1)
+			m_SnapshotIncomingDataSize = (NumParts - 1) * MAX_SNAPSHOT_PACKSIZE + PartSize;
+		const uint64_t AllParts = NumParts == 64 ? std::numeric_limits<uint64_t>::max() : ((uint64_t)1 << NumParts) - 1;
+		if(m_SnapshotParts != AllParts)
+			return;
+		m_SnapshotParts = 0;
+
+		const CSnapshot *pDeltaShot = CSnapshot::EmptySnapshot();
+		if(DeltaTick >= 0 && m_SnapshotStorage.Get(DeltaTick, nullptr, &pDeltaShot, nullptr) < 0)
+		{
+			// the server has to resend everything
+			m_SnapshotErrors++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		unsigned char aDeltaData[CSnapshot::MAX_SIZE];
+		const void *pDeltaData = SnapshotDelta.EmptyDelta();
+		int DeltaSize = sizeof(int) * 3;
+		if(m_SnapshotIncomingDataSize)
+		{
+			DeltaSize = CVariableInt::Decompress(m_aSnapshotIncomingData, m_SnapshotIncomingDataSize, aDeltaData, sizeof(aDeltaData));
+			if(DeltaSize < 0)
+			{
+				m_SnapshotErrors++;
+				return;
+			}
+			pDeltaData = aDeltaData;
+		}
+
+		alignas(CSnapshot) unsigned char aSnapshot[CSnapshot::MAX_SIZE];
+		CSnapshot *pSnapshot = (CSnapshot *)aSnapshot;
+		const int SnapSize = SnapshotDelta.UnpackDelta(pDeltaShot, pSnapshot, pDeltaData, DeltaSize, false);
+		if(SnapSize < 0 || !pSnapshot->IsValid(SnapSize) || (Msg != NETMSG_SNAPEMPTY && pSnapshot->Crc() != Crc))
+		{
+			m_SnapshotErrors++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		m_SnapshotStorage.PurgeUntil(DeltaTick);
+		m_SnapshotStorage.Add(GameTick, Now, SnapSize, pSnapshot, 0, nullptr);
+		m_AckGameTick = GameTick;
+		m_LastSnapshotTime = Now;
+		if(m_State == STATE_INGAME)
+			m_vSnapshotArrivals.push_back({GameTick, Now});
+	}
+
+	void OnSystemMessage(int Msg, const CNetChunk *pPacket, CUnpacker &Unpacker, CSnapshotDelta &SnapshotDelta, int64_t Now)
+	{
+		const bool Vital = pPacket->m_Flags & NET_CHUNKFLAG_VITAL;
+		if(Vital && Msg == NETMSG_MAP_CHANGE)
+		{
+			Unpacker.GetString(CUnpacker::SANITIZE_CC);
+			m_MapCrc = Unpacker.GetInt();
+			m_MapSize = Unpacker.GetInt();
+			if(Unpacker.Error() || m_MapSize < 0 || m_MapSize > 1024 * 1024 * 1024)
+			{
+				SetError("invalid map change");
+				return;
+			}
+			// always download the map, that is part of the load on the server
+			m_vMapData.clear();
+			m_vMapData.reserve(m_MapSize);
+			m_MapChunk = 0;
+			m_State = STATE_LOADING;
+			SendMapRequest();
+		}
+		else if(Msg == NETMSG_MAP_DATA)
+		{
+			const int Last = Unpacker.GetInt();
+			const int MapCrc = Unpacker.GetInt();
+			const int Chunk = Unpacker.GetInt();
+			const int Size = Unpacker.GetInt();
+			const unsigned char *pData = Unpacker.GetRaw(Size);
+			if(Unpacker.Error() || Size <= 0 || MapCrc != m_MapCrc || Chunk != m_MapChunk)
+				return;
+			m_vMapData.insert(m_vMapData.end(), pData, pData + Size);
+			if(!Last)
+			{
+				m_MapChunk++;
+				SendMapRequest();
+				return;
+			}
+			if((int)crc32(0, m_vMapData.data(), m_vMapData.size()) != m_MapCrc)
+			{
+				SetError("map crc mismatch");
+				return;
+			}
+			m_State = STATE_READY;
+			CMsgPacker Ready(NETMSG_READY, true);
+			SendMsg(&Ready, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+		}
+		else if(Vital && Msg == NETMSG_CON_READY)
+		{
+			SendStartInfo();
+		}
+		else if(Msg == NETMSG_PING)
+		{
+			CMsgPacker Reply(NETMSG_PING_REPLY, true);
+			SendMsg(&Reply, MSGFLAG_FLUSH);
+		}
+		else if(Msg == NETMSG_INPUTTIMING)
+		{
+			const int InputPredTick = Unpacker.GetInt();
+			Unpacker.GetInt();
+			if(Unpacker.Error())
+				return;
+			for(int i = maximum(0, m_InputCount - (int)std::size(m_aInputTick)); i < m_InputCount; i++)
+			{
+				const int Slot = i % std::size(m_aInputTick);
+				if(m_aInputTick[Slot] == InputPredTick)
+				{
+					m_vInputRoundTrips.push_back(Now - m_aInputSendTime[Slot]);
+					m_aInputTick[Slot] = -1;
+					break;
+				}
+			}
+		}
+		else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+		{
+			OnSnapshot(Msg, Unpacker, SnapshotDelta, Now);
+		}
+	}
+
+	void OnPacket(const CNetChunk *pPacket, CSnapshotDelta &SnapshotDelta, int64_t Now)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+		CMsgPacker Answer(NETMSG_EX, true);
+		int Msg;
+		bool Sys;
+		CUuid Uuid;
+		const int Result = UnpackMessageId(&Msg, &Sys, &Uuid, &Unpacker, &Answer);
+		if(Result == UNPACKMESSAGE_ERROR)
+			return;
+		if(Result == UNPACKMESSAGE_ANSWER)
+			SendMsg(&Answer, MSGFLAG_VITAL);
+
+		if(Sys)
+		{
+			OnSystemMessage(Msg, pPacket, Unpacker, SnapshotDelta, Now);
+		}
+		else if(Msg == NETMSGTYPE_SV_READYTOENTER && m_State == STATE_READY)
+		{
+			CMsgPacker EnterGame(NETMSG_ENTERGAME, true);
+			SendMsg(&EnterGame, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+			m_State = STATE_INGAME;
+			m_NextInputTime = Now;
+		}
+	}
+
+	void Pump(CSnapshotDelta &SnapshotDelta, const CLoadgenOptions &Options)
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+
+		m_NetClient.Update();
+		if(m_NetClient.State() == NETSTATE_OFFLINE)
+		{
+			str_copy(m_aError, m_NetClient.ErrorString()[0] ? m_NetClient.ErrorString() : "connection lost");
+			m_State = STATE_OFFLINE;
+			return;
+		}
+		if(m_State == STATE_CONNECTING && m_NetClient.State() == NETSTATE_ONLINE)
+		{
+			m_State = STATE_LOADING;
+			SendInfo(Options.m_pPassword);
+		}
+
+		CNetChunk Packet;
+		SECURITY_TOKEN ResponseToken;
+		while(m_State != STATE_OFFLINE && m_NetClient.Recv(&Packet, &ResponseToken, false))
+		{
+			if(Packet.m_ClientId == -1)
+				continue;
+			OnPacket(&Packet, SnapshotDelta, time_get());
+		}
+
+		const int64_t Now = time_get();
+		if(m_State == STATE_INGAME && m_AckGameTick >= 0 && Now >= m_NextInputTime)
+		{
+			SendInput(Now, Options.m_RandomInput);
+			m_NextInputTime = maximum(m_NextInputTime + time_freq() / SERVER_TICK_SPEED, Now - time_freq());
+		}
+	}
+
+	int LostSnapshots() const
+	{
+		// the server sends a snapshot every tick or every second tick,
+		// take the most common interval as the expected one
+		int aIntervals[3] = {0};
+		for(size_t i = 1; i < m_vSnapshotArrivals.size(); i++)
+		{
+			const int Interval = m_vSnapshotArrivals[i].m_Tick - m_vSnapshotArrivals[i - 1].m_Tick;
+			if(Interval >= 1 && Interval <= 2)
+				aIntervals[Interval]++;
+		}
+		const int Step = aIntervals[1] >= aIntervals[2] ? 1 : 2;
+		int Lost = 0;
+		for(size_t i = 1; i < m_vSnapshotArrivals.size(); i++)
+			Lost += maximum(0, (m_vSnapshotArrivals[i].m_Tick - m_vSnapshotArrivals[i - 1].m_Tick) / Step - 1);
+		return Lost;
+	}
+};
+
+static double ToMs(int64_t Time)
+{
+	return Time * 1000.0 / time_freq();
+}
+
+static int64_t Percentile(std::vector<int64_t> &vValues, double Fraction)
+{
+	if(vValues.empty())
+		return 0;
+	const size_t Index = std::min(vValues.size() - 1, (size_t)(Fraction * vValues.size()));
+	std::nth_element(vValues.begin(), vValues.begin() + Index, vValues.end());
+	return vValues[Index];
+}
+
+static void PrintPercentiles(const char *pWhat, std::vector<int64_t> &vValues)
+{
+	log_info(TOOL_NAME, "%-24s p50=%7.2fms p90=%7.2fms p99=%7.2fms max=%7.2fms (%d samples)", pWhat,
+		ToMs(Percentile(vValues, 0.5)), ToMs(Percentile(vValues, 0.9)), ToMs(Percentile(vValues, 0.99)), ToMs(Percentile(vValues, 1.0)), (int)vValues.size());
+}
+
+static void PrintReport(std::vector<std::unique_ptr<CLoadClient>> &vpClients)
+{
+	// The server starts a tick every 1/50 s, the earliest snapshot of all
+	// ticks gives the offset of the tick start to our clock. The delay of
+	// the snapshots after the tick start is the tick time of the server
+	// plus sending.
+	const int64_t TickTime = time_freq() / SERVER_TICK_SPEED;
+	int64_t TickStartOffset = std::numeric_limits<int64_t>::max();
+	for(const auto &pClient : vpClients)
+		for(const auto &Arrival : pClient->m_vSnapshotArrivals)
+			TickStartOffset = std::min(TickStartOffset, Arrival.m_Time - Arrival.m_Tick * TickTime);
+
+	std::vector<int64_t> vAllDelays;
+	std::vector<int64_t> vAllRoundTrips;
+	std::vector<std::pair<int, int64_t>> vFirstDelays; // per tick, delay of the first snapshot
+	int TotalSnapshots = 0;
+	int TotalLost = 0;
+	int NumIngame = 0;
+	for(const auto &pClient : vpClients)
+	{
+		std::vector<int64_t> vDelays;
+		for(const auto &Arrival : pClient->m_vSnapshotArrivals)
+		{
+			const int64_t Delay = Arrival.m_Time - Arrival.m_Tick * TickTime - TickStartOffset;
+			vDelays.push_back(Delay);
+			vFirstDelays.emplace_back(Arrival.m_Tick, Delay);
+		}
+		std::vector<int64_t> vRoundTrips = pClient->m_vInputRoundTrips;
+		const int Lost = pClient->LostSnapshots();
+		const int Received = pClient->m_vSnapshotArrivals.size();
+		TotalSnapshots += Received;
+		TotalLost += Lost;
+		NumIngame += Received > 0;
+		vAllDelays.insert(vAllDelays.end(), vDelays.begin(), vDelays.end());
+		vAllRoundTrips.insert(vAllRoundTrips.end(), vRoundTrips.begin(), vRoundTrips.end());
+
+		log_info(TOOL_NAME, "client %3d: snapshots=%6d lost=%5d (%5.2f%%) errors=%d latency p50=%6.2fms p99=%6.2fms input rtt p50=%6.2fms p99=%6.2fms%s%s",
+			pClient->m_Index, Received, Lost, Received + Lost ? 100.0 * Lost / (Received + Lost) : 0.0, pClient->m_SnapshotErrors,
+			ToMs(Percentile(vDelays, 0.5)), ToMs(Percentile(vDelays, 0.99)),
+			ToMs(Percentile(vRoundTrips, 0.5)), ToMs(Percentile(vRoundTrips, 0.99)),
+			pClient->m_aError[0] ? " error: " : "", pClient->m_aError);
+	}
+
+	std::sort(vFirstDelays.begin(), vFirstDelays.end());
+	std::vector<int64_t> vTickTimes;
+	for(size_t i = 0; i < vFirstDelays.size(); i++)
+		if(i == 0 || vFirstDelays[i].first != vFirstDelays[i - 1].first)
+			vTickTimes.push_back(vFirstDelays[i].second);
+
+	log_info(TOOL_NAME, "%d of %d clients got in game, %d snapshots received, %d lost (%.2f%%)",
+		NumIngame, (int)vpClients.size(), TotalSnapshots, TotalLost, TotalSnapshots + TotalLost ? 100.0 * TotalLost / (TotalSnapshots + TotalLost) : 0.0);
+	PrintPercentiles("server tick time", vTickTimes);
+	PrintPercentiles("snapshot latency", vAllDelays);
+	PrintPercentiles("input round trip", vAllRoundTrips);
+}
+
+static bool ParseOptions(int argc, const char **argv, CLoadgenOptions &Options)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		const char *pValue;
+		if((pValue = str_startswith(argv[i], "--clients=")))
+			Options.m_NumClients = maximum(str_toint(pValue), 1);
+		else if((pValue = str_startswith(argv[i], "--clients-per-address=")))
+			Options.m_ClientsPerAddress = maximum(str_toint(pValue), 1);
+		else if((pValue = str_startswith(argv[i], "--duration=")))
+			Options.m_Duration = maximum(str_toint(pValue), 1);
+		else if((pValue = str_startswith(argv[i], "--password=")))
+			Options.m_pPassword = pValue;
+		else if(str_comp(argv[i], "--random-input") == 0)
+			Options.m_RandomInput = true;
+		else if(argv[i][0] != '-')
+			Options.m_pServer = argv[i];
+		else
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	CLoadgenOptions Options;
+	if(!ParseOptions(argc, argv, Options))
+	{
+		log_error(TOOL_NAME, "Usage: %s [--clients=<n>] [--duration=<seconds>] [--random-input] [--password=<password>] [--clients-per-address=<n>] [server[:port]]", TOOL_NAME);
+		return -1;
+	}
+	if(secure_random_init() != 0)
+	{
+		log_error(TOOL_NAME, "could not initialize secure RNG");
+		return -1;
+	}
+	net_init();
+	CNetBase::Init();
+
+	// the connection reads its timeouts from the config, which is not
+	// loaded in this tool
+	g_Config.m_ConnTimeout = CConfig::ms_ConnTimeout;
+	g_Config.m_ConnTimeoutProtection = CConfig::ms_ConnTimeoutProtection;
+
+	NETADDR ServerAddr;
+	if(net_host_lookup(Options.m_pServer, &ServerAddr, NETTYPE_ALL))
+	{
+		log_error(TOOL_NAME, "host lookup of '%s' failed", Options.m_pServer);
+		return -1;
+	}
+	if(ServerAddr.port == 0)
+		ServerAddr.port = 8303;
+
+	CSnapshotDelta SnapshotDelta;
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	std::vector<std::unique_ptr<CLoadClient>> vpClients;
+	for(int i = 0; i < Options.m_NumClients; i++)
+	{
+		vpClients.push_back(std::make_unique<CLoadClient>(i));
+		if(!vpClients.back()->Open(ServerAddr, Options.m_ClientsPerAddress))
+		{
+			log_error(TOOL_NAME, "could not open socket for client %d", i);
+			return -1;
+		}
+	}
+
+	char aAddr[NETADDR_MAXSTRSIZE];
+	net_addr_str(&ServerAddr, aAddr, sizeof(aAddr), true);
+	log_info(TOOL_NAME, "connecting %d clients to %s for %d seconds", Options.m_NumClients, aAddr, Options.m_Duration);
+
+	// connect gradually, the server rate limits new connections
+	const int64_t ConnectInterval = time_freq() / 50;
+	const int64_t StartTime = time_get();
+	const int64_t EndTime = StartTime + Options.m_NumClients * ConnectInterval + Options.m_Duration * time_freq();
+	int NumConnected = 0;
+	while(time_get() < EndTime)
+	{
+		while(NumConnected < Options.m_NumClients && time_get() >= StartTime + NumConnected * ConnectInterval)
+			vpClients[NumConnected++]->Connect(ServerAddr);
+		for(int i = 0; i < NumConnected; i++)
+			vpClients[i]->Pump(SnapshotDelta, Options);
+
+		using namespace std::chrono_literals;
+		std::this_thread::sleep_for(200us);
+	}
+
+	PrintReport(vpClients);
+	for(auto &pClient : vpClients)
+		pClient->Close();
+	return 0;
+}
@@ -0,0 +1,190 @@
+// Replays the inputs of a teehistorian file through the character physics
+// on its map, to prove that changes to the physics are both faster and
+// give the same results. Reports the simulated ticks per second and
+// compares the state hash of every tick against a golden trace written by
+// an earlier run.
+
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/map.h>
+#include <engine/shared/datafile.h>
+#include <engine/shared/teehistorian_reader.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/physics_replay.h>
+
+#include <memory>
+
+static const char *TOOL_NAME = "physics_replay";
+
+class CReplayOptions
+{
+public:
+	const char *m_pMap = nullptr;
+	const char *m_pTeeHistorian = nullptr;
+	const char *m_pGolden = nullptr;
+	const char *m_pWriteGolden = nullptr;
+	int m_Repetitions = 1;
+};
+
+static bool ParseOptions(int argc, const char **argv, CReplayOptions &Options)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		const char *pValue;
+		if((pValue = str_startswith(argv[i], "--golden=")))
+			Options.m_pGolden = pValue;
+		else if((pValue = str_startswith(argv[i], "--write-golden=")))
+			Options.m_pWriteGolden = pValue;
+		else if((pValue = str_startswith(argv[i], "--repetitions=")))
+			Options.m_Repetitions = maximum(str_toint(pValue), 1);
+		else if(argv[i][0] != '-' && !Options.m_pMap)
+			Options.m_pMap = argv[i];
+		else if(argv[i][0] != '-' && !Options.m_pTeeHistorian)
+			Options.m_pTeeHistorian = argv[i];
+		else
+			return false;
+	}
+	return Options.m_pMap && Options.m_pTeeHistorian;
+}
+
+int main(int argc, const char **argv)
+{
+	const CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	CReplayOptions Options;
+	if(!ParseOptions(argc, argv, Options))
+	{
+		log_error(TOOL_NAME, "Usage: %s [--golden=<trace>] [--write-golden=<trace>] [--repetitions=<n>] <map> <teehistorian>", TOOL_NAME);
+		return -1;
+	}
+
+	std::unique_ptr<IStorage> pStorage = std::unique_ptr<IStorage>(CreateStorage(IStorage::EInitializationType::BASIC, argc, argv));
+	if(!pStorage)
+	{
+		log_error(TOOL_NAME, "Error creating basic storage");
+		return -1;
+	}
+
+	std::unique_ptr<IEngineMap> pMap = std::unique_ptr<IEngineMap>(CreateEngineMap());
+	CDataFileReader DataFile;
+	if(!DataFile.Open(pStorage.get(), Options.m_pMap, IStorage::TYPE_ABSOLUTE))
+	{
+		log_error(TOOL_NAME, "Failed to open map '%s'", Options.m_pMap);
+		return -1;
+	}
+	pMap->LoadPrepared(std::move(DataFile));
+	CLayers Layers;
+	Layers.Init(pMap.get(), true);
+	if(!Layers.GameLayer())
+	{
+		log_error(TOOL_NAME, "Map '%s' has no game layer", Options.m_pMap);
+		return -1;
+	}
+	CCollision Collision;
+	Collision.Init(&Layers);
+
+	IOHANDLE File = io_open(Options.m_pTeeHistorian, IOFLAG_READ);
+	CTeeHistorianReader Reader;
+	const bool Opened = File && Reader.Open(File);
+	if(File)
+		io_close(File);
+	if(!Opened)
+	{
+		log_error(TOOL_NAME, "Failed to open teehistorian '%s', compressed files have to be unpacked first", Options.m_pTeeHistorian);
+		return -1;
+	}
+
+	CPhysicsTrace Trace;
+	int64_t BestTime = -1;
+	int NumTicks = 0;
+	int64_t NumCharacterTicks = 0;
+	for(int Repetition = 0; Repetition < Options.m_Repetitions; Repetition++)
+	{
+		if(!Reader.Seek(nullptr, 0))
+		{
+			log_error(TOOL_NAME, "Failed to rewind the teehistorian");
+			return -1;
+		}
+		CPhysicsTrace RepetitionTrace;
+		auto pReplay = std::make_unique<CPhysicsReplay>(&Collision, &Reader);
+		int64_t Time = 0;
+		NumTicks = 0;
+		NumCharacterTicks = 0;
+		while(true)
+		{
+			// only the simulation is measured, not reading the stream or hashing
+			const int NumCharacters = pReplay->NumCharacters();
+			const int64_t Start = time_get();
+			const bool Ticked = pReplay->Tick();
+			Time += time_get() - Start;
+			if(!Ticked)
+				break;
+			RepetitionTrace.Add(pReplay->GameTick(), pReplay->StateHash());
+			NumTicks++;
+			NumCharacterTicks += NumCharacters;
+		}
+		if(Reader.Error())
+		{
+			log_error(TOOL_NAME, "Failed to read the teehistorian after tick %d", Reader.Tick());
+			return -1;
+		}
+		if(Repetition == 0)
+		{
+			Trace = RepetitionTrace;
+		}
+		else if(const int Mismatch = Trace.FirstMismatch(RepetitionTrace); Mismatch != -1)
+		{
+			log_error(TOOL_NAME, "Repetition %d differs from the first one at tick %d, the simulation is not deterministic", Repetition + 1, Mismatch);
+			return 1;
+		}
+		if(BestTime < 0 || Time < BestTime)
+			BestTime = Time;
+	}
+
+	const double Seconds = (double)maximum(BestTime, (int64_t)1) / time_freq();
+	log_info(TOOL_NAME, "replayed %d ticks with %lld character ticks, best of %d: %.0f ticks/s, %.0f character ticks/s, %.2f us per tick",
+		NumTicks, (long long)NumCharacterTicks, Options.m_Repetitions, NumTicks / Seconds, NumCharacterTicks / Seconds, NumTicks ? Seconds * 1000000.0 / NumTicks : 0.0);
+	if(!Reader.Finished())
+		log_warn(TOOL_NAME, "the teehistorian ends without a finish record");
+
+	int Result = 0;
+	if(Options.m_pGolden)
+	{
+		CPhysicsTrace Golden;
+		if(!Golden.Load(io_open(Options.m_pGolden, IOFLAG_READ)))
+		{
+			log_error(TOOL_NAME, "Failed to read golden trace '%s'", Options.m_pGolden);
+			return -1;
+		}
+		const int Mismatch = Trace.FirstMismatch(Golden);
+		if(Mismatch == -1)
+		{
+			log_info(TOOL_NAME, "all %d ticks match the golden trace", NumTicks);
+		}
+		else
+		{
+			log_error(TOOL_NAME, "the state differs from the golden trace at tick %d", Mismatch);
+			Result = 1;
+		}
+	}
+	if(Options.m_pWriteGolden)
+	{
+		IOHANDLE GoldenFile = io_open(Options.m_pWriteGolden, IOFLAG_WRITE);
+		const bool Saved = GoldenFile && Trace.Save(GoldenFile);
+		if(GoldenFile)
+			io_close(GoldenFile);
+		if(!Saved)
+		{
+			log_error(TOOL_NAME, "Failed to write golden trace '%s'", Options.m_pWriteGolden);
+			return -1;
+		}
+		log_info(TOOL_NAME, "wrote golden trace '%s'", Options.m_pWriteGolden);
+	}
+	return Result;
+}